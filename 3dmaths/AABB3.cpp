@@ -12,11 +12,17 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <type_traits>
 
 #include "AABB3.h"
 #include "Matrix4x3.h"
 #include "CommonStuff.h"
 
+// Boxes are plain data now that Vector3 is, so arrays of them may be
+// copied with memcpy
+
+static_assert(std::is_trivially_copyable<AABB3>::value, "AABB3 must be trivially copyable");
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // class AABB3 member functions
@@ -101,10 +107,10 @@ void	AABB3::add(const Vector3 &p) {
 
 	if (p.x < min.x) min.x = p.x;
 	if (p.x > max.x) max.x = p.x;
-	if (p.y < min.x) min.y = p.y;
-	if (p.y > max.x) max.y = p.y;
-	if (p.z < min.x) min.z = p.z;
-	if (p.z > max.x) max.z = p.z;
+	if (p.y < min.y) min.y = p.y;
+	if (p.y > max.y) max.y = p.y;
+	if (p.z < min.z) min.z = p.z;
+	if (p.z > max.z) max.z = p.z;
 }
 
 //---------------------------------------------------------------------------
@@ -117,11 +123,11 @@ void	AABB3::add(const AABB3 &box) {
 	// Expand the box as necessary.
 
 	if (box.min.x < min.x) min.x = box.min.x;
-	if (box.min.x > max.x) max.x = box.min.x;
-	if (box.min.y < min.x) min.y = box.min.y;
-	if (box.min.y > max.x) max.y = box.min.y;
-	if (box.min.z < min.x) min.z = box.min.z;
-	if (box.min.z > max.x) max.z = box.min.z;
+	if (box.max.x > max.x) max.x = box.max.x;
+	if (box.min.y < min.y) min.y = box.min.y;
+	if (box.max.y > max.y) max.y = box.max.y;
+	if (box.min.z < min.z) min.z = box.min.z;
+	if (box.max.z > max.z) max.z = box.max.z;
 }
 
 //---------------------------------------------------------------------------
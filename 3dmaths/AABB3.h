@@ -14,10 +14,11 @@
 #define __AABB3_H_INCLUDED__
 
 #ifndef __VECTOR3_H_INCLUDED__
-	#include "Vector3.h"
+	#include "vector3.h"
 #endif
 
-class Matrix4x3;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
 
 //---------------------------------------------------------------------------
 // class AABB3
@@ -0,0 +1,480 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AABB3Array.cpp - Implementation of class AABB3Array
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "AABB3Array.h"
+#include "Matrix4x3.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// With the box in center/extent form, the plane test is
+//
+//	c*n - d, against e*|n|
+//
+// where |n| is the normal with each component made positive.  That's the
+// same test as AABB3::classifyPlane(), which picks the corners nearest and
+// farthest along the normal, without any branches on the sign of the
+// normal, so a whole register of boxes goes through one plane at a time.
+// The answers agree with AABB3::classifyPlane() except for boxes within
+// rounding error of a plane.
+//
+// The padding past the end of each lane is kept at zero, so the kernels
+// can always work a whole register at a time, and just ignore the lanes
+// past the end.
+//
+// Frustum culling is mostly a matter of streaming through memory, so each
+// register of boxes goes through all six planes in one pass, and the
+// visible indices are written out without any branches, by always
+// writing the index and only advancing the output if it's visible.  When
+// every box in a register was culled by the same plane last time, that
+// plane is tried first by itself, and if it still culls them all, that's
+// the whole test.
+//
+// For threading, the boxes are split into fixed size ranges.  Each range
+// writes its visible indices starting at the same place in the output as
+// its first box, so the ranges can't overlap, and then the ranges are
+// slid down next to each other.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kBoxesPerRange = 16384;
+const int	kMinBoxesPerChunk = 16384;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// struct Frustum members
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// Frustum::setup
+//
+// Compute the planes in camera space, and then rotate them into world
+// space.  The side planes go through the camera.  A point at the left edge
+// of the screen has x*zoomX = -z, and so forth.
+
+void	Frustum::setup(const Matrix4x3 &cameraToWorld, float zoomX, float zoomY,
+	float nearClip, float farClip) {
+
+	Vector3	cameraN[kFrustumPlaneCount] = {
+		Vector3(zoomX, 0.0f, 1.0f),
+		Vector3(-zoomX, 0.0f, 1.0f),
+		Vector3(0.0f, zoomY, 1.0f),
+		Vector3(0.0f, -zoomY, 1.0f),
+		Vector3(0.0f, 0.0f, 1.0f),
+		Vector3(0.0f, 0.0f, -1.0f)
+	};
+	float	cameraD[kFrustumPlaneCount] = { 0.0f, 0.0f, 0.0f, 0.0f, nearClip, -farClip };
+
+	Vector3	pos = getTranslation(cameraToWorld);
+	for (int i = 0 ; i < kFrustumPlaneCount ; ++i) {
+		cameraN[i].normalize();
+		n[i] = cameraN[i] * cameraToWorld - pos;
+		d[i] = cameraD[i] + n[i] * pos;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AABB3Array members
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// AABB3Array::AABB3Array
+//
+// Constructors
+
+AABB3Array::AABB3Array() {
+	centerX = centerY = centerZ = NULL;
+	extentX = extentY = extentZ = NULL;
+	bCount = bAlloc = 0;
+}
+
+AABB3Array::AABB3Array(int n) {
+	centerX = centerY = centerZ = NULL;
+	extentX = extentY = extentZ = NULL;
+	bCount = bAlloc = 0;
+	resize(n);
+}
+
+AABB3Array::AABB3Array(const AABB3Array &a) {
+	centerX = centerY = centerZ = NULL;
+	extentX = extentY = extentZ = NULL;
+	bCount = bAlloc = 0;
+	*this = a;
+}
+
+//---------------------------------------------------------------------------
+// AABB3Array::~AABB3Array
+//
+// Destructor - make sure resources are freed
+
+AABB3Array::~AABB3Array() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// AABB3Array::operator=
+//
+// Make a copy of the array
+
+AABB3Array &AABB3Array::operator=(const AABB3Array &a) {
+
+	// Check for assignment to self
+
+	if (&a == this) {
+		return *this;
+	}
+
+	// Copy the lanes
+
+	resize(a.bCount);
+	memcpy(centerX, a.centerX, bCount * sizeof(float));
+	memcpy(centerY, a.centerY, bCount * sizeof(float));
+	memcpy(centerZ, a.centerZ, bCount * sizeof(float));
+	memcpy(extentX, a.extentX, bCount * sizeof(float));
+	memcpy(extentY, a.extentY, bCount * sizeof(float));
+	memcpy(extentZ, a.extentZ, bCount * sizeof(float));
+
+	// Return reference to l-value
+
+	return *this;
+}
+
+//---------------------------------------------------------------------------
+// AABB3Array::resize
+//
+// Set the number of boxes in the array.  The lanes are only reallocated
+// if they grow beyond the current capacity.
+
+void	AABB3Array::resize(int n) {
+	assert(n >= 0);
+
+	// Do we have room?
+
+	if (n > bAlloc) {
+
+		// Allocate all six lanes in one block
+
+		int	newAlloc = simdPadCount(n);
+		float	*block = (float *)alignedAlloc(newAlloc * 6 * sizeof(float));
+		assert(block != NULL);
+
+		// Copy over the old values
+
+		float	*lane[6] = { centerX, centerY, centerZ, extentX, extentY, extentZ };
+		if (bCount > 0) {
+			for (int k = 0 ; k < 6 ; ++k) {
+				memcpy(block + newAlloc*k, lane[k], bCount * sizeof(float));
+			}
+		}
+
+		// Install new lanes
+
+		alignedFree(centerX);
+		centerX = block;
+		centerY = block + newAlloc;
+		centerZ = block + newAlloc*2;
+		extentX = block + newAlloc*3;
+		extentY = block + newAlloc*4;
+		extentZ = block + newAlloc*5;
+		bAlloc = newAlloc;
+	}
+
+	// Zero the padding past the end
+
+	int	padCount = simdPadCount(n) - n;
+	if (padCount > 0) {
+		float	*lane[6] = { centerX, centerY, centerZ, extentX, extentY, extentZ };
+		for (int k = 0 ; k < 6 ; ++k) {
+			memset(lane[k] + n, 0, padCount * sizeof(float));
+		}
+	}
+
+	bCount = n;
+}
+
+//---------------------------------------------------------------------------
+// AABB3Array::freeMemory
+//
+// Free up any memory and reset object to default state
+
+void	AABB3Array::freeMemory() {
+	alignedFree(centerX);
+	centerX = centerY = centerZ = NULL;
+	extentX = extentY = extentZ = NULL;
+	bCount = bAlloc = 0;
+}
+
+//---------------------------------------------------------------------------
+// AABB3Array::get, AABB3Array::set
+//
+// Convert one box to and from min/max form
+
+AABB3	AABB3Array::get(int i) const {
+	assert(i >= 0 && i < bCount);
+	AABB3	box;
+	Vector3	c(centerX[i], centerY[i], centerZ[i]);
+	Vector3	e(extentX[i], extentY[i], extentZ[i]);
+	box.min = c - e;
+	box.max = c + e;
+	return box;
+}
+
+void	AABB3Array::set(int i, const AABB3 &box) {
+	assert(i >= 0 && i < bCount);
+	centerX[i] = (box.min.x + box.max.x) * .5f;
+	centerY[i] = (box.min.y + box.max.y) * .5f;
+	centerZ[i] = (box.min.z + box.max.z) * .5f;
+	extentX[i] = (box.max.x - box.min.x) * .5f;
+	extentY[i] = (box.max.y - box.min.y) * .5f;
+	extentZ[i] = (box.max.z - box.min.z) * .5f;
+}
+
+//---------------------------------------------------------------------------
+// AABB3Array::gather
+//
+// Load the array from n boxes in min/max form
+
+void	AABB3Array::gather(const AABB3 *src, int n) {
+	resize(n);
+	for (int i = 0 ; i < n ; ++i) {
+		set(i, src[i]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch kernels
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// SimdPlane
+//
+// A plane with each value in every lane, and the absolute value of the
+// normal for the extent
+
+struct SimdPlane {
+	SimdFloat	nx, ny, nz;
+	SimdFloat	ax, ay, az;
+	SimdFloat	d;
+
+	void	set(const Vector3 &n, float planeD) {
+		nx = simdSet1(n.x);
+		ny = simdSet1(n.y);
+		nz = simdSet1(n.z);
+		ax = simdSet1(fabsf(n.x));
+		ay = simdSet1(fabsf(n.y));
+		az = simdSet1(fabsf(n.z));
+		d = simdSet1(planeD);
+	}
+};
+
+//---------------------------------------------------------------------------
+// BoxBlock
+//
+// One register's worth of boxes
+
+struct BoxBlock {
+	SimdFloat	cx, cy, cz;
+	SimdFloat	ex, ey, ez;
+
+	void	load(const AABB3Array &box, int i) {
+		cx = simdLoad(box.centerX + i);
+		cy = simdLoad(box.centerY + i);
+		cz = simdLoad(box.centerZ + i);
+		ex = simdLoad(box.extentX + i);
+		ey = simdLoad(box.extentY + i);
+		ez = simdLoad(box.extentZ + i);
+	}
+
+	// Distance from the center to the plane, and the extent along the
+	// normal
+
+	SimdFloat	distance(const SimdPlane &p) const {
+		return cx*p.nx + cy*p.ny + cz*p.nz - p.d;
+	}
+	SimdFloat	radius(const SimdPlane &p) const {
+		return ex*p.ax + ey*p.ay + ez*p.az;
+	}
+
+	// Bit mask of the boxes completely on the back side of the plane
+
+	int	backMask(const SimdPlane &p) const {
+		return simdMoveMask(distance(p) + radius(p) <= simdZero());
+	}
+};
+
+//---------------------------------------------------------------------------
+// classifyPlane
+//
+// See the notes at the top of the file
+
+struct ClassifyJob {
+	signed char		*result;
+	const AABB3Array	*box;
+	SimdPlane		plane;
+};
+
+static void	classifyRange(int begin, int end, void *context) {
+	const ClassifyJob *job = (const ClassifyJob *)context;
+	SimdFloat	zero = simdZero();
+	for (int i = begin * kSimdWidth ; i < end * kSimdWidth ; i += kSimdWidth) {
+		BoxBlock	b;
+		b.load(*job->box, i);
+		SimdFloat	dist = b.distance(job->plane);
+		SimdFloat	r = b.radius(job->plane);
+		int	front = simdMoveMask(dist - r >= zero);
+		int	back = simdMoveMask(dist + r <= zero);
+		int	n = std::min(kSimdWidth, job->box->count() - i);
+		for (int j = 0 ; j < n ; ++j) {
+			job->result[i + j] = (signed char)(((front >> j) & 1) - ((back >> j) & 1));
+		}
+	}
+}
+
+void	classifyPlane(signed char *result, const AABB3Array &box, const Vector3 &n, float d) {
+	ClassifyJob	job;
+	job.result = result;
+	job.box = &box;
+	job.plane.set(n, d);
+	int	blockCount = (box.count() + kSimdWidth - 1) / kSimdWidth;
+	parallelFor(blockCount, kMinBoxesPerChunk / kSimdWidth, &classifyRange, &job);
+}
+
+//---------------------------------------------------------------------------
+// cullFrustum
+//
+// See the notes at the top of the file
+
+struct CullJob {
+	int			*visible;
+	int			*rangeCount;
+	const AABB3Array	*box;
+	unsigned char		*lastPlane;
+	SimdPlane		plane[kFrustumPlaneCount];
+};
+
+//---------------------------------------------------------------------------
+// samePlane
+//
+// The plane that culled all of a register of boxes last time, or -1 if
+// they weren't all culled by the same plane.  Lanes past the end don't
+// count.
+
+static inline int	samePlane(const unsigned char *lastPlane, int n) {
+	int	p = lastPlane[0];
+	for (int j = 1 ; j < n ; ++j) {
+		if (lastPlane[j] != p) {
+			return -1;
+		}
+	}
+	return p;
+}
+
+static void	cullRange(int beginRange, int endRange, void *context) {
+	const CullJob *job = (const CullJob *)context;
+	int	count = job->box->count();
+	for (int range = beginRange ; range < endRange ; ++range) {
+		int	begin = range * kBoxesPerRange;
+		int	end = std::min(begin + kBoxesPerRange, count);
+		int	*out = job->visible + begin;
+		int	visibleCount = 0;
+		for (int i = begin ; i < end ; i += kSimdWidth) {
+			int	n = std::min(kSimdWidth, end - i);
+			int	lanes = (1 << n) - 1;
+			BoxBlock	b;
+			b.load(*job->box, i);
+
+			// Try the plane that culled them all last time
+
+			int	first = 0;
+			if (job->lastPlane != NULL) {
+				int	p = samePlane(job->lastPlane + i, n);
+				if (p >= 0) {
+					if ((b.backMask(job->plane[p]) & lanes) == lanes) {
+						continue;
+					}
+					first = p;
+				}
+			}
+
+			// Go through all the planes, starting with that one,
+			// and remember which culls each box
+
+			int	culled = 0;
+			for (int k = 0 ; k < kFrustumPlaneCount && culled != lanes ; ++k) {
+				int	p = (first + k) % kFrustumPlaneCount;
+				int	newlyCulled = b.backMask(job->plane[p]) & lanes & ~culled;
+				if (newlyCulled == 0) {
+					continue;
+				}
+				culled |= newlyCulled;
+				if (job->lastPlane != NULL) {
+					for (int j = 0 ; j < n ; ++j) {
+						if (newlyCulled & (1 << j)) {
+							job->lastPlane[i + j] = (unsigned char)p;
+						}
+					}
+				}
+			}
+
+			// Write out the visible ones.  The output never gets
+			// ahead of the input, so it's always safe to write.
+
+			int	shown = ~culled & lanes;
+			for (int j = 0 ; j < n ; ++j) {
+				out[visibleCount] = i + j;
+				visibleCount += (shown >> j) & 1;
+			}
+		}
+		job->rangeCount[range] = visibleCount;
+	}
+}
+
+int	cullFrustum(int *visible, const AABB3Array &box, const Frustum &frustum,
+	unsigned char *lastPlane) {
+
+	int	rangeTotal = (box.count() + kBoxesPerRange - 1) / kBoxesPerRange;
+	std::vector<int>	rangeCount(rangeTotal);
+
+	CullJob	job;
+	job.visible = visible;
+	job.rangeCount = rangeTotal > 0 ? &rangeCount[0] : NULL;
+	job.box = &box;
+	job.lastPlane = lastPlane;
+	for (int i = 0 ; i < kFrustumPlaneCount ; ++i) {
+		job.plane[i].set(frustum.n[i], frustum.d[i]);
+	}
+	parallelFor(rangeTotal, kMinBoxesPerChunk / kBoxesPerRange, &cullRange, &job);
+
+	// Slide the ranges down next to each other
+
+	int	total = 0;
+	for (int range = 0 ; range < rangeTotal ; ++range) {
+		if (range > 0) {
+			memmove(visible + total, visible + range * kBoxesPerRange, rangeCount[range] * sizeof(int));
+		}
+		total += rangeCount[range];
+	}
+	return total;
+}
@@ -0,0 +1,136 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AABB3Array.h - Declarations for class AABB3Array
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see AABB3Array.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __AABB3ARRAY_H_INCLUDED__
+#define __AABB3ARRAY_H_INCLUDED__
+
+#ifndef __AABB3_H_INCLUDED__
+	#include "AABB3.h"
+#endif
+
+//---------------------------------------------------------------------------
+// struct Frustum
+//
+// The six planes of a view frustum, in the same order as the outcode bits:
+// left, right, bottom, top, near, far.  The normals point in, so a point
+// p is inside a plane if p*n >= d, the same convention as
+// AABB3::classifyPlane().
+
+const int	kFrustumPlaneCount = 6;
+
+struct Frustum {
+	Vector3	n[kFrustumPlaneCount];
+	float	d[kFrustumPlaneCount];
+
+	// Set up the planes for a camera, given the camera->world matrix,
+	// the zoom on each axis, and the clip plane distances.  The camera
+	// looks down +z, with +x right and +y up, as in the Renderer.
+
+	void	setup(const Matrix4x3 &cameraToWorld, float zoomX, float zoomY,
+			float nearClip, float farClip);
+};
+
+//---------------------------------------------------------------------------
+// class AABB3Array
+//
+// A list of boxes stored as a "structure of arrays," like Vector3Array.
+// Each box is kept as its center and its extent (half the size) on each
+// axis, in six separate lanes, which is the form the plane tests want:
+// the distance from the center to the plane, against the extent projected
+// onto the normal.
+//
+// Each lane is aligned and padded to a multiple of kSimdMaxWidth floats.
+
+class AABB3Array {
+public:
+
+// Public data
+
+	// The lanes.  Left public so that other batch kernels may stream
+	// over them directly
+
+	float	*centerX;
+	float	*centerY;
+	float	*centerZ;
+	float	*extentX;
+	float	*extentY;
+	float	*extentZ;
+
+// Standard class object maintenance
+
+	AABB3Array();
+	explicit AABB3Array(int n);
+	AABB3Array(const AABB3Array &a);
+	~AABB3Array();
+
+	AABB3Array &operator=(const AABB3Array &a);
+
+// Size
+
+	int	count() const { return bCount; }
+
+	// Set the number of boxes.  Existing values are preserved,
+	// new entries are uninitialized
+
+	void	resize(int n);
+
+	// Free all memory and reset to empty
+
+	void	freeMemory();
+
+// Element access.  Handy, but slow - don't use this in inner loops
+
+	AABB3	get(int i) const;
+	void	set(int i, const AABB3 &box);
+
+// Conversion from an array of AABB3, resizing to n
+
+	void	gather(const AABB3 *src, int n);
+
+// Private representation
+
+private:
+	int	bCount;
+	int	bAlloc;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch kernels.  Large arrays are split across the worker threads.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// The array version of AABB3::classifyPlane().  result[i] is -1 if box i
+// is completely on the back side of the plane, +1 if it's completely on
+// the front side, and 0 if it straddles the plane.  result must have room
+// for box.count() values.
+
+void	classifyPlane(signed char *result, const AABB3Array &box, const Vector3 &n, float d);
+
+// Frustum culling.  Writes the indices of the boxes that are at least
+// partly inside the frustum to visible, in increasing order, and returns
+// how many there are.  A box is culled if it's completely on the back side
+// of any plane.  visible must have room for box.count() values.
+//
+// lastPlane is optional.  If given, it has one entry per box, which is
+// the plane that culled that box last time.  That plane is tried first,
+// and updated when a different plane culls the box.  Things that were
+// off to the left last frame are usually still off to the left, so with
+// this most of the culled boxes only need one plane test.  Start it out
+// at all zeros, and keep one per frustum, since the planes that cull a box
+// in the main view have nothing to do with a shadow view.
+
+int	cullFrustum(int *visible, const AABB3Array &box, const Frustum &frustum,
+		unsigned char *lastPlane = 0);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __AABB3ARRAY_H_INCLUDED__
@@ -0,0 +1,2258 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AABBTree.cpp - Bounding volume hierarchy of axially aligned boxes
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "AABBTree.h"
+#include "Matrix4x3.h"
+#include "Parallel.h"
+#include "Renderer.h"
+#include "Simd.h"
+#include "TriMesh.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The tree is built top down.  At each node we look for the split of its
+// boxes into two groups that minimizes the surface area heuristic,
+//
+//	cost = kNodeCost + kBoxCost * (A(L) * N(L) + A(R) * N(R)) / A(P)
+//
+// where A() is the surface area of the box around a group and N() is the
+// number of boxes in it.  The area of a box is proportional to the chance
+// that a random ray passing through the parent also passes through it,
+// so this is the expected cost of a ray through the node.  The node is
+// made a leaf instead if that's cheaper, and it's small enough.
+//
+// The splits considered are the "sweeps" along each axis: sort the boxes
+// by the center along the axis, and try every split point in that order.
+// The boxes are sorted on all three axes once, up front, and each node
+// keeps its share of each sorted list in order as the lists are
+// partitioned, so nothing is sorted again.  This finds the best split of
+// its kind for every node, which makes for the best trees, at a cost of
+// O(n log n) per level.
+//
+// The binned builder is for when build time matters more.  Instead of
+// trying every split, the centers are dropped into kBinCount bins along
+// each axis, and only the splits between bins are tried.  That's one pass
+// over the boxes per node, with no sorting.  The bins for a node are laid
+// out over the box around the centers of its boxes, which we get for free
+// while partitioning the parent.  The centers are also kept in separate
+// lists for each axis, alongside the boxes, so the bins can be worked out
+// kSimdWidth boxes at a time.
+//
+// Most of the nodes are small, though, and binning them is a poor deal:
+// clearing and scanning bins for a few dozen boxes costs more than the
+// boxes themselves.  So smaller nodes get fewer bins, and once a node is
+// down to kMaxSweepBoxes boxes, its subtree is built with full sweeps
+// like the other builder, after sorting that handful of boxes once.  That
+// is cheaper than binning them level after level, and makes better trees
+// at the bottom, where most of the nodes are.
+//
+// Near the top of the tree there are only a few nodes, each with lots of
+// boxes, so the binning and partitioning of each node are spread across
+// the worker threads a block of boxes at a time.  Once a node has fewer
+// than kMinBoxesPerTask boxes, its whole subtree becomes one task, and
+// the tasks are handed out to the threads, biggest first.  Nodes are
+// allocated in pairs from the node array, which is already big enough
+// for any tree, by bumping an atomic counter.
+//
+// Refitting keeps the tree's shape and recomputes every node box from the
+// boxes below it.  Each subtree is independent, so a big tree is cut into
+// kRefitTaskCount subtrees near the top, which are refit across the
+// worker threads, and then the few nodes above them are done last.
+//
+// Incremental inserts follow Catto's dynamic tree in Box2D: walk down
+// from the root toward the child that's cheapest to add the box to,
+// counting the growth of every node on the way, and stop where making a
+// new parent for the node and the new box is cheaper than going further.
+// The node moves down into a new pair of children, next to the new leaf,
+// and its old place becomes their parent, so nothing else moves.  On the
+// way back up, each node tries swapping one child with a grandchild on
+// the other side, and does it if that shrinks the node in between.
+// (Kopta et al., "Fast, Effective BVH Updates for Animated Scenes.")
+//
+// The SAH cost is kept up to date, times the area of the root, by adding
+// and subtracting the cost of each node as it changes.
+//
+// Nodes are 32 bytes and allocated aligned, so each is half a cache line.
+// The children of a node are adjacent, so both are fetched together.  The
+// leaf boxes are copied into one array, in leaf order, so the boxes in a
+// leaf are adjacent too.
+//
+// The ray queries test the nodes with the "slab" test, using the
+// reciprocal of the ray direction, which is cheaper than
+// AABB3::rayIntersect() and gives the entry distance of both children so
+// we can visit the nearer first.  The far end of the slab interval is
+// pushed out by a hair, so that rounding can never cull a box that
+// AABB3::rayIntersect() would hit.  (Ize, "Robust BVH Ray Traversal.")
+// The boxes themselves are tested with AABB3::rayIntersect(), so we get
+// exactly the same answers as testing every box.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const float	kNodeCost = 1.0f;
+const float	kBoxCost = 1.0f;
+const int	kMaxLeafSize = 4;
+const int	kMaxTreeDepth = kAABBTreeMaxDepth;
+const float	kSlabSlack = 1.0f + 4.0f * FLT_EPSILON;
+const int	kMinRaysPerChunk = 256;
+const int	kBinCount = 32;
+const int	kMinBinCount = 8;
+const int	kBinChunk = 64;
+const int	kMaxSweepBoxes = 32;
+const int	kMinBoxesPerTask = 4096;
+const int	kBoxesPerBlock = 8192;
+const int	kMinTrianglesPerChunk = 8192;
+const int	kMinBoxesPerRefitTask = 4096;
+const int	kRefitTaskCount = 64;
+const int	kMinSlotsPerChunk = 4096;
+const float	kDefaultRebuildThreshold = 1.3f;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// halfArea
+//
+// Half the surface area of a box, which is all the SAH needs
+
+static inline float	halfArea(const AABB3 &box) {
+	Vector3	s = box.size();
+	return s.x*s.y + s.y*s.z + s.z*s.x;
+}
+
+//---------------------------------------------------------------------------
+// emptyBox, growBox
+//
+// Same as AABB3::empty() and AABB3::add(), but inline, for the inner
+// loops of the binned builder
+
+static inline void	emptyBox(AABB3 &box) {
+	box.min = Vector3(FLT_MAX, FLT_MAX, FLT_MAX);
+	box.max = Vector3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+}
+
+static inline void	growBox(AABB3 &box, const Vector3 &min, const Vector3 &max) {
+	box.min.x = std::min(box.min.x, min.x);
+	box.min.y = std::min(box.min.y, min.y);
+	box.min.z = std::min(box.min.z, min.z);
+	box.max.x = std::max(box.max.x, max.x);
+	box.max.y = std::max(box.max.y, max.y);
+	box.max.z = std::max(box.max.z, max.z);
+}
+
+static inline void	growBox(AABB3 &box, const AABB3 &b) {
+	growBox(box, b.min, b.max);
+}
+
+//---------------------------------------------------------------------------
+// SweepBuilder
+//
+// State for building a tree with full sweep SAH.  order[axis] holds the
+// box indices sorted by center along that axis.  Any range [begin, end)
+// of a node holds the same boxes in all three lists.
+
+struct SweepBuilder {
+	const AABB3		*box;
+	std::vector<int>	order[3];
+	std::vector<int>	scratch;
+	std::vector<float>	rightArea;
+	std::vector<unsigned char>	goesLeft;
+	AABBTreeNode		*node;
+	int			nodeCount;
+	int			depth;
+
+	void	buildNode(int n, int begin, int end, int level);
+};
+
+//---------------------------------------------------------------------------
+// CenterLess
+//
+// Sort order for one axis of the sweeps.  Ties are broken by index, so
+// the tree doesn't depend on the sort implementation.
+
+struct CenterLess {
+	const float	*center;
+
+	bool	operator()(int a, int b) const {
+		return (center[a] < center[b]) || (center[a] == center[b] && a < b);
+	}
+};
+
+//---------------------------------------------------------------------------
+// SweepBuilder::buildNode
+//
+// Fill in node n for the boxes in [begin, end), and recursively build
+// its children
+
+void	SweepBuilder::buildNode(int n, int begin, int end, int level) {
+	AABBTreeNode	&nd = node[n];
+	int		count = end - begin;
+
+	AABB3	bounds;
+	bounds.empty();
+	for (int i = begin ; i < end ; ++i) {
+		bounds.add(box[order[0][i]]);
+	}
+	nd.min = bounds.min;
+	nd.max = bounds.max;
+	if (level > depth) {
+		depth = level;
+	}
+
+	// A single box is always a leaf.  So is anything at the depth
+	// limit, which only a pathological set of boxes will reach.
+
+	if (count == 1 || level >= kMaxTreeDepth) {
+		nd.child = begin;
+		nd.count = count;
+		return;
+	}
+
+	// Sweep each axis.  Right to left first, to get the area of
+	// everything to the right of each split, then left to right,
+	// evaluating the split.
+
+	float	bestCost = FLT_MAX;
+	int	bestAxis = 0;
+	int	bestSplit = begin + count / 2;
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		const int	*o = &order[axis][0];
+		AABB3	acc;
+		acc.empty();
+		for (int i = end - 1 ; i > begin ; --i) {
+			acc.add(box[o[i]]);
+			rightArea[i] = halfArea(acc);
+		}
+		acc.empty();
+		for (int i = begin ; i < end - 1 ; ++i) {
+			acc.add(box[o[i]]);
+			float	cost = halfArea(acc) * (float)(i - begin + 1) + rightArea[i + 1] * (float)(end - i - 1);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i + 1;
+			}
+		}
+	}
+
+	// Would we be better off not splitting at all?  Both costs
+	// are multiplied through by the area of the parent.
+
+	float	parentArea = halfArea(bounds);
+	float	splitCost = kNodeCost * parentArea + kBoxCost * bestCost;
+	float	leafCost = kBoxCost * parentArea * (float)count;
+	if (count <= kMaxLeafSize && leafCost <= splitCost) {
+		nd.child = begin;
+		nd.count = count;
+		return;
+	}
+
+	// Split the other two lists the same way, keeping them sorted
+
+	const int	*o = &order[bestAxis][0];
+	for (int i = begin ; i < end ; ++i) {
+		goesLeft[o[i]] = (i < bestSplit) ? 1 : 0;
+	}
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		if (axis == bestAxis) {
+			continue;
+		}
+		int	*p = &order[axis][0];
+		int	left = begin, right = 0;
+		for (int i = begin ; i < end ; ++i) {
+			if (goesLeft[p[i]]) {
+				p[left++] = p[i];
+			} else {
+				scratch[right++] = p[i];
+			}
+		}
+		assert(left == bestSplit);
+		for (int i = 0 ; i < right ; ++i) {
+			p[left + i] = scratch[i];
+		}
+	}
+
+	// Make the children
+
+	int	c = nodeCount;
+	nodeCount += 2;
+	nd.child = c;
+	nd.count = 0;
+	buildNode(c, begin, bestSplit, level + 1);
+	buildNode(c + 1, bestSplit, end, level + 1);
+}
+
+//---------------------------------------------------------------------------
+// BinSet
+//
+// The boxes of a node dropped into bins along each axis, by center.  For
+// each bin we keep the box around its boxes, and how many there are.
+// (The "centers" are min + max, twice the real center, which is just as
+// good and saves a multiply.)  Only the first binCount of the kBinCount
+// bins are used.  The boxes around the children's centers are found
+// while partitioning, which looks at each box once instead of once per
+// axis.
+
+struct BinSet {
+	AABB3	bounds[3][kBinCount];
+	int	count[3][kBinCount];
+	int	binCount;
+
+	void	clear(int n) {
+		binCount = n;
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			for (int i = 0 ; i < n ; ++i) {
+				emptyBox(bounds[axis][i]);
+				count[axis][i] = 0;
+			}
+		}
+	}
+
+	void	merge(const BinSet &b) {
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			for (int i = 0 ; i < binCount ; ++i) {
+				growBox(bounds[axis][i], b.bounds[axis][i]);
+				count[axis][i] += b.count[axis][i];
+			}
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// BinMapping
+//
+// Which bin a center falls in, along each axis.  An axis with no extent
+// puts everything in bin 0, and can't be split.  Smaller nodes use fewer
+// bins, about one per four boxes, since trying 31 splits of a few dozen
+// boxes is mostly wasted work, and most of the nodes are small.
+
+struct BinMapping {
+	float	origin[3];
+	float	scale[3];
+	int	binCount;
+
+	BinMapping(const AABB3 &centers, int boxCount) {
+		binCount = std::max(kMinBinCount, std::min(kBinCount, boxCount / 4));
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			float	lo = (&centers.min.x)[axis];
+			float	extent = (&centers.max.x)[axis] - lo;
+			origin[axis] = lo;
+			scale[axis] = (extent > 0.0f) ? (float)binCount * (1.0f - 1e-5f) / extent : 0.0f;
+		}
+	}
+
+	int	bin(float c, int axis) const {
+		int	b = (int)((c - origin[axis]) * scale[axis]);
+		return (b < binCount - 1) ? b : binCount - 1;
+	}
+
+	// The bins of n centers along one axis, kSimdWidth at a time.  This
+	// must agree exactly with bin(), since the partition uses that, so
+	// it's the same subtract and multiply, and the centers are never
+	// below the origin, so the floor is the same as truncating.
+
+	void	bins(const float *c, int n, int axis, int *b) const {
+		SimdFloat	o = simdSet1(origin[axis]);
+		SimdFloat	k = simdSet1(scale[axis]);
+		SimdFloat	last = simdSet1((float)(binCount - 1));
+		int		i = 0;
+		for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+			simdStoreInt(b + i, simdMin(simdFloor((simdLoadU(c + i) - o) * k), last));
+		}
+		for ( ; i < n ; ++i) {
+			b[i] = bin(c[i], axis);
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// BinnedTask
+//
+// A node to fill in, with its range of the box list and the boxes
+// around its boxes and their centers
+
+struct BinnedTask {
+	int	node;
+	int	begin;
+	int	end;
+	int	level;
+	AABB3	bounds;
+	AABB3	centers;
+
+	int	count() const { return end - begin; }
+	bool	operator<(const BinnedTask &t) const { return count() > t.count(); }
+};
+
+//---------------------------------------------------------------------------
+// BinnedBuilder
+//
+// State for building a tree with binned SAH.  ref is the list of boxes
+// being partitioned, and the leaves refer to ranges of it.  The boxes
+// themselves are moved around, not their indices, so each pass over a
+// node reads memory in order.  center[] has the centers of the boxes in
+// ref on each axis, in separate lists which are moved along with it, so
+// the bins can be found several boxes at a time.
+
+struct BuildRef {
+	Vector3	min;
+	int	index;
+	Vector3	max;
+	int	pad;
+
+	Vector3	center() const { return min + max; }
+};
+
+//---------------------------------------------------------------------------
+// SmallSweep
+//
+// State for sweeping a small subtree.  The lists hold indices from the
+// start of the subtree's range.
+
+struct SmallSweep {
+	int		base;
+	unsigned char	order[3][kMaxSweepBoxes];
+	unsigned char	goesLeft[kMaxSweepBoxes];
+	unsigned char	right[kMaxSweepBoxes];
+	float		rightArea[kMaxSweepBoxes];
+};
+
+struct BinnedBuilder {
+	BuildRef		*ref;
+	BuildRef		*scratch;
+	float			*center[3];
+	float			*scratchCenter[3];
+	AABBTreeNode		*node;
+	std::atomic<int>	nodeCount;
+	std::atomic<int>	depth;
+
+	int	allocatePair() { return nodeCount.fetch_add(2); }
+
+	void	noteDepth(int level) {
+		int	d = depth.load();
+		while (level > d && !depth.compare_exchange_weak(d, level)) {
+		}
+	}
+
+	void	binRange(int begin, int end, const BinMapping &map, BinSet &bins) const;
+	void	binParallel(const BinnedTask &task, const BinMapping &map, BinSet &bins);
+	int	partitionParallel(const BinnedTask &task, const BinMapping &map, int axis, int split,
+			AABB3 centers[2]);
+	bool	splitNode(const BinnedTask &task, BinnedTask child[2], BinSet &bins, bool inParallel);
+	void	sweepNode(SmallSweep &s, int n, int begin, int end, int level, const AABB3 &bounds);
+	void	sweepSubtree(const BinnedTask &task);
+	void	buildSubtree(const BinnedTask &task);
+};
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::binRange
+//
+// Add the boxes in [begin, end) of the box list to the bins.  The bins
+// are found from the center lists kBinChunk boxes at a time, then the
+// boxes are added.
+
+void	BinnedBuilder::binRange(int begin, int end, const BinMapping &map, BinSet &bins) const {
+	int	binIndex[3][kBinChunk];
+	for (int chunk = begin ; chunk < end ; chunk += kBinChunk) {
+		int	n = std::min(kBinChunk, end - chunk);
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			map.bins(center[axis] + chunk, n, axis, binIndex[axis]);
+		}
+		for (int i = 0 ; i < n ; ++i) {
+			const BuildRef	&r = ref[chunk + i];
+			for (int axis = 0 ; axis < 3 ; ++axis) {
+				int	b = binIndex[axis][i];
+				growBox(bins.bounds[axis][b], r.min, r.max);
+				++bins.count[axis][b];
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// BlockJob
+//
+// Parameters for working on a big node a block of boxes at a time, passed
+// to parallelFor.  Block i is [begin + i*kBoxesPerBlock, ...)
+
+struct BlockJob {
+	BinnedBuilder		*builder;
+	const BinnedTask	*task;
+	const BinMapping	*map;
+	BinSet			*blockBins;
+	int			axis;
+	int			split;
+	int			*leftCount;
+	int			*leftStart;
+	int			*rightStart;
+	AABB3			*blockCenters;
+
+	int	blockBegin(int i) const { return task->begin + i * kBoxesPerBlock; }
+	int	blockEnd(int i) const { return std::min(task->end, blockBegin(i) + kBoxesPerBlock); }
+	bool	goesLeft(int j) const { return map->bin(builder->center[axis][j], axis) < split; }
+};
+
+//---------------------------------------------------------------------------
+// binBlocks, countBlocks, scatterBlocks, copyBlocks
+//
+// The steps of binning and partitioning a big node, over blocks
+// [begin, end) of a job
+
+static void	binBlocks(int begin, int end, void *context) {
+	const BlockJob *job = (const BlockJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->blockBins[i].clear(job->map->binCount);
+		job->builder->binRange(job->blockBegin(i), job->blockEnd(i), *job->map, job->blockBins[i]);
+	}
+}
+
+static void	countBlocks(int begin, int end, void *context) {
+	const BlockJob *job = (const BlockJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		int	n = 0;
+		for (int j = job->blockBegin(i) ; j < job->blockEnd(i) ; ++j) {
+			n += job->goesLeft(j) ? 1 : 0;
+		}
+		job->leftCount[i] = n;
+	}
+}
+
+static void	scatterBlocks(int begin, int end, void *context) {
+	const BlockJob *job = (const BlockJob *)context;
+	const BinnedBuilder	*b = job->builder;
+	for (int i = begin ; i < end ; ++i) {
+		int	left = job->leftStart[i], right = job->rightStart[i];
+		AABB3	*centers = job->blockCenters + i * 2;
+		emptyBox(centers[0]);
+		emptyBox(centers[1]);
+		for (int j = job->blockBegin(i) ; j < job->blockEnd(i) ; ++j) {
+			Vector3	c(b->center[0][j], b->center[1][j], b->center[2][j]);
+			int	side = job->goesLeft(j) ? 0 : 1;
+			int	k = side ? right++ : left++;
+			growBox(centers[side], c, c);
+			b->scratch[k] = b->ref[j];
+			for (int axis = 0 ; axis < 3 ; ++axis) {
+				b->scratchCenter[axis][k] = (&c.x)[axis];
+			}
+		}
+	}
+}
+
+static void	copyBlocks(int begin, int end, void *context) {
+	const BlockJob *job = (const BlockJob *)context;
+	const BinnedBuilder	*b = job->builder;
+	for (int i = begin ; i < end ; ++i) {
+		for (int j = job->blockBegin(i) ; j < job->blockEnd(i) ; ++j) {
+			b->ref[j] = b->scratch[j];
+			for (int axis = 0 ; axis < 3 ; ++axis) {
+				b->center[axis][j] = b->scratchCenter[axis][j];
+			}
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::binParallel
+//
+// Bin a big node, each block into its own bins, then merge them
+
+void	BinnedBuilder::binParallel(const BinnedTask &task, const BinMapping &map, BinSet &bins) {
+	int	blockCount = (task.count() + kBoxesPerBlock - 1) / kBoxesPerBlock;
+	std::vector<BinSet>	blockBins(blockCount);
+	BlockJob	job = { this, &task, &map, &blockBins[0], 0, 0, NULL, NULL, NULL, NULL };
+	parallelFor(blockCount, 1, &binBlocks, &job);
+	bins = blockBins[0];
+	for (int i = 1 ; i < blockCount ; ++i) {
+		bins.merge(blockBins[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::partitionParallel
+//
+// Partition a big node.  Count how many boxes of each block go left,
+// then each block knows where to put its boxes in the scratch list.
+// Returns the index of the first box on the right, and the boxes around
+// the centers on each side in centers[].
+
+int	BinnedBuilder::partitionParallel(const BinnedTask &task, const BinMapping &map, int axis, int split,
+	AABB3 centers[2]) {
+	int	blockCount = (task.count() + kBoxesPerBlock - 1) / kBoxesPerBlock;
+	std::vector<int>	leftCount(blockCount), leftStart(blockCount), rightStart(blockCount);
+	std::vector<AABB3>	blockCenters(blockCount * 2);
+	BlockJob	job = { this, &task, &map, NULL, axis, split, &leftCount[0], &leftStart[0], &rightStart[0],
+		&blockCenters[0] };
+	parallelFor(blockCount, 1, &countBlocks, &job);
+
+	int	totalLeft = 0;
+	for (int i = 0 ; i < blockCount ; ++i) {
+		totalLeft += leftCount[i];
+	}
+	int	left = task.begin, right = task.begin + totalLeft;
+	for (int i = 0 ; i < blockCount ; ++i) {
+		leftStart[i] = left;
+		rightStart[i] = right;
+		left += leftCount[i];
+		right += job.blockEnd(i) - job.blockBegin(i) - leftCount[i];
+	}
+	parallelFor(blockCount, 1, &scatterBlocks, &job);
+	parallelFor(blockCount, 1, &copyBlocks, &job);
+	for (int i = 0 ; i < blockCount ; ++i) {
+		growBox(centers[0], blockCenters[i * 2]);
+		growBox(centers[1], blockCenters[i * 2 + 1]);
+	}
+	return task.begin + totalLeft;
+}
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::splitNode
+//
+// Fill in a node.  If it's worth splitting, partition its boxes, allocate
+// its children and return true, with the children's tasks in child[].
+
+bool	BinnedBuilder::splitNode(const BinnedTask &task, BinnedTask child[2], BinSet &bins, bool inParallel) {
+	AABBTreeNode	&nd = node[task.node];
+	int		count = task.count();
+	nd.min = task.bounds.min;
+	nd.max = task.bounds.max;
+	nd.child = task.begin;
+	nd.count = count;
+	noteDepth(task.level);
+
+	if (count == 1 || task.level >= kMaxTreeDepth) {
+		return false;
+	}
+
+	// Bin the boxes
+
+	BinMapping	map(task.centers, count);
+	int		binCount = map.binCount;
+	if (inParallel) {
+		binParallel(task, map, bins);
+	} else {
+		bins.clear(binCount);
+		binRange(task.begin, task.end, map, bins);
+	}
+
+	// Find the cheapest split between two bins, same as the sweep
+	// but with binCount - 1 candidates per axis
+
+	float	bestCost = FLT_MAX;
+	int	bestAxis = -1;
+	int	bestSplit = 0;
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		if (map.scale[axis] == 0.0f) {
+			continue;
+		}
+		float	rightCost[kBinCount];
+		AABB3	acc;
+		emptyBox(acc);
+		int	n = 0;
+		for (int b = binCount - 1 ; b > 0 ; --b) {
+			growBox(acc, bins.bounds[axis][b]);
+			n += bins.count[axis][b];
+			rightCost[b] = (n > 0) ? halfArea(acc) * (float)n : 0.0f;
+		}
+		emptyBox(acc);
+		n = 0;
+		for (int b = 0 ; b < binCount - 1 ; ++b) {
+			growBox(acc, bins.bounds[axis][b]);
+			n += bins.count[axis][b];
+			if (n == 0 || n == count) {
+				continue;
+			}
+			float	cost = halfArea(acc) * (float)n + rightCost[b + 1];
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b + 1;
+			}
+		}
+	}
+
+	// Make a leaf if that's cheaper.  If all the centers are in the
+	// same spot there is no split, and we just cut the list in half.
+
+	float	parentArea = halfArea(task.bounds);
+	if (count <= kMaxLeafSize &&
+		(bestAxis < 0 || kBoxCost * parentArea * (float)count <= kNodeCost * parentArea + kBoxCost * bestCost)) {
+		return false;
+	}
+
+	int	middle;
+	if (bestAxis >= 0) {
+		AABB3	centers[2];
+		emptyBox(centers[0]);
+		emptyBox(centers[1]);
+		if (inParallel) {
+			middle = partitionParallel(task, map, bestAxis, bestSplit, centers);
+		} else {
+			middle = task.begin;
+			for (int i = task.begin ; i < task.end ; ++i) {
+				Vector3	c(center[0][i], center[1][i], center[2][i]);
+				if (map.bin((&c.x)[bestAxis], bestAxis) < bestSplit) {
+					growBox(centers[0], c, c);
+					std::swap(ref[i], ref[middle]);
+					for (int axis = 0 ; axis < 3 ; ++axis) {
+						std::swap(center[axis][i], center[axis][middle]);
+					}
+					++middle;
+				} else {
+					growBox(centers[1], c, c);
+				}
+			}
+		}
+		for (int side = 0 ; side < 2 ; ++side) {
+			emptyBox(child[side].bounds);
+			child[side].centers = centers[side];
+		}
+		for (int b = 0 ; b < binCount ; ++b) {
+			growBox(child[(b < bestSplit) ? 0 : 1].bounds, bins.bounds[bestAxis][b]);
+		}
+	} else {
+		middle = task.begin + count / 2;
+		for (int side = 0 ; side < 2 ; ++side) {
+			emptyBox(child[side].bounds);
+			emptyBox(child[side].centers);
+			for (int i = (side ? middle : task.begin) ; i < (side ? task.end : middle) ; ++i) {
+				growBox(child[side].bounds, ref[i].min, ref[i].max);
+				Vector3	c = ref[i].center();
+				growBox(child[side].centers, c, c);
+			}
+		}
+	}
+
+	int	c = allocatePair();
+	nd.child = c;
+	nd.count = 0;
+	child[0].node = c;
+	child[0].begin = task.begin;
+	child[0].end = middle;
+	child[0].level = task.level + 1;
+	child[1].node = c + 1;
+	child[1].begin = middle;
+	child[1].end = task.end;
+	child[1].level = task.level + 1;
+	return true;
+}
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::sweepNode
+//
+// Fill in node n of a small subtree for the boxes in [begin, end) of the
+// lists, and recursively build its children.  This is the same as
+// SweepBuilder::buildNode().
+
+void	BinnedBuilder::sweepNode(SmallSweep &s, int n, int begin, int end, int level, const AABB3 &bounds) {
+	AABBTreeNode	&nd = node[n];
+	int		count = end - begin;
+	nd.min = bounds.min;
+	nd.max = bounds.max;
+	nd.child = s.base + begin;
+	nd.count = count;
+	noteDepth(level);
+
+	if (count == 1 || level >= kMaxTreeDepth) {
+		return;
+	}
+
+	const BuildRef	*r = ref + s.base;
+	float	bestCost = FLT_MAX;
+	int	bestAxis = 0;
+	int	bestSplit = begin + count / 2;
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		const unsigned char	*o = s.order[axis];
+		AABB3	acc;
+		emptyBox(acc);
+		for (int i = end - 1 ; i > begin ; --i) {
+			growBox(acc, r[o[i]].min, r[o[i]].max);
+			s.rightArea[i] = halfArea(acc);
+		}
+		emptyBox(acc);
+		for (int i = begin ; i < end - 1 ; ++i) {
+			growBox(acc, r[o[i]].min, r[o[i]].max);
+			float	cost = halfArea(acc) * (float)(i - begin + 1) + s.rightArea[i + 1] * (float)(end - i - 1);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = i + 1;
+			}
+		}
+	}
+
+	float	parentArea = halfArea(bounds);
+	if (count <= kMaxLeafSize &&
+		kBoxCost * parentArea * (float)count <= kNodeCost * parentArea + kBoxCost * bestCost) {
+		return;
+	}
+
+	// Split the other two lists the same way, keeping them sorted,
+	// and find the children's boxes
+
+	const unsigned char	*o = s.order[bestAxis];
+	AABB3	childBounds[2];
+	emptyBox(childBounds[0]);
+	emptyBox(childBounds[1]);
+	for (int i = begin ; i < end ; ++i) {
+		s.goesLeft[o[i]] = (i < bestSplit) ? 1 : 0;
+		growBox(childBounds[(i < bestSplit) ? 0 : 1], r[o[i]].min, r[o[i]].max);
+	}
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		if (axis == bestAxis) {
+			continue;
+		}
+		unsigned char	*p = s.order[axis];
+		int	left = begin, right = 0;
+		for (int i = begin ; i < end ; ++i) {
+			if (s.goesLeft[p[i]]) {
+				p[left++] = p[i];
+			} else {
+				s.right[right++] = p[i];
+			}
+		}
+		for (int i = 0 ; i < right ; ++i) {
+			p[left + i] = s.right[i];
+		}
+	}
+
+	int	c = allocatePair();
+	nd.child = c;
+	nd.count = 0;
+	sweepNode(s, c, begin, bestSplit, level + 1, childBounds[0]);
+	sweepNode(s, c + 1, bestSplit, end, level + 1, childBounds[1]);
+}
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::sweepSubtree
+//
+// Build a subtree of no more than kMaxSweepBoxes boxes with full sweeps.
+// The boxes are sorted on each axis once, with an insertion sort, which
+// keeps ties in order like CenterLess.  The box list is put in the order
+// of the first list at the end, which is the order the leaves refer to.
+
+void	BinnedBuilder::sweepSubtree(const BinnedTask &task) {
+	int		count = task.count();
+	SmallSweep	s;
+	s.base = task.begin;
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		unsigned char	*o = s.order[axis];
+		const float	*c = center[axis] + task.begin;
+		for (int i = 0 ; i < count ; ++i) {
+			int	j = i;
+			while (j > 0 && c[o[j - 1]] > c[i]) {
+				o[j] = o[j - 1];
+				--j;
+			}
+			o[j] = (unsigned char)i;
+		}
+	}
+
+	sweepNode(s, task.node, 0, count, task.level, task.bounds);
+
+	BuildRef	sorted[kMaxSweepBoxes];
+	float		sortedCenter[3][kMaxSweepBoxes];
+	for (int i = 0 ; i < count ; ++i) {
+		int	j = task.begin + s.order[0][i];
+		sorted[i] = ref[j];
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			sortedCenter[axis][i] = center[axis][j];
+		}
+	}
+	for (int i = 0 ; i < count ; ++i) {
+		ref[task.begin + i] = sorted[i];
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			center[axis][task.begin + i] = sortedCenter[axis][i];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// BinnedBuilder::buildSubtree
+//
+// Build a whole subtree on this thread.  Once a node is down to
+// kMaxSweepBoxes boxes, the rest of its subtree is swept.
+
+void	BinnedBuilder::buildSubtree(const BinnedTask &task) {
+	std::vector<BinnedTask>	stack(1, task);
+	BinSet			bins;
+	while (!stack.empty()) {
+		BinnedTask	t = stack.back();
+		stack.pop_back();
+		if (t.count() <= kMaxSweepBoxes) {
+			sweepSubtree(t);
+			continue;
+		}
+		BinnedTask	child[2];
+		if (splitNode(t, child, bins, false)) {
+			stack.push_back(child[1]);
+			stack.push_back(child[0]);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// SubtreeJob
+//
+// Parameters for building the small subtrees, passed to parallelFor
+
+struct SubtreeJob {
+	BinnedBuilder		*builder;
+	const BinnedTask	*task;
+};
+
+static void	subtreeRange(int begin, int end, void *context) {
+	const SubtreeJob *job = (const SubtreeJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->builder->buildSubtree(job->task[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// PrepareJob
+//
+// Parameters for getting the boxes ready for the binned build, passed to
+// parallelFor.  Each block copies its boxes into the box list, and finds
+// the boxes around them and their centers.
+
+struct PrepareJob {
+	const AABB3	*box;
+	BuildRef	*ref;
+	float *const	*center;
+	int		count;
+	AABB3		*blockBounds;
+	AABB3		*blockCenters;
+};
+
+static void	prepareBlocks(int begin, int end, void *context) {
+	const PrepareJob *job = (const PrepareJob *)context;
+	for (int b = begin ; b < end ; ++b) {
+		AABB3	bounds, centers;
+		bounds.empty();
+		centers.empty();
+		int	last = std::min(job->count, (b + 1) * kBoxesPerBlock);
+		for (int i = b * kBoxesPerBlock ; i < last ; ++i) {
+			BuildRef	&r = job->ref[i];
+			r.min = job->box[i].min;
+			r.max = job->box[i].max;
+			r.index = i;
+			r.pad = 0;
+			Vector3	c = r.center();
+			job->center[0][i] = c.x;
+			job->center[1][i] = c.y;
+			job->center[2][i] = c.z;
+			growBox(bounds, r.min, r.max);
+			growBox(centers, c, c);
+		}
+		job->blockBounds[b] = bounds;
+		job->blockCenters[b] = centers;
+	}
+}
+
+//---------------------------------------------------------------------------
+// CopyJob
+//
+// Copy the boxes out of the box list, which is in leaf order, passed to
+// parallelFor
+
+struct CopyJob {
+	const BuildRef	*ref;
+	AABB3		*box;
+	int		*boxIndex;
+};
+
+static void	copyRange(int begin, int end, void *context) {
+	const CopyJob *job = (const CopyJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->boxIndex[i] = job->ref[i].index;
+		job->box[i].min = job->ref[i].min;
+		job->box[i].max = job->ref[i].max;
+	}
+}
+
+//---------------------------------------------------------------------------
+// TreeRay
+//
+// A ray, with the reciprocal of its direction for the slab tests.  Zero
+// components are nudged so the reciprocal is huge but finite, and the
+// products in the slab test can't be NaN.
+//
+// That alone isn't enough when the ray lies exactly in the plane of a
+// face: the distance to the plane is 0, and so is the product, so the
+// slab would be [-huge, 0] or [0, huge] instead of everything.  So for
+// those axes the slab test measures the min planes from a hair above the
+// origin, and the max planes from a hair below, which can only make the
+// slab wider.  Otherwise lo and hi are both the origin.
+
+struct TreeRay {
+	Vector3	lo;
+	Vector3	hi;
+	Vector3	invDelta;
+
+	static void	setup(float org, float d, float &lo, float &hi, float &inv) {
+		const float	kTiny = 1e-20f;
+		if (fabs(d) < kTiny) {
+			float	nudge = std::max(fabs(org) * 4.0f * FLT_EPSILON, 1e-10f);
+			lo = org + nudge;
+			hi = org - nudge;
+			inv = 1.0f / kTiny;
+		} else {
+			lo = org;
+			hi = org;
+			inv = 1.0f / d;
+		}
+	}
+
+	TreeRay(const Vector3 &rayOrg, const Vector3 &rayDelta) {
+		setup(rayOrg.x, rayDelta.x, lo.x, hi.x, invDelta.x);
+		setup(rayOrg.y, rayDelta.y, lo.y, hi.y, invDelta.y);
+		setup(rayOrg.z, rayDelta.z, lo.z, hi.z, invDelta.z);
+	}
+};
+
+//---------------------------------------------------------------------------
+// slabTest
+//
+// Does the ray pass through the node before tMax?  If so, tNear is where
+// it goes in (0 if it starts inside.)
+
+static inline bool	slabTest(const AABBTreeNode &n, const TreeRay &ray, float tMax, float &tNear) {
+	float	x0 = (n.min.x - ray.lo.x) * ray.invDelta.x;
+	float	x1 = (n.max.x - ray.hi.x) * ray.invDelta.x;
+	float	y0 = (n.min.y - ray.lo.y) * ray.invDelta.y;
+	float	y1 = (n.max.y - ray.hi.y) * ray.invDelta.y;
+	float	z0 = (n.min.z - ray.lo.z) * ray.invDelta.z;
+	float	z1 = (n.max.z - ray.hi.z) * ray.invDelta.z;
+
+	float	t0 = std::max(std::max(std::min(x0, x1), std::min(y0, y1)), std::max(std::min(z0, z1), 0.0f));
+	float	t1 = std::min(std::min(std::max(x0, x1), std::max(y0, y1)), std::max(z0, z1)) * kSlabSlack;
+	tNear = t0;
+	return t0 <= std::min(t1, tMax);
+}
+
+//---------------------------------------------------------------------------
+// StackEntry
+//
+// A node waiting to be visited, and where the ray enters it
+
+struct StackEntry {
+	int	node;
+	float	tNear;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AABBTree member functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// AABBTree::AABBTree
+//
+// Constructor - an empty tree
+
+AABBTree::AABBTree() {
+	node = NULL;
+	parent = NULL;
+	height = NULL;
+	nodeCount = 0;
+	nodeCapacity = 0;
+	firstFreeNodePair = -1;
+	depth = 0;
+	buildMilliseconds = 0.0f;
+	box = NULL;
+	boxIndex = NULL;
+	boxLeaf = NULL;
+	boxCount = 0;
+	slotCount = 0;
+	slotCapacity = 0;
+	firstFreeSlot = -1;
+	boxSlot = NULL;
+	indexCount = 0;
+	indexCapacity = 0;
+	sahSum = 0.0;
+	buildSahCost = 0.0f;
+	rebuildThreshold = kDefaultRebuildThreshold;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::~AABBTree
+//
+// Destructor - free the memory
+
+AABBTree::~AABBTree() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::freeMemory
+//
+// Free all memory, leaving an empty tree
+
+void	AABBTree::freeMemory() {
+	alignedFree(node);
+	node = NULL;
+	delete [] parent;
+	parent = NULL;
+	delete [] height;
+	height = NULL;
+	delete [] box;
+	box = NULL;
+	delete [] boxIndex;
+	boxIndex = NULL;
+	delete [] boxLeaf;
+	boxLeaf = NULL;
+	delete [] boxSlot;
+	boxSlot = NULL;
+	nodeCount = 0;
+	nodeCapacity = 0;
+	firstFreeNodePair = -1;
+	depth = 0;
+	buildMilliseconds = 0.0f;
+	boxCount = 0;
+	slotCount = 0;
+	slotCapacity = 0;
+	firstFreeSlot = -1;
+	indexCount = 0;
+	indexCapacity = 0;
+	sahSum = 0.0;
+	buildSahCost = 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::allocateMemory
+//
+// Make room for a tree over n boxes, with indices up to indices.  A binary
+// tree with one box per leaf has 2n - 1 nodes, and that's the most a build
+// will ever need.
+
+void	AABBTree::allocateMemory(int n, int indices) {
+	freeMemory();
+	reserveNodes(2*n - 1);
+	reserveSlots(n);
+	reserveIndices(indices);
+	boxCount = n;
+	slotCount = n;
+	indexCount = indices;
+}
+
+//---------------------------------------------------------------------------
+// growArray
+//
+// Reallocate an array with room for capacity elements, keeping the first
+// count
+
+template <class T>
+static void	growArray(T *&a, int count, int capacity) {
+	T	*p = new T[capacity];
+	std::copy(a, a + count, p);
+	delete [] a;
+	a = p;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::reserveNodes, AABBTree::reserveSlots, AABBTree::reserveIndices
+//
+// Make sure there's room for n of something, at least doubling the
+// arrays when they grow so that inserts are cheap on average
+
+void	AABBTree::reserveNodes(int n) {
+	if (n <= nodeCapacity) {
+		return;
+	}
+	int	capacity = std::max(n, nodeCapacity * 2);
+	AABBTreeNode	*p = (AABBTreeNode *)alignedAlloc(capacity * sizeof(AABBTreeNode));
+	std::copy(node, node + nodeCount, p);
+	alignedFree(node);
+	node = p;
+	growArray(parent, nodeCount, capacity);
+	growArray(height, nodeCount, capacity);
+	nodeCapacity = capacity;
+}
+
+void	AABBTree::reserveSlots(int n) {
+	if (n <= slotCapacity) {
+		return;
+	}
+	int	capacity = std::max(n, slotCapacity * 2);
+	growArray(box, slotCount, capacity);
+	growArray(boxIndex, slotCount, capacity);
+	growArray(boxLeaf, slotCount, capacity);
+	slotCapacity = capacity;
+}
+
+void	AABBTree::reserveIndices(int n) {
+	if (n <= indexCapacity) {
+		return;
+	}
+	int	capacity = std::max(n, indexCapacity * 2);
+	growArray(boxSlot, indexCount, capacity);
+	indexCapacity = capacity;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::build
+//
+// Build the tree one way or the other
+
+void	AABBTree::build(const AABB3 *srcBox, int count, EAABBTreeBuild method) {
+	assert(count >= 0);
+	buildFrom(srcBox, NULL, count, count, method);
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::buildFrom
+//
+// Build the tree, and time it.  If srcIndex isn't NULL, it has the index
+// to use for each box, instead of its place in the array.
+
+void	AABBTree::buildFrom(const AABB3 *srcBox, const int *srcIndex, int count, int indices,
+	EAABBTreeBuild method) {
+	std::chrono::steady_clock::time_point	start = std::chrono::steady_clock::now();
+
+	allocateMemory(count, indices);
+	if (count > 0) {
+		if (method == eAABBTreeBuildBinned) {
+			buildBinned(srcBox, count);
+		} else {
+			buildSweep(srcBox, count);
+		}
+		if (srcIndex != NULL) {
+			for (int i = 0 ; i < count ; ++i) {
+				boxIndex[i] = srcIndex[boxIndex[i]];
+			}
+		}
+	}
+
+	// Link everything up.  Refitting fills in the parents, heights,
+	// and leaves, and the SAH cost.
+
+	for (int i = 0 ; i < indices ; ++i) {
+		boxSlot[i] = -1;
+	}
+	for (int i = 0 ; i < count ; ++i) {
+		boxSlot[boxIndex[i]] = i;
+	}
+	refitNodes();
+	buildSahCost = getSahCost();
+
+	buildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::buildSweep
+//
+// Build the tree with full sweep SAH.  See the notes at the top of the
+// file.
+
+void	AABBTree::buildSweep(const AABB3 *srcBox, int count) {
+
+	// Sort the boxes along each axis
+
+	SweepBuilder	b;
+	b.box = srcBox;
+	std::vector<float>	center(count);
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		for (int i = 0 ; i < count ; ++i) {
+			center[i] = (&srcBox[i].min.x)[axis] + (&srcBox[i].max.x)[axis];
+		}
+		b.order[axis].resize(count);
+		for (int i = 0 ; i < count ; ++i) {
+			b.order[axis][i] = i;
+		}
+		CenterLess	less = { &center[0] };
+		std::sort(b.order[axis].begin(), b.order[axis].end(), less);
+	}
+	b.scratch.resize(count);
+	b.rightArea.resize(count);
+	b.goesLeft.resize(count);
+	b.node = node;
+	b.nodeCount = 1;
+	b.depth = 0;
+
+	// Build the nodes, starting with the root
+
+	b.buildNode(0, 0, count, 0);
+	nodeCount = b.nodeCount;
+	depth = b.depth;
+
+	// The leaves refer to the boxes in the order of the lists
+
+	for (int i = 0 ; i < count ; ++i) {
+		boxIndex[i] = b.order[0][i];
+		box[i] = srcBox[boxIndex[i]];
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::buildBinned
+//
+// Build the tree with binned SAH, using all the worker threads.  See the
+// notes at the top of the file.
+
+void	AABBTree::buildBinned(const AABB3 *srcBox, int count) {
+
+	// Fill the box list, and find the root's boxes
+
+	BinnedBuilder	b;
+	std::vector<BuildRef>	ref(count), scratch(count);
+	std::vector<float>	centerList(count * 3), scratchCenterList(count * 3);
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		b.center[axis] = &centerList[axis * count];
+		b.scratchCenter[axis] = &scratchCenterList[axis * count];
+	}
+	int	blockCount = (count + kBoxesPerBlock - 1) / kBoxesPerBlock;
+	std::vector<AABB3>	blockBounds(blockCount), blockCenters(blockCount);
+	PrepareJob	prepare = { srcBox, &ref[0], b.center, count, &blockBounds[0], &blockCenters[0] };
+	parallelFor(blockCount, 1, &prepareBlocks, &prepare);
+
+	BinnedTask	root;
+	root.node = 0;
+	root.begin = 0;
+	root.end = count;
+	root.level = 0;
+	root.bounds.empty();
+	root.centers.empty();
+	for (int i = 0 ; i < blockCount ; ++i) {
+		root.bounds.add(blockBounds[i]);
+		root.centers.add(blockCenters[i]);
+	}
+
+	b.ref = &ref[0];
+	b.scratch = &scratch[0];
+	b.node = node;
+	b.nodeCount = 1;
+	b.depth = 0;
+
+	// Split the big nodes at the top one at a time, each across all
+	// the threads, until they're small enough to be tasks
+
+	std::vector<BinnedTask>	big, next, small;
+	if (count > kMinBoxesPerTask) {
+		big.push_back(root);
+	} else {
+		small.push_back(root);
+	}
+	BinSet			*bins = new BinSet;
+	while (!big.empty()) {
+		next.clear();
+		for (int i = 0 ; i < (int)big.size() ; ++i) {
+			BinnedTask	child[2];
+			if (b.splitNode(big[i], child, *bins, true)) {
+				for (int side = 0 ; side < 2 ; ++side) {
+					if (child[side].count() > kMinBoxesPerTask) {
+						next.push_back(child[side]);
+					} else {
+						small.push_back(child[side]);
+					}
+				}
+			}
+		}
+		big.swap(next);
+	}
+	delete bins;
+
+	// Build the subtrees, biggest first so the threads finish
+	// together
+
+	if (!small.empty()) {
+		std::sort(small.begin(), small.end());
+		SubtreeJob	job = { &b, &small[0] };
+		parallelFor((int)small.size(), 1, &subtreeRange, &job);
+	}
+
+	nodeCount = b.nodeCount.load();
+	depth = b.depth.load();
+
+	// The leaves refer to the boxes in the order of the box list
+
+	CopyJob	copy = { &ref[0], box, boxIndex };
+	parallelFor(count, kBoxesPerBlock, &copyRange, &copy);
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::getBounds
+//
+// The box around everything in the tree
+
+AABB3	AABBTree::getBounds() const {
+	AABB3	bounds;
+	if (nodeCount > 0) {
+		bounds.min = node[0].min;
+		bounds.max = node[0].max;
+	} else {
+		bounds.empty();
+	}
+	return bounds;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::getStats
+//
+// Build time and quality.  The nodes freed by remove() are still in the
+// node array, so we count the ones in the tree by walking it.
+
+void	AABBTree::getStats(AABBTreeStats &stats) const {
+	stats.buildMilliseconds = buildMilliseconds;
+	stats.sahCost = getSahCost();
+	stats.buildSahCost = buildSahCost;
+	stats.nodeCount = 0;
+	stats.depth = depth;
+	stats.leafCount = 0;
+	stats.averageLeafSize = 0.0f;
+	if (boxCount == 0) {
+		return;
+	}
+
+	int	stack[kMaxTreeDepth + 1];
+	int	sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const AABBTreeNode	&nd = node[stack[--sp]];
+		++stats.nodeCount;
+		if (nd.isLeaf()) {
+			++stats.leafCount;
+		} else {
+			stack[sp++] = nd.child;
+			stack[sp++] = nd.child + 1;
+		}
+	}
+	stats.averageLeafSize = (float)boxCount / (float)stats.leafCount;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::getSahCost
+//
+// The SAH cost.  See getStats().  The cost of each node is its area,
+// relative to the root, times the cost of testing it.
+
+float	AABBTree::getSahCost() const {
+	if (boxCount == 0) {
+		return 0.0f;
+	}
+	float	rootArea = halfArea(getBounds());
+	return (rootArea > 0.0f) ? (float)(sahSum / rootArea) : 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::rayIntersect
+//
+// Closest intersection with a ray.  The children of each node are
+// visited nearest first, and anything farther away than the closest hit
+// so far is skipped.
+
+float	AABBTree::rayIntersect(const Vector3 &rayOrg, const Vector3 &rayDelta,
+	int *hitIndex, Vector3 *returnNormal) const {
+
+	// We'll return this huge number if no intersection
+
+	const float	kNoIntersection = 1e30f;
+
+	float	bestT = kNoIntersection;
+	int	best = -1;
+
+	TreeRay		ray(rayOrg, rayDelta);
+	float		tNear;
+	if (nodeCount > 0 && slabTest(node[0], ray, 1.0f, tNear)) {
+		StackEntry	stack[kMaxTreeDepth + 1];
+		int		sp = 0;
+		int		n = 0;
+		for (;;) {
+			const AABBTreeNode	&nd = node[n];
+			float	tMax = std::min(bestT, 1.0f);
+			if (nd.isLeaf()) {
+
+				// Test the boxes.  On a tie, keep the one
+				// that comes first in the original array,
+				// like a loop over the array would.
+
+				for (int i = nd.child ; i < nd.child + nd.count ; ++i) {
+					float	t = box[i].rayIntersect(rayOrg, rayDelta);
+					if (t <= 1.0f && (t < bestT || (t == bestT && boxIndex[i] < boxIndex[best]))) {
+						bestT = t;
+						best = i;
+					}
+				}
+			} else {
+
+				// Visit the children that the ray passes
+				// through, nearest first
+
+				float	t0, t1;
+				bool	hit0 = slabTest(node[nd.child], ray, tMax, t0);
+				bool	hit1 = slabTest(node[nd.child + 1], ray, tMax, t1);
+				if (hit0 && hit1) {
+					bool	secondFirst = t1 < t0;
+					stack[sp].node = nd.child + (secondFirst ? 0 : 1);
+					stack[sp].tNear = secondFirst ? t0 : t1;
+					++sp;
+					n = nd.child + (secondFirst ? 1 : 0);
+					continue;
+				}
+				if (hit0 || hit1) {
+					n = nd.child + (hit0 ? 0 : 1);
+					continue;
+				}
+			}
+
+			// Next node off the stack, skipping anything we've
+			// found a closer hit than
+
+			while (sp > 0 && stack[sp - 1].tNear > bestT) {
+				--sp;
+			}
+			if (sp == 0) {
+				break;
+			}
+			n = stack[--sp].node;
+		}
+	}
+
+	if (best >= 0 && returnNormal != NULL) {
+		box[best].rayIntersect(rayOrg, rayDelta, returnNormal);
+	}
+	if (hitIndex != NULL) {
+		*hitIndex = (best >= 0) ? boxIndex[best] : -1;
+	}
+	return bestT;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::rayIntersectAny
+//
+// Any intersection with a ray.  Same traversal, but we can stop at the
+// first hit, so there's no need to order the children.
+
+int	AABBTree::rayIntersectAny(const Vector3 &rayOrg, const Vector3 &rayDelta) const {
+	TreeRay		ray(rayOrg, rayDelta);
+	float		tNear;
+	if (nodeCount == 0 || !slabTest(node[0], ray, 1.0f, tNear)) {
+		return -1;
+	}
+
+	int	stack[kMaxTreeDepth + 1];
+	int	sp = 0;
+	int	n = 0;
+	for (;;) {
+		const AABBTreeNode	&nd = node[n];
+		if (nd.isLeaf()) {
+			for (int i = nd.child ; i < nd.child + nd.count ; ++i) {
+				if (box[i].rayIntersect(rayOrg, rayDelta) <= 1.0f) {
+					return boxIndex[i];
+				}
+			}
+		} else {
+			float	t0, t1;
+			bool	hit0 = slabTest(node[nd.child], ray, 1.0f, t0);
+			bool	hit1 = slabTest(node[nd.child + 1], ray, 1.0f, t1);
+			if (hit0) {
+				if (hit1) {
+					stack[sp++] = nd.child + 1;
+				}
+				n = nd.child;
+				continue;
+			}
+			if (hit1) {
+				n = nd.child + 1;
+				continue;
+			}
+		}
+		if (sp == 0) {
+			return -1;
+		}
+		n = stack[--sp];
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch ray queries
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// RayJob
+//
+// Parameters for a batch of rays, passed to parallelFor
+
+struct RayJob {
+	const AABBTree	*tree;
+	const Vector3	*org;
+	const Vector3	*delta;
+	float		*t;
+	int		*hitIndex;
+};
+
+//---------------------------------------------------------------------------
+// closestRange, anyRange
+//
+// Trace rays [begin, end) of a job
+
+static void	closestRange(int begin, int end, void *context) {
+	const RayJob *job = (const RayJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->t[i] = job->tree->rayIntersect(job->org[i], job->delta[i], &job->hitIndex[i]);
+	}
+}
+
+static void	anyRange(int begin, int end, void *context) {
+	const RayJob *job = (const RayJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->hitIndex[i] = job->tree->rayIntersectAny(job->org[i], job->delta[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::rayIntersect, AABBTree::rayIntersectAny
+//
+// Trace many rays, spread across the worker threads
+
+void	AABBTree::rayIntersect(const Vector3 *rayOrg, const Vector3 *rayDelta,
+	float *t, int *hitIndex, int count) const {
+	RayJob	job = { this, rayOrg, rayDelta, t, hitIndex };
+	parallelFor(count, kMinRaysPerChunk, &closestRange, &job);
+}
+
+void	AABBTree::rayIntersectAny(const Vector3 *rayOrg, const Vector3 *rayDelta,
+	int *hitIndex, int count) const {
+	RayJob	job = { this, rayOrg, rayDelta, NULL, hitIndex };
+	parallelFor(count, kMinRaysPerChunk, &anyRange, &job);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Refitting and incremental updates
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// nodeBox
+//
+// A node's box as an AABB3
+
+static inline AABB3	nodeBox(const AABBTreeNode &n) {
+	AABB3	b;
+	b.min = n.min;
+	b.max = n.max;
+	return b;
+}
+
+//---------------------------------------------------------------------------
+// RefitJob
+//
+// Parameters for refitting subtrees, passed to parallelFor
+
+struct RefitJob {
+	AABBTreeNode	*node;
+	int		*parent;
+	int		*height;
+	int		*boxLeaf;
+	const AABB3	*box;
+	const int	*subtree;
+	double		*sahSum;
+};
+
+//---------------------------------------------------------------------------
+// refitSubtree
+//
+// Recompute the boxes of node n and everything below it, and link up the
+// parents, heights and leaves while we're at it.  Returns the SAH cost of
+// the subtree, times the area of the root.  The recursion is no deeper
+// than the tree.
+
+static double	refitSubtree(const RefitJob *job, int n) {
+	AABBTreeNode	&nd = job->node[n];
+	AABB3		bounds;
+	emptyBox(bounds);
+	if (nd.isLeaf()) {
+		for (int i = nd.child ; i < nd.child + nd.count ; ++i) {
+			growBox(bounds, job->box[i]);
+			job->boxLeaf[i] = n;
+		}
+		nd.min = bounds.min;
+		nd.max = bounds.max;
+		job->height[n] = 0;
+		return kBoxCost * halfArea(bounds) * nd.count;
+	}
+
+	int	c = nd.child;
+	job->parent[c] = n;
+	job->parent[c + 1] = n;
+	double	sum = refitSubtree(job, c) + refitSubtree(job, c + 1);
+	growBox(bounds, job->node[c].min, job->node[c].max);
+	growBox(bounds, job->node[c + 1].min, job->node[c + 1].max);
+	nd.min = bounds.min;
+	nd.max = bounds.max;
+	job->height[n] = 1 + std::max(job->height[c], job->height[c + 1]);
+	return sum + kNodeCost * halfArea(bounds);
+}
+
+static void	refitRange(int begin, int end, void *context) {
+	const RefitJob *job = (const RefitJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->sahSum[i] = refitSubtree(job, job->subtree[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::refitNodes
+//
+// Recompute all the node boxes from the boxes.  A big tree is cut into
+// subtrees near the top, which are refit in parallel, and then the nodes
+// above them are done in reverse breadth first order, so the children of
+// each are done before it.
+
+void	AABBTree::refitNodes() {
+	sahSum = 0.0;
+	depth = 0;
+	if (boxCount == 0) {
+		return;
+	}
+
+	std::vector<int>	top, subtree(1, 0);
+	if (boxCount > kMinBoxesPerRefitTask) {
+		std::vector<int>	next;
+		bool			split = true;
+		while (split && (int)subtree.size() < kRefitTaskCount) {
+			split = false;
+			next.clear();
+			for (int i = 0 ; i < (int)subtree.size() ; ++i) {
+				int	n = subtree[i];
+				if (node[n].isLeaf()) {
+					next.push_back(n);
+				} else {
+					top.push_back(n);
+					next.push_back(node[n].child);
+					next.push_back(node[n].child + 1);
+					split = true;
+				}
+			}
+			subtree.swap(next);
+		}
+	}
+
+	std::vector<double>	sum(subtree.size());
+	RefitJob	job = { node, parent, height, boxLeaf, box, &subtree[0], &sum[0] };
+	parallelFor((int)subtree.size(), 1, &refitRange, &job);
+	for (int i = 0 ; i < (int)sum.size() ; ++i) {
+		sahSum += sum[i];
+	}
+
+	for (int i = (int)top.size() - 1 ; i >= 0 ; --i) {
+		int		n = top[i];
+		AABBTreeNode	&nd = node[n];
+		int		c = nd.child;
+		AABB3		bounds = nodeBox(node[c]);
+		growBox(bounds, node[c + 1].min, node[c + 1].max);
+		nd.min = bounds.min;
+		nd.max = bounds.max;
+		parent[c] = n;
+		parent[c + 1] = n;
+		height[n] = 1 + std::max(height[c], height[c + 1]);
+		sahSum += kNodeCost * halfArea(bounds);
+	}
+	parent[0] = -1;
+	depth = height[0];
+}
+
+//---------------------------------------------------------------------------
+// SetBoxJob
+//
+// Parameters for setting all the boxes, passed to parallelFor.  If
+// objectToWorld isn't NULL, each box is transformed by its matrix.
+
+struct SetBoxJob {
+	AABB3			*box;
+	const int		*boxIndex;
+	const int		*boxLeaf;
+	const AABB3		*src;
+	const Matrix4x3		*objectToWorld;
+};
+
+static void	setBoxRange(int begin, int end, void *context) {
+	const SetBoxJob *job = (const SetBoxJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		if (job->boxLeaf[i] < 0) {
+			continue;
+		}
+		int	k = job->boxIndex[i];
+		if (job->objectToWorld != NULL) {
+			job->box[i].setToTransformedBox(job->src[k], job->objectToWorld[k]);
+		} else {
+			job->box[i] = job->src[k];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::setBox
+//
+// Change one box, leaving the nodes alone until refit()
+
+void	AABBTree::setBox(int index, const AABB3 &newBox) {
+	assert(contains(index));
+	box[boxSlot[index]] = newBox;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::refit
+//
+// Recompute the node boxes after the boxes have moved
+
+void	AABBTree::refit() {
+	refitNodes();
+}
+
+void	AABBTree::refit(const AABB3 *srcBox) {
+	SetBoxJob	job = { box, boxIndex, boxLeaf, srcBox, NULL };
+	parallelFor(slotCount, kMinSlotsPerChunk, &setBoxRange, &job);
+	refitNodes();
+}
+
+void	AABBTree::refit(const AABB3 *localBox, const Matrix4x3 *objectToWorld) {
+	SetBoxJob	job = { box, boxIndex, boxLeaf, localBox, objectToWorld };
+	parallelFor(slotCount, kMinSlotsPerChunk, &setBoxRange, &job);
+	refitNodes();
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::allocateNodePair, AABBTree::freeNodePair
+//
+// Get two adjacent nodes, from the free list if we can, and put them back
+
+int	AABBTree::allocateNodePair() {
+	if (firstFreeNodePair >= 0) {
+		int	n = firstFreeNodePair;
+		firstFreeNodePair = node[n].child;
+		return n;
+	}
+	reserveNodes(nodeCount + 2);
+	nodeCount += 2;
+	return nodeCount - 2;
+}
+
+void	AABBTree::freeNodePair(int n) {
+	node[n].child = firstFreeNodePair;
+	node[n].count = 0;
+	firstFreeNodePair = n;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::allocateSlot, AABBTree::freeSlot
+//
+// Same for the box slots
+
+int	AABBTree::allocateSlot() {
+	if (firstFreeSlot >= 0) {
+		int	s = firstFreeSlot;
+		firstFreeSlot = boxIndex[s];
+		return s;
+	}
+	reserveSlots(slotCount + 1);
+	return slotCount++;
+}
+
+void	AABBTree::freeSlot(int s) {
+	boxLeaf[s] = -1;
+	boxIndex[s] = firstFreeSlot;
+	firstFreeSlot = s;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::nodeCost
+//
+// The SAH cost of one node, times the area of the root
+
+float	AABBTree::nodeCost(int n) const {
+	const AABBTreeNode	&nd = node[n];
+	float	area = halfArea(nodeBox(nd));
+	return nd.isLeaf() ? kBoxCost * area * (float)nd.count : kNodeCost * area;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::setChildLinks
+//
+// Point whatever is below node n back at it, after it's been moved there
+
+void	AABBTree::setChildLinks(int n) {
+	const AABBTreeNode	&nd = node[n];
+	if (nd.isLeaf()) {
+		for (int i = nd.child ; i < nd.child + nd.count ; ++i) {
+			boxLeaf[i] = n;
+		}
+	} else {
+		parent[nd.child] = n;
+		parent[nd.child + 1] = n;
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::refitLeaf
+//
+// Recompute the box of one leaf from its boxes
+
+void	AABBTree::refitLeaf(int n) {
+	AABBTreeNode	&nd = node[n];
+	sahSum -= nodeCost(n);
+	AABB3	bounds;
+	emptyBox(bounds);
+	for (int i = nd.child ; i < nd.child + nd.count ; ++i) {
+		growBox(bounds, box[i]);
+	}
+	nd.min = bounds.min;
+	nd.max = bounds.max;
+	sahSum += nodeCost(n);
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::fixUpward
+//
+// Recompute the boxes and heights of node n and everything above it,
+// rotating where that helps.  If the tree ends up deeper than the
+// queries can handle, it's rebuilt, so don't hang on to node numbers
+// across this.
+
+void	AABBTree::fixUpward(int n) {
+	while (n >= 0) {
+		AABBTreeNode	&nd = node[n];
+		int		c = nd.child;
+		sahSum -= nodeCost(n);
+		AABB3	bounds = nodeBox(node[c]);
+		growBox(bounds, node[c + 1].min, node[c + 1].max);
+		nd.min = bounds.min;
+		nd.max = bounds.max;
+		height[n] = 1 + std::max(height[c], height[c + 1]);
+		sahSum += nodeCost(n);
+		rotate(n);
+		n = parent[n];
+	}
+	depth = height[0];
+
+	// The queries can only handle so deep a tree.  Inserts can make it
+	// deeper, and so can the rotations, which only look at area: boxes
+	// moved one after another along a line pile up into a long chain.
+
+	if (depth > kMaxTreeDepth) {
+		rebuild();
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::rotate
+//
+// Try swapping each child of node n with each child of the other child.
+// That only changes the box of the other child, so pick the swap that
+// shrinks it the most, if any.
+
+void	AABBTree::rotate(int n) {
+	int	first = node[n].child;
+	float	bestGain = 0.0f;
+	int	bestChild = -1, bestGrandchild = -1;
+	for (int side = 0 ; side < 2 ; ++side) {
+		int	x = first + side;
+		int	y = first + 1 - side;
+		if (node[y].isLeaf()) {
+			continue;
+		}
+		float	area = halfArea(nodeBox(node[y]));
+		for (int k = 0 ; k < 2 ; ++k) {
+
+			// x takes the place of grandchild g, so y ends up
+			// around x and the other grandchild
+
+			int	g = node[y].child + k;
+			AABB3	b = nodeBox(node[x]);
+			growBox(b, node[node[y].child + 1 - k].min, node[node[y].child + 1 - k].max);
+			float	gain = area - halfArea(b);
+			if (gain > bestGain) {
+				bestGain = gain;
+				bestChild = x;
+				bestGrandchild = g;
+			}
+		}
+	}
+	if (bestChild < 0) {
+		return;
+	}
+
+	int	y = (bestChild == first) ? first + 1 : first;
+	swapNodes(bestChild, bestGrandchild);
+	AABBTreeNode	&ny = node[y];
+	sahSum -= nodeCost(y);
+	AABB3	bounds = nodeBox(node[ny.child]);
+	growBox(bounds, node[ny.child + 1].min, node[ny.child + 1].max);
+	ny.min = bounds.min;
+	ny.max = bounds.max;
+	height[y] = 1 + std::max(height[ny.child], height[ny.child + 1]);
+	sahSum += nodeCost(y);
+	height[n] = 1 + std::max(height[first], height[first + 1]);
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::swapNodes
+//
+// Swap the contents of two nodes, and everything below them.  Each keeps
+// the parent of its slot.
+
+void	AABBTree::swapNodes(int a, int b) {
+	std::swap(node[a], node[b]);
+	std::swap(height[a], height[b]);
+	setChildLinks(a);
+	setChildLinks(b);
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::insert
+//
+// Add a box to the tree.  See the notes at the top of the file.
+
+int	AABBTree::insert(const AABB3 &newBox) {
+	int	index = indexCount;
+	reserveIndices(indexCount + 1);
+	++indexCount;
+	int	slot = allocateSlot();
+	box[slot] = newBox;
+	boxIndex[slot] = index;
+	boxSlot[index] = slot;
+	++boxCount;
+
+	AABBTreeNode	leaf;
+	leaf.min = newBox.min;
+	leaf.child = slot;
+	leaf.max = newBox.max;
+	leaf.count = 1;
+
+	// The first box is the root
+
+	if (boxCount == 1) {
+		reserveNodes(1);
+		nodeCount = 1;
+		node[0] = leaf;
+		parent[0] = -1;
+		height[0] = 0;
+		boxLeaf[slot] = 0;
+		sahSum = nodeCost(0);
+		depth = 0;
+		return index;
+	}
+
+	// Find the sibling for the new leaf.  inherit is what it costs all
+	// the nodes above to grow around the new box if we go further down.
+
+	int	s = 0;
+	float	inherit = 0.0f;
+	while (!node[s].isLeaf()) {
+		const AABBTreeNode	&nd = node[s];
+		AABB3	b = nodeBox(nd);
+		float	area = halfArea(b);
+		growBox(b, newBox);
+		float	combined = halfArea(b);
+		float	cost = inherit + kNodeCost * combined;
+		float	childInherit = inherit + kNodeCost * (combined - area);
+
+		float	childCost[2];
+		for (int k = 0 ; k < 2 ; ++k) {
+			const AABBTreeNode	&ch = node[nd.child + k];
+			AABB3	cb = nodeBox(ch);
+			float	childArea = halfArea(cb);
+			growBox(cb, newBox);
+			childCost[k] = childInherit + kNodeCost * halfArea(cb) - (ch.isLeaf() ? 0.0f : kNodeCost * childArea);
+		}
+		if (cost <= childCost[0] && cost <= childCost[1]) {
+			break;
+		}
+		inherit = childInherit;
+		s = nd.child + ((childCost[1] < childCost[0]) ? 1 : 0);
+	}
+
+	// Move the sibling down into a new pair of nodes, next to the new
+	// leaf.  The sibling's slot becomes their parent.
+
+	int	p = allocateNodePair();
+	node[p] = node[s];
+	height[p] = height[s];
+	parent[p] = s;
+	setChildLinks(p);
+	node[p + 1] = leaf;
+	height[p + 1] = 0;
+	parent[p + 1] = s;
+	boxLeaf[slot] = p + 1;
+	sahSum += nodeCost(p + 1);
+
+	node[s].child = p;
+	node[s].count = 0;
+	sahSum += nodeCost(s);
+	fixUpward(s);
+	return index;
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::remove
+//
+// Take a box out of the tree.  If it was the only box in its leaf, the
+// leaf's sibling takes the place of their parent.
+
+void	AABBTree::remove(int index) {
+	assert(contains(index));
+	int	slot = boxSlot[index];
+	int	leaf = boxLeaf[slot];
+	boxSlot[index] = -1;
+	--boxCount;
+
+	// Take it out of a leaf with other boxes, moving the last box of
+	// the leaf into its slot
+
+	AABBTreeNode	&nd = node[leaf];
+	if (nd.count > 1) {
+		int	last = nd.child + nd.count - 1;
+		if (slot != last) {
+			box[slot] = box[last];
+			boxIndex[slot] = boxIndex[last];
+			boxSlot[boxIndex[slot]] = slot;
+		}
+		freeSlot(last);
+		sahSum -= nodeCost(leaf);
+		--nd.count;
+		sahSum += nodeCost(leaf);
+		refitLeaf(leaf);
+		fixUpward(parent[leaf]);
+		return;
+	}
+
+	freeSlot(slot);
+	if (leaf == 0) {
+
+		// That was the last box
+
+		nodeCount = 0;
+		firstFreeNodePair = -1;
+		slotCount = 0;
+		firstFreeSlot = -1;
+		sahSum = 0.0;
+		depth = 0;
+		return;
+	}
+
+	int	p = parent[leaf];
+	int	c = node[p].child;
+	int	sibling = (leaf == c) ? c + 1 : c;
+	sahSum -= nodeCost(leaf) + nodeCost(p);
+	node[p] = node[sibling];
+	height[p] = height[sibling];
+	setChildLinks(p);
+	freeNodePair(c);
+	if (parent[p] >= 0) {
+		fixUpward(parent[p]);
+	} else {
+		depth = height[0];
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::moveBox
+//
+// Change one box, and fix up the nodes above it
+
+void	AABBTree::moveBox(int index, const AABB3 &newBox) {
+	assert(contains(index));
+	int	slot = boxSlot[index];
+	int	leaf = boxLeaf[slot];
+	box[slot] = newBox;
+	refitLeaf(leaf);
+	fixUpward(parent[leaf]);
+}
+
+//---------------------------------------------------------------------------
+// AABBTree::rebuild, AABBTree::rebuildIfNeeded
+//
+// Build the tree again from the boxes in it, keeping their indices
+
+void	AABBTree::rebuild(EAABBTreeBuild method) {
+	std::vector<AABB3>	liveBox;
+	std::vector<int>	liveIndex;
+	liveBox.reserve(boxCount);
+	liveIndex.reserve(boxCount);
+	for (int i = 0 ; i < slotCount ; ++i) {
+		if (boxLeaf[i] >= 0) {
+			liveBox.push_back(box[i]);
+			liveIndex.push_back(boxIndex[i]);
+		}
+	}
+	int	n = (int)liveBox.size();
+	buildFrom(n > 0 ? &liveBox[0] : NULL, n > 0 ? &liveIndex[0] : NULL, n, indexCount, method);
+}
+
+bool	AABBTree::rebuildIfNeeded(EAABBTreeBuild method) {
+	if (getSahCost() <= buildSahCost * rebuildThreshold) {
+		return false;
+	}
+	rebuild(method);
+	return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Triangle bounds
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// TriangleBoundsJob
+//
+// Parameters for computing triangle bounds, passed to parallelFor
+
+struct TriangleBoundsJob {
+	const RenderVertex	*vertexList;
+	const RenderTri		*triList;
+	AABB3			*box;
+};
+
+static void	triangleBoundsRange(int begin, int end, void *context) {
+	const TriangleBoundsJob *job = (const TriangleBoundsJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		const unsigned short	*v = job->triList[i].index;
+		const Vector3	&a = job->vertexList[v[0]].p;
+		const Vector3	&b = job->vertexList[v[1]].p;
+		const Vector3	&c = job->vertexList[v[2]].p;
+		AABB3	&box = job->box[i];
+		box.min.x = std::min(a.x, std::min(b.x, c.x));
+		box.min.y = std::min(a.y, std::min(b.y, c.y));
+		box.min.z = std::min(a.z, std::min(b.z, c.z));
+		box.max.x = std::max(a.x, std::max(b.x, c.x));
+		box.max.y = std::max(a.y, std::max(b.y, c.y));
+		box.max.z = std::max(a.z, std::max(b.z, c.z));
+	}
+}
+
+//---------------------------------------------------------------------------
+// computeTriangleBounds
+//
+// The box around each triangle of a mesh
+
+void	computeTriangleBounds(const RenderVertex *vertexList, const RenderTri *triList,
+	int triCount, AABB3 *box) {
+	TriangleBoundsJob	job = { vertexList, triList, box };
+	parallelFor(triCount, kMinTrianglesPerChunk, &triangleBoundsRange, &job);
+}
+
+void	computeTriangleBounds(const TriMesh &mesh, AABB3 *box) {
+	computeTriangleBounds(mesh.getVertexList(), mesh.getTriList(), mesh.getTriCount(), box);
+}
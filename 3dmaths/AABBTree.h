@@ -0,0 +1,277 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AABBTree.h - Bounding volume hierarchy of axially aligned boxes
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see AABBTree.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __AABBTREE_H_INCLUDED__
+#define __AABBTREE_H_INCLUDED__
+
+#ifndef __AABB3_H_INCLUDED__
+	#include "AABB3.h"
+#endif
+
+class TriMesh;
+struct RenderVertex;
+struct RenderTri;
+
+// The deepest a tree can get.  The queries keep a stack this deep.
+
+const int	kAABBTreeMaxDepth = 64;
+
+// How to build the tree.  The sweep builder makes the best trees.  The
+// binned builder makes trees nearly as good much faster, using all the
+// worker threads, for rebuilding while the game is running.
+
+enum EAABBTreeBuild {
+	eAABBTreeBuildSweep,
+	eAABBTreeBuildBinned
+};
+
+//---------------------------------------------------------------------------
+// struct AABBTreeNode
+//
+// One node of the tree, 32 bytes, so a node never straddles a cache line.
+// The two children of a node are always next to each other in the node
+// array, so the node only needs the index of the first.
+
+struct AABBTreeNode {
+	Vector3	min;
+	int	child;	// interior: index of the first child.  leaf: first box in the box list
+	Vector3	max;
+	int	count;	// number of boxes in a leaf, 0 for an interior node
+
+	bool	isLeaf() const { return count > 0; }
+};
+
+//---------------------------------------------------------------------------
+// struct AABBTreeStats
+//
+// How long a tree took to build, and how good it is.  The SAH cost is the
+// expected cost of tracing a ray that passes through the root, in units
+// of one node test; lower is better.  buildSahCost is what it was right
+// after the last build, before anything moved.
+
+struct AABBTreeStats {
+	float	buildMilliseconds;
+	float	sahCost;
+	float	buildSahCost;
+	int	nodeCount;
+	int	leafCount;
+	int	depth;
+	float	averageLeafSize;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AABBTree
+//
+// A bounding volume hierarchy over a set of boxes, for ray picking and
+// line of sight tests against a whole scene.  Each leaf holds a few of
+// the boxes, and each interior node the box around its two children, so
+// a ray only has to be tested against the boxes in the few leaves it
+// passes near, instead of every box.
+//
+// The tree is built with the surface area heuristic (SAH), which splits
+// each node where the expected cost of tracing a random ray through the
+// two halves is least.  getStats() reports how long that took and how
+// good the result is, to choose between the builders.
+//
+// The boxes are identified by their index in the array the tree was built
+// from.  The tree keeps its own copy of the boxes.
+//
+// When things move, the boxes can be updated and the tree refit, which
+// keeps the shape of the tree and just recomputes the node boxes.  Boxes
+// can also be inserted and removed one at a time.  Either way the tree
+// gets worse as things move away from where it was built, so the SAH cost
+// is tracked, and rebuildIfNeeded() rebuilds the tree once it's gotten
+// too much worse.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+class AABBTree {
+public:
+	AABBTree();
+	~AABBTree();
+
+	// Build the tree over count boxes, replacing anything already in
+	// the tree
+
+	void	build(const AABB3 *box, int count, EAABBTreeBuild method = eAABBTreeBuildSweep);
+
+	// Free all memory, leaving an empty tree
+
+	void	freeMemory();
+
+	// Accessors.  The node count is the size of the node array, which
+	// includes any nodes freed by remove().
+
+	int	getBoxCount() const { return boxCount; }
+	int	getIndexCount() const { return indexCount; }
+	int	getNodeCount() const { return nodeCount; }
+	int	getDepth() const { return depth; }
+	const AABBTreeNode	*getNodes() const { return node; }
+
+	// The boxes in the order the leaves use them, and the index of each.
+	// There may be holes left by remove(), which no leaf refers to.
+
+	const AABB3	*getBoxes() const { return box; }
+	const int	*getBoxIndices() const { return boxIndex; }
+
+	// Is a box index in the tree?  It won't be if it was removed.
+
+	bool	contains(int index) const { return index >= 0 && index < indexCount && boxSlot[index] >= 0; }
+
+	// The box around everything in the tree
+
+	AABB3	getBounds() const;
+
+	// Build time and quality.  getSahCost() is the current SAH cost,
+	// which is kept up to date as the tree changes, so it's cheap.
+
+	void	getStats(AABBTreeStats &stats) const;
+	float	getSahCost() const;
+
+	// Moving boxes.  setBox() changes one box without touching the
+	// nodes, so call refit() once you've set them all.  The other refit()
+	// versions set all the boxes at once from an array with one per
+	// index, either directly or by transforming each box by its own
+	// matrix, and then refit.  Large trees are refit across the worker
+	// threads.
+
+	void	setBox(int index, const AABB3 &box);
+	void	refit();
+	void	refit(const AABB3 *box);
+	void	refit(const AABB3 *localBox, const Matrix4x3 *objectToWorld);
+
+	// Incremental updates.  insert() adds a box and returns its index,
+	// which is one more than the largest index so far.  moveBox() changes
+	// one box and fixes up just the nodes above it.  These rotate the
+	// nodes on the way back up to the root when that improves the tree.
+	// Any of them rebuilds the whole tree if it would otherwise get
+	// deeper than kAABBTreeMaxDepth.
+
+	int	insert(const AABB3 &box);
+	void	remove(int index);
+	void	moveBox(int index, const AABB3 &box);
+
+	// Rebuild the tree if the SAH cost has grown by more than the
+	// threshold since the last build.  Returns true if it rebuilt.  The
+	// default threshold is 1.3, or 30% worse.
+
+	void	setRebuildThreshold(float ratio) { rebuildThreshold = ratio; }
+	bool	rebuildIfNeeded(EAABBTreeBuild method = eAABBTreeBuildBinned);
+	void	rebuild(EAABBTreeBuild method = eAABBTreeBuildBinned);
+
+	// Closest intersection with a ray.  Same as calling
+	// AABB3::rayIntersect() on every box and keeping the smallest
+	// result: returns the parametric point of intersection in range
+	// 0...1, or a really big number (>1) if no intersection.  hitIndex
+	// gets the index of the box hit, or -1.  The normal is optional.
+
+	float	rayIntersect(const Vector3 &rayOrg, const Vector3 &rayDelta,
+			int *hitIndex, Vector3 *returnNormal = 0) const;
+
+	// Any intersection with a ray.  Returns the index of a box the ray
+	// intersects, not necessarily the closest, or -1 if it doesn't hit
+	// anything.  This is faster than rayIntersect(), and is all a line
+	// of sight test needs.
+
+	int	rayIntersectAny(const Vector3 &rayOrg, const Vector3 &rayDelta) const;
+
+	// Trace many rays at once.  Large arrays are split across the
+	// worker threads.
+
+	void	rayIntersect(const Vector3 *rayOrg, const Vector3 *rayDelta,
+			float *t, int *hitIndex, int count) const;
+	void	rayIntersectAny(const Vector3 *rayOrg, const Vector3 *rayDelta,
+			int *hitIndex, int count) const;
+
+protected:
+
+	void	allocateMemory(int boxCount, int indexCount);
+	void	buildFrom(const AABB3 *box, const int *index, int count, int indexCount, EAABBTreeBuild method);
+	void	buildSweep(const AABB3 *box, int count);
+	void	buildBinned(const AABB3 *box, int count);
+	void	refitNodes();
+	void	reserveNodes(int n);
+	void	reserveSlots(int n);
+	void	reserveIndices(int n);
+	int	allocateNodePair();
+	void	freeNodePair(int n);
+	int	allocateSlot();
+	void	freeSlot(int s);
+	void	setChildLinks(int n);
+	void	refitLeaf(int n);
+	void	fixUpward(int n);
+	void	rotate(int n);
+	void	swapNodes(int a, int b);
+	float	nodeCost(int n) const;
+
+	// Nodes.  The root is node 0.  The nodes removed by remove() are
+	// kept in a free list, two at a time, linked by child.  Each node
+	// knows its parent, and the height of the tree below it.
+
+	AABBTreeNode	*node;
+	int		*parent;
+	int		*height;
+	int		nodeCount;
+	int		nodeCapacity;
+	int		firstFreeNodePair;
+	int		depth;
+	float		buildMilliseconds;
+
+	// The boxes, in the order the leaves use them, the index of each in
+	// the original array, and the leaf it's in.  The slots freed by
+	// remove() are kept in a free list, linked by boxIndex, with a leaf
+	// of -1.  boxCount is the number of boxes in the tree, and slotCount
+	// the number of slots in use, free or not.
+
+	AABB3	*box;
+	int	*boxIndex;
+	int	*boxLeaf;
+	int	boxCount;
+	int	slotCount;
+	int	slotCapacity;
+	int	firstFreeSlot;
+
+	// The slot of each index, or -1 if it's been removed
+
+	int	*boxSlot;
+	int	indexCount;
+	int	indexCapacity;
+
+	// SAH cost times the area of the root, and the SAH cost right after
+	// the last build
+
+	double	sahSum;
+	float	buildSahCost;
+	float	rebuildThreshold;
+
+private:
+
+	// Not copyable
+
+	AABBTree(const AABBTree &);
+	AABBTree &operator=(const AABBTree &);
+};
+
+//---------------------------------------------------------------------------
+// Triangle bounds
+//
+// The box around each triangle of a mesh, for building a tree over the
+// triangles.  box must have room for one per triangle.  Large meshes are
+// split across the worker threads.
+
+void	computeTriangleBounds(const RenderVertex *vertexList, const RenderTri *triList,
+		int triCount, AABB3 *box);
+void	computeTriangleBounds(const TriMesh &mesh, AABB3 *box);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __AABBTREE_H_INCLUDED__
@@ -0,0 +1,643 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AABBTreeWide.cpp - Wide bounding volume hierarchy for SIMD ray tracing
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+
+#include <algorithm>
+
+#include "AABBTreeWide.h"
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The wide tree is made by collapsing the binary tree from the top down.
+// Each wide node starts with the two children of a binary node, and keeps
+// replacing the child with the biggest area by its own two children,
+// until it has kWideNodeWidth of them or they're all leaves.  The big
+// children are the ones rays are most likely to go into, so they're the
+// ones worth opening up.
+//
+// The slab test is the same as the binary tree's, and gives exactly the
+// same answers.  The ray is set up once with the reciprocal of its
+// direction, and the sign of each component, which tells us which plane
+// of each slab the ray enters by.  So we can load the near and far planes
+// of all the children directly, instead of loading both and sorting them
+// with min and max.  The boxes themselves are tested with
+// AABB3::rayIntersect(), as in the binary tree.
+//
+// A packet is kSimdWidth rays, one per lane, tested against one box at a
+// time.  If all the rays in the packet go the same way on each axis,
+// which is the usual case for camera rays, the packet uses the signs the
+// same way.  If not, it falls back on min and max.  A packet visits a node
+// if any of its rays hits the node, so the rays in it had better hit
+// mostly the same nodes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const float	kSlabSlack = 1.0f + 4.0f * FLT_EPSILON;
+const float	kEmptyPlane = 1e30f;
+const float	kNoIntersection = 1e30f;
+const int	kMaxStackSize = (kWideNodeWidth - 1) * kAABBTreeMaxDepth + 1;
+const int	kMinRaysPerChunk = 256;
+const int	kMinPacketsPerChunk = 64;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// halfArea
+//
+// Half the surface area of a node, which is all we need to compare them
+
+static inline float	halfArea(const AABBTreeNode &n) {
+	Vector3	s = n.max - n.min;
+	return s.x*s.y + s.y*s.z + s.z*s.x;
+}
+
+//---------------------------------------------------------------------------
+// setupAxis
+//
+// Set up one axis of a ray for the slab tests, the same way as the binary
+// tree does.  Zero components are nudged so the reciprocal is huge but
+// finite.  For those axes the min planes are measured from a hair above
+// the origin and the max planes from a hair below, so a ray lying in the
+// plane of a face still goes through the slab.
+
+static inline void	setupAxis(float org, float d, float &lo, float &hi, float &inv) {
+	const float	kTiny = 1e-20f;
+	if (fabs(d) < kTiny) {
+		float	nudge = std::max(fabs(org) * 4.0f * FLT_EPSILON, 1e-10f);
+		lo = org + nudge;
+		hi = org - nudge;
+		inv = 1.0f / kTiny;
+	} else {
+		lo = org;
+		hi = org;
+		inv = 1.0f / d;
+	}
+}
+
+//---------------------------------------------------------------------------
+// WideRay
+//
+// One ray, set up for testing against all the children of a node.  Each
+// value is in every lane.  nearPlane and farPlane are the rows of the
+// node's bounds the ray enters and leaves each slab by.
+
+struct WideRay {
+	SimdFloat	lo[3];
+	SimdFloat	hi[3];
+	SimdFloat	invDelta[3];
+	int		nearPlane[3];
+	int		farPlane[3];
+
+	WideRay(const Vector3 &rayOrg, const Vector3 &rayDelta) {
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			float	l, h, inv;
+			setupAxis((&rayOrg.x)[axis], (&rayDelta.x)[axis], l, h, inv);
+			lo[axis] = simdSet1(l);
+			hi[axis] = simdSet1(h);
+			invDelta[axis] = simdSet1(inv);
+			nearPlane[axis] = (inv < 0.0f) ? axis + 3 : axis;
+			farPlane[axis] = (inv < 0.0f) ? axis : axis + 3;
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// wideSlabTest
+//
+// Which children of a node does the ray pass through before tMax?
+// Returns a bit mask, and tNear gets where it goes into each.
+
+static inline int	wideSlabTest(const AABBTreeWideNode &n, const WideRay &ray, float tMax, float *tNear) {
+	SimdFloat	limit = simdSet1(tMax);
+	SimdFloat	slack = simdSet1(kSlabSlack);
+	int		mask = 0;
+	for (int j = 0 ; j < kWideNodeWidth ; j += kSimdWidth) {
+		SimdFloat	t0 = simdZero();
+		SimdFloat	t1 = simdSet1(FLT_MAX);
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			t0 = simdMax(t0, (simdLoad(&n.bounds[ray.nearPlane[axis]][j]) - ray.lo[axis]) * ray.invDelta[axis]);
+			t1 = simdMin(t1, (simdLoad(&n.bounds[ray.farPlane[axis]][j]) - ray.hi[axis]) * ray.invDelta[axis]);
+		}
+		simdStoreU(tNear + j, t0);
+		mask |= simdMoveMask(t0 <= simdMin(t1 * slack, limit)) << j;
+	}
+	return mask;
+}
+
+//---------------------------------------------------------------------------
+// RayPacket
+//
+// kSimdWidth rays, one per lane.  If the rays all go the same way on each
+// axis, coherent is set, and nearPlane and farPlane are used as for a
+// single ray.  Lanes past the end of a short packet repeat the first ray.
+
+struct RayPacket {
+	SimdFloat	lo[3];
+	SimdFloat	hi[3];
+	SimdFloat	invDelta[3];
+	int		nearPlane[3];
+	int		farPlane[3];
+	bool		coherent;
+
+	RayPacket(const Vector3 *rayOrg, const Vector3 *rayDelta, int count) {
+		coherent = true;
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			float	l[kSimdMaxWidth], h[kSimdMaxWidth], inv[kSimdMaxWidth];
+			for (int r = 0 ; r < kSimdWidth ; ++r) {
+				int	k = (r < count) ? r : 0;
+				setupAxis((&rayOrg[k].x)[axis], (&rayDelta[k].x)[axis], l[r], h[r], inv[r]);
+				if ((inv[r] < 0.0f) != (inv[0] < 0.0f)) {
+					coherent = false;
+				}
+			}
+			lo[axis] = simdLoadU(l);
+			hi[axis] = simdLoadU(h);
+			invDelta[axis] = simdLoadU(inv);
+			nearPlane[axis] = (inv[0] < 0.0f) ? axis + 3 : axis;
+			farPlane[axis] = (inv[0] < 0.0f) ? axis : axis + 3;
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// packetSlabTest
+//
+// Which rays of a packet pass through a box before their tMax?  The box
+// is given by its six planes, min x, y, z then max x, y, z.  Returns a
+// bit mask of rays, and tNear gets where each goes in.
+
+static inline int	packetSlabTest(const float *plane, const RayPacket &packet, SimdFloat tMax, SimdFloat &tNear) {
+	SimdFloat	t0 = simdZero();
+	SimdFloat	t1 = simdSet1(FLT_MAX);
+	if (packet.coherent) {
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			t0 = simdMax(t0, (simdSet1(plane[packet.nearPlane[axis]]) - packet.lo[axis]) * packet.invDelta[axis]);
+			t1 = simdMin(t1, (simdSet1(plane[packet.farPlane[axis]]) - packet.hi[axis]) * packet.invDelta[axis]);
+		}
+	} else {
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			SimdFloat	x0 = (simdSet1(plane[axis]) - packet.lo[axis]) * packet.invDelta[axis];
+			SimdFloat	x1 = (simdSet1(plane[axis + 3]) - packet.hi[axis]) * packet.invDelta[axis];
+			t0 = simdMax(t0, simdMin(x0, x1));
+			t1 = simdMin(t1, simdMax(x0, x1));
+		}
+	}
+	tNear = t0;
+	return simdMoveMask(t0 <= simdMin(t1 * simdSet1(kSlabSlack), tMax));
+}
+
+//---------------------------------------------------------------------------
+// StackEntry
+//
+// A node waiting to be visited, and where the ray (or the first ray of
+// the packet) enters it
+
+struct StackEntry {
+	int	node;
+	float	tNear;
+};
+
+//---------------------------------------------------------------------------
+// pushSorted
+//
+// Push a node onto the stack, keeping the entries from first up sorted
+// so the nearest is on top
+
+static inline void	pushSorted(StackEntry *stack, int first, int &sp, int n, float tNear) {
+	int	i = sp++;
+	while (i > first && stack[i - 1].tNear < tNear) {
+		stack[i] = stack[i - 1];
+		--i;
+	}
+	stack[i].node = n;
+	stack[i].tNear = tNear;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AABBTreeWide member functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::AABBTreeWide
+//
+// Constructor - make an empty tree
+
+AABBTreeWide::AABBTreeWide() {
+	node = NULL;
+	nodeCount = 0;
+	depth = 0;
+	box = NULL;
+	boxIndex = NULL;
+	boxCount = 0;
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::~AABBTreeWide
+//
+// Destructor - free the memory
+
+AABBTreeWide::~AABBTreeWide() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::freeMemory
+//
+// Free all memory, leaving an empty tree
+
+void	AABBTreeWide::freeMemory() {
+	alignedFree(node);
+	node = NULL;
+	delete [] box;
+	box = NULL;
+	delete [] boxIndex;
+	boxIndex = NULL;
+	nodeCount = 0;
+	depth = 0;
+	boxCount = 0;
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::build
+//
+// Collapse a binary tree.  There's never more than one wide node per
+// binary node.
+
+void	AABBTreeWide::build(const AABBTree &tree) {
+	freeMemory();
+	if (tree.getBoxCount() == 0) {
+		return;
+	}
+	node = (AABBTreeWideNode *)alignedAlloc(tree.getNodeCount() * sizeof(AABBTreeWideNode));
+	box = new AABB3[tree.getBoxCount()];
+	boxIndex = new int[tree.getBoxCount()];
+	collapse(tree, 0, 0);
+	assert(boxCount == tree.getBoxCount());
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::collapse
+//
+// Make a wide node out of binary node n and the nodes below it, and
+// return its index.  See the notes at the top of the file.
+
+int	AABBTreeWide::collapse(const AABBTree &tree, int n, int level) {
+	const AABBTreeNode	*bin = tree.getNodes();
+	int	w = nodeCount++;
+	if (level > depth) {
+		depth = level;
+	}
+
+	// Open up the biggest children until the node is full
+
+	int	lane[kWideNodeWidth];
+	int	laneCount;
+	if (bin[n].isLeaf()) {
+		lane[0] = n;
+		laneCount = 1;
+	} else {
+		lane[0] = bin[n].child;
+		lane[1] = bin[n].child + 1;
+		laneCount = 2;
+		while (laneCount < kWideNodeWidth) {
+			int	open = -1;
+			float	biggest = -1.0f;
+			for (int k = 0 ; k < laneCount ; ++k) {
+				if (!bin[lane[k]].isLeaf() && halfArea(bin[lane[k]]) > biggest) {
+					biggest = halfArea(bin[lane[k]]);
+					open = k;
+				}
+			}
+			if (open < 0) {
+				break;
+			}
+			int	c = bin[lane[open]].child;
+			lane[open] = c;
+			lane[laneCount++] = c + 1;
+		}
+	}
+
+	// Fill in the children, collapsing the interior ones
+
+	const AABB3	*srcBox = tree.getBoxes();
+	const int	*srcIndex = tree.getBoxIndices();
+	for (int k = 0 ; k < kWideNodeWidth ; ++k) {
+		if (k >= laneCount) {
+			for (int axis = 0 ; axis < 3 ; ++axis) {
+				node[w].bounds[axis][k] = kEmptyPlane;
+				node[w].bounds[axis + 3][k] = -kEmptyPlane;
+			}
+			node[w].child[k] = -1;
+			node[w].count[k] = 0;
+			continue;
+		}
+		const AABBTreeNode	&b = bin[lane[k]];
+		for (int axis = 0 ; axis < 3 ; ++axis) {
+			node[w].bounds[axis][k] = (&b.min.x)[axis];
+			node[w].bounds[axis + 3][k] = (&b.max.x)[axis];
+		}
+		if (b.isLeaf()) {
+			node[w].child[k] = boxCount;
+			node[w].count[k] = b.count;
+			for (int i = b.child ; i < b.child + b.count ; ++i) {
+				box[boxCount] = srcBox[i];
+				boxIndex[boxCount] = srcIndex[i];
+				++boxCount;
+			}
+		} else {
+			int	c = collapse(tree, lane[k], level + 1);
+			node[w].child[k] = c;
+			node[w].count[k] = 0;
+		}
+	}
+	return w;
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::rayIntersect
+//
+// Closest intersection with a ray.  The leaves a ray passes through are
+// tested right away, and the interior children are pushed so the nearest
+// is visited first.
+
+float	AABBTreeWide::rayIntersect(const Vector3 &rayOrg, const Vector3 &rayDelta,
+	int *hitIndex, Vector3 *returnNormal) const {
+
+	float	bestT = kNoIntersection;
+	int	best = -1;
+
+	if (nodeCount > 0) {
+		WideRay		ray(rayOrg, rayDelta);
+		StackEntry	stack[kMaxStackSize];
+		int		sp = 0;
+		stack[sp].node = 0;
+		stack[sp].tNear = 0.0f;
+		++sp;
+		while (sp > 0) {
+			StackEntry	e = stack[--sp];
+			if (e.tNear > bestT) {
+				continue;
+			}
+			const AABBTreeWideNode	&nd = node[e.node];
+			float	tNear[kWideNodeWidth];
+			int	mask = wideSlabTest(nd, ray, std::min(bestT, 1.0f), tNear);
+			int	first = sp;
+			for (int k = 0 ; k < kWideNodeWidth ; ++k) {
+				if ((mask & (1 << k)) == 0) {
+					continue;
+				}
+				if (nd.count[k] == 0) {
+					pushSorted(stack, first, sp, nd.child[k], tNear[k]);
+					continue;
+				}
+
+				// Test the boxes.  On a tie, keep the one that
+				// comes first in the original array.
+
+				for (int i = nd.child[k] ; i < nd.child[k] + nd.count[k] ; ++i) {
+					float	t = box[i].rayIntersect(rayOrg, rayDelta);
+					if (t <= 1.0f && (t < bestT || (t == bestT && boxIndex[i] < boxIndex[best]))) {
+						bestT = t;
+						best = i;
+					}
+				}
+			}
+		}
+	}
+
+	if (best >= 0 && returnNormal != NULL) {
+		box[best].rayIntersect(rayOrg, rayDelta, returnNormal);
+	}
+	if (hitIndex != NULL) {
+		*hitIndex = (best >= 0) ? boxIndex[best] : -1;
+	}
+	return bestT;
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::rayIntersectAny
+//
+// Any intersection with a ray.  We can stop at the first hit, so the
+// children don't need sorting.
+
+int	AABBTreeWide::rayIntersectAny(const Vector3 &rayOrg, const Vector3 &rayDelta) const {
+	if (nodeCount == 0) {
+		return -1;
+	}
+
+	WideRay	ray(rayOrg, rayDelta);
+	int	stack[kMaxStackSize];
+	int	sp = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const AABBTreeWideNode	&nd = node[stack[--sp]];
+		float	tNear[kWideNodeWidth];
+		int	mask = wideSlabTest(nd, ray, 1.0f, tNear);
+		for (int k = 0 ; k < kWideNodeWidth ; ++k) {
+			if ((mask & (1 << k)) == 0) {
+				continue;
+			}
+			if (nd.count[k] == 0) {
+				stack[sp++] = nd.child[k];
+				continue;
+			}
+			for (int i = nd.child[k] ; i < nd.child[k] + nd.count[k] ; ++i) {
+				if (box[i].rayIntersect(rayOrg, rayDelta) <= 1.0f) {
+					return boxIndex[i];
+				}
+			}
+		}
+	}
+	return -1;
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::rayIntersectPacket
+//
+// Closest intersection for a packet of up to kSimdWidth rays.  Each child
+// box is tested against the whole packet, and a child is visited if any
+// ray in the packet hits it.  Rays the packet test says hit a box are
+// then tested exactly, one at a time.
+
+void	AABBTreeWide::rayIntersectPacket(const Vector3 *rayOrg, const Vector3 *rayDelta,
+	float *t, int *hitIndex, int count) const {
+	assert(count >= 1 && count <= kSimdWidth);
+
+	// Lanes past the end of the packet get a tMax of -1, so they never
+	// hit anything
+
+	float	bestT[kSimdMaxWidth];
+	int	best[kSimdMaxWidth];
+	for (int r = 0 ; r < kSimdWidth ; ++r) {
+		bestT[r] = (r < count) ? kNoIntersection : -1.0f;
+		best[r] = -1;
+	}
+
+	if (nodeCount > 0) {
+		RayPacket	packet(rayOrg, rayDelta, count);
+		SimdFloat	one = simdSet1(1.0f);
+		SimdFloat	tMax = simdMin(simdLoadU(bestT), one);
+		float		farthest = kNoIntersection;
+		StackEntry	stack[kMaxStackSize];
+		int		sp = 0;
+		stack[sp].node = 0;
+		stack[sp].tNear = 0.0f;
+		++sp;
+		while (sp > 0) {
+			StackEntry	e = stack[--sp];
+			if (e.tNear > farthest) {
+				continue;
+			}
+			const AABBTreeWideNode	&nd = node[e.node];
+			int	first = sp;
+			for (int k = 0 ; k < kWideNodeWidth ; ++k) {
+				if (nd.child[k] < 0) {
+					continue;
+				}
+				float	plane[6];
+				for (int i = 0 ; i < 6 ; ++i) {
+					plane[i] = nd.bounds[i][k];
+				}
+				SimdFloat	tNear;
+				int	mask = packetSlabTest(plane, packet, tMax, tNear);
+				if (mask == 0) {
+					continue;
+				}
+
+				// An interior child goes on the stack with the
+				// nearest entry of any ray that hits it
+
+				if (nd.count[k] == 0) {
+					float	entry[kSimdMaxWidth];
+					simdStoreU(entry, tNear);
+					float	nearest = FLT_MAX;
+					for (int r = 0 ; r < kSimdWidth ; ++r) {
+						if (mask & (1 << r)) {
+							nearest = std::min(nearest, entry[r]);
+						}
+					}
+					pushSorted(stack, first, sp, nd.child[k], nearest);
+					continue;
+				}
+
+				// Test the boxes in a leaf against the packet,
+				// and then exactly against the rays that hit
+
+				bool	improved = false;
+				for (int i = nd.child[k] ; i < nd.child[k] + nd.count[k] ; ++i) {
+					SimdFloat	boxNear;
+					int		boxMask = packetSlabTest(&box[i].min.x, packet, tMax, boxNear);
+					for (int r = 0 ; r < kSimdWidth ; ++r) {
+						if ((boxMask & (1 << r)) == 0) {
+							continue;
+						}
+						float	tr = box[i].rayIntersect(rayOrg[r], rayDelta[r]);
+						if (tr <= 1.0f && (tr < bestT[r] || (tr == bestT[r] && boxIndex[i] < boxIndex[best[r]]))) {
+							bestT[r] = tr;
+							best[r] = i;
+							improved = true;
+						}
+					}
+				}
+				if (improved) {
+					tMax = simdMin(simdLoadU(bestT), one);
+					farthest = bestT[0];
+					for (int r = 1 ; r < count ; ++r) {
+						farthest = std::max(farthest, bestT[r]);
+					}
+				}
+			}
+		}
+	}
+
+	for (int r = 0 ; r < count ; ++r) {
+		t[r] = bestT[r];
+		hitIndex[r] = (best[r] >= 0) ? boxIndex[best[r]] : -1;
+	}
+}
+
+//---------------------------------------------------------------------------
+// RayJob
+//
+// Parameters for tracing many rays, passed to parallelFor
+
+struct RayJob {
+	const AABBTreeWide	*tree;
+	const Vector3		*org;
+	const Vector3		*delta;
+	float			*t;
+	int			*hitIndex;
+	int			count;
+};
+
+//---------------------------------------------------------------------------
+// closestRange, anyRange, packetRange
+//
+// Trace rays [begin, end) of a job, or for packetRange, packets
+// [begin, end)
+
+static void	closestRange(int begin, int end, void *context) {
+	const RayJob *job = (const RayJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->t[i] = job->tree->rayIntersect(job->org[i], job->delta[i], &job->hitIndex[i]);
+	}
+}
+
+static void	anyRange(int begin, int end, void *context) {
+	const RayJob *job = (const RayJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->hitIndex[i] = job->tree->rayIntersectAny(job->org[i], job->delta[i]);
+	}
+}
+
+static void	packetRange(int begin, int end, void *context) {
+	const RayJob *job = (const RayJob *)context;
+	for (int p = begin ; p < end ; ++p) {
+		int	i = p * kSimdWidth;
+		int	n = std::min(kSimdWidth, job->count - i);
+		job->tree->rayIntersectPacket(job->org + i, job->delta + i, job->t + i, job->hitIndex + i, n);
+	}
+}
+
+//---------------------------------------------------------------------------
+// AABBTreeWide::rayIntersect, AABBTreeWide::rayIntersectAny,
+// AABBTreeWide::rayIntersectPackets
+//
+// Trace many rays, spread across the worker threads
+
+void	AABBTreeWide::rayIntersect(const Vector3 *rayOrg, const Vector3 *rayDelta,
+	float *t, int *hitIndex, int count) const {
+	RayJob	job = { this, rayOrg, rayDelta, t, hitIndex, count };
+	parallelFor(count, kMinRaysPerChunk, &closestRange, &job);
+}
+
+void	AABBTreeWide::rayIntersectAny(const Vector3 *rayOrg, const Vector3 *rayDelta,
+	int *hitIndex, int count) const {
+	RayJob	job = { this, rayOrg, rayDelta, NULL, hitIndex, count };
+	parallelFor(count, kMinRaysPerChunk, &anyRange, &job);
+}
+
+void	AABBTreeWide::rayIntersectPackets(const Vector3 *rayOrg, const Vector3 *rayDelta,
+	float *t, int *hitIndex, int count) const {
+	RayJob	job = { this, rayOrg, rayDelta, t, hitIndex, count };
+	parallelFor((count + kSimdWidth - 1) / kSimdWidth, kMinPacketsPerChunk, &packetRange, &job);
+}
@@ -0,0 +1,133 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AABBTreeWide.h - Wide bounding volume hierarchy for SIMD ray tracing
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see AABBTreeWide.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __AABBTREEWIDE_H_INCLUDED__
+#define __AABBTREEWIDE_H_INCLUDED__
+
+#ifndef __AABBTREE_H_INCLUDED__
+	#include "AABBTree.h"
+#endif
+
+#ifndef __SIMD_H_INCLUDED__
+	#include "Simd.h"
+#endif
+
+// Children per node.  One register's worth for AVX, and otherwise 4,
+// which is one register for SSE and a short loop for the scalar version.
+
+const int	kWideNodeWidth = (kSimdWidth > 4) ? kSimdWidth : 4;
+
+//---------------------------------------------------------------------------
+// struct AABBTreeWideNode
+//
+// One node of the wide tree.  The boxes of the children are stored by
+// plane, so one ray can be tested against all of them at once.  Unused
+// children have an empty box, which nothing ever hits.
+
+struct AABBTreeWideNode {
+	float	bounds[6][kWideNodeWidth];	// min x, y, z, then max x, y, z
+	int	child[kWideNodeWidth];		// interior: index of the child node.  leaf: first box
+	int	count[kWideNodeWidth];		// number of boxes in a leaf, 0 for an interior node
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AABBTreeWide
+//
+// A bounding volume hierarchy with kWideNodeWidth children per node, made
+// by collapsing a binary AABBTree, for tracing lots of rays.  Each step
+// down the tree tests a ray against all the children of a node with one
+// SIMD slab test, instead of two at a time.
+//
+// Rays can also be traced in packets of kSimdWidth, with each child box
+// tested against the whole packet at once.  That's a win when the rays
+// in a packet go the same way and hit the same things, like camera rays
+// through neighboring pixels, and a loss otherwise.
+//
+// The answers are exactly the same as the binary tree's.  The tree is a
+// copy, so it has to be built again after the binary tree changes.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+class AABBTreeWide {
+public:
+	AABBTreeWide();
+	~AABBTreeWide();
+
+	// Build from a binary tree, replacing anything already in the tree
+
+	void	build(const AABBTree &tree);
+
+	// Free all memory, leaving an empty tree
+
+	void	freeMemory();
+
+	// Accessors
+
+	int	getBoxCount() const { return boxCount; }
+	int	getNodeCount() const { return nodeCount; }
+	int	getDepth() const { return depth; }
+	const AABBTreeWideNode	*getNodes() const { return node; }
+
+	// Closest and any intersection with a ray.  Same as the AABBTree
+	// versions.
+
+	float	rayIntersect(const Vector3 &rayOrg, const Vector3 &rayDelta,
+			int *hitIndex, Vector3 *returnNormal = 0) const;
+	int	rayIntersectAny(const Vector3 &rayOrg, const Vector3 &rayDelta) const;
+
+	// Trace many rays at once, one at a time.  Large arrays are split
+	// across the worker threads.
+
+	void	rayIntersect(const Vector3 *rayOrg, const Vector3 *rayDelta,
+			float *t, int *hitIndex, int count) const;
+	void	rayIntersectAny(const Vector3 *rayOrg, const Vector3 *rayDelta,
+			int *hitIndex, int count) const;
+
+	// Trace many rays in packets of kSimdWidth neighbors in the arrays.
+	// Put rays that go the same way next to each other.
+
+	void	rayIntersectPackets(const Vector3 *rayOrg, const Vector3 *rayDelta,
+			float *t, int *hitIndex, int count) const;
+
+	// Trace one packet of up to kSimdWidth rays
+
+	void	rayIntersectPacket(const Vector3 *rayOrg, const Vector3 *rayDelta,
+			float *t, int *hitIndex, int count) const;
+
+protected:
+
+	int	collapse(const AABBTree &tree, int n, int level);
+
+	// Nodes.  The root is node 0.
+
+	AABBTreeWideNode	*node;
+	int			nodeCount;
+	int			depth;
+
+	// The boxes, in the order the leaves use them, and the index of
+	// each in the original array
+
+	AABB3	*box;
+	int	*boxIndex;
+	int	boxCount;
+
+private:
+
+	// Not copyable
+
+	AABBTreeWide(const AABBTreeWide &);
+	AABBTreeWide &operator=(const AABBTreeWide &);
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __AABBTREEWIDE_H_INCLUDED__
@@ -0,0 +1,577 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AnimationClip.cpp - Keyframed skeletal animation
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <stdlib.h>
+
+#include "AnimationClip.h"
+#include "Quaternion.h"
+#include "Matrix4x3.h"
+#include "MatrixDecompose.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Sampling a pose is done in three passes over blocks of tracks:
+//
+// 1. For each track, find the two keys on either side of the time and
+//    the fraction of the way between them.  The sampler's cursor is where
+//    we start looking, so this is normally a compare or two.
+//
+// 2. Slerp the whole block of rotations at once with slerpBatch(), or
+//    squad them with squadBatch().
+//
+// 3. Build the matrices, kSimdWidth at a time.
+//
+// The translations and scales are lerped in the first pass, while we
+// have the keys in hand.
+//
+// The blocks are small enough that the scratch arrays live on the stack
+// and stay in the cache, so sampling doesn't allocate any memory.
+//
+// When animating many instances, sampleInstances() spreads the instances
+// across the worker threads.  Each instance is sampled serially; the
+// slerpBatch() inside is a nested parallel loop, so it runs serially too.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kTracksPerBlock = 64;
+const int	kMinInstancesPerChunk = 8;
+
+// How many keys the cursor steps forward before giving up and searching
+
+const int	kMaxCursorSteps = 4;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// searchKeys
+//
+// Binary search for the last key in [lo, hi] whose time is <= t.  Returns
+// lo if there isn't one.
+
+static int	searchKeys(const float *keyTime, int lo, int hi, float t) {
+	while (lo < hi) {
+		int	mid = (lo + hi + 1) >> 1;
+		if (keyTime[mid] <= t) {
+			lo = mid;
+		} else {
+			hi = mid - 1;
+		}
+	}
+	return lo;
+}
+
+//---------------------------------------------------------------------------
+// findSegment
+//
+// Find the key at the start of the segment containing time t, among
+// keyCount keys.  The result is in [0, keyCount - 2] (or 0 if there is
+// only one key.)  cursor is the answer from last time, and is updated.
+
+static int	findSegment(const float *keyTime, int keyCount, float t, int &cursor) {
+	int	last = keyCount - 2;
+	if (last <= 0) {
+		cursor = 0;
+		return 0;
+	}
+
+	int	k = (cursor < last) ? cursor : last;
+	if (t >= keyTime[k]) {
+
+		// Moving forward.  Usually we're still in the same segment,
+		// or have only gone on to the next one.
+
+		for (int step = 0 ; step < kMaxCursorSteps && k < last && t >= keyTime[k + 1] ; ++step) {
+			++k;
+		}
+		if (k < last && t >= keyTime[k + 1]) {
+			k = searchKeys(keyTime, k + 1, last, t);
+		}
+	} else if (k > 0) {
+
+		// Went backwards
+
+		k = searchKeys(keyTime, 0, k - 1, t);
+	}
+
+	cursor = k;
+	return k;
+}
+
+//---------------------------------------------------------------------------
+// PoseBlock
+//
+// Scratch space for sampling one block of tracks.  Everything is stored
+// in SIMD lanes except the rotations, which slerpBatch() wants as
+// quaternions.  The arrays are padded to a whole number of SIMD blocks.
+
+struct PoseBlock {
+	Quaternion	q0[kTracksPerBlock];
+	Quaternion	q1[kTracksPerBlock];
+	Quaternion	a0[kTracksPerBlock];
+	Quaternion	a1[kTracksPerBlock];
+	Quaternion	q[kTracksPerBlock];
+	float		t[kTracksPerBlock];
+	float		sx[kTracksPerBlock], sy[kTracksPerBlock], sz[kTracksPerBlock];
+	float		px[kTracksPerBlock], py[kTracksPerBlock], pz[kTracksPerBlock];
+};
+
+//---------------------------------------------------------------------------
+// buildMatrices
+//
+// Setup the local->parent matrices for tracks [0, n) of a block: scale,
+// then rotate, then translate.  The rotation part is the same as
+// Matrix4x3::fromQuaternion(); each row is then multiplied by the scale
+// along that axis.  kSimdWidth matrices are computed at a time.
+
+static void	buildMatrices(const PoseBlock &b, int n, Matrix4x3 *localToParent) {
+	for (int base = 0 ; base < n ; base += kSimdWidth) {
+		SimdFloat	w, x, y, z;
+		simdLoadTranspose4(&b.q[base].w, w, x, y, z);
+
+		SimdFloat	one = simdSet1(1.0f);
+		SimdFloat	ww = w + w;
+		SimdFloat	xx = x + x;
+		SimdFloat	yy = y + y;
+		SimdFloat	zz = z + z;
+		SimdFloat	sx = simdLoadU(b.sx + base);
+		SimdFloat	sy = simdLoadU(b.sy + base);
+		SimdFloat	sz = simdLoadU(b.sz + base);
+
+		float	m[9][kSimdMaxWidth];
+		simdStoreU(m[0], sx * (one - yy*y - zz*z));
+		simdStoreU(m[1], sx * (xx*y + ww*z));
+		simdStoreU(m[2], sx * (xx*z - ww*y));
+		simdStoreU(m[3], sy * (xx*y - ww*z));
+		simdStoreU(m[4], sy * (one - xx*x - zz*z));
+		simdStoreU(m[5], sy * (yy*z + ww*x));
+		simdStoreU(m[6], sz * (xx*z + ww*y));
+		simdStoreU(m[7], sz * (yy*z - ww*x));
+		simdStoreU(m[8], sz * (one - xx*x - yy*y));
+
+		int	count = (n - base < kSimdWidth) ? n - base : kSimdWidth;
+		for (int lane = 0 ; lane < count ; ++lane) {
+			int		i = base + lane;
+			Matrix4x3	&r = localToParent[i];
+			r.m11 = m[0][lane]; r.m12 = m[1][lane]; r.m13 = m[2][lane];
+			r.m21 = m[3][lane]; r.m22 = m[4][lane]; r.m23 = m[5][lane];
+			r.m31 = m[6][lane]; r.m32 = m[7][lane]; r.m33 = m[8][lane];
+			r.tx = b.px[i];
+			r.ty = b.py[i];
+			r.tz = b.pz[i];
+
+			if (b.sx[i] != b.sy[i] || b.sx[i] != b.sz[i]) {
+				r.transformType = eTransformTypeAffine;
+			} else if (b.sx[i] != 1.0f) {
+				r.transformType = eTransformTypeSimilarity;
+			} else {
+				r.transformType = eTransformTypeRigid;
+			}
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AnimationClip member functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// AnimationClip::AnimationClip
+//
+// Constructor - reset internal variables to default (empty) state
+
+AnimationClip::AnimationClip() {
+	trackCount = 0;
+	trackFirstKey = NULL;
+	duration = 0.0f;
+	rotationInterpolation = eRotationSlerp;
+	keyTime = NULL;
+	keyRotation = NULL;
+	keyTangent = NULL;
+}
+
+//---------------------------------------------------------------------------
+// AnimationClip::~AnimationClip
+//
+// Destructor - free up any allocated memory
+
+AnimationClip::~AnimationClip() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// AnimationClip::allocateMemory
+//
+// Allocate the tracks and keys
+
+void	AnimationClip::allocateMemory(int nTrackCount, const int *keyCount) {
+
+	// First, make sure and free any memory already allocated
+
+	freeMemory();
+
+	// Lay out the tracks
+
+	trackCount = nTrackCount;
+	trackFirstKey = new int[trackCount + 1];
+	trackFirstKey[0] = 0;
+	for (int i = 0 ; i < trackCount ; ++i) {
+		assert(keyCount[i] >= 1);
+		trackFirstKey[i + 1] = trackFirstKey[i] + keyCount[i];
+	}
+
+	// Allocate the keys, and set them to the identity
+
+	int	totalKeyCount = trackFirstKey[trackCount];
+	keyTime = new float[totalKeyCount];
+	keyRotation = new Quaternion[totalKeyCount];
+	keyTranslation.resize(totalKeyCount);
+	keyScale.resize(totalKeyCount);
+	for (int i = 0 ; i < totalKeyCount ; ++i) {
+		keyTime[i] = 0.0f;
+		keyRotation[i] = kQuaternionIdentity;
+		keyTranslation.set(i, kZeroVector);
+		keyScale.set(i, Vector3(1.0f, 1.0f, 1.0f));
+	}
+
+	// The tangents of identity keys are the identity
+
+	if (rotationInterpolation == eRotationSquad) {
+		keyTangent = new Quaternion[totalKeyCount];
+		for (int i = 0 ; i < totalKeyCount ; ++i) {
+			keyTangent[i] = kQuaternionIdentity;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// AnimationClip::freeMemory
+//
+// Free up any memory and reset object to default state.  The rotation
+// interpolation mode is kept.
+
+void	AnimationClip::freeMemory() {
+	delete [] trackFirstKey;
+	delete [] keyTime;
+	delete [] keyRotation;
+	delete [] keyTangent;
+	keyTranslation.freeMemory();
+	keyScale.freeMemory();
+	trackFirstKey = NULL;
+	keyTime = NULL;
+	keyRotation = NULL;
+	keyTangent = NULL;
+	trackCount = 0;
+	duration = 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// AnimationClip::setKey
+//
+// Fill in one key.  Without a scale, the key has no scale.  A matrix is
+// split into rotation, translation and scale.
+
+void	AnimationClip::setKey(int track, int key, float time, const Quaternion &rotation,
+	const Vector3 &translation) {
+
+	setKey(track, key, time, rotation, translation, Vector3(1.0f, 1.0f, 1.0f));
+}
+
+void	AnimationClip::setKey(int track, int key, float time, const Quaternion &rotation,
+	const Vector3 &translation, const Vector3 &scale) {
+
+	assert(track >= 0 && track < trackCount);
+	assert(key >= 0 && key < getKeyCount(track));
+
+	int	i = trackFirstKey[track] + key;
+
+	// Keys must be in order
+
+	assert(key == 0 || time >= keyTime[i - 1]);
+
+	keyTime[i] = time;
+	keyRotation[i] = rotation;
+	keyTranslation.set(i, translation);
+	keyScale.set(i, scale);
+
+	if (time > duration) {
+		duration = time;
+	}
+
+	// The tangents of this key and its neighbors depend on it
+
+	if (keyTangent != NULL) {
+		updateTangents(track, key - 1, key + 1);
+	}
+}
+
+void	AnimationClip::setKey(int track, int key, float time, const Matrix4x3 &localToParent) {
+	Quaternion	rotation;
+	Vector3		translation, scale;
+	decomposeTRS(localToParent, rotation, translation, scale);
+	setKey(track, key, time, rotation, translation, scale);
+}
+
+//---------------------------------------------------------------------------
+// AnimationClip::setRotationInterpolation
+//
+// Switch between slerp and squad.  The tangents are only kept for squad.
+
+void	AnimationClip::setRotationInterpolation(ERotationInterpolation mode) {
+	rotationInterpolation = mode;
+
+	if (mode != eRotationSquad) {
+		delete [] keyTangent;
+		keyTangent = NULL;
+		return;
+	}
+
+	if (keyTangent == NULL && trackCount > 0) {
+		keyTangent = new Quaternion[trackFirstKey[trackCount]];
+		for (int track = 0 ; track < trackCount ; ++track) {
+			int	first = trackFirstKey[track];
+			computeSquadTangents(keyRotation + first, keyTangent + first, getKeyCount(track));
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// AnimationClip::updateTangents
+//
+// Recompute the squad tangents of keys [firstKey, lastKey] of a track.
+// The range is clipped to the track.
+
+void	AnimationClip::updateTangents(int track, int firstKey, int lastKey) {
+	int	keyCount = getKeyCount(track);
+	if (firstKey < 0) firstKey = 0;
+	if (lastKey > keyCount - 1) lastKey = keyCount - 1;
+
+	const Quaternion	*key = keyRotation + trackFirstKey[track];
+	Quaternion		*tangent = keyTangent + trackFirstKey[track];
+	for (int k = firstKey ; k <= lastKey ; ++k) {
+		if (k == 0 || k == keyCount - 1) {
+			tangent[k] = key[k];
+		} else {
+			tangent[k] = squadTangent(key[k - 1], key[k], key[k + 1]);
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class AnimationSampler member functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// AnimationSampler::AnimationSampler
+//
+// Constructors.  The default one isn't attached to any clip.
+
+AnimationSampler::AnimationSampler() {
+	clip = NULL;
+	cursor = NULL;
+}
+
+AnimationSampler::AnimationSampler(const AnimationSampler &s) {
+	clip = NULL;
+	cursor = NULL;
+	*this = s;
+}
+
+//---------------------------------------------------------------------------
+// AnimationSampler::~AnimationSampler
+//
+// Destructor - free the cursors
+
+AnimationSampler::~AnimationSampler() {
+	delete [] cursor;
+}
+
+//---------------------------------------------------------------------------
+// AnimationSampler::operator=
+//
+// Bind to the same clip, and pick up where the other sampler left off
+
+AnimationSampler &AnimationSampler::operator=(const AnimationSampler &s) {
+
+	// Check for assignment to self
+
+	if (&s == this) {
+		return *this;
+	}
+
+	bind(s.clip);
+	if (clip != NULL) {
+		for (int i = 0 ; i < clip->getTrackCount() ; ++i) {
+			cursor[i] = s.cursor[i];
+		}
+	}
+	return *this;
+}
+
+//---------------------------------------------------------------------------
+// AnimationSampler::bind
+//
+// Attach to a clip, and start each track at its first key
+
+void	AnimationSampler::bind(const AnimationClip *c) {
+	delete [] cursor;
+	cursor = NULL;
+	clip = c;
+	if (clip != NULL) {
+		cursor = new int[clip->getTrackCount()];
+		reset();
+	}
+}
+
+//---------------------------------------------------------------------------
+// AnimationSampler::reset
+//
+// Start looking for keys from the beginning of each track
+
+void	AnimationSampler::reset() {
+	if (clip == NULL) {
+		return;
+	}
+	for (int i = 0 ; i < clip->getTrackCount() ; ++i) {
+		cursor[i] = 0;
+	}
+}
+
+//---------------------------------------------------------------------------
+// AnimationSampler::sample
+//
+// Compute the pose at a given time.  See the notes at the top of the file.
+
+void	AnimationSampler::sample(float time, Matrix4x3 *localToParent, ESlerpMode mode) {
+	assert(clip != NULL);
+
+	const float		*keyTime = clip->getKeyTimes();
+	const Quaternion	*keyRotation = clip->getRotationKeys();
+	const Quaternion	*keyTangent = clip->getRotationTangents();
+	const Vector3Array	&keyTranslation = clip->getTranslationKeys();
+	const Vector3Array	&keyScale = clip->getScaleKeys();
+
+	PoseBlock	b;
+
+	int	trackCount = clip->getTrackCount();
+	for (int base = 0 ; base < trackCount ; base += kTracksPerBlock) {
+		int	n = trackCount - base;
+		if (n > kTracksPerBlock) {
+			n = kTracksPerBlock;
+		}
+
+		// Find the keys on either side of the time, and lerp the
+		// translation and scale
+
+		for (int i = 0 ; i < n ; ++i) {
+			int	track = base + i;
+			int	first = clip->getFirstKey(track);
+			int	keyCount = clip->getKeyCount(track);
+			int	k = first + findSegment(keyTime + first, keyCount, time, cursor[track]);
+			int	k1 = (keyCount > 1) ? k + 1 : k;
+
+			// Fraction of the way from key k to key k1, clamped so
+			// times outside the track hold the end keys
+
+			float	span = keyTime[k1] - keyTime[k];
+			float	f = (span > 0.0f) ? (time - keyTime[k]) / span : 0.0f;
+			if (f < 0.0f) f = 0.0f;
+			if (f > 1.0f) f = 1.0f;
+
+			b.q0[i] = keyRotation[k];
+			b.q1[i] = keyRotation[k1];
+			if (keyTangent != NULL) {
+				b.a0[i] = keyTangent[k];
+				b.a1[i] = keyTangent[k1];
+			}
+			b.t[i] = f;
+			b.sx[i] = keyScale.x[k] + (keyScale.x[k1] - keyScale.x[k]) * f;
+			b.sy[i] = keyScale.y[k] + (keyScale.y[k1] - keyScale.y[k]) * f;
+			b.sz[i] = keyScale.z[k] + (keyScale.z[k1] - keyScale.z[k]) * f;
+			b.px[i] = keyTranslation.x[k] + (keyTranslation.x[k1] - keyTranslation.x[k]) * f;
+			b.py[i] = keyTranslation.y[k] + (keyTranslation.y[k1] - keyTranslation.y[k]) * f;
+			b.pz[i] = keyTranslation.z[k] + (keyTranslation.z[k1] - keyTranslation.z[k]) * f;
+		}
+
+		// Interpolate all the rotations at once
+
+		if (keyTangent != NULL) {
+			squadBatch(b.q0, b.a0, b.a1, b.q1, b.t, b.q, n, mode);
+		} else {
+			slerpBatch(b.q0, b.q1, b.t, b.q, n, mode);
+		}
+
+		// Pad out the last SIMD block, and build the matrices
+
+		for (int i = n ; i < kTracksPerBlock && (i % kSimdWidth) != 0 ; ++i) {
+			b.q[i] = kQuaternionIdentity;
+			b.sx[i] = b.sy[i] = b.sz[i] = 1.0f;
+		}
+		buildMatrices(b, n, localToParent + base);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// SampleJob
+//
+// Parameters for sampleInstances(), passed to parallelFor
+
+struct SampleJob {
+	AnimationSampler	*samplers;
+	const float		*time;
+	Matrix4x3 *const	*localToParent;
+	ESlerpMode		mode;
+};
+
+//---------------------------------------------------------------------------
+// sampleRange
+//
+// Sample instances [begin, end) of a job
+
+static void	sampleRange(int begin, int end, void *context) {
+	const SampleJob *job = (const SampleJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		job->samplers[i].sample(job->time[i], job->localToParent[i], job->mode);
+	}
+}
+
+//---------------------------------------------------------------------------
+// sampleInstances
+//
+// Sample many instances, in parallel
+
+void	sampleInstances(AnimationSampler *samplers, const float *time,
+	Matrix4x3 *const *localToParent, int instanceCount, ESlerpMode mode) {
+
+	SampleJob	job;
+	job.samplers = samplers;
+	job.time = time;
+	job.localToParent = localToParent;
+	job.mode = mode;
+	parallelFor(instanceCount, kMinInstancesPerChunk, &sampleRange, &job);
+}
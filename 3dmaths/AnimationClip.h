@@ -0,0 +1,192 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// AnimationClip.h - Keyframed skeletal animation
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see AnimationClip.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __ANIMATIONCLIP_H_INCLUDED__
+#define __ANIMATIONCLIP_H_INCLUDED__
+
+#ifndef __VECTOR3ARRAY_H_INCLUDED__
+	#include "Vector3Array.h"
+#endif
+
+#ifndef __QUATERNIONBATCH_H_INCLUDED__
+	#include "QuaternionBatch.h"
+#endif
+
+class Quaternion;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// AnimationClip
+//
+// A clip animates a number of tracks, usually one per bone.  Each track
+// has its own list of keys, and each key holds a time, a rotation, a
+// translation and a scale.  Between keys the rotation is slerped and the
+// translation and scale are lerped.
+//
+// The keys of all the tracks are stored together, one array per field,
+// and the keys of each track are contiguous and sorted by time.
+//
+// The rotation is the object->inertial rotation, the same one
+// Quaternion::setToRotateObjectToInertial() gives.  So a key matches the
+// matrix Matrix4x3::setupLocalToParent() computes from the same
+// orientation and position (with the scale applied first.)
+//
+// With eRotationSquad, the rotations are interpolated with squad
+// instead, which is smooth through the keys rather than just continuous.
+// A smooth path then needs far fewer keys.  The tangent quaternions are
+// kept with the keys, and updated as keys are set.  Squad assumes the
+// keys of a track are roughly evenly spaced in time.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+enum ERotationInterpolation {
+	eRotationSlerp,
+	eRotationSquad
+};
+
+class AnimationClip {
+public:
+	AnimationClip();
+	~AnimationClip();
+
+	// Memory allocation.  keyCount[i] is the number of keys in
+	// track i, which must be at least 1.  Keys are initialized to
+	// time 0 with no rotation, translation or scale.
+
+	void	allocateMemory(int nTrackCount, const int *keyCount);
+	void	freeMemory();
+
+	// Accessors
+
+	int	getTrackCount() const { return trackCount; }
+	int	getKeyCount(int track) const { return trackFirstKey[track + 1] - trackFirstKey[track]; }
+	float	getDuration() const { return duration; }
+	ERotationInterpolation	getRotationInterpolation() const { return rotationInterpolation; }
+
+	// Fill in key number key of a track.  Fill in the keys of each
+	// track in order of increasing time.
+
+	void	setKey(int track, int key, float time, const Quaternion &rotation,
+			const Vector3 &translation);
+	void	setKey(int track, int key, float time, const Quaternion &rotation,
+			const Vector3 &translation, const Vector3 &scale);
+
+	// Fill in a key from a local->parent matrix, when baking an
+	// animation.  The matrix is split up with decomposeTRS(); any
+	// skew is lost.
+
+	void	setKey(int track, int key, float time, const Matrix4x3 &localToParent);
+
+	// Choose how rotations are interpolated.  Switching to squad
+	// computes the tangents of all the keys set so far.
+
+	void	setRotationInterpolation(ERotationInterpolation mode);
+
+	// Direct access to the key arrays.  The keys of a track start at
+	// index getFirstKey(track).
+
+	int			getFirstKey(int track) const { return trackFirstKey[track]; }
+	const float		*getKeyTimes() const { return keyTime; }
+	const Quaternion	*getRotationKeys() const { return keyRotation; }
+	const Quaternion	*getRotationTangents() const { return keyTangent; }	// NULL unless squad
+	const Vector3Array	&getTranslationKeys() const { return keyTranslation; }
+	const Vector3Array	&getScaleKeys() const { return keyScale; }
+
+protected:
+
+	void	updateTangents(int track, int firstKey, int lastKey);
+
+	int		trackCount;
+	int		*trackFirstKey;		// trackCount + 1 entries; the last is the total key count
+	float		duration;		// time of the last key of any track
+	ERotationInterpolation	rotationInterpolation;
+
+	// Key data, one entry per key
+
+	float		*keyTime;
+	Quaternion	*keyRotation;
+	Quaternion	*keyTangent;		// squad tangents, or NULL
+	Vector3Array	keyTranslation;
+	Vector3Array	keyScale;
+
+private:
+
+	// Not copyable
+
+	AnimationClip(const AnimationClip &);
+	AnimationClip &operator=(const AnimationClip &);
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// AnimationSampler
+//
+// Plays back a clip on one instance.  The sampler remembers which pair of
+// keys each track used last time, so when the time moves forward a
+// little each frame, as it usually does, finding the keys takes constant
+// time rather than a search.  Jumping backwards, such as when a looping
+// clip wraps around, falls back to a binary search.
+//
+// The pose is written as one local->parent matrix per track, ready for
+// flattenHierarchy() in Matrix4x3Batch.h, or for rendering in place of
+// Renderer::instance().
+//
+/////////////////////////////////////////////////////////////////////////////
+
+class AnimationSampler {
+public:
+	AnimationSampler();
+	AnimationSampler(const AnimationSampler &s);
+	~AnimationSampler();
+
+	// Copies are bound to the same clip, with their own copy of the
+	// cached key positions, so samplers can be kept in a std::vector
+
+	AnimationSampler &operator=(const AnimationSampler &s);
+
+	// Attach to a clip.  The clip must outlive the sampler, or be
+	// bound to again after it changes.
+
+	void	bind(const AnimationClip *clip);
+
+	// Forget the cached key positions
+
+	void	reset();
+
+	const AnimationClip	*getClip() const { return clip; }
+
+	// Evaluate the clip at the given time.  localToParent must have
+	// room for one matrix per track.  Times outside the clip hold the
+	// first or last key.
+
+	void	sample(float time, Matrix4x3 *localToParent, ESlerpMode mode = eSlerpModeFast);
+
+protected:
+
+	const AnimationClip	*clip;
+	int			*cursor;	// per track, the key at the start of the last segment used
+};
+
+//---------------------------------------------------------------------------
+// Sample many instances at once
+//
+// Instance i samples samplers[i] at time[i] into the pose localToParent[i].
+// The instances are spread across the worker threads.
+
+void	sampleInstances(AnimationSampler *samplers, const float *time,
+		Matrix4x3 *const *localToParent, int instanceCount,
+		ESlerpMode mode = eSlerpModeFast);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __ANIMATIONCLIP_H_INCLUDED__
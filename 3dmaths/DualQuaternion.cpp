@@ -0,0 +1,260 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// DualQuaternion.cpp - DualQuaternion implementation
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+
+#include "DualQuaternion.h"
+#include "Matrix4x3.h"
+#include "MatrixDecompose.h"
+#include "vector3.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// A dual quaternion is r + e*d, where r and d are ordinary quaternions and
+// e*e = 0.  To represent rotation by r followed by translation by t, the
+// dual part is d = (1/2) t r, where t is the quaternion [0, t] and the
+// product uses the standard definition of quaternion multiplication.  The
+// translation comes back out as t = 2 d r*.
+//
+// Quaternion::operator* multiplies in the opposite order from the
+// standard definition (see 10.4.8), so the products in this file are
+// written out longhand to avoid confusion.
+//
+// A point is transformed by rotating it by r, then adding t.  The rotation
+// uses the usual shortcut for a unit quaternion r = [w, v]:
+//
+//	c = 2 (v x p)
+//	p' = p + w c + v x c
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// hamilton
+//
+// Standard quaternion product a b
+
+static Quaternion	hamilton(const Quaternion &a, const Quaternion &b) {
+	Quaternion	r;
+	r.w = a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z;
+	r.x = a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y;
+	r.y = a.w*b.y + a.y*b.w + a.z*b.x - a.x*b.z;
+	r.z = a.w*b.z + a.z*b.w + a.x*b.y - a.y*b.x;
+	return r;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class DualQuaternion members
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// DualQuaternion::identity
+//
+// Set to the identity transform
+
+void	DualQuaternion::identity() {
+	real.identity();
+	dual.w = dual.x = dual.y = dual.z = 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternion::setup
+//
+// Setup to rotate, then translate.  d = (1/2) t r
+
+void	DualQuaternion::setup(const Quaternion &rotation, const Vector3 &translation) {
+	real = rotation;
+
+	Quaternion	t;
+	t.w = 0.0f;
+	t.x = translation.x * 0.5f;
+	t.y = translation.y * 0.5f;
+	t.z = translation.z * 0.5f;
+	dual = hamilton(t, real);
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternion::fromMatrix4x3
+//
+// Convert from a rigid matrix
+
+void	DualQuaternion::fromMatrix4x3(const Matrix4x3 &m) {
+
+	// Anything with scale or reflection can't be represented
+
+	assert(m.transformType <= eTransformTypeRigid || fabs(determinant(m) - 1.0f) < 0.01f);
+
+	setup(rotationFromMatrix(m), Vector3(m.tx, m.ty, m.tz));
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternion::toMatrix4x3
+//
+// Convert to a matrix
+
+void	DualQuaternion::toMatrix4x3(Matrix4x3 &m) const {
+	m.fromQuaternion(real);
+	m.setTranslation(getTranslation());
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternion::getTranslation
+//
+// Extract the translation.  t = 2 d r*, which works out to
+// 2 (w_r v_d - w_d v_r + v_r x v_d)
+
+Vector3	DualQuaternion::getTranslation() const {
+	return Vector3(
+		2.0f * (real.w*dual.x - dual.w*real.x + real.y*dual.z - real.z*dual.y),
+		2.0f * (real.w*dual.y - dual.w*real.y + real.z*dual.x - real.x*dual.z),
+		2.0f * (real.w*dual.z - dual.w*real.z + real.x*dual.y - real.y*dual.x)
+	);
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternion::operator *
+//
+// Concatenation: apply this transform, then a.  In the standard order,
+// that's a * this:
+//
+//	real = a.r this.r
+//	dual = a.r this.d + a.d this.r
+
+DualQuaternion DualQuaternion::operator *(const DualQuaternion &a) const {
+	DualQuaternion	result;
+
+	result.real = hamilton(a.real, real);
+
+	Quaternion	d1 = hamilton(a.real, dual);
+	Quaternion	d2 = hamilton(a.dual, real);
+	result.dual.w = d1.w + d2.w;
+	result.dual.x = d1.x + d2.x;
+	result.dual.y = d1.y + d2.y;
+	result.dual.z = d1.z + d2.z;
+
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternion::normalize
+//
+// Divide through by the magnitude of the real part, and then remove the
+// component of the dual part that is parallel to the real part.  (For a
+// unit dual quaternion, r . d = 0.)
+
+void	DualQuaternion::normalize() {
+
+	float	mag = (float)sqrt(dotProduct(real, real));
+
+	if (mag > 0.0f) {
+		float	oneOverMag = 1.0f / mag;
+		real.w *= oneOverMag; real.x *= oneOverMag; real.y *= oneOverMag; real.z *= oneOverMag;
+		dual.w *= oneOverMag; dual.x *= oneOverMag; dual.y *= oneOverMag; dual.z *= oneOverMag;
+
+		float	k = dotProduct(real, dual);
+		dual.w -= real.w * k;
+		dual.x -= real.x * k;
+		dual.y -= real.y * k;
+		dual.z -= real.z * k;
+	} else {
+
+		// Houston, we have a problem
+
+		assert(false);
+
+		// In a release build, just slam it to something
+
+		identity();
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Nonmember functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// operator *
+//
+// Transform a point.  Rotate by the real part, then translate
+
+Vector3	operator*(const Vector3 &p, const DualQuaternion &dq) {
+	return transformNormal(p, dq) + dq.getTranslation();
+}
+
+//---------------------------------------------------------------------------
+// transformNormal
+//
+// Rotate a vector by the real part.  See the notes at the top of the file.
+
+Vector3	transformNormal(const Vector3 &n, const DualQuaternion &dq) {
+	const Quaternion &r = dq.real;
+	Vector3	v(r.x, r.y, r.z);
+	Vector3	c = crossProduct(v, n) * 2.0f;
+	return n + c * r.w + crossProduct(v, c);
+}
+
+//---------------------------------------------------------------------------
+// blend
+//
+// Dual quaternion linear blending.  See DualQuaternion.h
+
+DualQuaternion blend(const DualQuaternion *dq, const float *weight, int count) {
+	assert(count > 0);
+
+	DualQuaternion	result;
+	result.real.w = result.real.x = result.real.y = result.real.z = 0.0f;
+	result.dual.w = result.dual.x = result.dual.y = result.dual.z = 0.0f;
+
+	for (int i = 0 ; i < count ; ++i) {
+
+		// q and -q are the same transform, so use the one on
+		// the same side as the first, to take the short way
+
+		float	w = weight[i];
+		if (dotProduct(dq[i].real, dq[0].real) < 0.0f) {
+			w = -w;
+		}
+
+		result.real.w += dq[i].real.w * w;
+		result.real.x += dq[i].real.x * w;
+		result.real.y += dq[i].real.y * w;
+		result.real.z += dq[i].real.z * w;
+		result.dual.w += dq[i].dual.w * w;
+		result.dual.x += dq[i].dual.x * w;
+		result.dual.y += dq[i].dual.y * w;
+		result.dual.z += dq[i].dual.z * w;
+	}
+
+	result.normalize();
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// convertPalette
+//
+// Convert an array of rigid matrices to dual quaternions
+
+void	convertPalette(const Matrix4x3 *src, DualQuaternion *dst, int count) {
+	for (int i = 0 ; i < count ; ++i) {
+		dst[i].fromMatrix4x3(src[i]);
+	}
+}
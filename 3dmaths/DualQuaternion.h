@@ -0,0 +1,107 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// DualQuaternion.h - Declarations for class DualQuaternion
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see DualQuaternion.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __DUALQUATERNION_H_INCLUDED__
+#define __DUALQUATERNION_H_INCLUDED__
+
+#ifndef __QUATERNION_H_INCLUDED__
+	#include "Quaternion.h"
+#endif
+
+template <class T> class TVector3;
+typedef TVector3<float> Vector3;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
+
+//---------------------------------------------------------------------------
+// class DualQuaternion
+//
+// A rigid transformation (rotation followed by translation) stored as a
+// unit dual quaternion.  This takes 8 floats rather than the 12 of a
+// Matrix4x3, and unlike matrices, dual quaternions can be blended
+// without the result shrinking, which is why they are used for skinning.
+
+class DualQuaternion {
+public:
+
+// Public data
+
+	// The real part is the rotation.  The dual part encodes the
+	// translation t as (1/2) t r, with t treated as a quaternion with
+	// zero w.  (Standard multiplication order, not the order used by
+	// Quaternion::operator*.)  See DualQuaternion.cpp for the details.
+
+	Quaternion	real;
+	Quaternion	dual;
+
+// Public operations
+
+	// Set to identity
+
+	void	identity();
+
+	// Setup to rotate and then translate
+
+	void	setup(const Quaternion &rotation, const Vector3 &translation);
+
+	// Convert from a rigid transformation matrix.  The matrix must not
+	// contain scale, skew, or reflection.
+
+	void	fromMatrix4x3(const Matrix4x3 &m);
+
+	// Convert back to a matrix
+
+	void	toMatrix4x3(Matrix4x3 &m) const;
+
+	// Extract the rotation and translation
+
+	const Quaternion	&getRotation() const { return real; }
+	Vector3			getTranslation() const;
+
+	// Concatenation.  Like Quaternion::operator*, the order of
+	// multiplication, from left to right, is the order that the
+	// transformations are applied.
+
+	DualQuaternion operator *(const DualQuaternion &a) const;
+
+	// Restore unit length, and make the dual part perpendicular to the
+	// real part, to combat floating point error creep
+
+	void	normalize();
+};
+
+// A global "identity" dual quaternion constant, built at compile time
+
+constexpr DualQuaternion kDualQuaternionIdentity = {
+	{ 1.0f, 0.0f, 0.0f, 0.0f },
+	{ 0.0f, 0.0f, 0.0f, 0.0f }
+};
+
+// Transform a point (rotation and translation), and a direction or
+// surface normal (rotation only)
+
+extern Vector3	operator*(const Vector3 &p, const DualQuaternion &dq);
+extern Vector3	transformNormal(const Vector3 &n, const DualQuaternion &dq);
+
+// Dual quaternion linear blending.  Returns the normalized weighted sum of
+// count transforms.  Each quaternion is flipped if necessary to lie in the
+// same hemisphere as the first one, so the blend takes the short way
+// around.
+
+extern DualQuaternion blend(const DualQuaternion *dq, const float *weight, int count);
+
+// Convert an array of rigid matrices, such as a bone palette
+
+extern void	convertPalette(const Matrix4x3 *src, DualQuaternion *dst, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __DUALQUATERNION_H_INCLUDED__
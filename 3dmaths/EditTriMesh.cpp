@@ -19,6 +19,7 @@
 #include "EditTriMesh.h"
 #include "CommonStuff.h"
 #include "Matrix4x3.h"
+#include "Matrix4x3Batch.h"
 #include "AABB3.h"
 
 /////////////////////////////////////////////////////////////////////////////
@@ -1504,11 +1505,15 @@ void	EditTriMesh::detachAllFaces() {
 //
 // Transform all the vertices.  We could transform the surface normals,
 // but they may not even be valid, anyway.  If you need them, compute them.
+//
+// The positions are transformed in place, right inside the vertex list,
+// using the batch transform.
 
 void	EditTriMesh::transformVertices(const Matrix4x3 &m) {
-	for (int i = 0 ; i < vertexCount() ; ++i) {
-		vertex(i).p *= m;
+	if (vCount < 1) {
+		return;
 	}
+	transformPoints(m, &vList[0].p, &vList[0].p, vCount, sizeof(Vertex), sizeof(Vertex));
 }
 
 //---------------------------------------------------------------------------
@@ -33,24 +33,6 @@
 //
 /////////////////////////////////////////////////////////////////////////////
 
-/////////////////////////////////////////////////////////////////////////////
-//
-// ȫ
-// global data
-//
-/////////////////////////////////////////////////////////////////////////////
-
-// ȫ֡λŷǳǲȷ֪ܱĹϵ
-// пڳʼ֮ǰοȻڴ󲿷ֵʵ֣ڳʼʱǷʼ
-// κ屻֮ǰ
-// The global "identity" Euler angle constant.  Now we may not know exactly
-// when this object may get constructed, in relation to other objects, so
-// it is possible for the object to be referenced before it is initialized.
-// However, on most implementations, it will be zero-initialized at program
-// startup anyway, before any other objects are constructed.
-
-const EulerAngles kEulerAnglesIdentity(0.0f, 0.0f, 0.0f);
-
 /////////////////////////////////////////////////////////////////////////////
 //
 // ŷʵ
@@ -149,7 +131,7 @@ void	EulerAngles::fromObjectToInertialQuaternion(const Quaternion &q) {
 		// headingbankΪ0
 		// Compute heading, slam bank to zero
 
-		heading = atan2(-q.x*q.z + q.w*q.y, 0.5f - q.y*q.y - q.z*q.z);
+		heading = safeAtan2(-q.x*q.z + q.w*q.y, 0.5f - q.y*q.y - q.z*q.z);
 		bank = 0.0f;
 
 	} else {
@@ -159,9 +141,9 @@ void	EulerAngles::fromObjectToInertialQuaternion(const Quaternion &q) {
 		// function because we already checked for range errors when
 		// checking for Gimbel lock
 
-		pitch	= asin(sp);
-		heading	= atan2(q.x*q.z + q.w*q.y, 0.5f - q.x*q.x - q.y*q.y);
-		bank	= atan2(q.x*q.y + q.w*q.z, 0.5f - q.x*q.x - q.z*q.z);
+		pitch	= safeAsin(sp);
+		heading	= safeAtan2(q.x*q.z + q.w*q.y, 0.5f - q.x*q.x - q.y*q.y);
+		bank	= safeAtan2(q.x*q.y + q.w*q.z, 0.5f - q.x*q.x - q.z*q.z);
 	}
 }
 
@@ -194,7 +176,7 @@ void	EulerAngles::fromInertialToObjectQuaternion(const Quaternion &q) {
 		// headingbankΪ0
 		// Compute heading, slam bank to zero
 
-		heading = atan2(-q.x*q.z - q.w*q.y, 0.5f - q.y*q.y - q.z*q.z);
+		heading = safeAtan2(-q.x*q.z - q.w*q.y, 0.5f - q.y*q.y - q.z*q.z);
 		bank = 0.0f;
 
 	} else {
@@ -204,9 +186,9 @@ void	EulerAngles::fromInertialToObjectQuaternion(const Quaternion &q) {
 		// function because we already checked for range errors when
 		// checking for Gimbel lock
 
-		pitch	= asin(sp);
-		heading	= atan2(q.x*q.z - q.w*q.y, 0.5f - q.x*q.x - q.y*q.y);
-		bank	= atan2(q.x*q.y - q.w*q.z, 0.5f - q.x*q.x - q.z*q.z);
+		pitch	= safeAsin(sp);
+		heading	= safeAtan2(q.x*q.z - q.w*q.y, 0.5f - q.x*q.x - q.y*q.y);
+		bank	= safeAtan2(q.x*q.y - q.w*q.z, 0.5f - q.x*q.x - q.z*q.z);
 	}
 }
 
@@ -232,7 +214,7 @@ void	EulerAngles::fromObjectToWorldMatrix(const Matrix4x3 &m) {
 	// 
 	// Check for Gimbel lock
 	
-	if (fabs(sp) > 9.99999f) {
+	if (fabs(sp) > 0.99999f) {
 
 		// ֱΪֱϻֱ
 		// Looking straight up or down
@@ -242,7 +224,7 @@ void	EulerAngles::fromObjectToWorldMatrix(const Matrix4x3 &m) {
 		// headingbankΪ0
 		// Compute heading, slam bank to zero
 
-		heading = atan2(-m.m23, m.m11);
+		heading = safeAtan2(-m.m13, m.m11);
 		bank = 0.0f;
 
 	} else {
@@ -252,9 +234,9 @@ void	EulerAngles::fromObjectToWorldMatrix(const Matrix4x3 &m) {
 		// function because we already checked for range errors when
 		// checking for Gimbel lock
 
-		heading = atan2(m.m31, m.m33);
-		pitch = asin(sp);
-		bank = atan2(m.m12, m.m22);
+		heading = safeAtan2(m.m31, m.m33);
+		pitch = safeAsin(sp);
+		bank = safeAtan2(m.m12, m.m22);
 	}
 }
 
@@ -281,7 +263,7 @@ void	EulerAngles::fromWorldToObjectMatrix(const Matrix4x3 &m) {
 	// 
 	// Check for Gimbel lock
 	
-	if (fabs(sp) > 9.99999f) {
+	if (fabs(sp) > 0.99999f) {
 
 		// ֱΪֱϻֱ
 		// Looking straight up or down
@@ -291,7 +273,7 @@ void	EulerAngles::fromWorldToObjectMatrix(const Matrix4x3 &m) {
 		// headingbankΪ0
 		// Compute heading, slam bank to zero
 
-		heading = atan2(-m.m31, m.m11);
+		heading = safeAtan2(-m.m31, m.m11);
 		bank = 0.0f;
 
 	} else {
@@ -301,9 +283,9 @@ void	EulerAngles::fromWorldToObjectMatrix(const Matrix4x3 &m) {
 		// function because we already checked for range errors when
 		// checking for Gimbel lock
 
-		heading = atan2(m.m13, m.m33);
-		pitch = asin(sp);
-		bank = atan2(m.m21, m.m22);
+		heading = safeAtan2(m.m13, m.m33);
+		pitch = safeAsin(sp);
+		bank = safeAtan2(m.m21, m.m22);
 	}
 }
 
@@ -326,7 +308,7 @@ void	EulerAngles::fromRotationMatrix(const RotationMatrix &m) {
 	// 
 	// Check for Gimbel lock
 	
-	if (fabs(sp) > 9.99999f) {
+	if (fabs(sp) > 0.99999f) {
 
 		// ֱΪֱϻֱ
 		// Looking straight up or down
@@ -336,7 +318,7 @@ void	EulerAngles::fromRotationMatrix(const RotationMatrix &m) {
 		// headingbankΪ0
 		// Compute heading, slam bank to zero
 
-		heading = atan2(-m.m31, m.m11);
+		heading = safeAtan2(-m.m31, m.m11);
 		bank = 0.0f;
 
 	} else {
@@ -346,8 +328,8 @@ void	EulerAngles::fromRotationMatrix(const RotationMatrix &m) {
 		// function because we already checked for range errors when
 		// checking for Gimbel lock
 
-		heading = atan2(m.m13, m.m33);
-		pitch = asin(sp);
-		bank = atan2(m.m21, m.m22);
+		heading = safeAtan2(m.m13, m.m33);
+		pitch = safeAsin(sp);
+		bank = safeAtan2(m.m21, m.m22);
 	}
 }
@@ -21,7 +21,8 @@
 // Forward declarations
 
 class Quaternion;
-class Matrix4x3;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
 class RotationMatrix;
 
 //---------------------------------------------------------------------------
@@ -50,12 +51,12 @@ public:
 	// ĬϹκι
 	// Default constructor does nothing
 
-	EulerAngles() {}
+	EulerAngles() = default;
 
 	// ֵ
 	// Construct from three values
 
-	EulerAngles(float h, float p, float b) :
+	constexpr EulerAngles(float h, float p, float b) :
 		heading(h), pitch(p), bank(b) {}
 
 	// õλΪ0
@@ -94,10 +95,11 @@ public:
 	void	fromRotationMatrix(const RotationMatrix &m);
 };
 
-// ȫ֡λŷǳ
-// A global "identity" Euler angle constant
+// ȫ֡λŷǳڱڹ죬Բڳʼ˳⡣
+// A global "identity" Euler angle constant.  It's built at compile
+// time, so there is no question of initialization order.
 
-extern const EulerAngles kEulerAnglesIdentity;
+constexpr EulerAngles kEulerAnglesIdentity(0.0f, 0.0f, 0.0f);
 
 /////////////////////////////////////////////////////////////////////////////
 #endif // #ifndef __EULERANGLES_H_INCLUDED__
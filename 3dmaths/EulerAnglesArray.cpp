@@ -0,0 +1,679 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// EulerAnglesArray.cpp - Batch conversions between Euler angles and the
+// other orientation forms
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <string.h>
+
+#include "EulerAnglesArray.h"
+#include "Vector3Array.h"
+#include "RotationMatrix.h"
+#include "Quaternion.h"
+#include "Matrix4x3.h"
+#include "MathUtil.h"
+#include "SimdTrig.h"
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Every conversion works on blocks of kSimdWidth elements.  The Euler
+// angle lanes are padded, so a block always reads or writes them with
+// full SIMD loads and stores, even at the end of the array.  The other
+// side of each conversion is an array of structures; its elements are
+// moved through a small table on the stack, one column per field, so only
+// the elements that really exist are touched.
+//
+// The per-element functions branch on gimbal lock.  Here both answers are
+// computed and the right one is selected for each lane.
+//
+// The trig uses the polynomials from SimdTrig.h.  If the project is built
+// with MATH_FAST_TRIG, we use the same tier as the one-at-a-time
+// functions; otherwise we use the high accuracy tier.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(MATH_FAST_TRIG)
+const ETrigAccuracy	kEulerTrigAccuracy = MATH_FAST_TRIG_ACCURACY;
+#else
+const ETrigAccuracy	kEulerTrigAccuracy = eTrigAccuracyHigh;
+#endif
+
+// Don't bother splitting up batches smaller than this many blocks
+
+const int	kMinEulerBlocksPerChunk = 4096 / kSimdWidth;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class EulerAnglesArray members
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::EulerAnglesArray
+//
+// Constructors
+
+EulerAnglesArray::EulerAnglesArray() {
+	heading = pitch = bank = NULL;
+	eCount = eAlloc = 0;
+}
+
+EulerAnglesArray::EulerAnglesArray(int n) {
+	heading = pitch = bank = NULL;
+	eCount = eAlloc = 0;
+	resize(n);
+}
+
+EulerAnglesArray::EulerAnglesArray(const EulerAnglesArray &a) {
+	heading = pitch = bank = NULL;
+	eCount = eAlloc = 0;
+	*this = a;
+}
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::~EulerAnglesArray
+//
+// Destructor - make sure resources are freed
+
+EulerAnglesArray::~EulerAnglesArray() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::operator=
+//
+// Make a copy of the array
+
+EulerAnglesArray &EulerAnglesArray::operator=(const EulerAnglesArray &a) {
+
+	// Check for assignment to self
+
+	if (&a == this) {
+		return *this;
+	}
+
+	// Copy the lanes
+
+	resize(a.eCount);
+	memcpy(heading, a.heading, eCount * sizeof(float));
+	memcpy(pitch, a.pitch, eCount * sizeof(float));
+	memcpy(bank, a.bank, eCount * sizeof(float));
+
+	// Return reference to l-value
+
+	return *this;
+}
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::resize
+//
+// Set the number of triples in the array.  The lanes are only reallocated
+// if they grow beyond the current capacity.
+
+void	EulerAnglesArray::resize(int n) {
+	assert(n >= 0);
+
+	// Do we have room?
+
+	if (n > eAlloc) {
+
+		// Allocate all three lanes in one block
+
+		int	newAlloc = simdPadCount(n);
+		float	*block = (float *)alignedAlloc(newAlloc * 3 * sizeof(float));
+		assert(block != NULL);
+
+		// Copy over the old values
+
+		if (eCount > 0) {
+			memcpy(block, heading, eCount * sizeof(float));
+			memcpy(block + newAlloc, pitch, eCount * sizeof(float));
+			memcpy(block + newAlloc*2, bank, eCount * sizeof(float));
+		}
+
+		// Install new lanes
+
+		alignedFree(heading);
+		heading = block;
+		pitch = block + newAlloc;
+		bank = block + newAlloc*2;
+		eAlloc = newAlloc;
+	}
+
+	eCount = n;
+}
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::freeMemory
+//
+// Free up any memory and reset object to default state
+
+void	EulerAnglesArray::freeMemory() {
+	alignedFree(heading);
+	heading = pitch = bank = NULL;
+	eCount = eAlloc = 0;
+}
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::gather
+//
+// Load the array from n EulerAngles, which may be embedded in a larger
+// structure
+
+void	EulerAnglesArray::gather(const EulerAngles *src, int n, int strideInBytes) {
+	resize(n);
+
+	const char *s = (const char *)src;
+	for (int i = 0 ; i < n ; ++i) {
+		const EulerAngles *e = (const EulerAngles *)s;
+		heading[i] = e->heading;
+		pitch[i] = e->pitch;
+		bank[i] = e->bank;
+		s += strideInBytes;
+	}
+}
+
+//---------------------------------------------------------------------------
+// EulerAnglesArray::scatter
+//
+// Store the array out to count() EulerAngles
+
+void	EulerAnglesArray::scatter(EulerAngles *dst, int strideInBytes) const {
+	char *d = (char *)dst;
+	for (int i = 0 ; i < eCount ; ++i) {
+		EulerAngles *e = (EulerAngles *)d;
+		e->heading = heading[i];
+		e->pitch = pitch[i];
+		e->bank = bank[i];
+		d += strideInBytes;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Lane math
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// simdWrapPi
+//
+// wrapPi() on each lane
+
+static inline SimdFloat	simdWrapPi(SimdFloat radian) {
+	radian = radian + simdSet1(kPi);
+	radian = radian - simdFloor(radian * simdSet1(k1Over2Pi)) * simdSet1(k2Pi);
+	return radian - simdSet1(kPi);
+}
+
+//---------------------------------------------------------------------------
+// rotationLanes
+//
+// The inertial->object matrix for a block of orientations, exactly as
+// RotationMatrix::setup() builds it.  m[] is m11, m12, ..., m33.
+
+static inline void	rotationLanes(SimdFloat heading, SimdFloat pitch, SimdFloat bank, SimdFloat m[9]) {
+	SimdFloat	sh, ch, sp, cp, sb, cb;
+	simdSinCos<kEulerTrigAccuracy>(heading, sh, ch);
+	simdSinCos<kEulerTrigAccuracy>(pitch, sp, cp);
+	simdSinCos<kEulerTrigAccuracy>(bank, sb, cb);
+
+	SimdFloat	shsp = sh * sp;
+	SimdFloat	chsp = ch * sp;
+
+	m[0] = ch * cb + shsp * sb;
+	m[1] = shsp * cb - ch * sb;
+	m[2] = sh * cp;
+
+	m[3] = sb * cp;
+	m[4] = cb * cp;
+	m[5] = -sp;
+
+	m[6] = chsp * sb - sh * cb;
+	m[7] = sb * sh + chsp * cb;
+	m[8] = ch * cp;
+}
+
+//---------------------------------------------------------------------------
+// eulerFromRotationLanes
+//
+// Extract Euler angles from a block of inertial->object matrices, the
+// same way EulerAngles::fromRotationMatrix() does.  Only the seven
+// elements that are needed are passed in.
+
+static inline void	eulerFromRotationLanes(SimdFloat m11, SimdFloat m13, SimdFloat m21,
+	SimdFloat m22, SimdFloat m23, SimdFloat m31, SimdFloat m33,
+	SimdFloat &heading, SimdFloat &pitch, SimdFloat &bank) {
+
+	SimdFloat	sp = -m23;
+
+	// Looking straight up or down?  Then heading takes all of the
+	// rotation about the vertical axis, and bank is zero.
+
+	SimdMask	gimbal = simdAbs(sp) > simdSet1(0.99999f);
+	SimdFloat	hy = simdSelect(gimbal, -m31, m13);
+	SimdFloat	hx = simdSelect(gimbal, m11, m33);
+
+	heading = simdAtan2<kEulerTrigAccuracy>(hy, hx);
+	pitch = simdSelect(gimbal, simdSet1(kPiOver2) * sp,
+		simdSet1(kPiOver2) - simdAcos<kEulerTrigAccuracy>(sp));
+	bank = simdSelect(gimbal, simdZero(), simdAtan2<kEulerTrigAccuracy>(m21, m22));
+}
+
+//---------------------------------------------------------------------------
+// eulerFromQuaternionLanes
+//
+// Extract Euler angles from a block of object->inertial quaternions, the
+// same way EulerAngles::fromObjectToInertialQuaternion() does.  An
+// inertial->object quaternion is just the conjugate, so the caller
+// negates w for those.
+
+static inline void	eulerFromQuaternionLanes(SimdFloat w, SimdFloat x, SimdFloat y, SimdFloat z,
+	SimdFloat &heading, SimdFloat &pitch, SimdFloat &bank) {
+
+	SimdFloat	half = simdSet1(0.5f);
+	SimdFloat	sp = simdSet1(-2.0f) * (y*z - w*x);
+
+	SimdMask	gimbal = simdAbs(sp) > simdSet1(0.9999f);
+	SimdFloat	xz = x*z;
+	SimdFloat	wy = w*y;
+	SimdFloat	hy = simdSelect(gimbal, wy - xz, xz + wy);
+	SimdFloat	hx = simdSelect(gimbal, half - y*y - z*z, half - x*x - y*y);
+
+	heading = simdAtan2<kEulerTrigAccuracy>(hy, hx);
+	pitch = simdSelect(gimbal, simdSet1(kPiOver2) * sp,
+		simdSet1(kPiOver2) - simdAcos<kEulerTrigAccuracy>(sp));
+	bank = simdSelect(gimbal, simdZero(),
+		simdAtan2<kEulerTrigAccuracy>(x*y + w*z, half - x*x - z*z));
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Block operations.  Each handles the block of kSimdWidth elements
+// starting at base, of which the first n exist.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// EulerJob
+//
+// Arguments for the conversions, passed to parallelFor
+
+struct EulerJob {
+	int		count;
+	const float	*heading, *pitch, *bank;	// Euler angles in
+	float		*outHeading, *outPitch, *outBank; // Euler angles out
+	const float	*px, *py, *pz;			// positions, for Matrix4x3
+	const void	*src;				// other orientation form in
+	void		*dst;				// other orientation form out
+};
+
+//---------------------------------------------------------------------------
+// CanonizeOp
+
+struct CanonizeOp {
+	static void	block(const EulerJob *job, int base, int) {
+		SimdFloat	heading = simdLoad(job->outHeading + base);
+		SimdFloat	pitch = simdLoad(job->outPitch + base);
+		SimdFloat	bank = simdLoad(job->outBank + base);
+
+		// Pitch to -pi...pi, then fold it into -pi/2...pi/2 by
+		// looking the other way and upside down
+
+		pitch = simdWrapPi(pitch);
+		SimdMask	low = pitch < simdSet1(-kPiOver2);
+		SimdMask	high = pitch > simdSet1(kPiOver2);
+		SimdFloat	turn = simdSelect(low | high, simdSet1(kPi), simdZero());
+		pitch = simdSelect(low, simdSet1(-kPi) - pitch, pitch);
+		pitch = simdSelect(high, simdSet1(kPi) - pitch, pitch);
+		heading = heading + turn;
+		bank = bank + turn;
+
+		// In gimbal lock, put all the rotation about the vertical
+		// axis into heading
+
+		SimdMask	gimbal = simdAbs(pitch) > simdSet1(kPiOver2 - 1e-4f);
+		heading = simdSelect(gimbal, heading + bank, heading);
+		bank = simdSelect(gimbal, simdZero(), simdWrapPi(bank));
+		heading = simdWrapPi(heading);
+
+		simdStore(job->outHeading + base, heading);
+		simdStore(job->outPitch + base, pitch);
+		simdStore(job->outBank + base, bank);
+	}
+};
+
+//---------------------------------------------------------------------------
+// ToRotationMatrixOp
+
+struct ToRotationMatrixOp {
+	static void	block(const EulerJob *job, int base, int n) {
+		SimdFloat	m[9];
+		rotationLanes(simdLoad(job->heading + base), simdLoad(job->pitch + base),
+			simdLoad(job->bank + base), m);
+
+		float	t[9][kSimdMaxWidth];
+		for (int k = 0 ; k < 9 ; ++k) {
+			simdStoreU(t[k], m[k]);
+		}
+
+		RotationMatrix	*r = (RotationMatrix *)job->dst + base;
+		for (int lane = 0 ; lane < n ; ++lane) {
+			r[lane].m11 = t[0][lane]; r[lane].m12 = t[1][lane]; r[lane].m13 = t[2][lane];
+			r[lane].m21 = t[3][lane]; r[lane].m22 = t[4][lane]; r[lane].m23 = t[5][lane];
+			r[lane].m31 = t[6][lane]; r[lane].m32 = t[7][lane]; r[lane].m33 = t[8][lane];
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// ToQuaternionOp
+//
+// Same math as Quaternion::setToRotateObjectToInertial(); for
+// inertial->object we return the conjugate, which is what
+// setToRotateInertialToObject() computes.
+
+template <bool kInertialToObject>
+struct ToQuaternionOp {
+	static void	block(const EulerJob *job, int base, int n) {
+		SimdFloat	half = simdSet1(0.5f);
+		SimdFloat	sp, cp, sb, cb, sh, ch;
+		simdSinCos<kEulerTrigAccuracy>(simdLoad(job->pitch + base) * half, sp, cp);
+		simdSinCos<kEulerTrigAccuracy>(simdLoad(job->bank + base) * half, sb, cb);
+		simdSinCos<kEulerTrigAccuracy>(simdLoad(job->heading + base) * half, sh, ch);
+
+		SimdFloat	chcp = ch * cp;
+		SimdFloat	shsp = sh * sp;
+		SimdFloat	chsp = ch * sp;
+		SimdFloat	shcp = sh * cp;
+
+		SimdFloat	w = chcp * cb + shsp * sb;
+		SimdFloat	x = chsp * cb + shcp * sb;
+		SimdFloat	y = shcp * cb - chsp * sb;
+		SimdFloat	z = chcp * sb - shsp * cb;
+		if (kInertialToObject) {
+			x = -x;
+			y = -y;
+			z = -z;
+		}
+
+		Quaternion	*q = (Quaternion *)job->dst + base;
+		if (n == kSimdWidth) {
+			simdStoreTranspose4(&q->w, w, x, y, z);
+		} else {
+			Quaternion	t[kSimdMaxWidth];
+			simdStoreTranspose4(&t[0].w, w, x, y, z);
+			for (int lane = 0 ; lane < n ; ++lane) {
+				q[lane] = t[lane];
+			}
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// ToMatrix4x3Op
+//
+// Same as Matrix4x3::setupLocalToParent() or setupParentToLocal().  The
+// rotation matrix is inertial->object, which is parent->local, so local->
+// parent copies it transposed.
+
+template <bool kParentToLocal>
+struct ToMatrix4x3Op {
+	static void	block(const EulerJob *job, int base, int n) {
+		SimdFloat	m[9];
+		rotationLanes(simdLoad(job->heading + base), simdLoad(job->pitch + base),
+			simdLoad(job->bank + base), m);
+
+		SimdFloat	px = simdLoad(job->px + base);
+		SimdFloat	py = simdLoad(job->py + base);
+		SimdFloat	pz = simdLoad(job->pz + base);
+
+		float	t[12][kSimdMaxWidth];
+		if (kParentToLocal) {
+			for (int k = 0 ; k < 9 ; ++k) {
+				simdStoreU(t[k], m[k]);
+			}
+			simdStoreU(t[9], -(px*m[0] + py*m[3] + pz*m[6]));
+			simdStoreU(t[10], -(px*m[1] + py*m[4] + pz*m[7]));
+			simdStoreU(t[11], -(px*m[2] + py*m[5] + pz*m[8]));
+		} else {
+			for (int row = 0 ; row < 3 ; ++row) {
+				for (int col = 0 ; col < 3 ; ++col) {
+					simdStoreU(t[row*3 + col], m[col*3 + row]);
+				}
+			}
+			simdStoreU(t[9], px);
+			simdStoreU(t[10], py);
+			simdStoreU(t[11], pz);
+		}
+
+		Matrix4x3	*r = (Matrix4x3 *)job->dst + base;
+		for (int lane = 0 ; lane < n ; ++lane) {
+			r[lane].m11 = t[0][lane]; r[lane].m12 = t[1][lane]; r[lane].m13 = t[2][lane];
+			r[lane].m21 = t[3][lane]; r[lane].m22 = t[4][lane]; r[lane].m23 = t[5][lane];
+			r[lane].m31 = t[6][lane]; r[lane].m32 = t[7][lane]; r[lane].m33 = t[8][lane];
+			r[lane].tx = t[9][lane]; r[lane].ty = t[10][lane]; r[lane].tz = t[11][lane];
+			r[lane].transformType = eTransformTypeRigid;
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// FromMatrixOp
+//
+// Euler angles from rotation matrices.  The Matrix class is either
+// RotationMatrix or Matrix4x3.  RotationMatrix and world->object matrices
+// are both inertial->object; object->world matrices are the transpose.
+// Missing elements at the end of the array are filled in with the
+// identity.
+
+template <class Matrix, bool kTranspose>
+struct FromMatrixOp {
+	static void	block(const EulerJob *job, int base, int n) {
+		float	t[9][kSimdMaxWidth];
+		const Matrix	*m = (const Matrix *)job->src + base;
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			if (lane < n) {
+				t[0][lane] = m[lane].m11; t[1][lane] = m[lane].m12; t[2][lane] = m[lane].m13;
+				t[3][lane] = m[lane].m21; t[4][lane] = m[lane].m22; t[5][lane] = m[lane].m23;
+				t[6][lane] = m[lane].m31; t[7][lane] = m[lane].m32; t[8][lane] = m[lane].m33;
+			} else {
+				for (int k = 0 ; k < 9 ; ++k) {
+					t[k][lane] = (k % 4 == 0) ? 1.0f : 0.0f;
+				}
+			}
+		}
+
+		// Element k of the inertial->object matrix, which is the
+		// transpose of what we loaded for object->world
+
+		SimdFloat	e[9];
+		for (int k = 0 ; k < 9 ; ++k) {
+			e[k] = simdLoadU(t[kTranspose ? (k % 3) * 3 + k / 3 : k]);
+		}
+
+		SimdFloat	heading, pitch, bank;
+		eulerFromRotationLanes(e[0], e[2], e[3], e[4], e[5], e[6], e[8], heading, pitch, bank);
+
+		simdStore(job->outHeading + base, heading);
+		simdStore(job->outPitch + base, pitch);
+		simdStore(job->outBank + base, bank);
+	}
+};
+
+//---------------------------------------------------------------------------
+// FromQuaternionOp
+
+template <bool kInertialToObject>
+struct FromQuaternionOp {
+	static void	block(const EulerJob *job, int base, int n) {
+		const Quaternion	*q = (const Quaternion *)job->src + base;
+		SimdFloat		w, x, y, z;
+		if (n == kSimdWidth) {
+			simdLoadTranspose4(&q->w, w, x, y, z);
+		} else {
+			Quaternion	t[kSimdMaxWidth];
+			for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+				t[lane] = (lane < n) ? q[lane] : kQuaternionIdentity;
+			}
+			simdLoadTranspose4(&t[0].w, w, x, y, z);
+		}
+		if (kInertialToObject) {
+			w = -w;
+		}
+
+		SimdFloat	heading, pitch, bank;
+		eulerFromQuaternionLanes(w, x, y, z, heading, pitch, bank);
+
+		simdStore(job->outHeading + base, heading);
+		simdStore(job->outPitch + base, pitch);
+		simdStore(job->outBank + base, bank);
+	}
+};
+
+//---------------------------------------------------------------------------
+// eulerRange
+//
+// Process blocks [begin, end) of a job
+
+template <class Op>
+static void	eulerRange(int begin, int end, void *context) {
+	const EulerJob *job = (const EulerJob *)context;
+	for (int block = begin ; block < end ; ++block) {
+		int	base = block * kSimdWidth;
+		int	n = job->count - base;
+		if (n > kSimdWidth) n = kSimdWidth;
+		Op::block(job, base, n);
+	}
+}
+
+//---------------------------------------------------------------------------
+// runEuler
+//
+// Run a job across the worker threads
+
+template <class Op>
+static void	runEuler(const EulerJob &job) {
+	int	blockCount = (job.count + kSimdWidth - 1) / kSimdWidth;
+	parallelFor(blockCount, kMinEulerBlocksPerChunk, &eulerRange<Op>, (void *)&job);
+}
+
+//---------------------------------------------------------------------------
+// eulerJobIn
+// eulerJobOut
+//
+// Start a job that reads or writes Euler angles
+
+static EulerJob	eulerJobIn(const EulerAnglesArray &orient, void *dst) {
+	EulerJob	job;
+	memset(&job, 0, sizeof(job));
+	job.count = orient.count();
+	job.heading = orient.heading;
+	job.pitch = orient.pitch;
+	job.bank = orient.bank;
+	job.dst = dst;
+	return job;
+}
+
+static EulerJob	eulerJobOut(EulerAnglesArray &result, const void *src, int count) {
+	assert(count >= 0);
+	result.resize(count);
+
+	EulerJob	job;
+	memset(&job, 0, sizeof(job));
+	job.count = count;
+	job.outHeading = result.heading;
+	job.outPitch = result.pitch;
+	job.outBank = result.bank;
+	job.src = src;
+	return job;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch conversions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// canonize
+
+void	canonize(EulerAnglesArray &a) {
+	EulerJob	job = eulerJobOut(a, NULL, a.count());
+	runEuler<CanonizeOp>(job);
+}
+
+//---------------------------------------------------------------------------
+// setupRotationMatrices
+// setToRotateObjectToInertial
+// setToRotateInertialToObject
+
+void	setupRotationMatrices(RotationMatrix *result, const EulerAnglesArray &orient) {
+	runEuler<ToRotationMatrixOp>(eulerJobIn(orient, result));
+}
+
+void	setToRotateObjectToInertial(Quaternion *result, const EulerAnglesArray &orient) {
+	runEuler<ToQuaternionOp<false> >(eulerJobIn(orient, result));
+}
+
+void	setToRotateInertialToObject(Quaternion *result, const EulerAnglesArray &orient) {
+	runEuler<ToQuaternionOp<true> >(eulerJobIn(orient, result));
+}
+
+//---------------------------------------------------------------------------
+// setupLocalToParent
+// setupParentToLocal
+
+void	setupLocalToParent(Matrix4x3 *result, const Vector3Array &pos, const EulerAnglesArray &orient) {
+	assert(pos.count() == orient.count());
+	EulerJob	job = eulerJobIn(orient, result);
+	job.px = pos.x;
+	job.py = pos.y;
+	job.pz = pos.z;
+	runEuler<ToMatrix4x3Op<false> >(job);
+}
+
+void	setupParentToLocal(Matrix4x3 *result, const Vector3Array &pos, const EulerAnglesArray &orient) {
+	assert(pos.count() == orient.count());
+	EulerJob	job = eulerJobIn(orient, result);
+	job.px = pos.x;
+	job.py = pos.y;
+	job.pz = pos.z;
+	runEuler<ToMatrix4x3Op<true> >(job);
+}
+
+//---------------------------------------------------------------------------
+// fromRotationMatrices
+// fromObjectToInertialQuaternions
+// fromInertialToObjectQuaternions
+// fromObjectToWorldMatrices
+// fromWorldToObjectMatrices
+
+void	fromRotationMatrices(EulerAnglesArray &result, const RotationMatrix *m, int count) {
+	runEuler<FromMatrixOp<RotationMatrix, false> >(eulerJobOut(result, m, count));
+}
+
+void	fromObjectToInertialQuaternions(EulerAnglesArray &result, const Quaternion *q, int count) {
+	runEuler<FromQuaternionOp<false> >(eulerJobOut(result, q, count));
+}
+
+void	fromInertialToObjectQuaternions(EulerAnglesArray &result, const Quaternion *q, int count) {
+	runEuler<FromQuaternionOp<true> >(eulerJobOut(result, q, count));
+}
+
+void	fromObjectToWorldMatrices(EulerAnglesArray &result, const Matrix4x3 *m, int count) {
+	runEuler<FromMatrixOp<Matrix4x3, true> >(eulerJobOut(result, m, count));
+}
+
+void	fromWorldToObjectMatrices(EulerAnglesArray &result, const Matrix4x3 *m, int count) {
+	runEuler<FromMatrixOp<Matrix4x3, false> >(eulerJobOut(result, m, count));
+}
@@ -0,0 +1,129 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// EulerAnglesArray.h - Declarations for class EulerAnglesArray
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see EulerAnglesArray.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __EULERANGLESARRAY_H_INCLUDED__
+#define __EULERANGLESARRAY_H_INCLUDED__
+
+#ifndef __EULERANGLES_H_INCLUDED__
+	#include "EulerAngles.h"
+#endif
+
+class Vector3Array;
+
+//---------------------------------------------------------------------------
+// class EulerAnglesArray
+//
+// A list of heading-pitch-bank triples stored as a "structure of arrays,"
+// one lane per angle, just like Vector3Array.  This is the layout the
+// batch conversions below want.
+//
+// Each lane is aligned and padded to a multiple of kSimdMaxWidth floats.
+
+class EulerAnglesArray {
+public:
+
+// Public data
+
+	// The angle lanes, in radians.  Left public so that other batch
+	// kernels may stream over them directly
+
+	float	*heading;
+	float	*pitch;
+	float	*bank;
+
+// Standard class object maintenance
+
+	EulerAnglesArray();
+	explicit EulerAnglesArray(int n);
+	EulerAnglesArray(const EulerAnglesArray &a);
+	~EulerAnglesArray();
+
+	EulerAnglesArray &operator=(const EulerAnglesArray &a);
+
+// Size
+
+	int	count() const { return eCount; }
+
+	// Set the number of triples.  Existing values are preserved,
+	// new entries are uninitialized
+
+	void	resize(int n);
+
+	// Free all memory and reset to empty
+
+	void	freeMemory();
+
+// Element access.  Handy, but slow - don't use this in inner loops
+
+	EulerAngles	get(int i) const { return EulerAngles(heading[i], pitch[i], bank[i]); }
+	void		set(int i, const EulerAngles &e) { heading[i] = e.heading; pitch[i] = e.pitch; bank[i] = e.bank; }
+
+// Conversion to/from an array of EulerAngles, which may be embedded in
+// larger structures.  Pass the size of the structure as the stride.
+
+	void	gather(const EulerAngles *src, int n, int strideInBytes = sizeof(EulerAngles));
+	void	scatter(EulerAngles *dst, int strideInBytes = sizeof(EulerAngles)) const;
+
+// Private representation
+
+private:
+	int	eCount;
+	int	eAlloc;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch conversions.  These are the array versions of the EulerAngles,
+// RotationMatrix, Quaternion and Matrix4x3 conversion functions, and give
+// the same results to within float precision.  The sines, cosines and
+// inverse trig are computed several angles at a time with the
+// polynomials in SimdTrig.h, and large arrays are split across the
+// worker threads.
+//
+// Output arrays of structures must have room for orient.count()
+// elements.  Output EulerAnglesArrays are resized to count.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Canonize each triple in place, like EulerAngles::canonize()
+
+void	canonize(EulerAnglesArray &a);
+
+// Euler angles to inertial->object rotation matrices, like
+// RotationMatrix::setup()
+
+void	setupRotationMatrices(RotationMatrix *result, const EulerAnglesArray &orient);
+
+// Euler angles to quaternions, like Quaternion::setToRotateObjectToInertial()
+// and Quaternion::setToRotateInertialToObject()
+
+void	setToRotateObjectToInertial(Quaternion *result, const EulerAnglesArray &orient);
+void	setToRotateInertialToObject(Quaternion *result, const EulerAnglesArray &orient);
+
+// Positions and Euler angles to 4x3 matrices, like
+// Matrix4x3::setupLocalToParent() and Matrix4x3::setupParentToLocal().
+// pos must be the same length as orient.
+
+void	setupLocalToParent(Matrix4x3 *result, const Vector3Array &pos, const EulerAnglesArray &orient);
+void	setupParentToLocal(Matrix4x3 *result, const Vector3Array &pos, const EulerAnglesArray &orient);
+
+// Back to Euler angles, like EulerAngles::fromRotationMatrix(),
+// fromObjectToInertialQuaternion(), and so on
+
+void	fromRotationMatrices(EulerAnglesArray &result, const RotationMatrix *m, int count);
+void	fromObjectToInertialQuaternions(EulerAnglesArray &result, const Quaternion *q, int count);
+void	fromInertialToObjectQuaternions(EulerAnglesArray &result, const Quaternion *q, int count);
+void	fromObjectToWorldMatrices(EulerAnglesArray &result, const Matrix4x3 *m, int count);
+void	fromWorldToObjectMatrices(EulerAnglesArray &result, const Matrix4x3 *m, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __EULERANGLESARRAY_H_INCLUDED__
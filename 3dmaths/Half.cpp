@@ -0,0 +1,235 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Half.cpp - Bulk conversion between float and half precision
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <type_traits>
+
+#include "Half.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The arrays are converted eight values at a time.  With F16C that's an
+// instruction or two.  Without it, the SSE2 version runs the same bit
+// tricks as floatToHalfBits() and halfBitsToFloat() on four lanes at a
+// time, with masks instead of the branches.  Either way the last few
+// values go through the single value functions, which give the same
+// bits.
+//
+// Conversion is mostly memory bound, so the arrays are only split across
+// threads when they are big.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kHalfBlock = 8;
+const int	kMinHalfPerChunk = 16384;
+
+// The vector versions treat arrays of vectors as flat arrays of
+// components
+
+static_assert(sizeof(Half) == 2, "Half must be 16 bits");
+static_assert(sizeof(HalfVector3) == 3 * sizeof(Half), "HalfVector3 must be packed");
+static_assert(sizeof(HalfVector2) == 2 * sizeof(Half), "HalfVector2 must be packed");
+static_assert(sizeof(Vector3) == 3 * sizeof(float), "Vector3 must be packed");
+static_assert(std::is_trivially_copyable<HalfVector3>::value, "HalfVector3 must be trivially copyable");
+static_assert(std::is_trivially_copyable<HalfVector2>::value, "HalfVector2 must be trivially copyable");
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(MATH_HALF_F16C) && defined(MATH_SIMD_SSE)
+
+//---------------------------------------------------------------------------
+// floatToHalf4
+//
+// SSE2 version of floatToHalfBits().  The results are sign extended to
+// 32 bits, ready for _mm_packs_epi32
+
+static __m128i	floatToHalf4(__m128 f) {
+	__m128i	x = _mm_castps_si128(f);
+	__m128i	sign = _mm_and_si128(x, _mm_set1_epi32((int)0x80000000u));
+	x = _mm_xor_si128(x, sign);
+
+	// 65536 or more, infinity, or NaN
+
+	__m128i	isBig = _mm_cmpgt_epi32(x, _mm_set1_epi32(0x477fffff));
+	__m128i	isNan = _mm_cmpgt_epi32(x, _mm_set1_epi32(0x7f800000));
+	__m128i	big = _mm_or_si128(_mm_set1_epi32(0x7c00), _mm_and_si128(isNan, _mm_set1_epi32(0x0200)));
+
+	// Denormal
+
+	__m128i	isSmall = _mm_cmplt_epi32(x, _mm_set1_epi32(0x38800000));
+	__m128	t = _mm_add_ps(_mm_castsi128_ps(x), _mm_set1_ps(0.5f));
+	__m128i	small = _mm_sub_epi32(_mm_castps_si128(t), _mm_set1_epi32(0x3f000000));
+
+	// Normal
+
+	__m128i	odd = _mm_and_si128(_mm_srli_epi32(x, 13), _mm_set1_epi32(1));
+	__m128i	normal = _mm_add_epi32(_mm_add_epi32(x, _mm_set1_epi32((int)0xc8000fffu)), odd);
+	normal = _mm_srli_epi32(normal, 13);
+
+	__m128i	o = _mm_or_si128(_mm_and_si128(isSmall, small), _mm_andnot_si128(isSmall, normal));
+	o = _mm_or_si128(_mm_and_si128(isBig, big), _mm_andnot_si128(isBig, o));
+	o = _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+	return _mm_srai_epi32(_mm_slli_epi32(o, 16), 16);
+}
+
+//---------------------------------------------------------------------------
+// halfToFloat4
+//
+// SSE2 version of halfBitsToFloat().  The input is four halves, zero
+// extended to 32 bits
+
+static __m128	halfToFloat4(__m128i h) {
+	__m128i	expMant = _mm_and_si128(h, _mm_set1_epi32(0x7fff));
+	__m128	f = _mm_castsi128_ps(_mm_slli_epi32(expMant, 13));
+	f = _mm_mul_ps(f, _mm_set1_ps(5.192296858534828e33f));
+	__m128i	infNan = _mm_and_si128(_mm_cmpgt_epi32(expMant, _mm_set1_epi32(0x7bff)), _mm_set1_epi32(0x7f800000));
+	__m128i	sign = _mm_slli_epi32(_mm_xor_si128(h, expMant), 16);
+	return _mm_or_ps(f, _mm_castsi128_ps(_mm_or_si128(infNan, sign)));
+}
+
+#endif
+
+//---------------------------------------------------------------------------
+// floatToHalfBlock
+// halfToFloatBlock
+//
+// Convert kHalfBlock values.  No alignment is required.
+
+static void	floatToHalfBlock(const float *src, Half *dst) {
+#if defined(MATH_HALF_F16C) && defined(MATH_SIMD_AVX)
+	_mm_storeu_si128((__m128i *)dst, _mm256_cvtps_ph(_mm256_loadu_ps(src), 0));
+#elif defined(MATH_HALF_F16C)
+	_mm_storel_epi64((__m128i *)dst, _mm_cvtps_ph(_mm_loadu_ps(src), 0));
+	_mm_storel_epi64((__m128i *)(dst + 4), _mm_cvtps_ph(_mm_loadu_ps(src + 4), 0));
+#elif defined(MATH_SIMD_SSE)
+	__m128i	lo = floatToHalf4(_mm_loadu_ps(src));
+	__m128i	hi = floatToHalf4(_mm_loadu_ps(src + 4));
+	_mm_storeu_si128((__m128i *)dst, _mm_packs_epi32(lo, hi));
+#else
+	for (int i = 0 ; i < kHalfBlock ; ++i) {
+		dst[i].bits = floatToHalfBits(src[i]);
+	}
+#endif
+}
+
+static void	halfToFloatBlock(const Half *src, float *dst) {
+#if defined(MATH_HALF_F16C) && defined(MATH_SIMD_AVX)
+	_mm256_storeu_ps(dst, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)src)));
+#elif defined(MATH_HALF_F16C)
+	_mm_storeu_ps(dst, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)src)));
+	_mm_storeu_ps(dst + 4, _mm_cvtph_ps(_mm_loadl_epi64((const __m128i *)(src + 4))));
+#elif defined(MATH_SIMD_SSE)
+	__m128i	h = _mm_loadu_si128((const __m128i *)src);
+	__m128i	zero = _mm_setzero_si128();
+	_mm_storeu_ps(dst, halfToFloat4(_mm_unpacklo_epi16(h, zero)));
+	_mm_storeu_ps(dst + 4, halfToFloat4(_mm_unpackhi_epi16(h, zero)));
+#else
+	for (int i = 0 ; i < kHalfBlock ; ++i) {
+		dst[i] = halfBitsToFloat(src[i].bits);
+	}
+#endif
+}
+
+//---------------------------------------------------------------------------
+// HalfJob
+//
+// Parameters for a batch conversion, passed to parallelFor
+
+struct HalfJob {
+	const float	*floats;
+	Half		*halves;
+	const Half	*halvesIn;
+	float		*floatsOut;
+};
+
+//---------------------------------------------------------------------------
+// floatToHalfRange
+// halfToFloatRange
+//
+// Convert values [begin, end) of a job
+
+static void	floatToHalfRange(int begin, int end, void *context) {
+	const HalfJob *job = (const HalfJob *)context;
+
+	int	i = begin;
+	for ( ; i + kHalfBlock <= end ; i += kHalfBlock) {
+		floatToHalfBlock(job->floats + i, job->halves + i);
+	}
+	for ( ; i < end ; ++i) {
+		job->halves[i].bits = floatToHalfBits(job->floats[i]);
+	}
+}
+
+static void	halfToFloatRange(int begin, int end, void *context) {
+	const HalfJob *job = (const HalfJob *)context;
+
+	int	i = begin;
+	for ( ; i + kHalfBlock <= end ; i += kHalfBlock) {
+		halfToFloatBlock(job->halvesIn + i, job->floatsOut + i);
+	}
+	for ( ; i < end ; ++i) {
+		job->floatsOut[i] = halfBitsToFloat(job->halvesIn[i].bits);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// floatToHalf
+// halfToFloat
+//
+// Array versions.  See Half.h
+
+void	floatToHalf(Half *dst, const float *src, int count) {
+	assert(count >= 0);
+	HalfJob	job;
+	job.floats = src;
+	job.halves = dst;
+	job.halvesIn = NULL;
+	job.floatsOut = NULL;
+	parallelFor(count, kMinHalfPerChunk, &floatToHalfRange, &job);
+}
+
+void	halfToFloat(float *dst, const Half *src, int count) {
+	assert(count >= 0);
+	HalfJob	job;
+	job.floats = NULL;
+	job.halves = NULL;
+	job.halvesIn = src;
+	job.floatsOut = dst;
+	parallelFor(count, kMinHalfPerChunk, &halfToFloatRange, &job);
+}
+
+//---------------------------------------------------------------------------
+// packHalfVector3
+// unpackHalfVector3
+//
+// Both types are just their components, so these are the flat versions
+// with three times the count
+
+void	packHalfVector3(HalfVector3 *dst, const Vector3 *src, int count) {
+	floatToHalf(&dst->x, &src->x, count * 3);
+}
+
+void	unpackHalfVector3(Vector3 *dst, const HalfVector3 *src, int count) {
+	halfToFloat(&dst->x, &src->x, count * 3);
+}
@@ -0,0 +1,180 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Half.h - 16-bit floating point storage types
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see Half.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __HALF_H_INCLUDED__
+#define __HALF_H_INCLUDED__
+
+#include <string.h>
+
+#ifndef __VECTOR3_H_INCLUDED__
+	#include "vector3.h"
+#endif
+
+// Use the F16C conversion instructions when the compiler has been told
+// they are available.  MSVC doesn't have a seperate switch for them, but
+// every AVX2 processor has them.
+
+#if !defined(MATH_NO_SIMD) && (defined(__F16C__) || (defined(_MSC_VER) && defined(__AVX2__)))
+	#define MATH_HALF_F16C
+	#include <immintrin.h>
+#endif
+
+//---------------------------------------------------------------------------
+// Single value conversion
+//
+// IEEE 754 half precision: 1 sign bit, 5 exponent bits, 10 mantissa bits.
+// That's about 3 decimal digits, with a range of +/- 65504.  Converting
+// to half rounds to nearest even, values too large become infinity, and
+// small values become denormals.  Converting back to float is exact.
+
+inline unsigned short	floatToHalfBits(float f) {
+#if defined(MATH_HALF_F16C)
+	return (unsigned short)_cvtss_sh(f, 0);
+#else
+	unsigned int	x;
+	memcpy(&x, &f, sizeof(x));
+
+	unsigned int	sign = x & 0x80000000u;
+	x ^= sign;
+
+	unsigned int	o;
+	if (x >= 0x47800000u) {
+
+		// 65536 or more, infinity, or NaN
+
+		o = (x > 0x7f800000u) ? 0x7e00u : 0x7c00u;
+	} else if (x < 0x38800000u) {
+
+		// Below the smallest normal half.  Adding 0.5 lines the
+		// mantissa up with the half denormal, and the FPU does the
+		// rounding for us
+
+		float	t;
+		memcpy(&t, &x, sizeof(t));
+		t += 0.5f;
+		memcpy(&o, &t, sizeof(o));
+		o -= 0x3f000000u;
+	} else {
+
+		// Normal.  Rebias the exponent and round the mantissa to
+		// nearest even.  A carry out of the mantissa bumps the
+		// exponent, which is what we want
+
+		o = (x + 0xc8000fffu + ((x >> 13) & 1)) >> 13;
+	}
+	return (unsigned short)(o | (sign >> 16));
+#endif
+}
+
+inline float	halfBitsToFloat(unsigned short h) {
+#if defined(MATH_HALF_F16C)
+	return _cvtsh_ss(h);
+#else
+
+	// Shift the exponent and mantissa into place and scale by 2^112 to
+	// fix the exponent bias.  This handles denormals too.  Infinity and
+	// NaN need their exponent forced to all ones
+
+	unsigned int	expMant = h & 0x7fffu;
+	unsigned int	shifted = expMant << 13;
+	float		f;
+	memcpy(&f, &shifted, sizeof(f));
+	f *= 5.192296858534828e33f;
+	unsigned int	o;
+	memcpy(&o, &f, sizeof(o));
+	if (expMant >= 0x7c00u) {
+		o |= 0x7f800000u;
+	}
+	o |= (unsigned int)(h & 0x8000u) << 16;
+	memcpy(&f, &o, sizeof(f));
+	return f;
+#endif
+}
+
+//---------------------------------------------------------------------------
+// class Half
+//
+// A half precision float, for storage only.  It converts to and from
+// float automatically, so do the math in float and store the result.
+// The class is just the 16 bits, so it's fine in vertex formats and
+// animation tracks, and arrays of them may be copied with memcpy.
+
+class Half {
+public:
+
+// Public data
+
+	// The raw IEEE half bits
+
+	unsigned short	bits;
+
+// Constructors
+
+	// Default constructor leaves the value uninitialized
+
+	Half() = default;
+
+	// Convert from float
+
+	Half(float f) : bits(floatToHalfBits(f)) {}
+
+// Conversion to float
+
+	operator float() const { return halfBitsToFloat(bits); }
+};
+
+//---------------------------------------------------------------------------
+// class HalfVector3
+// class HalfVector2
+//
+// Half precision vectors, 6 and 4 bytes.  Good for normals, texture
+// coordinates and animation keys where three digits is plenty.
+
+class HalfVector3 {
+public:
+	Half	x, y, z;
+
+	HalfVector3() = default;
+	HalfVector3(float nx, float ny, float nz) : x(nx), y(ny), z(nz) {}
+	HalfVector3(const Vector3 &v) : x(v.x), y(v.y), z(v.z) {}
+
+	operator Vector3() const { return Vector3(x, y, z); }
+};
+
+class HalfVector2 {
+public:
+	Half	x, y;
+
+	HalfVector2() = default;
+	HalfVector2(float nx, float ny) : x(nx), y(ny) {}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Array conversions.  These use F16C or SSE2 when available, and split
+// large arrays across the worker threads.  Results are identical to the
+// single value conversions, except that with F16C a NaN keeps its
+// payload.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+void	floatToHalf(Half *dst, const float *src, int count);
+void	halfToFloat(float *dst, const Half *src, int count);
+
+// The vector versions.  For HalfVector2, pass the floats to the
+// functions above with twice the count.
+
+void	packHalfVector3(HalfVector3 *dst, const Vector3 *src, int count);
+void	unpackHalfVector3(Vector3 *dst, const HalfVector3 *src, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __HALF_H_INCLUDED__
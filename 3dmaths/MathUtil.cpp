@@ -12,11 +12,24 @@
 /////////////////////////////////////////////////////////////////////////////
 
 #include <math.h>
+#include <type_traits>
 
 #include "MathUtil.h"
-#include "Vector3.h"
+#include "vector3.h"
+#include "SimdTrig.h"
+#include "Parallel.h"
 
-const Vector3 kZeroVector(0.0f, 0.0f, 0.0f);
+// ǽͷļģ塣ʽʵõİ汾ÿԱ
+// ٱһΣȷǿmemcpyơ
+// The vector class is a header-only template.  Explicitly instantiate
+// the usual versions here, so that every member gets compiled at least
+// once, and check that they can be copied with memcpy.
+
+template class TVector3<float>;
+template class TVector3<double>;
+
+static_assert(std::is_trivially_copyable<Vector3>::value, "Vector3 must be trivially copyable");
+static_assert(std::is_trivially_copyable<Vector3d>::value, "Vector3d must be trivially copyable");
 
 //---------------------------------------------------------------------------
 // ʹһǶȻƵ-pipiͨ2piĳ˷
@@ -54,5 +67,215 @@ float safeAcos(float x) {
 	// ֵΧ-ֱʹñ׼C
 	// Value is in the domain - use standard C function
 
+#if defined(MATH_FAST_TRIG)
+	return fastAcos(x, MATH_FAST_TRIG_ACCURACY);
+#else
 	return acos(x);
+#endif
+}
+
+//---------------------------------------------------------------------------
+// safeAsin
+//
+// safeAcos()һнֵ-pi/2pi/2
+// Clamps like safeAcos().  The value returned is in range -pi/2...pi/2
+
+float safeAsin(float x) {
+	if (x <= -1.0f) {
+		return -kPiOver2;
+	}
+	if (x >= 1.0f) {
+		return kPiOver2;
+	}
+#if defined(MATH_FAST_TRIG)
+	return kPiOver2 - fastAcos(x, MATH_FAST_TRIG_ACCURACY);
+#else
+	return asin(x);
+#endif
+}
+
+//---------------------------------------------------------------------------
+// safeAtan2
+
+float safeAtan2(float y, float x) {
+#if defined(MATH_FAST_TRIG)
+	return fastAtan2(y, x, MATH_FAST_TRIG_ACCURACY);
+#else
+	return atan2(y, x);
+#endif
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Fast trig
+//
+// The kernels are in SimdTrig.h.  Here we pick the tier and run the
+// batch versions across the worker threads.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Don't bother splitting up batches smaller than this
+
+const int	kMinTrigPerChunk = 8192;
+
+//---------------------------------------------------------------------------
+// fastSinCos
+// fastAcos
+// fastAtan2
+
+void	fastSinCos(float *returnSin, float *returnCos, float theta, ETrigAccuracy accuracy) {
+	switch (accuracy) {
+		case eTrigAccuracyLow: scalarSinCos<eTrigAccuracyLow>(theta, *returnSin, *returnCos); break;
+		case eTrigAccuracyMedium: scalarSinCos<eTrigAccuracyMedium>(theta, *returnSin, *returnCos); break;
+		default: scalarSinCos<eTrigAccuracyHigh>(theta, *returnSin, *returnCos); break;
+	}
+}
+
+float	fastAcos(float x, ETrigAccuracy accuracy) {
+	switch (accuracy) {
+		case eTrigAccuracyLow: return scalarAcos<eTrigAccuracyLow>(x);
+		case eTrigAccuracyMedium: return scalarAcos<eTrigAccuracyMedium>(x);
+		default: return scalarAcos<eTrigAccuracyHigh>(x);
+	}
+}
+
+float	fastAtan2(float y, float x, ETrigAccuracy accuracy) {
+	switch (accuracy) {
+		case eTrigAccuracyLow: return scalarAtan2<eTrigAccuracyLow>(y, x);
+		case eTrigAccuracyMedium: return scalarAtan2<eTrigAccuracyMedium>(y, x);
+		default: return scalarAtan2<eTrigAccuracyHigh>(y, x);
+	}
+}
+
+//---------------------------------------------------------------------------
+// TrigJob
+//
+// Arguments for the batch kernels.  b is the second input (x of atan2)
+// and out2 the second output (cos of sinCos.)
+
+struct TrigJob {
+	const float	*a;
+	const float	*b;
+	float		*out;
+	float		*out2;
+};
+
+//---------------------------------------------------------------------------
+// SinCosOp
+// AcosOp
+// Atan2Op
+//
+// One block of kSimdWidth values for each function, and how many inputs
+// and outputs it has
+
+template <int kAccuracy>
+struct SinCosOp {
+	enum { kInputCount = 1, kOutputCount = 2 };
+	static void	block(const float *a, const float *, float *out, float *out2) {
+		SimdFloat	s, c;
+		simdSinCos<kAccuracy>(simdLoadU(a), s, c);
+		simdStoreU(out, s);
+		simdStoreU(out2, c);
+	}
+};
+
+template <int kAccuracy>
+struct AcosOp {
+	enum { kInputCount = 1, kOutputCount = 1 };
+	static void	block(const float *a, const float *, float *out, float *) {
+		simdStoreU(out, simdAcos<kAccuracy>(simdLoadU(a)));
+	}
+};
+
+template <int kAccuracy>
+struct Atan2Op {
+	enum { kInputCount = 2, kOutputCount = 1 };
+	static void	block(const float *a, const float *b, float *out, float *) {
+		simdStoreU(out, simdAtan2<kAccuracy>(simdLoadU(a), simdLoadU(b)));
+	}
+};
+
+//---------------------------------------------------------------------------
+// trigRange
+//
+// Process elements [begin, end) of a job.  The last few are copied to a
+// full block of scratch space.
+
+template <class Op>
+static void	trigRange(int begin, int end, void *context) {
+	const TrigJob *job = (const TrigJob *)context;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		Op::block(job->a + i,
+			(Op::kInputCount > 1) ? job->b + i : NULL,
+			job->out + i,
+			(Op::kOutputCount > 1) ? job->out2 + i : NULL);
+	}
+
+	int	left = end - i;
+	if (left > 0) {
+		float	a[kSimdMaxWidth], b[kSimdMaxWidth], out[kSimdMaxWidth], out2[kSimdMaxWidth];
+		for (int j = 0 ; j < kSimdWidth ; ++j) {
+			a[j] = (j < left) ? job->a[i + j] : 0.0f;
+			b[j] = (Op::kInputCount > 1 && j < left) ? job->b[i + j] : 1.0f;
+		}
+		Op::block(a, b, out, out2);
+		for (int j = 0 ; j < left ; ++j) {
+			job->out[i + j] = out[j];
+			if (Op::kOutputCount > 1) job->out2[i + j] = out2[j];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// runTrig
+//
+// Run a job across the worker threads with the kernel for the tier
+
+template <template <int> class Op>
+static void	runTrig(const TrigJob &job, int count, ETrigAccuracy accuracy) {
+	switch (accuracy) {
+		case eTrigAccuracyLow:
+			parallelFor(count, kMinTrigPerChunk, &trigRange<Op<eTrigAccuracyLow> >, (void *)&job);
+			break;
+		case eTrigAccuracyMedium:
+			parallelFor(count, kMinTrigPerChunk, &trigRange<Op<eTrigAccuracyMedium> >, (void *)&job);
+			break;
+		default:
+			parallelFor(count, kMinTrigPerChunk, &trigRange<Op<eTrigAccuracyHigh> >, (void *)&job);
+			break;
+	}
+}
+
+//---------------------------------------------------------------------------
+// sinCosBatch
+// acosBatch
+// atan2Batch
+
+void	sinCosBatch(const float *theta, float *sinResult, float *cosResult, int count, ETrigAccuracy accuracy) {
+	TrigJob	job;
+	job.a = theta;
+	job.b = NULL;
+	job.out = sinResult;
+	job.out2 = cosResult;
+	runTrig<SinCosOp>(job, count, accuracy);
+}
+
+void	acosBatch(const float *x, float *result, int count, ETrigAccuracy accuracy) {
+	TrigJob	job;
+	job.a = x;
+	job.b = NULL;
+	job.out = result;
+	job.out2 = NULL;
+	runTrig<AcosOp>(job, count, accuracy);
+}
+
+void	atan2Batch(const float *y, const float *x, float *result, int count, ETrigAccuracy accuracy) {
+	TrigJob	job;
+	job.a = y;
+	job.b = x;
+	job.out = result;
+	job.out2 = NULL;
+	runTrig<Atan2Op>(job, count, accuracy);
 }
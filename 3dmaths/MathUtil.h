@@ -27,6 +27,30 @@ const float k1Over2Pi = 1.0f / k2Pi;
 const float kPiOver180 = kPi / 180.0f;
 const float k180OverPi = 180.0f / kPi;
 
+// Ǻľȵȼϵȣ
+// Accuracy tiers for the fast trig functions below.  The errors are the
+// largest absolute error over the whole domain, in radians; see
+// SimdTrig.h for the details.
+
+enum ETrigAccuracy {
+	eTrigAccuracyLow,	// about 5e-4; good enough for most visuals
+	eTrigAccuracyMedium,	// about 1e-5
+	eTrigAccuracyHigh	// about 3e-7, as close as float can get
+};
+
+// Ϊ̶MATH_FAST_TRIGsinCos()safeAcos()safeAsin()
+// safeAtan2()ʹĶʽ汾ŷǵתЩ
+// MATH_FAST_TRIG_ACCURACYѡ񾫶ȵȼĬΪeTrigAccuracyHigh
+// Define MATH_FAST_TRIG for the whole project to make sinCos(),
+// safeAcos(), safeAsin() and safeAtan2() use the polynomial versions
+// below.  The Euler angle conversions all go through these.
+// MATH_FAST_TRIG_ACCURACY picks the tier; the default is
+// eTrigAccuracyHigh.
+
+#if defined(MATH_FAST_TRIG) && !defined(MATH_FAST_TRIG_ACCURACY)
+	#define MATH_FAST_TRIG_ACCURACY eTrigAccuracyHigh
+#endif
+
 // ʹһǶȻƵ-pipiͨ2piĳ˷
 // "Wrap" an angle in range -pi...pi by adding the correct multiple
 // of 2 pi
@@ -37,6 +61,37 @@ extern float wrapPi(float radian);
 // "Safe" inverse trig functions
 
 extern float safeAcos(float x);
+extern float safeAsin(float x);
+
+// atan2(y, x)һ-pipiatan2(0, 0)Ϊ0
+// Same as atan2(y, x): the result is in range -pi...pi, and
+// safeAtan2(0, 0) is 0.
+
+extern float safeAtan2(float y, float x);
+
+// ʽƵǺȿѡacosнֵsafeAcos()
+// fastSinCos()|theta|СԼ1e5ʱЧ
+// Polynomial approximations, with selectable accuracy.  fastAcos()
+// clamps its input, like safeAcos().  fastSinCos() is good for |theta|
+// up to about 1e5.
+
+extern void	fastSinCos(float *returnSin, float *returnCos, float theta,
+			ETrigAccuracy accuracy = eTrigAccuracyHigh);
+extern float	fastAcos(float x, ETrigAccuracy accuracy = eTrigAccuracyHigh);
+extern float	fastAtan2(float y, float x, ETrigAccuracy accuracy = eTrigAccuracyHigh);
+
+// 汾ʹSIMD䵽̡߳ĵ汾ȫһ
+// Ը롣
+// Batch versions, vectorized and spread across the worker threads.  The
+// results are exactly the same as the single versions above.  The
+// output may overwrite an input.
+
+extern void	sinCosBatch(const float *theta, float *sinResult, float *cosResult,
+			int count, ETrigAccuracy accuracy = eTrigAccuracyHigh);
+extern void	acosBatch(const float *x, float *result, int count,
+			ETrigAccuracy accuracy = eTrigAccuracyHigh);
+extern void	atan2Batch(const float *y, const float *x, float *result, int count,
+			ETrigAccuracy accuracy = eTrigAccuracyHigh);
 
 // ڽǶȺͻֱת
 // Convert between degrees and radians
@@ -51,11 +106,32 @@ inline float	radToDeg(float rad) { return rad * k180OverPi; }
 
 inline void sinCos(float *returnSin, float *returnCos, float theta) {
 
+#if defined(MATH_FAST_TRIG)
+
+	// ʽ汾ͬʱֵ÷Χ
+	// The polynomial version computes both at once, sharing the
+	// range reduction
+
+	fastSinCos(returnSin, returnCos, theta, MATH_FAST_TRIG_ACCURACY);
+#else
+
 	// ڻֻʹóǺ
 	// עĳЩƽ̨ĸá
 	// For simplicity, we'll just use the normal trig functions.
 	// Note that on some platforms we may be able to do better
 
+	*returnSin = sin(theta);
+	*returnCos = cos(theta);
+#endif
+}
+
+// double汾TMatrix4x3<double>˫ȴʹáʽ汾ֻ
+// floatȣʹóǺ
+// The double version, for double precision code like TMatrix4x3<double>.
+// The polynomials are only good to float precision, so this always uses
+// the normal trig functions
+
+inline void sinCos(double *returnSin, double *returnCos, double theta) {
 	*returnSin = sin(theta);
 	*returnCos = cos(theta);
 }
@@ -16,8 +16,9 @@
 
 #include <assert.h>
 #include <math.h>
+#include <type_traits>
 
-#include "Vector3.h"
+#include "vector3.h"
 #include "EulerAngles.h"
 #include "Quaternion.h"
 #include "RotationMatrix.h"
@@ -92,11 +93,84 @@
 // þΪλ
 // Set the matrix to identity
 
-void	Matrix4x3::identity() {
+template <class T>
+void	TMatrix4x3<T>::identity() {
 	m11 = 1.0f; m12 = 0.0f; m13 = 0.0f;
 	m21 = 0.0f; m22 = 1.0f; m23 = 0.0f;
 	m31 = 0.0f; m32 = 0.0f; m33 = 1.0f;
-	tx  = 0.0f; ty  = 0.0f; tz  = 1.0f;
+	tx  = 0.0f; ty  = 0.0f; tz  = 0.0f;
+	transformType = eTransformTypeIdentity;
+}
+
+//---------------------------------------------------------------------------
+// Matrix4x3::classify
+//
+// ͨԪȷ任ֱ͡޸˾Ԫأ
+// ͵
+// Determine the transform type by inspecting the matrix elements.  Call
+// this if you have poked values into the matrix directly.
+//
+// 3x3ֵĸлഹֱҳͬͳһš
+// Ϊ1ʱǸ任
+// If the rows of the 3x3 portion are mutually perpendicular and all
+// the same length, then it is an orthogonal matrix times a uniform
+// scale.  If the length is one, then it's a rigid transform.
+
+template <class T>
+void	TMatrix4x3<T>::classify() {
+
+	// жֵ""ʱʹõ
+	// Relative tolerance used when deciding if values are "equal"
+
+	const T kEpsilon = 1e-5f;
+
+	// ȼ3x3Ƿǵλ
+	// First, check if the 3x3 portion is exactly identity
+
+	if (
+		m11 == 1.0f && m12 == 0.0f && m13 == 0.0f &&
+		m21 == 0.0f && m22 == 1.0f && m23 == 0.0f &&
+		m31 == 0.0f && m32 == 0.0f && m33 == 1.0f
+	) {
+		if (tx == 0.0f && ty == 0.0f && tz == 0.0f) {
+			transformType = eTransformTypeIdentity;
+		} else {
+			transformType = eTransformTypeTranslation;
+		}
+		return;
+	}
+
+	// ֮ĵ
+	// Compute the dot products of the rows with each other
+
+	T	d11 = m11*m11 + m12*m12 + m13*m13;
+	T	d22 = m21*m21 + m22*m22 + m23*m23;
+	T	d33 = m31*m31 + m32*m32 + m33*m33;
+	T	d12 = m11*m21 + m12*m22 + m13*m23;
+	T	d13 = m11*m31 + m12*m32 + m13*m33;
+	T	d23 = m21*m31 + m22*m32 + m23*m33;
+
+	// Ƿഹֱҳͬ
+	// Check that the rows are perpendicular and the same length
+
+	T	tol = kEpsilon * d11;
+	if (
+		d11 <= 0.0f ||
+		fabs(d12) > tol || fabs(d13) > tol || fabs(d23) > tol ||
+		fabs(d22 - d11) > tol || fabs(d33 - d11) > tol
+	) {
+		transformType = eTransformTypeAffine;
+		return;
+	}
+
+	// 1
+	// Unit length?
+
+	if (fabs(d11 - 1.0f) <= kEpsilon) {
+		transformType = eTransformTypeRigid;
+	} else {
+		transformType = eTransformTypeSimilarity;
+	}
 }
 
 //---------------------------------------------------------------------------
@@ -105,8 +179,16 @@ void	Matrix4x3::identity() {
 // ĵжΪ0аƽƲ
 // Zero the 4th row of the matrix, which contains the translation portion.
 
-void	Matrix4x3::zeroTranslation() {
+template <class T>
+void	TMatrix4x3<T>::zeroTranslation() {
 	tx = ty = tz = 0.0f;
+
+	// ƽƾڱɵλ
+	// A pure translation is now the identity
+
+	if (transformType == eTransformTypeTranslation) {
+		transformType = eTransformTypeIdentity;
+	}
 }
 
 //---------------------------------------------------------------------------
@@ -115,8 +197,17 @@ void	Matrix4x3::zeroTranslation() {
 // ʽþƽƲ
 // Sets the translation portion of the matrix in vector form
 
-void	Matrix4x3::setTranslation(const Vector3 &d) {
+template <class T>
+void	TMatrix4x3<T>::setTranslation(const TVector3<T> &d) {
 	tx = d.x; ty = d.y; tz = d.z;
+
+	// λڱƽƾˣͲƽƲӰ
+	// The identity becomes a translation.  The other types don't
+	// depend on the translation portion
+
+	if (transformType == eTransformTypeIdentity) {
+		transformType = eTransformTypeTranslation;
+	}
 }
 
 //---------------------------------------------------------------------------
@@ -125,7 +216,8 @@ void	Matrix4x3::setTranslation(const Vector3 &d) {
 // ʽþƽƲ֣Ա任Ϊλ
 // Sets the translation portion of the matrix in vector form
 
-void	Matrix4x3::setupTranslation(const Vector3 &d) {
+template <class T>
+void	TMatrix4x3<T>::setupTranslation(const TVector3<T> &d) {
 
 	// Ա任Ϊλ
 	// Set the linear transformation portion to identity
@@ -138,6 +230,11 @@ void	Matrix4x3::setupTranslation(const Vector3 &d) {
 	// Set the translation portion
 
 	tx = d.x; ty = d.y; tz = d.z;
+
+	// ֻƽ
+	// Translation only
+
+	transformType = eTransformTypeTranslation;
 }
 
 //---------------------------------------------------------------------------
@@ -160,7 +257,8 @@ void	Matrix4x3::setupTranslation(const Vector3 &d) {
 // We allow the orientation to be specified using either euler angles,
 // or a RotationMatrix
 
-void	Matrix4x3::setupLocalToParent(const Vector3 &pos, const EulerAngles &orient) {
+template <class T>
+void	TMatrix4x3<T>::setupLocalToParent(const TVector3<T> &pos, const EulerAngles &orient) {
 
 	// ת
 	// Create a rotation matrix.
@@ -178,7 +276,8 @@ void	Matrix4x3::setupLocalToParent(const Vector3 &pos, const EulerAngles &orient
 	setupLocalToParent(pos, orientMatrix);
 }
 
-void	Matrix4x3::setupLocalToParent(const Vector3 &pos, const RotationMatrix &orient) {
+template <class T>
+void	TMatrix4x3<T>::setupLocalToParent(const TVector3<T> &pos, const RotationMatrix &orient) {
 
 	// ƾת֡RotationMatrix.cppעͣתͨǹϵ->ϵľ
 	// ҲǴӸռ->ֲռ䡣Ҫֲռ->ռתƵʱҪתá
@@ -198,6 +297,11 @@ void	Matrix4x3::setupLocalToParent(const Vector3 &pos, const RotationMatrix &ori
 	// field directly
 
 	tx = pos.x; ty = pos.y; tz = pos.z;
+
+	// 󣬸任
+	// Orthogonal - this is a rigid transform
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -222,7 +326,8 @@ void	Matrix4x3::setupLocalToParent(const Vector3 &pos, const RotationMatrix &ori
 // We allow the orientation to be specified using either euler angles,
 // or a RotationMatrix
 
-void	Matrix4x3::setupParentToLocal(const Vector3 &pos, const EulerAngles &orient) {
+template <class T>
+void	TMatrix4x3<T>::setupParentToLocal(const TVector3<T> &pos, const EulerAngles &orient) {
 
 	// һת
 	// Create a rotation matrix.
@@ -236,7 +341,8 @@ void	Matrix4x3::setupParentToLocal(const Vector3 &pos, const EulerAngles &orient
 	setupParentToLocal(pos, orientMatrix);
 }
 
-void	Matrix4x3::setupParentToLocal(const Vector3 &pos, const RotationMatrix &orient) {
+template <class T>
+void	TMatrix4x3<T>::setupParentToLocal(const TVector3<T> &pos, const RotationMatrix &orient) {
 
 	// ƾת֡ǸRotationMatrix.cppעеĲֱ֣ӸԪأתã
 	// Copy the rotation portion of the matrix.  We can copy the
@@ -262,6 +368,11 @@ void	Matrix4x3::setupParentToLocal(const Vector3 &pos, const RotationMatrix &ori
 	tx = -(pos.x*m11 + pos.y*m21 + pos.z*m31);
 	ty = -(pos.x*m12 + pos.y*m22 + pos.z*m32);
 	tz = -(pos.x*m13 + pos.y*m23 + pos.z*m33);
+
+	// 󣬸任
+	// Orthogonal - this is a rigid transform
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -290,12 +401,13 @@ void	Matrix4x3::setupParentToLocal(const Vector3 &pos, const RotationMatrix &ori
 // μ8.2.2øϢ
 // See 8.2.2 for more info.
 
-void	Matrix4x3::setupRotate(int axis, float theta) {
+template <class T>
+void	TMatrix4x3<T>::setupRotate(int axis, T theta) {
 
 	// תǵsincosֵ
 	// Get sin and cosine of rotation angle
 
-	float	s, c;
+	T	s, c;
 	sinCos(&s, &c, theta);
 
 	// ĸת
@@ -339,6 +451,11 @@ void	Matrix4x3::setupRotate(int axis, float theta) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// 󣬸任
+	// Orthogonal - this is a rigid transform
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -362,7 +479,8 @@ void	Matrix4x3::setupRotate(int axis, float theta) {
 // 鿴8.2.3øϢ
 // See 8.2.3 for more info.
 
-void	Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
+template <class T>
+void	TMatrix4x3<T>::setupRotate(const TVector3<T> &axis, T theta) {
 
 	// ȷaxisǵλ
 	// Quick sanity check to make sure they passed in a unit vector
@@ -373,16 +491,16 @@ void	Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
 	// תǵsincosֵ
 	// Get sin and cosine of rotation angle
 
-	float	s, c;
+	T	s, c;
 	sinCos(&s, &c, theta);
 
 	// 1 - cos(theta) һЩӱʽ
 	// Compute 1 - cos(theta) and some common subexpressions
 
-	float	a = 1.0f - c;
-	float	ax = a * axis.x;
-	float	ay = a * axis.y;
-	float	az = a * axis.z;
+	T	a = 1.0f - c;
+	T	ax = a * axis.x;
+	T	ay = a * axis.y;
+	T	az = a * axis.z;
 
 	// þԪءȻһЩȥŻ๫ӱʽ
 	// ǻñ..
@@ -406,6 +524,11 @@ void	Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// 󣬸任
+	// Orthogonal - this is a rigid transform
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -421,15 +544,16 @@ void	Matrix4x3::setupRotate(const Vector3 &axis, float theta) {
 // 鿴10.6.3øϢ
 // See 10.6.3 for more info.
 
-void	Matrix4x3::fromQuaternion(const Quaternion &q) {
+template <class T>
+void	TMatrix4x3<T>::fromQuaternion(const Quaternion &q) {
 
 	// һЩֵŻӱʽ
 	// Compute a few values to optimize common subexpressions
 
-	float	ww = 2.0f * q.w;
-	float	xx = 2.0f * q.x;
-	float	yy = 2.0f * q.y;
-	float	zz = 2.0f * q.z;
+	T	ww = 2.0f * q.w;
+	T	xx = 2.0f * q.x;
+	T	yy = 2.0f * q.y;
+	T	zz = 2.0f * q.z;
 
 	// þԪءȻһЩȥŻ๫ӱʽ
 	// ǻñ..
@@ -439,7 +563,7 @@ void	Matrix4x3::fromQuaternion(const Quaternion &q) {
 
 	m11 = 1.0f - yy*q.y - zz*q.z;
 	m12 = xx*q.y + ww*q.z;
-	m13 = xx*q.z - ww*q.x;
+	m13 = xx*q.z - ww*q.y;
 
 	m21 = xx*q.y - ww*q.z;
 	m22 = 1.0f - xx*q.x - zz*q.z;
@@ -453,6 +577,11 @@ void	Matrix4x3::fromQuaternion(const Quaternion &q) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// 󣬸任
+	// Orthogonal - this is a rigid transform
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -468,7 +597,8 @@ void	Matrix4x3::fromQuaternion(const Quaternion &q) {
 // 鿴8.3.1øϢ
 // See 8.3.1 for more info.
 
-void	Matrix4x3::setupScale(const Vector3 &s) {
+template <class T>
+void	TMatrix4x3<T>::setupScale(const TVector3<T> &s) {
 
 	// þԪء൱ֱ
 	// Set the matrix elements.  Pretty straightforward
@@ -481,6 +611,16 @@ void	Matrix4x3::setupScale(const Vector3 &s) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// ͳһƱ任һķ任
+	// Uniform scale is a similarity transform, otherwise it's
+	// a general affine transform
+
+	if (s.x == s.y && s.x == s.z) {
+		transformType = (s.x == 1.0f) ? eTransformTypeIdentity : eTransformTypeSimilarity;
+	} else {
+		transformType = eTransformTypeAffine;
+	}
 }
 
 //---------------------------------------------------------------------------
@@ -498,7 +638,8 @@ void	Matrix4x3::setupScale(const Vector3 &s) {
 // 鿴8.3.2øϢ
 // See 8.3.2 for more info.
 
-void	Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
+template <class T>
+void	TMatrix4x3<T>::setupScaleAlongAxis(const TVector3<T> &axis, T k) {
 
 	// ȷaxisǵλ
 	// Quick sanity check to make sure they passed in a unit vector
@@ -509,10 +650,10 @@ void	Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
 	// k-1һЩӱʽ
 	// Compute k-1 and some common subexpressions
 
-	float	a = k - 1.0f;
-	float	ax = a * axis.x;
-	float	ay = a * axis.y;
-	float	az = a * axis.z;
+	T	a = k - 1.0f;
+	T	ax = a * axis.x;
+	T	ay = a * axis.y;
+	T	az = a * axis.z;
 
 	// ԪءǻǵĹӱʽŻΪԽӦľԪȵ
 	// Fill in the matrix elements.  We'll do the common
@@ -531,6 +672,11 @@ void	Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// һķ任
+	// General affine transform
+
+	transformType = eTransformTypeAffine;
 }
 
 //---------------------------------------------------------------------------
@@ -554,7 +700,8 @@ void	Matrix4x3::setupScaleAlongAxis(const Vector3 &axis, float k) {
 // 鿴8.6øϢ
 // See 8.6 for more info.
 
-void	Matrix4x3::setupShear(int axis, float s, float t) {
+template <class T>
+void	TMatrix4x3<T>::setupShear(int axis, T s, T t) {
 
 	// Ҫб
 	// Check which type of shear they want
@@ -597,6 +744,11 @@ void	Matrix4x3::setupShear(int axis, float s, float t) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// һķ任
+	// General affine transform
+
+	transformType = eTransformTypeAffine;
 }
 
 //---------------------------------------------------------------------------
@@ -610,7 +762,8 @@ void	Matrix4x3::setupShear(int axis, float s, float t) {
 // 鿴8.4.2øϢ
 // See 8.4.2 for more info.
 
-void	Matrix4x3::setupProject(const Vector3 &n) {
+template <class T>
+void	TMatrix4x3<T>::setupProject(const TVector3<T> &n) {
 
 	// ȷaxisǵλ
 	// Quick sanity check to make sure they passed in a unit vector
@@ -635,6 +788,11 @@ void	Matrix4x3::setupProject(const Vector3 &n) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// һķ任
+	// General affine transform
+
+	transformType = eTransformTypeAffine;
 }
 
 //---------------------------------------------------------------------------
@@ -660,7 +818,8 @@ void	Matrix4x3::setupProject(const Vector3 &n) {
 //
 // See 8.5 for more info.
 
-void	Matrix4x3::setupReflect(int axis, float k) {
+template <class T>
+void	TMatrix4x3<T>::setupReflect(int axis, T k) {
 
 	// ĸƽķ
 	// Check which plane they want to reflect about
@@ -714,6 +873,10 @@ void	Matrix4x3::setupReflect(int axis, float k) {
 			assert(false);
 	}
 
+	// 
+	// Reflection matrices are orthogonal
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -729,7 +892,8 @@ void	Matrix4x3::setupReflect(int axis, float k) {
 // 鿴8.5øϢ
 // See 8.5 for more info.
 
-void	Matrix4x3::setupReflect(const Vector3 &n) {
+template <class T>
+void	TMatrix4x3<T>::setupReflect(const TVector3<T> &n) {
 
 	// ȷaxisǵλ
 	// Quick sanity check to make sure they passed in a unit vector
@@ -740,9 +904,9 @@ void	Matrix4x3::setupReflect(const Vector3 &n) {
 	// 㹫ӱʽ
 	// Compute common subexpressions
 
-	float	ax = -2.0f * n.x;
-	float	ay = -2.0f * n.y;
-	float	az = -2.0f * n.z;
+	T	ax = -2.0f * n.x;
+	T	ay = -2.0f * n.y;
+	T	az = -2.0f * n.z;
 
 	// ԪءǻǵĹӱʽŻΪԽӦľԪȵ
 	// Fill in the matrix elements.  We'll do the common
@@ -761,6 +925,11 @@ void	Matrix4x3::setupReflect(const Vector3 &n) {
 	// Reset the translation portion
 
 	tx = ty = tz = 0.0f;
+
+	// 
+	// Reflection matrices are orthogonal
+
+	transformType = eTransformTypeRigid;
 }
 
 //---------------------------------------------------------------------------
@@ -777,19 +946,31 @@ void	Matrix4x3::setupReflect(const Vector3 &n) {
 // See 7.1.7
 
 
-Vector3	operator*(const Vector3 &p, const Matrix4x3 &m) {
+template <class T>
+TVector3<T>	operator*(const TVector3<T> &p, const TMatrix4x3<T> &m) {
+
+	// λʹƽ
+	// Check for the special cases: identity and pure translation
+
+	if (m.transformType == eTransformTypeIdentity) {
+		return p;
+	}
+	if (m.transformType == eTransformTypeTranslation) {
+		return TVector3<T>(p.x + m.tx, p.y + m.ty, p.z + m.tz);
+	}
 
 	// ͨԴĥ
 	// Grind through the linear algebra.
 
-	return Vector3(
+	return TVector3<T>(
 		p.x*m.m11 + p.y*m.m21 + p.z*m.m31 + m.tx,
 		p.x*m.m12 + p.y*m.m22 + p.z*m.m32 + m.ty,
 		p.x*m.m13 + p.y*m.m23 + p.z*m.m33 + m.tz
 	);
 }
 
-Vector3 &operator*=(Vector3 &p, const Matrix4x3 &m) {
+template <class T>
+TVector3<T> &operator*=(TVector3<T> &p, const TMatrix4x3<T> &m) {
 	p = p * m;
 	return p;
 }
@@ -807,9 +988,48 @@ Vector3 &operator*=(Vector3 &p, const Matrix4x3 &m) {
 // μ7.1.6
 // See 7.1.6
 
-Matrix4x3 operator*(const Matrix4x3 &a, const Matrix4x3 &b) {
+template <class T>
+TMatrix4x3<T> operator*(const TMatrix4x3<T> &a, const TMatrix4x3<T> &b) {
+
+	// һǵλ󣬽һ
+	// Identity on either side is just a copy of the other side
+
+	if (a.transformType == eTransformTypeIdentity) {
+		return b;
+	}
+	if (b.transformType == eTransformTypeIdentity) {
+		return a;
+	}
+
+	TMatrix4x3<T> r;
+
+	// ֮ƽƣֻҪӵaƽƲ
+	// Translating afterwards just adds to a's translation
+
+	if (b.transformType == eTransformTypeTranslation) {
+		r = a;
+		r.tx += b.tx;
+		r.ty += b.ty;
+		r.tz += b.tz;
+		return r;
+	}
+
+	// ƽƣô3x3־bģֻҪ任aƽƲ
+	// Translating first - the 3x3 portion is b's, and a's translation
+	// is transformed by b
+
+	if (a.transformType == eTransformTypeTranslation) {
+		r.m11 = b.m11; r.m12 = b.m12; r.m13 = b.m13;
+		r.m21 = b.m21; r.m22 = b.m22; r.m23 = b.m23;
+		r.m31 = b.m31; r.m32 = b.m32; r.m33 = b.m33;
 
-	Matrix4x3 r;
+		r.tx = a.tx*b.m11 + a.ty*b.m21 + a.tz*b.m31 + b.tx;
+		r.ty = a.tx*b.m12 + a.ty*b.m22 + a.tz*b.m32 + b.ty;
+		r.tz = a.tx*b.m13 + a.ty*b.m23 + a.tz*b.m33 + b.tz;
+
+		r.transformType = b.transformType;
+		return r;
+	}
 
 	// 3x3Ա任
 	// Compute the upper 3x3 (linear transformation) portion
@@ -833,6 +1053,11 @@ Matrix4x3 operator*(const Matrix4x3 &a, const Matrix4x3 &b) {
 	r.ty = a.tx*b.m12 + a.ty*b.m22 + a.tz*b.m32 + b.ty;
 	r.tz = a.tx*b.m13 + a.ty*b.m23 + a.tz*b.m33 + b.tz;
 
+	// ӺнһǸ
+	// The type of the result is the more general of the two
+
+	r.transformType = (a.transformType > b.transformType) ? a.transformType : b.transformType;
+
 	// ѽ - ˹캯ٶҪģǿҪ
 	// һͬĺҪĵط...
 	// Return it.  Ouch - involves a copy constructor call.  If speed
@@ -842,7 +1067,8 @@ Matrix4x3 operator*(const Matrix4x3 &a, const Matrix4x3 &b) {
 	return r;
 }
 
-Matrix4x3 &operator*=(Matrix4x3 &a, const Matrix4x3 &b) {
+template <class T>
+TMatrix4x3<T> &operator*=(TMatrix4x3<T> &a, const TMatrix4x3<T> &b) {
 	a = a * b;
 	return a;
 }
@@ -856,7 +1082,16 @@ Matrix4x3 &operator*=(Matrix4x3 &a, const Matrix4x3 &b) {
 // μ9.1.1ڻøϢ
 // See 9.1.1 for more info.
 
-float	determinant(const Matrix4x3 &m) {
+template <class T>
+T	determinant(const TMatrix4x3<T> &m) {
+
+	// λƽƾʽ1
+	// Identity and translation have a determinant of one
+
+	if (m.transformType <= eTransformTypeTranslation) {
+		return 1.0f;
+	}
+
 	return
 		  m.m11 * (m.m22*m.m33 - m.m23*m.m32)
 		+ m.m12 * (m.m23*m.m31 - m.m21*m.m33)
@@ -873,42 +1108,87 @@ float	determinant(const Matrix4x3 &m) {
 // μ9.2.1øϢ
 // See 9.2.1 for more info.
 
-Matrix4x3 inverse(const Matrix4x3 &m) {
+template <class T>
+TMatrix4x3<T> inverse(const TMatrix4x3<T> &m) {
 
-	// ʽ
-	// Compute the determinant
+	TMatrix4x3<T>	r;
 
-	float	det = determinant(m);
+	// λԼ
+	// The identity is its own inverse
 
-	// ʽ㣬û
-	// If we're singular, then the determinant is zero and there's
-	// no inverse
+	if (m.transformType == eTransformTypeIdentity) {
+		return m;
+	}
 
-	assert(fabs(det) > 0.000001f);
+	// ƽƾǷƽ
+	// The inverse of a translation is the opposite translation
 
-	// һʽֻҪһΣȻȥÿһԪء
-	// Compute one over the determinant, so we divide once and
-	// can *multiply* per element
+	if (m.transformType == eTransformTypeTranslation) {
+		r = m;
+		r.tx = -m.tx;
+		r.ty = -m.ty;
+		r.tz = -m.tz;
+		return r;
+	}
 
-	float	oneOverDet = 1.0f / det;
+	if (
+		m.transformType == eTransformTypeRigid ||
+		m.transformType == eTransformTypeSimilarity
+	) {
 
-	// 3x3ֵͨʽ
-	// Compute the 3x3 portion of the inverse, by
-	// dividing the adjoint by the determinant
+		// תþ󣨲μ9.3.2ڣ
+		// Ʊ任ÿһеĳȶsԻҪsƽ
+		// The inverse of an orthogonal matrix is its transpose.  (See
+		// 9.3.2.)  For a similarity transform, the rows all have length
+		// s, so we must also divide by s squared.
 
-	Matrix4x3	r;
+		T	k = 1.0f;
+		if (m.transformType == eTransformTypeSimilarity) {
+			k = 1.0f / (m.m11*m.m11 + m.m12*m.m12 + m.m13*m.m13);
+		}
 
-	r.m11 = (m.m22*m.m33 - m.m23*m.m32) * oneOverDet;
-	r.m12 = (m.m13*m.m32 - m.m12*m.m33) * oneOverDet;
-	r.m13 = (m.m12*m.m23 - m.m13*m.m22) * oneOverDet;
+		r.m11 = m.m11*k; r.m12 = m.m21*k; r.m13 = m.m31*k;
+		r.m21 = m.m12*k; r.m22 = m.m22*k; r.m23 = m.m32*k;
+		r.m31 = m.m13*k; r.m32 = m.m23*k; r.m33 = m.m33*k;
 
-	r.m21 = (m.m23*m.m31 - m.m21*m.m33) * oneOverDet;
-	r.m22 = (m.m11*m.m33 - m.m13*m.m31) * oneOverDet;
-	r.m23 = (m.m13*m.m21 - m.m11*m.m23) * oneOverDet;
+	} else {
 
-	r.m31 = (m.m21*m.m32 - m.m22*m.m31) * oneOverDet;
-	r.m32 = (m.m12*m.m31 - m.m11*m.m32) * oneOverDet;
-	r.m33 = (m.m11*m.m22 - m.m12*m.m21) * oneOverDet;
+		// һ
+		// The general case
+
+		// ʽ
+		// Compute the determinant
+
+		T	det = determinant(m);
+
+		// ʽ㣬û
+		// If we're singular, then the determinant is zero and there's
+		// no inverse
+
+		assert(fabs(det) > 0.000001f);
+
+		// һʽֻҪһΣȻȥÿһԪء
+		// Compute one over the determinant, so we divide once and
+		// can *multiply* per element
+
+		T	oneOverDet = 1.0f / det;
+
+		// 3x3ֵͨʽ
+		// Compute the 3x3 portion of the inverse, by
+		// dividing the adjoint by the determinant
+
+		r.m11 = (m.m22*m.m33 - m.m23*m.m32) * oneOverDet;
+		r.m12 = (m.m13*m.m32 - m.m12*m.m33) * oneOverDet;
+		r.m13 = (m.m12*m.m23 - m.m13*m.m22) * oneOverDet;
+
+		r.m21 = (m.m23*m.m31 - m.m21*m.m33) * oneOverDet;
+		r.m22 = (m.m11*m.m33 - m.m13*m.m31) * oneOverDet;
+		r.m23 = (m.m13*m.m21 - m.m11*m.m23) * oneOverDet;
+
+		r.m31 = (m.m21*m.m32 - m.m22*m.m31) * oneOverDet;
+		r.m32 = (m.m12*m.m31 - m.m11*m.m32) * oneOverDet;
+		r.m33 = (m.m11*m.m22 - m.m12*m.m21) * oneOverDet;
+	}
 
 	// ƽƲ
 	// Compute the translation portion of the inverse
@@ -917,6 +1197,11 @@ Matrix4x3 inverse(const Matrix4x3 &m) {
 	r.ty = -(m.tx*r.m12 + m.ty*r.m22 + m.tz*r.m32);
 	r.tz = -(m.tx*r.m13 + m.ty*r.m23 + m.tz*r.m33);
 
+	// ԭͬ
+	// The inverse is the same type of transform
+
+	r.transformType = m.transformType;
+
 	// ѽ - ˹캯ٶҪģǿҪ
 	// һͬĺҪĵط...
 	// Return it.  Ouch - involves a copy constructor call.  If speed
@@ -932,8 +1217,9 @@ Matrix4x3 inverse(const Matrix4x3 &m) {
 // ʽؾƽƲ
 // Return the translation row of the matrix in vector form
 
-Vector3	getTranslation(const Matrix4x3 &m) {
-	return Vector3(m.tx, m.ty, m.tz);
+template <class T>
+TVector3<T>	getTranslation(const TMatrix4x3<T> &m) {
+	return TVector3<T>(m.tx, m.ty, m.tz);
 }
 
 //---------------------------------------------------------------------------
@@ -947,7 +1233,8 @@ Vector3	getTranslation(const Matrix4x3 &m) {
 // We assume that the matrix represents a rigid transformation.  (No scale,
 // skew, or mirroring)
 
-Vector3	getPositionFromParentToLocalMatrix(const Matrix4x3 &m) {
+template <class T>
+TVector3<T>	getPositionFromParentToLocalMatrix(const TMatrix4x3<T> &m) {
 
 	// ͨת3x3ֳԸƽֵͨתãǼٶġڷǼ̱任ı任ûģ
 	// Multiply negative translation value by the
@@ -955,7 +1242,7 @@ Vector3	getPositionFromParentToLocalMatrix(const Matrix4x3 &m) {
 	// we assume that the matrix is orthogonal.  (This function
 	// doesn't really make sense for non-rigid transformations...)
 
-	return Vector3(
+	return TVector3<T>(
 		-(m.tx*m.m11 + m.ty*m.m12 + m.tz*m.m13),
 		-(m.tx*m.m21 + m.ty*m.m22 + m.tz*m.m23),
 		-(m.tx*m.m31 + m.ty*m.m32 + m.tz*m.m33)
@@ -969,10 +1256,47 @@ Vector3	getPositionFromParentToLocalMatrix(const Matrix4x3 &m) {
 // Extract the position of an object given a local -> parent transformation
 // matrix (such as an object -> world matrix)
 
-Vector3	getPositionFromLocalToParentMatrix(const Matrix4x3 &m) {
+template <class T>
+TVector3<T>	getPositionFromLocalToParentMatrix(const TMatrix4x3<T> &m) {
 
 	// λüƽƲ
 	// Position is simply the translation portion
 
-	return Vector3(m.tx, m.ty, m.tz);
+	return TVector3<T>(m.tx, m.ty, m.tz);
 }
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// ʽʵ
+// Explicit instantiations
+//
+// ģֻļпɼʵfloatdouble汾
+// The templates above are only visible in this file, so the float and
+// double versions are instantiated here.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+static_assert(std::is_trivially_copyable<Matrix4x3>::value, "Matrix4x3 must be trivially copyable");
+static_assert(std::is_trivially_copyable<Matrix4x3d>::value, "Matrix4x3d must be trivially copyable");
+
+template class TMatrix4x3<float>;
+template Vector3	operator*(const Vector3 &p, const Matrix4x3 &m);
+template Matrix4x3	operator*(const Matrix4x3 &a, const Matrix4x3 &b);
+template Vector3	&operator*=(Vector3 &p, const Matrix4x3 &m);
+template Matrix4x3	&operator*=(Matrix4x3 &a, const Matrix4x3 &b);
+template float		determinant(const Matrix4x3 &m);
+template Matrix4x3	inverse(const Matrix4x3 &m);
+template Vector3	getTranslation(const Matrix4x3 &m);
+template Vector3	getPositionFromParentToLocalMatrix(const Matrix4x3 &m);
+template Vector3	getPositionFromLocalToParentMatrix(const Matrix4x3 &m);
+
+template class TMatrix4x3<double>;
+template Vector3d	operator*(const Vector3d &p, const Matrix4x3d &m);
+template Matrix4x3d	operator*(const Matrix4x3d &a, const Matrix4x3d &b);
+template Vector3d	&operator*=(Vector3d &p, const Matrix4x3d &m);
+template Matrix4x3d	&operator*=(Matrix4x3d &a, const Matrix4x3d &b);
+template double		determinant(const Matrix4x3d &m);
+template Matrix4x3d	inverse(const Matrix4x3d &m);
+template Vector3d	getTranslation(const Matrix4x3d &m);
+template Vector3d	getPositionFromParentToLocalMatrix(const Matrix4x3d &m);
+template Vector3d	getPositionFromLocalToParentMatrix(const Matrix4x3d &m);
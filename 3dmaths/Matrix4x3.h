@@ -17,20 +17,49 @@
 #ifndef __MATRIX4X3_H_INCLUDED__
 #define __MATRIX4X3_H_INCLUDED__
 
-class Vector3;
+template <class T> class TVector3;
+typedef TVector3<float> Vector3;
+typedef TVector3<double> Vector3d;
 class EulerAngles;
 class Quaternion;
 class RotationMatrix;
 
 //---------------------------------------------------------------------------
-// Matrix4x3
-// class Matrix4x3
+// 任
+// ETransformType
+//
+// ʾı任ࡣմ⵽һ˳У
+// Ӻ;нϴǸ
+// The kind of transformation a matrix represents.  These are ordered
+// from most special to most general, so the type of the concatenation
+// of two matrices is simply the larger of the two types.
+
+enum ETransformType {
+	eTransformTypeIdentity,		// identity
+	eTransformTypeTranslation,	// translation only, 3x3 portion is identity
+	eTransformTypeRigid,		// 3x3 portion is orthogonal (rotation, possibly with reflection)
+	eTransformTypeSimilarity,	// orthogonal times uniform scale
+	eTransformTypeAffine		// anything else
+};
+
+//---------------------------------------------------------------------------
+// TMatrix4x3
+// class TMatrix4x3
 //
 // ʵ4x3תԱκη仯
 // Implement a 4x3 transformation matrix.  This class can represent
 // any 3D affine transformation.
-
-class Matrix4x3 {
+//
+// ԪģTVector3һԱMatrix4x3.cppʵ֣
+// ʽʵfloatdouble汾ҲMatrix4x3Matrix4x3d
+// ƽɸƵġ
+// The element type is a template parameter, just like TVector3.  The
+// members are implemented in Matrix4x3.cpp, which explicitly
+// instantiates the float and double versions, aliased below as
+// Matrix4x3 and Matrix4x3d.  The class is trivially copyable.
+
+template <class T>
+class TMatrix4x3 {
 public:
 
 // 
@@ -43,10 +72,50 @@ public:
 	// translation portion.  See the Matrix4x3.cpp for more
 	// details.
 
-	float	m11, m12, m13;
-	float	m21, m22, m23;
-	float	m31, m32, m33;
-	float	tx,  ty,  tz;
+	T	m11, m12, m13;
+	T	m21, m22, m23;
+	T	m31, m32, m33;
+	T	tx,  ty,  tz;
+
+	// ı任͡setupϵкԶάӡͱ任ʱ
+	// ѡļ㷽ֱ޸Ԫأ
+	// classify()߰ΪeTransformTypeAffine
+	// The type of transformation.  This is maintained automatically by
+	// the setup functions, and allows concatenation, inversion and point
+	// transformation to use faster special-case math.  If you modify the
+	// elements above directly, call classify(), or just set this to
+	// eTransformTypeAffine, which is always safe.
+
+	ETransformType	transformType;
+
+// 캯
+// Constructors
+
+	// ĬϹ캯ʼԪأΪһķ任
+	// ǰȫġ
+	// Default constructor leaves the elements uninitialized, just like
+	// before.  The type is set to the general case, which is always safe
+
+	TMatrix4x3() : transformType(eTransformTypeAffine) {}
+
+	// Ԫغͱ任͵Ĺ캯constexpr
+	// ԿڳkMatrix4x3Identity
+	// Construct given all of the elements and the transform type.  This
+	// is constexpr, so it can be used for compile time constants like
+	// kMatrix4x3Identity
+
+	constexpr TMatrix4x3(
+		T n11, T n12, T n13,
+		T n21, T n22, T n23,
+		T n31, T n32, T n33,
+		T ntx, T nty, T ntz,
+		ETransformType type = eTransformTypeAffine
+	) :
+		m11(n11), m12(n12), m13(n13),
+		m21(n21), m22(n22), m23(n23),
+		m31(n31), m32(n32), m33(n33),
+		tx(ntx), ty(nty), tz(ntz),
+		transformType(type) {}
 
 // в
 // Public operations
@@ -56,12 +125,17 @@ public:
 
 	void	identity();
 
+	// ݾԪȷ任
+	// Determine the transform type by inspecting the elements
+
+	void	classify();
+
 	// ֱʹþƽƲ
 	// Access the translation portion of the matrix directly
 
 	void	zeroTranslation();
-	void	setTranslation(const Vector3 &d);
-	void	setupTranslation(const Vector3 &d);
+	void	setTranslation(const TVector3<T> &d);
+	void	setupTranslation(const TVector3<T> &d);
 
 	// һӸռ䵽ֲռ෴ضת
 	// ٶؿռǸռľָλúͳ
@@ -71,20 +145,20 @@ public:
 	// and orientation within the parent space.  The orientation may be
 	// specified using either Euler angles, or a rotation matrix
 
-	void	setupLocalToParent(const Vector3 &pos, const EulerAngles &orient);
-	void	setupLocalToParent(const Vector3 &pos, const RotationMatrix &orient);
-	void	setupParentToLocal(const Vector3 &pos, const EulerAngles &orient);
-	void	setupParentToLocal(const Vector3 &pos, const RotationMatrix &orient);
+	void	setupLocalToParent(const TVector3<T> &pos, const EulerAngles &orient);
+	void	setupLocalToParent(const TVector3<T> &pos, const RotationMatrix &orient);
+	void	setupParentToLocal(const TVector3<T> &pos, const EulerAngles &orient);
+	void	setupParentToLocal(const TVector3<T> &pos, const RotationMatrix &orient);
 
 	// ִйҪת
 	// Setup the matrix to perform a rotation about a cardinal axis
 
-	void	setupRotate(int axis, float theta);
+	void	setupRotate(int axis, T theta);
 
 	// ת
 	// Setup the matrix to perform a rotation about an arbitrary axis
 
-	void	setupRotate(const Vector3 &axis, float theta);
+	void	setupRotate(const TVector3<T> &axis, T theta);
 
 	// ִתһԪʽĽλơ
 	// Setup the matrix to perform a rotation, given
@@ -95,73 +169,90 @@ public:
 	// ִÿϵšʹʽVector3(k,k,k)ͳһk
 	// Setup the matrix to perform scale on each axis
 
-	void	setupScale(const Vector3 &s);
+	void	setupScale(const TVector3<T> &s);
 
 	// ִš
 	// Setup the matrix to perform scale along an arbitrary axis
 
-	void	setupScaleAlongAxis(const Vector3 &axis, float k);
+	void	setupScaleAlongAxis(const TVector3<T> &axis, T k);
 
 	// ִб
 	// Setup the matrix to perform a shear
 
-	void	setupShear(int axis, float s, float t);
+	void	setupShear(int axis, T s, T t);
 
 	// ִͶӰһͨԭƽ档
 	// Setup the matrix to perform a projection onto a plane passing
 	// through the origin
 
-	void	setupProject(const Vector3 &n);
+	void	setupProject(const TVector3<T> &n);
 
 	// һƽڻƽķ䡣
 	// Setup the matrix to perform a reflection about a plane parallel
 	// to a cardinal plane
 
-	void	setupReflect(int axis, float k = 0.0f);
+	void	setupReflect(int axis, T k = 0.0f);
 
 	// þִйͨԭƽķ䡣
 	// Setup the matrix to perform a reflection about an arbitrary plane
 	// through the origin
 
-	void	setupReflect(const Vector3 &n);
+	void	setupReflect(const TVector3<T> &n);
 };
 
+// õʵ
+// The usual instantiations
+
+typedef TMatrix4x3<float>	Matrix4x3;
+typedef TMatrix4x3<double>	Matrix4x3d;
+
+// λ
+// The identity matrix constant
+
+constexpr Matrix4x3 kMatrix4x3Identity(
+	1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f,
+	0.0f, 0.0f, 1.0f,
+	0.0f, 0.0f, 0.0f,
+	eTransformTypeIdentity
+);
+
 // *任㣬ҲӾ
 // ˵˳ͱ任˳һġ
 // Operator* is used to transforms a point, and also concatonate matrices.
 // The order of multiplications from left to right is the same as
 // the order of transformations
 
-Vector3		operator*(const Vector3 &p, const Matrix4x3 &m);
-Matrix4x3	operator*(const Matrix4x3 &a, const Matrix4x3 &b);
+template <class T> TVector3<T>	operator*(const TVector3<T> &p, const TMatrix4x3<T> &m);
+template <class T> TMatrix4x3<T>	operator*(const TMatrix4x3<T> &a, const TMatrix4x3<T> &b);
 
 // *=ʹúC++׼һ
 // Operator *= for conformance to C++ standards
 
-Vector3		&operator*=(Vector3 &p, const Matrix4x3 &m);
-Matrix4x3	&operator*=(const Matrix4x3 &a, const Matrix4x3 &m);
+template <class T> TVector3<T>	&operator*=(TVector3<T> &p, const TMatrix4x3<T> &m);
+template <class T> TMatrix4x3<T>	&operator*=(TMatrix4x3<T> &a, const TMatrix4x3<T> &m);
 
 // 3x3󲿷ֵʽ
 // Compute the determinant of the 3x3 portion of the matrix
 
-float	determinant(const Matrix4x3 &m);
+template <class T> T	determinant(const TMatrix4x3<T> &m);
 
 // 
 // Compute the inverse of a matrix
 
-Matrix4x3 inverse(const Matrix4x3 &m);
+template <class T> TMatrix4x3<T>	inverse(const TMatrix4x3<T> &m);
 
 // ӾȡƽƲ
 // Extract the translation portion of the matrix
 
-Vector3	getTranslation(const Matrix4x3 &m);
+template <class T> TVector3<T>	getTranslation(const TMatrix4x3<T> &m);
 
 // Ӿֲϵ->ϵϵ->ֲϵȡλ/λ
 // Extract the position/orientation from a local->parent matrix,
 // or a parent->local matrix
 
-Vector3	getPositionFromParentToLocalMatrix(const Matrix4x3 &m);
-Vector3	getPositionFromLocalToParentMatrix(const Matrix4x3 &m);
+template <class T> TVector3<T>	getPositionFromParentToLocalMatrix(const TMatrix4x3<T> &m);
+template <class T> TVector3<T>	getPositionFromLocalToParentMatrix(const TMatrix4x3<T> &m);
 
 /////////////////////////////////////////////////////////////////////////////
 #endif // #ifndef __ROTATIONMATRIX_H_INCLUDED__
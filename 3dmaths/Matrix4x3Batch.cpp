@@ -0,0 +1,457 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Matrix4x3Batch.cpp - Array-at-a-time operations using Matrix4x3
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+
+#include <vector>
+
+#include "Matrix4x3Batch.h"
+#include "Matrix4x3.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The input vectors are usually embedded in vertex structures, so we
+// can't load them straight into registers.  Instead, for each group of
+// kSimdWidth vectors we gather the x, y and z components into three
+// registers, do the math "sideways" exactly like the Vector3Array
+// kernels, and scatter the results back out.  The twelve matrix elements
+// are broadcast into registers once, outside the loop.
+//
+// Arrays smaller than kMinPointsPerChunk vectors don't bother with the
+// worker threads.
+//
+// Matrix concatenation is different.  Gathering the twelve elements of
+// several matrices into lanes costs more than the multiply itself, so
+// instead each row of a matrix lives in one four-wide register.  See
+// concatInto().
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMinPointsPerChunk = 8192;
+const int	kMinMatricesPerChunk = 1024;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// TransformJob
+//
+// Parameters for one batch transform, passed to parallelFor
+
+struct TransformJob {
+	Matrix4x3	m;
+	const char	*src;
+	char		*dst;
+	int		srcStride;
+	int		dstStride;
+};
+
+//---------------------------------------------------------------------------
+// transformRange
+//
+// Transform vectors [begin, end) of a job.  The template parameters let
+// the compiler throw away the translation and normalization code when it
+// isn't needed.
+
+template <bool kTranslate, bool kNormalize>
+static void	transformRange(int begin, int end, void *context) {
+	const TransformJob *job = (const TransformJob *)context;
+	const Matrix4x3 &m = job->m;
+
+	// Strides are in bytes, but the gathers want floats
+
+	int	sf = job->srcStride / (int)sizeof(float);
+	int	df = job->dstStride / (int)sizeof(float);
+
+	// Load up the matrix
+
+	SimdFloat	m11 = simdSet1(m.m11), m12 = simdSet1(m.m12), m13 = simdSet1(m.m13);
+	SimdFloat	m21 = simdSet1(m.m21), m22 = simdSet1(m.m22), m23 = simdSet1(m.m23);
+	SimdFloat	m31 = simdSet1(m.m31), m32 = simdSet1(m.m32), m33 = simdSet1(m.m33);
+	SimdFloat	tx = simdSet1(kTranslate ? m.tx : 0.0f);
+	SimdFloat	ty = simdSet1(kTranslate ? m.ty : 0.0f);
+	SimdFloat	tz = simdSet1(kTranslate ? m.tz : 0.0f);
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		const float *s = (const float *)(job->src + (size_t)i * job->srcStride);
+		SimdFloat	x = simdGather(s, sf);
+		SimdFloat	y = simdGather(s + 1, sf);
+		SimdFloat	z = simdGather(s + 2, sf);
+
+		SimdFloat	rx = simdMadd(x, m11, simdMadd(y, m21, simdMadd(z, m31, tx)));
+		SimdFloat	ry = simdMadd(x, m12, simdMadd(y, m22, simdMadd(z, m32, ty)));
+		SimdFloat	rz = simdMadd(x, m13, simdMadd(y, m23, simdMadd(z, m33, tz)));
+
+		if (kNormalize) {
+			SimdFloat	magSq = rx*rx + ry*ry + rz*rz;
+			SimdFloat	k = simdSelect(magSq > simdZero(), simdRsqrt(magSq), simdSet1(1.0f));
+			rx = rx * k;
+			ry = ry * k;
+			rz = rz * k;
+		}
+
+		float *d = (float *)(job->dst + (size_t)i * job->dstStride);
+		simdScatter(d, df, rx);
+		simdScatter(d + 1, df, ry);
+		simdScatter(d + 2, df, rz);
+	}
+
+	// Finish up the last few one at a time
+
+	for ( ; i < end ; ++i) {
+		const Vector3 *s = (const Vector3 *)(job->src + (size_t)i * job->srcStride);
+		Vector3 r(
+			s->x*m.m11 + s->y*m.m21 + s->z*m.m31,
+			s->x*m.m12 + s->y*m.m22 + s->z*m.m32,
+			s->x*m.m13 + s->y*m.m23 + s->z*m.m33
+		);
+		if (kTranslate) {
+			r.x += m.tx; r.y += m.ty; r.z += m.tz;
+		}
+		if (kNormalize) {
+			r.normalize();
+		}
+		*(Vector3 *)(job->dst + (size_t)i * job->dstStride) = r;
+	}
+}
+
+//---------------------------------------------------------------------------
+// runTransform
+//
+// Fill in a job and run it across the worker threads
+
+static void	runTransform(ParallelRangeFunc func, const Matrix4x3 &m, const Vector3 *src,
+	Vector3 *dst, int count, int srcStride, int dstStride) {
+
+	// The gathers index by floats, so the strides must be
+	// a whole number of floats
+
+	assert(srcStride % sizeof(float) == 0);
+	assert(dstStride % sizeof(float) == 0);
+
+	// In-place is fine, but only if the vectors line up
+
+	assert(src != dst || srcStride == dstStride);
+
+	TransformJob	job;
+	job.m = m;
+	job.src = (const char *)src;
+	job.dst = (char *)dst;
+	job.srcStride = srcStride;
+	job.dstStride = dstStride;
+
+	parallelFor(count, kMinPointsPerChunk, func, &job);
+}
+
+//---------------------------------------------------------------------------
+// moreGeneralType
+//
+// The type of the concatenation of two matrices
+
+static inline ETransformType	moreGeneralType(ETransformType a, ETransformType b) {
+	return (a > b) ? a : b;
+}
+
+//---------------------------------------------------------------------------
+// concatInto
+//
+// r = a * b.  Unlike the vector kernels, this works on one matrix at a
+// time: each row of the result is a combination of the rows of b,
+//
+//	r.row[i] = a.mi1*b.row[1] + a.mi2*b.row[2] + a.mi3*b.row[3] (+ b.t)
+//
+// so with a four-wide register holding one row, a whole matrix is nine
+// multiply-adds.  The rows are stored with four-wide writes that spill
+// one float into the next row, or into transformType on the last row,
+// which we write afterwards.  r may be the same matrix as a or b.
+
+static inline void	concatInto(const Matrix4x3 &a, const Matrix4x3 &b, Matrix4x3 &r) {
+	ETransformType	type = moreGeneralType(a.transformType, b.transformType);
+
+#if defined(MATH_SIMD_SSE)
+
+	// Only the translation row would pick up transformType in the
+	// fourth lane, so mask it off
+
+	const __m128	xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+	__m128	b1 = _mm_loadu_ps(&b.m11);
+	__m128	b2 = _mm_loadu_ps(&b.m21);
+	__m128	b3 = _mm_loadu_ps(&b.m31);
+	__m128	bt = _mm_and_ps(_mm_loadu_ps(&b.tx), xyzMask);
+
+	__m128	r1 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m11), b1),
+		_mm_mul_ps(_mm_set1_ps(a.m12), b2)), _mm_mul_ps(_mm_set1_ps(a.m13), b3));
+	__m128	r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m21), b1),
+		_mm_mul_ps(_mm_set1_ps(a.m22), b2)), _mm_mul_ps(_mm_set1_ps(a.m23), b3));
+	__m128	r3 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.m31), b1),
+		_mm_mul_ps(_mm_set1_ps(a.m32), b2)), _mm_mul_ps(_mm_set1_ps(a.m33), b3));
+	__m128	rt = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.tx), b1),
+		_mm_mul_ps(_mm_set1_ps(a.ty), b2)), _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a.tz), b3), bt));
+
+	_mm_storeu_ps(&r.m11, r1);
+	_mm_storeu_ps(&r.m21, r2);
+	_mm_storeu_ps(&r.m31, r3);
+	_mm_storeu_ps(&r.tx, rt);
+	r.transformType = type;
+
+#else
+
+	r = a * b;
+	r.transformType = type;
+
+#endif
+}
+
+//---------------------------------------------------------------------------
+// ConcatJob
+//
+// Parameters for a batch concatenation, passed to parallelFor
+
+struct ConcatJob {
+	const Matrix4x3	*a;
+	const Matrix4x3	*b;
+	Matrix4x3	*result;
+};
+
+//---------------------------------------------------------------------------
+// concatRange
+//
+// Concatenate matrices [begin, end) of a job
+
+static void	concatRange(int begin, int end, void *context) {
+	const ConcatJob *job = (const ConcatJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		concatInto(job->a[i], job->b[i], job->result[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// HierarchyJob
+//
+// Parameters for one level of a hierarchy, passed to parallelFor.  nodes
+// lists the nodes on the level, all of which have a parent.
+
+struct HierarchyJob {
+	const int	*parentIndex;
+	const Matrix4x3	*local;
+	Matrix4x3	*world;
+	const int	*nodes;
+};
+
+//---------------------------------------------------------------------------
+// hierarchyRange
+//
+// Compute the world matrices of nodes [begin, end) of one level
+
+static void	hierarchyRange(int begin, int end, void *context) {
+	const HierarchyJob *job = (const HierarchyJob *)context;
+	for (int i = begin ; i < end ; ++i) {
+		int node = job->nodes[i];
+		concatInto(job->local[node], job->world[job->parentIndex[node]], job->world[node]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// transformPoints
+//
+// Transform an array of points.  See Matrix4x3Batch.h
+
+void	transformPoints(const Matrix4x3 &m, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride, int dstStride) {
+
+	// Transforming in place by the identity is a no-op
+
+	if (m.transformType == eTransformTypeIdentity && src == dst) {
+		return;
+	}
+
+	runTransform(&transformRange<true, false>, m, src, dst, count, srcStride, dstStride);
+}
+
+//---------------------------------------------------------------------------
+// transformVectors
+//
+// Transform an array of direction vectors, ignoring translation
+
+void	transformVectors(const Matrix4x3 &m, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride, int dstStride) {
+
+	// Translation doesn't affect vectors, so this is a no-op
+	// for the identity and for pure translations
+
+	if (m.transformType <= eTransformTypeTranslation && src == dst) {
+		return;
+	}
+
+	runTransform(&transformRange<false, false>, m, src, dst, count, srcStride, dstStride);
+}
+
+//---------------------------------------------------------------------------
+// normalMatrix
+//
+// The inverse transpose of the 3x3 portion of the matrix.  (See 9.2.1 for
+// the classical adjoint.)  The transpose of the inverse is just the
+// cofactor matrix divided by the determinant.  Normals get renormalized
+// anyway, but we still divide so that mirroring transforms flip the
+// normals the right way.
+
+Matrix4x3	normalMatrix(const Matrix4x3 &m) {
+
+	Matrix4x3	n;
+
+	n.m11 = m.m22*m.m33 - m.m23*m.m32;
+	n.m12 = m.m23*m.m31 - m.m21*m.m33;
+	n.m13 = m.m21*m.m32 - m.m22*m.m31;
+
+	n.m21 = m.m13*m.m32 - m.m12*m.m33;
+	n.m22 = m.m11*m.m33 - m.m13*m.m31;
+	n.m23 = m.m12*m.m31 - m.m11*m.m32;
+
+	n.m31 = m.m12*m.m23 - m.m13*m.m22;
+	n.m32 = m.m13*m.m21 - m.m11*m.m23;
+	n.m33 = m.m11*m.m22 - m.m12*m.m21;
+
+	n.tx = n.ty = n.tz = 0.0f;
+
+	// Divide by the determinant, unless it is singular, in
+	// which case the cofactors are as good as anything
+
+	float	det = m.m11*n.m11 + m.m12*n.m12 + m.m13*n.m13;
+	if (fabs(det) > 0.000001f) {
+		float	oneOverDet = 1.0f / det;
+		n.m11 *= oneOverDet; n.m12 *= oneOverDet; n.m13 *= oneOverDet;
+		n.m21 *= oneOverDet; n.m22 *= oneOverDet; n.m23 *= oneOverDet;
+		n.m31 *= oneOverDet; n.m32 *= oneOverDet; n.m33 *= oneOverDet;
+	}
+
+	return n;
+}
+
+//---------------------------------------------------------------------------
+// transformNormals
+//
+// Transform an array of surface normals by the inverse transpose of the
+// 3x3 portion of the matrix
+
+void	transformNormals(const Matrix4x3 &m, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride, int dstStride) {
+	runTransform(&transformRange<false, true>, normalMatrix(m), src, dst, count, srcStride, dstStride);
+}
+
+//---------------------------------------------------------------------------
+// concatenate
+//
+// result[i] = a[i] * b[i].  See Matrix4x3Batch.h
+
+void	concatenate(const Matrix4x3 *a, const Matrix4x3 *b, Matrix4x3 *result, int count) {
+	ConcatJob	job;
+	job.a = a;
+	job.b = b;
+	job.result = result;
+
+	parallelFor(count, kMinMatricesPerChunk, &concatRange, &job);
+}
+
+//---------------------------------------------------------------------------
+// flattenHierarchy
+//
+// Compute world matrices for a topologically sorted hierarchy.  See
+// Matrix4x3Batch.h
+
+void	flattenHierarchy(const int *parentIndex, const Matrix4x3 *local,
+	Matrix4x3 *world, int count) {
+
+	if (count < 1) {
+		return;
+	}
+
+	// With only one thread (or not much work) there is nothing to gain
+	// by sorting into levels.  Parents come first, so just stream
+	// through the array.
+
+	if (count <= kMinMatricesPerChunk || getWorkerThreadCount() <= 1) {
+		for (int i = 0 ; i < count ; ++i) {
+			int parent = parentIndex[i];
+			if (parent < 0) {
+				world[i] = local[i];
+			} else {
+				assert(parent < i);
+				concatInto(local[i], world[parent], world[i]);
+			}
+		}
+		return;
+	}
+
+	// Figure out how deep each node is.  Since parents come first,
+	// one pass does it.  Roots are copied over as we go.
+
+	std::vector<int>	depth(count);
+	int			levelCount = 1;
+	for (int i = 0 ; i < count ; ++i) {
+		int parent = parentIndex[i];
+		if (parent < 0) {
+			depth[i] = 0;
+			world[i] = local[i];
+		} else {
+			assert(parent < i);
+			depth[i] = depth[parent] + 1;
+			if (depth[i] >= levelCount) {
+				levelCount = depth[i] + 1;
+			}
+		}
+	}
+
+	// Sort the non-root nodes by depth.  Nodes keep their relative
+	// order within a level, so siblings stay close together in memory.
+
+	std::vector<int>	levelStart(levelCount + 1, 0);
+	for (int i = 0 ; i < count ; ++i) {
+		++levelStart[depth[i] + 1];
+	}
+	for (int level = 1 ; level <= levelCount ; ++level) {
+		levelStart[level] += levelStart[level - 1];
+	}
+
+	std::vector<int>	nodes(count);
+	std::vector<int>	fill(levelStart.begin(), levelStart.end() - 1);
+	for (int i = 0 ; i < count ; ++i) {
+		nodes[fill[depth[i]]++] = i;
+	}
+
+	// Do each level in turn.  Everything on a level depends only on the
+	// level above, so a level can be split any way we like.
+
+	HierarchyJob	job;
+	job.parentIndex = parentIndex;
+	job.local = local;
+	job.world = world;
+
+	for (int level = 1 ; level < levelCount ; ++level) {
+		job.nodes = &nodes[levelStart[level]];
+		parallelFor(levelStart[level + 1] - levelStart[level], kMinMatricesPerChunk,
+			&hierarchyRange, &job);
+	}
+}
@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Matrix4x3Batch.h - Array-at-a-time operations using Matrix4x3
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see Matrix4x3Batch.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MATRIX4X3BATCH_H_INCLUDED__
+#define __MATRIX4X3BATCH_H_INCLUDED__
+
+#ifndef __VECTOR3_H_INCLUDED__
+	#include "vector3.h"
+#endif
+
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
+
+//---------------------------------------------------------------------------
+// Batch transformation
+//
+// Transform count vectors from src to dst.  These do the same thing as
+// calling operator*(const Vector3 &, const Matrix4x3 &) in a loop, but
+// the matrix is only loaded once and several vectors are processed at a
+// time using SIMD.  Large arrays are split across the worker threads.
+//
+// The vectors may be embedded in larger structures, such as
+// RenderVertex::p or EditTriMesh::Vertex::p; pass the size of the
+// structure as the stride, in bytes.  src and dst may be the same array,
+// provided the strides are the same.
+
+// Transform points.  (The translation portion is applied)
+
+void	transformPoints(const Matrix4x3 &m, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride = sizeof(Vector3), int dstStride = sizeof(Vector3));
+
+// Transform direction vectors.  (The translation portion is ignored)
+
+void	transformVectors(const Matrix4x3 &m, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride = sizeof(Vector3), int dstStride = sizeof(Vector3));
+
+// Transform surface normals.  Normals must be multiplied by the inverse
+// transpose of the 3x3 portion to remain perpendicular to the surface
+// when the matrix contains non-uniform scale or skew.  The results are
+// renormalized.
+
+void	transformNormals(const Matrix4x3 &m, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride = sizeof(Vector3), int dstStride = sizeof(Vector3));
+
+// The matrix transformNormals() actually multiplies by: the inverse
+// transpose of the 3x3 portion, with no translation
+
+Matrix4x3	normalMatrix(const Matrix4x3 &m);
+
+//---------------------------------------------------------------------------
+// Batch concatenation
+//
+// result[i] = a[i] * b[i], for count matrices.  Same as calling
+// operator*(const Matrix4x3 &, const Matrix4x3 &) in a loop, but each
+// row of the result is computed with one SIMD register, and large arrays
+// are split across the worker threads.  result may be the same array as
+// a or b.
+
+void	concatenate(const Matrix4x3 *a, const Matrix4x3 *b, Matrix4x3 *result, int count);
+
+//---------------------------------------------------------------------------
+// Hierarchy flattening
+//
+// Compute the world (local-to-root) matrix of every node in a hierarchy,
+// such as a skeleton or a scene graph:
+//
+//	world[i] = local[i] * world[parentIndex[i]]
+//
+// Root nodes have parentIndex[i] < 0, and their world matrix is just the
+// local matrix.  The nodes must be topologically sorted, with every parent
+// appearing before its children (parentIndex[i] < i).
+//
+// On one thread the nodes are simply streamed through in order.  With
+// worker threads available, the nodes are sorted by depth; nodes at the
+// same depth don't depend on each other, so each level is spread across
+// the threads.
+
+void	flattenHierarchy(const int *parentIndex, const Matrix4x3 *local,
+	Matrix4x3 *world, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __MATRIX4X3BATCH_H_INCLUDED__
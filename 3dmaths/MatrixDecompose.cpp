@@ -0,0 +1,728 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// MatrixDecompose.cpp - Splitting matrices into rotation, translation and
+//                       scale, and putting them back together
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+
+#include <atomic>
+
+#include "MatrixDecompose.h"
+#include "Matrix4x3.h"
+#include "Quaternion.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Reading the scale off as the lengths of the rows, and the rotation as
+// the normalized rows, only works when the rows are perpendicular.  Any
+// skew, or just the round off accumulated by concatenating a long chain
+// of matrices, leaves a "rotation" that isn't orthogonal, and the
+// quaternion extracted from it is garbage.
+//
+// Instead we use the polar decomposition m = P Q, where Q is the
+// orthogonal matrix nearest to m and P is symmetric.  When m really is
+// S R, we get P = S and Q = R exactly.  Q is found with Higham's Newton
+// iteration,
+//
+//	Q' = (g Q + (1/g) Q^-T) / 2
+//
+// starting from Q = m.  The inverse transpose is just the cofactor matrix
+// divided by the determinant (see 9.2.1), so each step costs about as
+// much as one matrix multiply.  g rescales Q so the iteration doesn't
+// waste steps on matrices with large or small scale; with g chosen from
+// the Frobenius norms of Q and Q^-T it converges to float precision in
+// four to eight steps for any reasonable matrix.
+//
+// The iteration finds the nearest orthogonal matrix, which is a
+// reflection if m has a negative determinant.  So we flip the first row
+// beforehand, and the reflection shows up as a negative x scale.
+//
+// Singular matrices (scale of zero along some axis) have no inverse to
+// iterate with, so we build a rotation from the rows that are left.
+//
+// The batch version runs the iteration on kSimdWidth matrices at once,
+// stopping when the slowest lane has converged.  Singular matrices are
+// rare, so lanes that hold one are simply redone with the scalar code.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMinDecomposePerChunk = 512;
+const int	kMinComposePerChunk = 2048;
+
+// Limit on the Newton steps.  Nothing sensible needs more than about
+// ten, but we don't want to spin forever on a NaN
+
+const int	kMaxPolarIterations = 20;
+
+// Stop iterating when the sum of the squared changes to the elements
+// drops below this.  The iteration converges quadratically, so the step
+// after that lands at float precision anyway.
+
+const float	kPolarTolerance = 1e-10f;
+
+// A matrix is treated as singular when the determinant is this small
+// relative to the product of the row lengths.  (For perpendicular rows,
+// they are equal.)
+
+const float	kSingularTolerance = 1e-6f;
+
+// A matrix is considered to have skew when an off-diagonal element of
+// the stretch is this big relative to the largest scale
+
+const float	kSkewTolerance = 1e-4f;
+
+// Matrices are gathered from and scattered to arrays by float
+
+const int	kMatrixStride = (int)(sizeof(Matrix4x3) / sizeof(float));
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// typeForScale
+//
+// The transform type of a TRS matrix with the given scale
+
+static inline ETransformType	typeForScale(const Vector3 &s) {
+	if (s.x != s.y || s.x != s.z) {
+		return eTransformTypeAffine;
+	}
+	if (s.x != 1.0f) {
+		return eTransformTypeSimilarity;
+	}
+	return eTransformTypeRigid;
+}
+
+//---------------------------------------------------------------------------
+// polarIterate
+//
+// Run the Newton iteration on the 3x3 portion of q, which must have a
+// positive determinant, leaving the nearest rotation
+
+static void	polarIterate(Matrix4x3 &q) {
+	for (int iter = 0 ; iter < kMaxPolarIterations ; ++iter) {
+
+		// Cofactors.  Divided by the determinant, these are
+		// the inverse transpose.
+
+		float	c11 = q.m22*q.m33 - q.m23*q.m32;
+		float	c12 = q.m23*q.m31 - q.m21*q.m33;
+		float	c13 = q.m21*q.m32 - q.m22*q.m31;
+		float	c21 = q.m13*q.m32 - q.m12*q.m33;
+		float	c22 = q.m11*q.m33 - q.m13*q.m31;
+		float	c23 = q.m12*q.m31 - q.m11*q.m32;
+		float	c31 = q.m12*q.m23 - q.m13*q.m22;
+		float	c32 = q.m13*q.m21 - q.m11*q.m23;
+		float	c33 = q.m11*q.m22 - q.m12*q.m21;
+
+		float	det = q.m11*c11 + q.m12*c12 + q.m13*c13;
+
+		// Frobenius scaling
+
+		float	qNorm2 =
+			q.m11*q.m11 + q.m12*q.m12 + q.m13*q.m13 +
+			q.m21*q.m21 + q.m22*q.m22 + q.m23*q.m23 +
+			q.m31*q.m31 + q.m32*q.m32 + q.m33*q.m33;
+		float	cNorm2 =
+			c11*c11 + c12*c12 + c13*c13 +
+			c21*c21 + c22*c22 + c23*c23 +
+			c31*c31 + c32*c32 + c33*c33;
+		float	g = sqrt(sqrt(cNorm2 / qNorm2) / det);
+
+		float	a = 0.5f * g;
+		float	b = 0.5f / (g * det);
+
+		float	n11 = a*q.m11 + b*c11, n12 = a*q.m12 + b*c12, n13 = a*q.m13 + b*c13;
+		float	n21 = a*q.m21 + b*c21, n22 = a*q.m22 + b*c22, n23 = a*q.m23 + b*c23;
+		float	n31 = a*q.m31 + b*c31, n32 = a*q.m32 + b*c32, n33 = a*q.m33 + b*c33;
+
+		float	change =
+			(n11 - q.m11)*(n11 - q.m11) + (n12 - q.m12)*(n12 - q.m12) + (n13 - q.m13)*(n13 - q.m13) +
+			(n21 - q.m21)*(n21 - q.m21) + (n22 - q.m22)*(n22 - q.m22) + (n23 - q.m23)*(n23 - q.m23) +
+			(n31 - q.m31)*(n31 - q.m31) + (n32 - q.m32)*(n32 - q.m32) + (n33 - q.m33)*(n33 - q.m33);
+
+		q.m11 = n11; q.m12 = n12; q.m13 = n13;
+		q.m21 = n21; q.m22 = n22; q.m23 = n23;
+		q.m31 = n31; q.m32 = n32; q.m33 = n33;
+
+		if (change < kPolarTolerance) {
+			break;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// basisFromRows
+//
+// Build a rotation for a singular matrix.  We keep the direction of the
+// longest row, then whichever of the other two has the most left over
+// once the first direction is taken out, and complete the basis with a
+// cross product.
+
+static void	basisFromRows(const Matrix4x3 &m, Matrix4x3 &q) {
+	Vector3	row[3] = {
+		Vector3(m.m11, m.m12, m.m13),
+		Vector3(m.m21, m.m22, m.m23),
+		Vector3(m.m31, m.m32, m.m33)
+	};
+
+	int	a = 0;
+	for (int i = 1 ; i < 3 ; ++i) {
+		if (row[i]*row[i] > row[a]*row[a]) {
+			a = i;
+		}
+	}
+
+	// A zero matrix has no direction at all
+
+	if (row[a]*row[a] <= 0.0f) {
+		q.identity();
+		return;
+	}
+
+	Vector3	axis[3];
+	axis[a] = row[a];
+	axis[a].normalize();
+
+	int	b = (a + 1) % 3;
+	int	c = (a + 2) % 3;
+	Vector3	pb = row[b] - axis[a] * (row[b] * axis[a]);
+	Vector3	pc = row[c] - axis[a] * (row[c] * axis[a]);
+	if (pc*pc > pb*pb) {
+		int t = b; b = c; c = t;
+		pb = pc;
+	}
+
+	// If all the rows are parallel, any perpendicular direction will do
+
+	if (pb*pb <= 1e-12f * (row[b]*row[b])) {
+		if (fabs(axis[a].x) < 0.9f) {
+			pb = crossProduct(axis[a], Vector3(1.0f, 0.0f, 0.0f));
+		} else {
+			pb = crossProduct(axis[a], Vector3(0.0f, 1.0f, 0.0f));
+		}
+	}
+	pb.normalize();
+	axis[b] = pb;
+
+	// Each row of a rotation is the cross product of the next two
+
+	axis[c] = crossProduct(axis[(c + 1) % 3], axis[(c + 2) % 3]);
+
+	q.m11 = axis[0].x; q.m12 = axis[0].y; q.m13 = axis[0].z;
+	q.m21 = axis[1].x; q.m22 = axis[1].y; q.m23 = axis[1].z;
+	q.m31 = axis[2].x; q.m32 = axis[2].y; q.m33 = axis[2].z;
+}
+
+//---------------------------------------------------------------------------
+// DecomposeJob
+//
+// Parameters for a batch decomposition, passed to parallelFor
+
+struct DecomposeJob {
+	const Matrix4x3		*m;
+	Quaternion		*rotation;
+	Vector3			*translation;
+	Vector3			*scale;
+	std::atomic<int>	inexactCount;
+};
+
+//---------------------------------------------------------------------------
+// decomposeRange
+//
+// Decompose matrices [begin, end) of a job, kSimdWidth at a time.  This
+// is polarDecompose(), rotationFromMatrix() and decomposeTRS() with every
+// branch turned into a select.
+
+static void	decomposeRange(int begin, int end, void *context) {
+	DecomposeJob *job = (DecomposeJob *)context;
+
+	SimdFloat	zero = simdZero();
+	SimdFloat	one = simdSet1(1.0f);
+	SimdFloat	half = simdSet1(0.5f);
+	int		inexact = 0;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		const float *s = &job->m[i].m11;
+		SimdFloat	m11 = simdGather(s + 0, kMatrixStride);
+		SimdFloat	m12 = simdGather(s + 1, kMatrixStride);
+		SimdFloat	m13 = simdGather(s + 2, kMatrixStride);
+		SimdFloat	m21 = simdGather(s + 3, kMatrixStride);
+		SimdFloat	m22 = simdGather(s + 4, kMatrixStride);
+		SimdFloat	m23 = simdGather(s + 5, kMatrixStride);
+		SimdFloat	m31 = simdGather(s + 6, kMatrixStride);
+		SimdFloat	m32 = simdGather(s + 7, kMatrixStride);
+		SimdFloat	m33 = simdGather(s + 8, kMatrixStride);
+
+		// Flip the first row of the reflections, and look for
+		// singular matrices
+
+		SimdFloat	det = m11*(m22*m33 - m23*m32) + m12*(m23*m31 - m21*m33) + m13*(m21*m32 - m22*m31);
+		SimdFloat	flip = simdSelect(det < zero, simdSet1(-1.0f), one);
+		SimdFloat	rowProduct2 =
+			(m11*m11 + m12*m12 + m13*m13) *
+			(m21*m21 + m22*m22 + m23*m23) *
+			(m31*m31 + m32*m32 + m33*m33);
+		SimdMask	singular = simdAbs(det) <= simdSet1(kSingularTolerance) * simdSqrt(rowProduct2);
+		int		singularLanes = simdMoveMask(singular);
+
+		SimdFloat	q11 = m11*flip, q12 = m12*flip, q13 = m13*flip;
+		SimdFloat	q21 = m21, q22 = m22, q23 = m23;
+		SimdFloat	q31 = m31, q32 = m32, q33 = m33;
+
+		// The Newton iteration.  The singular lanes are kept finite
+		// by pretending their determinant is 1; they get redone below.
+
+		for (int iter = 0 ; iter < kMaxPolarIterations ; ++iter) {
+			SimdFloat	c11 = q22*q33 - q23*q32;
+			SimdFloat	c12 = q23*q31 - q21*q33;
+			SimdFloat	c13 = q21*q32 - q22*q31;
+			SimdFloat	c21 = q13*q32 - q12*q33;
+			SimdFloat	c22 = q11*q33 - q13*q31;
+			SimdFloat	c23 = q12*q31 - q11*q32;
+			SimdFloat	c31 = q12*q23 - q13*q22;
+			SimdFloat	c32 = q13*q21 - q11*q23;
+			SimdFloat	c33 = q11*q22 - q12*q21;
+
+			SimdFloat	d = simdSelect(singular, one, q11*c11 + q12*c12 + q13*c13);
+
+			SimdFloat	qNorm2 =
+				q11*q11 + q12*q12 + q13*q13 +
+				q21*q21 + q22*q22 + q23*q23 +
+				q31*q31 + q32*q32 + q33*q33;
+			SimdFloat	cNorm2 =
+				c11*c11 + c12*c12 + c13*c13 +
+				c21*c21 + c22*c22 + c23*c23 +
+				c31*c31 + c32*c32 + c33*c33;
+			SimdFloat	g = simdSelect(singular, one, simdSqrt(simdSqrt(cNorm2 / qNorm2) / d));
+
+			SimdFloat	a = half * g;
+			SimdFloat	b = half / (g * d);
+
+			SimdFloat	n11 = simdMadd(a, q11, b*c11), n12 = simdMadd(a, q12, b*c12), n13 = simdMadd(a, q13, b*c13);
+			SimdFloat	n21 = simdMadd(a, q21, b*c21), n22 = simdMadd(a, q22, b*c22), n23 = simdMadd(a, q23, b*c23);
+			SimdFloat	n31 = simdMadd(a, q31, b*c31), n32 = simdMadd(a, q32, b*c32), n33 = simdMadd(a, q33, b*c33);
+
+			SimdFloat	change =
+				(n11 - q11)*(n11 - q11) + (n12 - q12)*(n12 - q12) + (n13 - q13)*(n13 - q13) +
+				(n21 - q21)*(n21 - q21) + (n22 - q22)*(n22 - q22) + (n23 - q23)*(n23 - q23) +
+				(n31 - q31)*(n31 - q31) + (n32 - q32)*(n32 - q32) + (n33 - q33)*(n33 - q33);
+
+			q11 = n11; q12 = n12; q13 = n13;
+			q21 = n21; q22 = n22; q23 = n23;
+			q31 = n31; q32 = n32; q33 = n33;
+
+			if ((simdMoveMask(change >= simdSet1(kPolarTolerance)) & ~singularLanes) == 0) {
+				break;
+			}
+		}
+
+		// Rotation matrix to quaternion.  Find the biggest of w, x, y
+		// and z from the diagonal, and select the matching formulas
+		// for the other three.
+
+		SimdFloat	t0 = q11 + q22 + q33;
+		SimdFloat	t1 = q11 - q22 - q33;
+		SimdFloat	t2 = q22 - q11 - q33;
+		SimdFloat	t3 = q33 - q11 - q22;
+
+		SimdMask	isX = t1 > t0;
+		SimdFloat	biggest = simdSelect(isX, t1, t0);
+		SimdMask	isY = t2 > biggest;
+		biggest = simdSelect(isY, t2, biggest);
+		SimdMask	isZ = t3 > biggest;
+		biggest = simdSelect(isZ, t3, biggest);
+
+		SimdFloat	bigVal = simdSqrt(biggest + one) * half;
+		SimdFloat	mult = simdSet1(0.25f) / bigVal;
+		SimdFloat	d23 = (q23 - q32) * mult;
+		SimdFloat	d31 = (q31 - q13) * mult;
+		SimdFloat	d12 = (q12 - q21) * mult;
+		SimdFloat	s12 = (q12 + q21) * mult;
+		SimdFloat	s31 = (q31 + q13) * mult;
+		SimdFloat	s23 = (q23 + q32) * mult;
+
+		SimdFloat	w = simdSelect(isZ, d12, simdSelect(isY, d31, simdSelect(isX, d23, bigVal)));
+		SimdFloat	x = simdSelect(isZ, s31, simdSelect(isY, s12, simdSelect(isX, bigVal, d23)));
+		SimdFloat	y = simdSelect(isZ, s23, simdSelect(isY, bigVal, simdSelect(isX, s12, d31)));
+		SimdFloat	z = simdSelect(isZ, bigVal, simdSelect(isY, s23, simdSelect(isX, s31, d12)));
+
+		// Normalize, with w >= 0
+
+		SimdFloat	k = simdRsqrt(w*w + x*x + y*y + z*z);
+		k = simdSelect(w < zero, -k, k);
+		simdStoreTranspose4(&job->rotation[i].w, w*k, x*k, y*k, z*k);
+
+		// The stretch is m times the transpose of the rotation.  The
+		// diagonal is the scale, and anything off the diagonal is skew.
+
+		SimdFloat	sx = m11*q11 + m12*q12 + m13*q13;
+		SimdFloat	sy = m21*q21 + m22*q22 + m23*q23;
+		SimdFloat	sz = m31*q31 + m32*q32 + m33*q33;
+		simdScatter(&job->scale[i].x, 3, sx);
+		simdScatter(&job->scale[i].y, 3, sy);
+		simdScatter(&job->scale[i].z, 3, sz);
+
+		SimdFloat	skew = simdAbs(m11*q21 + m12*q22 + m13*q23);
+		skew = simdMax(skew, simdAbs(m11*q31 + m12*q32 + m13*q33));
+		skew = simdMax(skew, simdAbs(m21*q11 + m22*q12 + m23*q13));
+		skew = simdMax(skew, simdAbs(m21*q31 + m22*q32 + m23*q33));
+		skew = simdMax(skew, simdAbs(m31*q11 + m32*q12 + m33*q13));
+		skew = simdMax(skew, simdAbs(m31*q21 + m32*q22 + m33*q23));
+		SimdFloat	maxScale = simdMax(simdAbs(sx), simdMax(simdAbs(sy), simdAbs(sz)));
+		int		skewLanes = simdMoveMask(skew > simdSet1(kSkewTolerance) * maxScale);
+
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			const Matrix4x3 &m = job->m[i + lane];
+			job->translation[i + lane] = Vector3(m.tx, m.ty, m.tz);
+			if (singularLanes & (1 << lane)) {
+				decomposeTRS(m, job->rotation[i + lane], job->translation[i + lane], job->scale[i + lane]);
+				++inexact;
+			} else if (skewLanes & (1 << lane)) {
+				++inexact;
+			}
+		}
+	}
+
+	// Finish up the last few one at a time
+
+	for ( ; i < end ; ++i) {
+		if (!decomposeTRS(job->m[i], job->rotation[i], job->translation[i], job->scale[i])) {
+			++inexact;
+		}
+	}
+
+	job->inexactCount += inexact;
+}
+
+//---------------------------------------------------------------------------
+// ComposeJob
+//
+// Parameters for a batch composition, passed to parallelFor
+
+struct ComposeJob {
+	const Quaternion	*rotation;
+	const Vector3		*translation;
+	const Vector3		*scale;
+	Matrix4x3		*m;
+};
+
+//---------------------------------------------------------------------------
+// composeRange
+//
+// Compose matrices [begin, end) of a job, kSimdWidth at a time.  The
+// rotation part is the same as Matrix4x3::fromQuaternion(); each row is
+// then multiplied by the scale along that axis.
+
+static void	composeRange(int begin, int end, void *context) {
+	const ComposeJob *job = (const ComposeJob *)context;
+
+	SimdFloat	one = simdSet1(1.0f);
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		SimdFloat	w, x, y, z;
+		simdLoadTranspose4(&job->rotation[i].w, w, x, y, z);
+
+		SimdFloat	ww = w + w;
+		SimdFloat	xx = x + x;
+		SimdFloat	yy = y + y;
+		SimdFloat	zz = z + z;
+		SimdFloat	sx = simdGather(&job->scale[i].x, 3);
+		SimdFloat	sy = simdGather(&job->scale[i].y, 3);
+		SimdFloat	sz = simdGather(&job->scale[i].z, 3);
+
+		float *d = &job->m[i].m11;
+		simdScatter(d + 0, kMatrixStride, sx * (one - yy*y - zz*z));
+		simdScatter(d + 1, kMatrixStride, sx * (xx*y + ww*z));
+		simdScatter(d + 2, kMatrixStride, sx * (xx*z - ww*y));
+		simdScatter(d + 3, kMatrixStride, sy * (xx*y - ww*z));
+		simdScatter(d + 4, kMatrixStride, sy * (one - xx*x - zz*z));
+		simdScatter(d + 5, kMatrixStride, sy * (yy*z + ww*x));
+		simdScatter(d + 6, kMatrixStride, sz * (xx*z + ww*y));
+		simdScatter(d + 7, kMatrixStride, sz * (yy*z - ww*x));
+		simdScatter(d + 8, kMatrixStride, sz * (one - xx*x - yy*y));
+
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			Matrix4x3	&r = job->m[i + lane];
+			const Vector3	&t = job->translation[i + lane];
+			r.tx = t.x;
+			r.ty = t.y;
+			r.tz = t.z;
+			r.transformType = typeForScale(job->scale[i + lane]);
+		}
+	}
+
+	// Finish up the last few one at a time
+
+	for ( ; i < end ; ++i) {
+		job->m[i] = composeTRS(job->rotation[i], job->translation[i], job->scale[i]);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// rotationFromMatrix
+//
+// Extract the rotation quaternion from the 3x3 portion of a matrix built
+// by Matrix4x3::fromQuaternion.  We compute whichever of w, x, y, z is
+// largest from the diagonal, and the others from the off-diagonal
+// elements, which keeps us away from dividing by something tiny.  This
+// is the same technique used in 10.6.4 to go from a matrix to Euler
+// angles by way of a quaternion.
+
+Quaternion	rotationFromMatrix(const Matrix4x3 &m) {
+	Quaternion	q;
+
+	// Four times the square of each component, less one
+
+	float	fourWSquaredMinus1 = m.m11 + m.m22 + m.m33;
+	float	fourXSquaredMinus1 = m.m11 - m.m22 - m.m33;
+	float	fourYSquaredMinus1 = m.m22 - m.m11 - m.m33;
+	float	fourZSquaredMinus1 = m.m33 - m.m11 - m.m22;
+
+	// Find the largest
+
+	int	biggestIndex = 0;
+	float	fourBiggestSquaredMinus1 = fourWSquaredMinus1;
+	if (fourXSquaredMinus1 > fourBiggestSquaredMinus1) {
+		fourBiggestSquaredMinus1 = fourXSquaredMinus1;
+		biggestIndex = 1;
+	}
+	if (fourYSquaredMinus1 > fourBiggestSquaredMinus1) {
+		fourBiggestSquaredMinus1 = fourYSquaredMinus1;
+		biggestIndex = 2;
+	}
+	if (fourZSquaredMinus1 > fourBiggestSquaredMinus1) {
+		fourBiggestSquaredMinus1 = fourZSquaredMinus1;
+		biggestIndex = 3;
+	}
+
+	// Square root and divide
+
+	float	biggestVal = sqrt(fourBiggestSquaredMinus1 + 1.0f) * 0.5f;
+	float	mult = 0.25f / biggestVal;
+
+	// The rest come from sums and differences of the
+	// off-diagonal elements
+
+	switch (biggestIndex) {
+		case 0:
+			q.w = biggestVal;
+			q.x = (m.m23 - m.m32) * mult;
+			q.y = (m.m31 - m.m13) * mult;
+			q.z = (m.m12 - m.m21) * mult;
+			break;
+
+		case 1:
+			q.x = biggestVal;
+			q.w = (m.m23 - m.m32) * mult;
+			q.y = (m.m12 + m.m21) * mult;
+			q.z = (m.m31 + m.m13) * mult;
+			break;
+
+		case 2:
+			q.y = biggestVal;
+			q.w = (m.m31 - m.m13) * mult;
+			q.x = (m.m12 + m.m21) * mult;
+			q.z = (m.m23 + m.m32) * mult;
+			break;
+
+		case 3:
+			q.z = biggestVal;
+			q.w = (m.m12 - m.m21) * mult;
+			q.x = (m.m31 + m.m13) * mult;
+			q.y = (m.m23 + m.m32) * mult;
+			break;
+	}
+
+	return q;
+}
+
+//---------------------------------------------------------------------------
+// polarDecompose
+//
+// m = stretch * rotation.  See MatrixDecompose.h
+
+bool	polarDecompose(const Matrix4x3 &m, Matrix4x3 &rotation, Matrix4x3 &stretch) {
+	Matrix4x3	&q = rotation;
+	q = m;
+	q.zeroTranslation();
+
+	// Flip the first row of a reflection, so we converge
+	// on a rotation
+
+	float	det = determinant(m);
+	if (det < 0.0f) {
+		q.m11 = -q.m11; q.m12 = -q.m12; q.m13 = -q.m13;
+	}
+
+	float	rowProduct2 =
+		(m.m11*m.m11 + m.m12*m.m12 + m.m13*m.m13) *
+		(m.m21*m.m21 + m.m22*m.m22 + m.m23*m.m23) *
+		(m.m31*m.m31 + m.m32*m.m32 + m.m33*m.m33);
+	bool	singular = fabs(det) <= kSingularTolerance * sqrt(rowProduct2);
+
+	// Always iterate, even if m is tagged rigid.  Concatenating rigid
+	// matrices keeps the tag, but not the orthogonality, and the
+	// iteration stops after a step or two when there's nothing to fix.
+
+	if (singular) {
+		basisFromRows(m, q);
+	} else {
+		polarIterate(q);
+	}
+	q.transformType = eTransformTypeRigid;
+
+	// stretch = m * transpose(rotation)
+
+	stretch.m11 = m.m11*q.m11 + m.m12*q.m12 + m.m13*q.m13;
+	stretch.m12 = m.m11*q.m21 + m.m12*q.m22 + m.m13*q.m23;
+	stretch.m13 = m.m11*q.m31 + m.m12*q.m32 + m.m13*q.m33;
+	stretch.m21 = m.m21*q.m11 + m.m22*q.m12 + m.m23*q.m13;
+	stretch.m22 = m.m21*q.m21 + m.m22*q.m22 + m.m23*q.m23;
+	stretch.m23 = m.m21*q.m31 + m.m22*q.m32 + m.m23*q.m33;
+	stretch.m31 = m.m31*q.m11 + m.m32*q.m12 + m.m33*q.m13;
+	stretch.m32 = m.m31*q.m21 + m.m32*q.m22 + m.m33*q.m23;
+	stretch.m33 = m.m31*q.m31 + m.m32*q.m32 + m.m33*q.m33;
+	stretch.tx = stretch.ty = stretch.tz = 0.0f;
+	stretch.transformType = eTransformTypeAffine;
+
+	return !singular;
+}
+
+//---------------------------------------------------------------------------
+// decomposeTRS
+//
+// Split a matrix into rotation, translation and scale.  See
+// MatrixDecompose.h
+
+bool	decomposeTRS(const Matrix4x3 &m, Quaternion &rotation,
+	Vector3 &translation, Vector3 &scale) {
+
+	translation = getTranslation(m);
+
+	// No rotation or scale at all?
+
+	if (m.transformType <= eTransformTypeTranslation) {
+		rotation = kQuaternionIdentity;
+		scale = Vector3(1.0f, 1.0f, 1.0f);
+		return true;
+	}
+
+	Matrix4x3	q, p;
+	bool		ok = polarDecompose(m, q, p);
+
+	rotation = rotationFromMatrix(q);
+	rotation.normalize();
+	if (rotation.w < 0.0f) {
+		rotation.w = -rotation.w;
+		rotation.x = -rotation.x;
+		rotation.y = -rotation.y;
+		rotation.z = -rotation.z;
+	}
+
+	scale = Vector3(p.m11, p.m22, p.m33);
+
+	// Anything left off the diagonal is skew
+
+	float	maxScale = fabs(scale.x);
+	if (fabs(scale.y) > maxScale) maxScale = fabs(scale.y);
+	if (fabs(scale.z) > maxScale) maxScale = fabs(scale.z);
+
+	float	skew = fabs(p.m12);
+	if (fabs(p.m13) > skew) skew = fabs(p.m13);
+	if (fabs(p.m21) > skew) skew = fabs(p.m21);
+	if (fabs(p.m23) > skew) skew = fabs(p.m23);
+	if (fabs(p.m31) > skew) skew = fabs(p.m31);
+	if (fabs(p.m32) > skew) skew = fabs(p.m32);
+
+	return ok && skew <= kSkewTolerance * maxScale;
+}
+
+//---------------------------------------------------------------------------
+// composeTRS
+//
+// Build the matrix that scales, rotates, then translates
+
+Matrix4x3	composeTRS(const Quaternion &rotation, const Vector3 &translation,
+	const Vector3 &scale) {
+
+	Matrix4x3	m;
+	m.fromQuaternion(rotation);
+
+	m.m11 *= scale.x; m.m12 *= scale.x; m.m13 *= scale.x;
+	m.m21 *= scale.y; m.m22 *= scale.y; m.m23 *= scale.y;
+	m.m31 *= scale.z; m.m32 *= scale.z; m.m33 *= scale.z;
+
+	m.tx = translation.x;
+	m.ty = translation.y;
+	m.tz = translation.z;
+
+	m.transformType = typeForScale(scale);
+
+	return m;
+}
+
+//---------------------------------------------------------------------------
+// decomposeTRS
+//
+// Batch decomposition.  See MatrixDecompose.h
+
+int	decomposeTRS(const Matrix4x3 *m, Quaternion *rotation,
+	Vector3 *translation, Vector3 *scale, int count) {
+
+	// The gathers index by floats
+
+	assert(sizeof(Matrix4x3) % sizeof(float) == 0);
+
+	DecomposeJob	job;
+	job.m = m;
+	job.rotation = rotation;
+	job.translation = translation;
+	job.scale = scale;
+	job.inexactCount = 0;
+
+	parallelFor(count, kMinDecomposePerChunk, &decomposeRange, &job);
+
+	return job.inexactCount;
+}
+
+//---------------------------------------------------------------------------
+// composeTRS
+//
+// Batch composition.  See MatrixDecompose.h
+
+void	composeTRS(const Quaternion *rotation, const Vector3 *translation,
+	const Vector3 *scale, Matrix4x3 *m, int count) {
+
+	assert(sizeof(Matrix4x3) % sizeof(float) == 0);
+
+	ComposeJob	job;
+	job.rotation = rotation;
+	job.translation = translation;
+	job.scale = scale;
+	job.m = m;
+
+	parallelFor(count, kMinComposePerChunk, &composeRange, &job);
+}
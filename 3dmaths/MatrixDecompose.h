@@ -0,0 +1,91 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// MatrixDecompose.h - Splitting matrices into rotation, translation and
+//                     scale, and putting them back together
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see MatrixDecompose.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __MATRIXDECOMPOSE_H_INCLUDED__
+#define __MATRIXDECOMPOSE_H_INCLUDED__
+
+#ifndef __VECTOR3_H_INCLUDED__
+	#include "vector3.h"
+#endif
+
+class Quaternion;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
+
+//---------------------------------------------------------------------------
+// TRS form
+//
+// A local->parent matrix that scales along the local axes, then rotates,
+// then translates is
+//
+//	m = S R T
+//
+// with S the diagonal scale matrix, R the rotation, and T the
+// translation.  This is the order AnimationClip keys use, and the order
+// Matrix4x3::setupLocalToParent() uses when there is no scale.  The
+// rotation is stored as a quaternion, in the same convention as
+// Matrix4x3::fromQuaternion().
+//
+// A reflection is returned as a negative scale on the x axis.  Skew can't
+// be represented in TRS form; see decomposeTRS().
+
+// Extract the rotation from a matrix whose 3x3 portion is a rotation
+// (orthonormal, determinant +1).  The result is not normalized, or
+// flipped to any particular hemisphere.
+
+Quaternion	rotationFromMatrix(const Matrix4x3 &m);
+
+// Polar decomposition of the 3x3 portion of m into the nearest rotation
+// and the stretch left over,
+//
+//	m = stretch * rotation
+//
+// The stretch is symmetric unless m contains a reflection, in which case
+// its first row is also negated.  Singular matrices get a rotation built
+// from the rows that are left, and return false.  The translations of
+// both results are zero.
+
+bool	polarDecompose(const Matrix4x3 &m, Matrix4x3 &rotation, Matrix4x3 &stretch);
+
+// Split a matrix into TRS form.  The rotation is normalized, with w >= 0,
+// so equal rotations give identical quaternions.  Returns true if m is
+// exactly TRS, to within float precision.  Returns false if m is singular
+// or contains skew; the result is then the closest TRS in the polar
+// sense, with the skew dropped.
+
+bool	decomposeTRS(const Matrix4x3 &m, Quaternion &rotation,
+	Vector3 &translation, Vector3 &scale);
+
+// Build the matrix S R T.  The transform type is set to rigid,
+// similarity or affine according to the scale.
+
+Matrix4x3	composeTRS(const Quaternion &rotation, const Vector3 &translation,
+	const Vector3 &scale);
+
+//---------------------------------------------------------------------------
+// Batch decomposition
+//
+// The same as calling decomposeTRS() and composeTRS() in a loop, but
+// several matrices are processed at a time using SIMD, and large arrays
+// are split across the worker threads.  Returns the number of matrices
+// that were not exactly TRS.  The rotations passed to composeTRS() must
+// be normalized.
+
+int	decomposeTRS(const Matrix4x3 *m, Quaternion *rotation,
+	Vector3 *translation, Vector3 *scale, int count);
+
+void	composeTRS(const Quaternion *rotation, const Vector3 *translation,
+	const Vector3 *scale, Matrix4x3 *m, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __MATRIXDECOMPOSE_H_INCLUDED__
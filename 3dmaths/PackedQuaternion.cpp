@@ -0,0 +1,362 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// PackedQuaternion.cpp - Compressed storage for unit quaternions
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+
+#include "PackedQuaternion.h"
+#include "Quaternion.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// A unit quaternion has w^2 + x^2 + y^2 + z^2 = 1, so any one component
+// can be recomputed from the other three, up to sign.  q and -q are the
+// same rotation, so we can always flip the quaternion to make the
+// dropped component positive, which takes care of the sign.  We drop the
+// largest component: it is the most accurately recovered, and the other
+// three are then guaranteed to lie in [-1/sqrt(2), 1/sqrt(2)], so we
+// don't waste any bits on values that can't happen.
+//
+// Each of the three is mapped linearly from that range to an unsigned
+// integer [0, 2^bits - 1].
+//
+// The float math for kSimdWidth quaternions is done at once in SIMD
+// registers.  Fitting the integers into bit fields is done per quaternion;
+// it's just a few shifts.  The tail of the array goes through the same
+// SIMD code, padded out with identity quaternions, so packing one
+// quaternion gives exactly the same bits as packing it in an array.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMinPackedPerChunk = 8192;
+
+// The range of the three smallest components is +/- 1/sqrt(2)
+
+const float	kSmallestThreeRange = 0.70710678f;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// Format48
+// Format32
+//
+// Bit layouts of the packed formats.  Component values are already
+// quantized to kBits bits.
+//
+// 48-bit: bits[0] = a | (index bit 0) << 15
+//         bits[1] = b | (index bit 1) << 15
+//         bits[2] = c
+//
+// 32-bit: index << 30 | a << 20 | b << 10 | c
+
+struct Format48 {
+	typedef PackedQuaternion48 Packed;
+	enum { kBits = 15 };
+
+	static void	store(Packed &p, int index, int a, int b, int c) {
+		p.bits[0] = (unsigned short)(a | ((index & 1) << 15));
+		p.bits[1] = (unsigned short)(b | ((index >> 1) << 15));
+		p.bits[2] = (unsigned short)c;
+	}
+
+	static void	load(const Packed &p, int &index, int &a, int &b, int &c) {
+		index = (p.bits[0] >> 15) | ((p.bits[1] >> 15) << 1);
+		a = p.bits[0] & 0x7fff;
+		b = p.bits[1] & 0x7fff;
+		c = p.bits[2] & 0x7fff;
+	}
+};
+
+struct Format32 {
+	typedef PackedQuaternion32 Packed;
+	enum { kBits = 10 };
+
+	static void	store(Packed &p, int index, int a, int b, int c) {
+		p.bits = ((unsigned)index << 30) | ((unsigned)a << 20) | ((unsigned)b << 10) | (unsigned)c;
+	}
+
+	static void	load(const Packed &p, int &index, int &a, int &b, int &c) {
+		index = (int)(p.bits >> 30);
+		a = (int)((p.bits >> 20) & 0x3ff);
+		b = (int)((p.bits >> 10) & 0x3ff);
+		c = (int)(p.bits & 0x3ff);
+	}
+};
+
+//---------------------------------------------------------------------------
+// packBlock
+//
+// Pack kSimdWidth quaternions
+
+template <class Format>
+static void	packBlock(const Quaternion *src, typename Format::Packed *dst) {
+	const float	kMaxValue = (float)((1 << Format::kBits) - 1);
+
+	SimdFloat	w, x, y, z;
+	simdLoadTranspose4(&src->w, w, x, y, z);
+
+	// Find the largest component.  Ties go to the first one.
+
+	SimdFloat	index = simdZero();
+	SimdFloat	biggest = simdAbs(w);
+	SimdFloat	largest = w;
+
+	SimdMask	m = simdAbs(x) > biggest;
+	index = simdSelect(m, simdSet1(1.0f), index);
+	biggest = simdSelect(m, simdAbs(x), biggest);
+	largest = simdSelect(m, x, largest);
+
+	m = simdAbs(y) > biggest;
+	index = simdSelect(m, simdSet1(2.0f), index);
+	biggest = simdSelect(m, simdAbs(y), biggest);
+	largest = simdSelect(m, y, largest);
+
+	m = simdAbs(z) > biggest;
+	index = simdSelect(m, simdSet1(3.0f), index);
+	largest = simdSelect(m, z, largest);
+
+	// The other three, in order
+
+	SimdFloat	a = simdSelect(index < simdSet1(0.5f), x, w);
+	SimdFloat	b = simdSelect(index < simdSet1(1.5f), y, x);
+	SimdFloat	c = simdSelect(index < simdSet1(2.5f), z, y);
+
+	// Flip so the dropped component is positive, and map
+	// [-range, range] to [0, kMaxValue]
+
+	SimdFloat	halfMax = simdSet1(kMaxValue * 0.5f);
+	SimdFloat	scale = simdSelect(largest < simdZero(), -halfMax, halfMax) * simdSet1(1.0f / kSmallestThreeRange);
+	SimdFloat	lo = simdZero();
+	SimdFloat	hi = simdSet1(kMaxValue);
+	a = simdMin(simdMax(simdMadd(a, scale, halfMax), lo), hi);
+	b = simdMin(simdMax(simdMadd(b, scale, halfMax), lo), hi);
+	c = simdMin(simdMax(simdMadd(c, scale, halfMax), lo), hi);
+
+	// Round to integers and pack the bits
+
+	int	ia[kSimdMaxWidth], ib[kSimdMaxWidth], ic[kSimdMaxWidth], ii[kSimdMaxWidth];
+	simdStoreInt(ia, a);
+	simdStoreInt(ib, b);
+	simdStoreInt(ic, c);
+	simdStoreInt(ii, index);
+	for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+		Format::store(dst[lane], ii[lane], ia[lane], ib[lane], ic[lane]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// unpackBlock
+//
+// Unpack kSimdWidth quaternions
+
+template <class Format>
+static void	unpackBlock(const typename Format::Packed *src, Quaternion *dst) {
+	const float	kMaxValue = (float)((1 << Format::kBits) - 1);
+
+	// Pull out the bits
+
+	int	ia[kSimdMaxWidth], ib[kSimdMaxWidth], ic[kSimdMaxWidth], ii[kSimdMaxWidth];
+	for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+		Format::load(src[lane], ii[lane], ia[lane], ib[lane], ic[lane]);
+	}
+
+	// Map [0, kMaxValue] back to [-range, range]
+
+	SimdFloat	scale = simdSet1(2.0f * kSmallestThreeRange / kMaxValue);
+	SimdFloat	offset = simdSet1(-kSmallestThreeRange);
+	SimdFloat	a = simdMadd(simdLoadInt(ia), scale, offset);
+	SimdFloat	b = simdMadd(simdLoadInt(ib), scale, offset);
+	SimdFloat	c = simdMadd(simdLoadInt(ic), scale, offset);
+	SimdFloat	index = simdLoadInt(ii);
+
+	// Recompute the one we dropped
+
+	SimdFloat	d = simdSqrt(simdMax(simdSet1(1.0f) - a*a - b*b - c*c, simdZero()));
+
+	// Put everything back where it came from
+
+	SimdMask	is0 = index < simdSet1(0.5f);
+	SimdMask	upTo1 = index < simdSet1(1.5f);
+	SimdMask	upTo2 = index < simdSet1(2.5f);
+	SimdFloat	w = simdSelect(is0, d, a);
+	SimdFloat	x = simdSelect(is0, a, simdSelect(upTo1, d, b));
+	SimdFloat	y = simdSelect(upTo1, b, simdSelect(upTo2, d, c));
+	SimdFloat	z = simdSelect(upTo2, c, d);
+
+	// Quantization error means the three we kept aren't quite
+	// right, so normalize
+
+	SimdFloat	k = simdRsqrt(w*w + x*x + y*y + z*z);
+	simdStoreTranspose4(&dst->w, w * k, x * k, y * k, z * k);
+}
+
+//---------------------------------------------------------------------------
+// PackJob
+//
+// Parameters for a batch pack or unpack, passed to parallelFor
+
+template <class Format>
+struct PackJob {
+	const Quaternion		*quaternions;
+	typename Format::Packed		*packed;
+	const typename Format::Packed	*packedIn;
+	Quaternion			*quaternionsOut;
+};
+
+//---------------------------------------------------------------------------
+// packRange
+// unpackRange
+//
+// Process elements [begin, end) of a job.  The last few are copied to a
+// full block of scratch space.
+
+template <class Format>
+static void	packRange(int begin, int end, void *context) {
+	const PackJob<Format> *job = (const PackJob<Format> *)context;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		packBlock<Format>(job->quaternions + i, job->packed + i);
+	}
+
+	int	left = end - i;
+	if (left > 0) {
+		Quaternion		q[kSimdMaxWidth];
+		typename Format::Packed	p[kSimdMaxWidth];
+		for (int j = 0 ; j < kSimdWidth ; ++j) {
+			q[j] = (j < left) ? job->quaternions[i + j] : kQuaternionIdentity;
+		}
+		packBlock<Format>(q, p);
+		for (int j = 0 ; j < left ; ++j) {
+			job->packed[i + j] = p[j];
+		}
+	}
+}
+
+template <class Format>
+static void	unpackRange(int begin, int end, void *context) {
+	const PackJob<Format> *job = (const PackJob<Format> *)context;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		unpackBlock<Format>(job->packedIn + i, job->quaternionsOut + i);
+	}
+
+	int	left = end - i;
+	if (left > 0) {
+		typename Format::Packed	p[kSimdMaxWidth];
+		Quaternion		q[kSimdMaxWidth];
+		for (int j = 0 ; j < kSimdWidth ; ++j) {
+			if (j < left) {
+				p[j] = job->packedIn[i + j];
+			} else {
+				Format::store(p[j], 0, 0, 0, 0);
+			}
+		}
+		unpackBlock<Format>(p, q);
+		for (int j = 0 ; j < left ; ++j) {
+			job->quaternionsOut[i + j] = q[j];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// runPack
+// runUnpack
+//
+// Fill in a job and run it across the worker threads.  A single element
+// isn't worth handing to parallelFor, so it's done right here.
+
+template <class Format>
+static void	runPack(const Quaternion *src, typename Format::Packed *dst, int count) {
+	PackJob<Format>	job;
+	job.quaternions = src;
+	job.packed = dst;
+	job.packedIn = NULL;
+	job.quaternionsOut = NULL;
+	if (count == 1) {
+		packRange<Format>(0, 1, &job);
+	} else {
+		parallelFor(count, kMinPackedPerChunk, &packRange<Format>, &job);
+	}
+}
+
+template <class Format>
+static void	runUnpack(const typename Format::Packed *src, Quaternion *dst, int count) {
+	PackJob<Format>	job;
+	job.quaternions = NULL;
+	job.packed = NULL;
+	job.packedIn = src;
+	job.quaternionsOut = dst;
+	if (count == 1) {
+		unpackRange<Format>(0, 1, &job);
+	} else {
+		parallelFor(count, kMinPackedPerChunk, &unpackRange<Format>, &job);
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// packQuaternion
+// unpackQuaternion
+//
+// Single quaternion versions.  These go through the batch code so the
+// results are bit-for-bit the same.
+
+void	packQuaternion(const Quaternion &q, PackedQuaternion48 &p) {
+	runPack<Format48>(&q, &p, 1);
+}
+
+void	packQuaternion(const Quaternion &q, PackedQuaternion32 &p) {
+	runPack<Format32>(&q, &p, 1);
+}
+
+void	unpackQuaternion(const PackedQuaternion48 &p, Quaternion &q) {
+	runUnpack<Format48>(&p, &q, 1);
+}
+
+void	unpackQuaternion(const PackedQuaternion32 &p, Quaternion &q) {
+	runUnpack<Format32>(&p, &q, 1);
+}
+
+//---------------------------------------------------------------------------
+// packQuaternions
+// unpackQuaternions
+//
+// Array versions.  See PackedQuaternion.h
+
+void	packQuaternions(const Quaternion *src, PackedQuaternion48 *dst, int count) {
+	runPack<Format48>(src, dst, count);
+}
+
+void	packQuaternions(const Quaternion *src, PackedQuaternion32 *dst, int count) {
+	runPack<Format32>(src, dst, count);
+}
+
+void	unpackQuaternions(const PackedQuaternion48 *src, Quaternion *dst, int count) {
+	runUnpack<Format48>(src, dst, count);
+}
+
+void	unpackQuaternions(const PackedQuaternion32 *src, Quaternion *dst, int count) {
+	runUnpack<Format32>(src, dst, count);
+}
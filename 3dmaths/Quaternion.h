@@ -17,7 +17,8 @@
 #ifndef __QUATERNION_H_INCLUDED__
 #define __QUATERNION_H_INCLUDED__
 
-class Vector3;
+template <class T> class TVector3;
+typedef TVector3<float> Vector3;
 class EulerAngles;
 
 //---------------------------------------------------------------------------
@@ -90,10 +91,15 @@ public:
 	Vector3	getRotationAxis() const;
 };
 
-// һȫΨһʶԪ
-// A global "identity" quaternion constant
+// һȫΨһʶԪԪûй캯Կ
+// ۺϳʼڱڹ
+// A global "identity" quaternion constant.  The Quaternion class has no
+// constructors, so it's built at compile time with aggregate
+// initialization.
 
-extern const Quaternion kQuaternionIdentity;
+constexpr Quaternion kQuaternionIdentity = {
+	1.0f, 0.0f, 0.0f, 0.0f
+};
 
 // Ԫ
 // Quaternion dot product.
@@ -115,5 +121,39 @@ extern Quaternion conjugate(const Quaternion &q);
 
 extern Quaternion pow(const Quaternion &q, float exponent);
 
+// ԪĶָڵλԪq = [cos a, sin a n]
+// log(q) = [0, a n]exp()㡣
+// Quaternion logarithm and exponential.  For a unit quaternion
+// q = [cos a, sin a n], log(q) = [0, a n], and exp() undoes it.
+
+extern Quaternion log(const Quaternion &q);
+extern Quaternion exp(const Quaternion &q);
+
+// βֵ(squad)q0q1֮ƽزֵa0a1
+// squadTangent()˵Ԫt = 01ʱq0q1
+// ڹؼ֡Ľٶ
+// Spherical cubic interpolation (squad).  Smoothly interpolates from
+// q0 to q1, with a0 and a1 the tangent quaternions at either end, as
+// computed by squadTangent().  Returns q0 and q1 at t = 0 and 1, and
+// the angular velocity is continuous from one segment to the next.
+
+extern Quaternion squad(const Quaternion &q0, const Quaternion &a0,
+	const Quaternion &a1, const Quaternion &q1, float t);
+
+// ؼ֡qsquadԪǰĹؼ֡
+// Compute the squad tangent quaternion of key q, given the keys
+// before and after it.
+
+extern Quaternion squadTangent(const Quaternion &qPrev, const Quaternion &q,
+	const Quaternion &qNext);
+
+// Ԫתv * Matrix4x3::fromQuaternion(q)ͬ
+// Ҫȹ
+// Rotate a vector by a quaternion.  Gives the same result as
+// v * Matrix4x3::fromQuaternion(q), without building the matrix first.
+// The quaternion must be normalized.
+
+extern Vector3 rotate(const Quaternion &q, const Vector3 &v);
+
 /////////////////////////////////////////////////////////////////////////////
 #endif // #ifndef __QUATERNION_H_INCLUDED__
@@ -0,0 +1,731 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// QuaternionBatch.cpp - Array-at-a-time operations on quaternions
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+
+#include "QuaternionBatch.h"
+#include "Quaternion.h"
+#include "Matrix4x3.h"
+#include "Vector3Array.h"
+#include "MathUtil.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Quaternions are stored w, x, y, z, so kSimdWidth of them in a row can
+// be loaded and transposed into four registers, one per component, with
+// simdLoadTranspose4().  Everything after that is done "sideways," one
+// quaternion per lane.
+//
+// Exact slerp needs acos and sin, which we don't have in SIMD form, so we
+// evaluate them with polynomials.  Since we always take the short way
+// around, cos(omega) >= 0, so omega is in [0, pi/2], and the sines are of
+// angles in the same range.  Over these ranges the polynomials below are
+// good to a few float ulps.
+//
+// The fast slerp is nlerp with a corrected t.  nlerp moves too fast in
+// the middle of the interval and too slowly at the ends; the correction
+// is a cubic in t that vanishes at t = 0, 1/2 and 1, scaled by a factor
+// that depends on the angle between the endpoints.  The coefficients were
+// fitted by least squares against true slerp (see zeux.io, "Approximating
+// slerp", 2015, for the derivation.)
+//
+// Squad is three of these interpolations, kept in registers throughout.
+//
+// Arrays whose length isn't a multiple of kSimdWidth are finished by
+// copying the last few into a full block of scratch space, so the tail
+// gets exactly the same math as everything else.
+//
+// Rotating vectors by per-element quaternions uses the two cross product
+// form of q v q* (see rotate() in Quaternion.cpp), with the quaternions
+// transposed into lanes like above.  That's 30 operations a vector, twice
+// what a 3x3 matrix takes, so a shared quaternion is turned into a matrix
+// once up front, and only the nine multiply-adds are done per vector.
+// The vectors are gathered into lanes like the transforms in
+// Matrix4x3Batch.cpp.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMinQuaternionsPerChunk = 4096;
+const int	kMinRotationsPerChunk = 8192;
+const int	kMinSquadsPerChunk = 2048;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Interpolation kernels
+
+enum EInterpolation {
+	eInterpolationSlerp,
+	eInterpolationFastSlerp,
+	eInterpolationNlerp
+};
+
+//---------------------------------------------------------------------------
+// simdAcosPositive
+//
+// acos(x) for x in [0, 1].  For x <= 1/2 we use acos(x) = pi/2 - asin(x);
+// above that, acos(x) = 2 asin(sqrt((1 - x)/2)), so asin is only ever
+// needed on [0, 1/2], where a short polynomial does the job.  (The
+// polynomial is the single precision one from the Cephes library.)
+
+static inline SimdFloat	simdAcosPositive(SimdFloat x) {
+	SimdMask	big = x > simdSet1(0.5f);
+	SimdFloat	a = simdSelect(big, simdSqrt((simdSet1(1.0f) - x) * simdSet1(0.5f)), x);
+	SimdFloat	z = a * a;
+
+	SimdFloat	p = simdSet1(4.2163199048e-2f);
+	p = simdMadd(p, z, simdSet1(2.4181311049e-2f));
+	p = simdMadd(p, z, simdSet1(4.5470025998e-2f));
+	p = simdMadd(p, z, simdSet1(7.4953002686e-2f));
+	p = simdMadd(p, z, simdSet1(1.6666752422e-1f));
+	SimdFloat	asinA = simdMadd(p * z, a, a);
+
+	return simdSelect(big, asinA + asinA, simdSet1(kPiOver2) - asinA);
+}
+
+//---------------------------------------------------------------------------
+// simdSinSmall
+//
+// sin(x) for x in [-pi/2, pi/2], using the Taylor series through x^11.
+// The first term left out is less than 6e-8 over the range.
+
+static inline SimdFloat	simdSinSmall(SimdFloat x) {
+	SimdFloat	x2 = x * x;
+	SimdFloat	p = simdSet1(-2.5052108e-8f);
+	p = simdMadd(p, x2, simdSet1(2.7557319e-6f));
+	p = simdMadd(p, x2, simdSet1(-1.9841270e-4f));
+	p = simdMadd(p, x2, simdSet1(8.3333333e-3f));
+	p = simdMadd(p, x2, simdSet1(-1.6666667e-1f));
+	return simdMadd(p * x2, x, x);
+}
+
+//---------------------------------------------------------------------------
+// interpolateLanes
+//
+// Interpolate kSimdWidth quaternions, one per lane, from (w0, x0, y0, z0)
+// to (w1, x1, y1, z1), leaving the results in w, x, y and z.
+
+template <int kKind>
+static inline void	interpolateLanes(
+	SimdFloat w0, SimdFloat x0, SimdFloat y0, SimdFloat z0,
+	SimdFloat w1, SimdFloat x1, SimdFloat y1, SimdFloat z1,
+	SimdFloat t, SimdFloat &w, SimdFloat &x, SimdFloat &y, SimdFloat &z) {
+
+	SimdFloat	zero = simdZero();
+	SimdFloat	one = simdSet1(1.0f);
+
+	// Compute "cosine of angle between quaternions" using dot product.
+	// If negative, use -q1 so we take the short way around.
+
+	SimdFloat	cosOmega = w0*w1 + x0*x1 + y0*y1 + z0*z1;
+	SimdMask	flip = cosOmega < zero;
+	SimdFloat	fw1 = simdSelect(flip, -w1, w1);
+	SimdFloat	fx1 = simdSelect(flip, -x1, x1);
+	SimdFloat	fy1 = simdSelect(flip, -y1, y1);
+	SimdFloat	fz1 = simdSelect(flip, -z1, z1);
+	cosOmega = simdAbs(cosOmega);
+
+	// Compute interpolation fractions
+
+	SimdFloat	k0, k1;
+	if (kKind == eInterpolationSlerp) {
+
+		// Clamp so that denormalized input doesn't give us a NaN.
+		// The linear fallback takes over long before that anyway.
+
+		cosOmega = simdMin(cosOmega, one);
+
+		// The sine is computed as sqrt((1 - c)(1 + c)) rather than
+		// sqrt(1 - c*c).  Near c = 1, rounding c*c loses most of the
+		// bits of the difference, and the result no longer agrees
+		// with omega, which shows up as a non-unit result.
+
+		SimdFloat	omega = simdAcosPositive(cosOmega);
+		SimdFloat	sinOmega = simdSqrt((one - cosOmega) * (one + cosOmega));
+		SimdFloat	oneOverSinOmega = one / simdMax(sinOmega, simdSet1(1e-6f));
+		SimdFloat	s0 = simdSinSmall((one - t) * omega) * oneOverSinOmega;
+		SimdFloat	s1 = simdSinSmall(t * omega) * oneOverSinOmega;
+
+		// Very close - just use linear interpolation, just like slerp()
+
+		SimdMask	close = cosOmega > simdSet1(0.9999f);
+		k0 = simdSelect(close, one - t, s0);
+		k1 = simdSelect(close, t, s1);
+
+	} else if (kKind == eInterpolationFastSlerp) {
+
+		// Correct t, then nlerp
+
+		SimdFloat	d = cosOmega;
+		SimdFloat	a = simdMadd(simdMadd(simdMadd(simdSet1(-1.43519f), d, simdSet1(3.55645f)), d,
+					simdSet1(-3.2452f)), d, simdSet1(1.0904f));
+		SimdFloat	b = simdMadd(simdMadd(simdSet1(0.215638f), d, simdSet1(-1.06021f)), d,
+					simdSet1(0.848013f));
+		SimdFloat	tc = t - simdSet1(0.5f);
+		SimdFloat	k = simdMadd(a * tc, tc, b);
+		SimdFloat	ot = simdMadd(t * tc * (t - one), k, t);
+		k0 = one - ot;
+		k1 = ot;
+
+	} else {
+		k0 = one - t;
+		k1 = t;
+	}
+
+	// Interpolate
+
+	w = k0*w0 + k1*fw1;
+	x = k0*x0 + k1*fx1;
+	y = k0*y0 + k1*fy1;
+	z = k0*z0 + k1*fz1;
+
+	if (kKind == eInterpolationSlerp) {
+
+		// Out-of-range parameters return the endpoints as given,
+		// just like slerp()
+
+		SimdMask	lo = t <= zero;
+		SimdMask	hi = t >= one;
+		w = simdSelect(lo, w0, simdSelect(hi, w1, w));
+		x = simdSelect(lo, x0, simdSelect(hi, x1, x));
+		y = simdSelect(lo, y0, simdSelect(hi, y1, y));
+		z = simdSelect(lo, z0, simdSelect(hi, z1, z));
+
+	} else {
+
+		// Lerping shortens the quaternion, so normalize it
+
+		SimdFloat	mag = simdRsqrt(w*w + x*x + y*y + z*z);
+		w = w * mag;
+		x = x * mag;
+		y = y * mag;
+		z = z * mag;
+	}
+}
+
+//---------------------------------------------------------------------------
+// interpolateBlock
+//
+// Interpolate kSimdWidth quaternions.  q0, q1 and out point to arrays of
+// kSimdWidth quaternions.
+
+template <int kKind>
+static inline void	interpolateBlock(const Quaternion *q0, const Quaternion *q1, SimdFloat t, Quaternion *out) {
+	SimdFloat	w0, x0, y0, z0;
+	SimdFloat	w1, x1, y1, z1;
+	simdLoadTranspose4(&q0->w, w0, x0, y0, z0);
+	simdLoadTranspose4(&q1->w, w1, x1, y1, z1);
+
+	SimdFloat	w, x, y, z;
+	interpolateLanes<kKind>(w0, x0, y0, z0, w1, x1, y1, z1, t, w, x, y, z);
+	simdStoreTranspose4(&out->w, w, x, y, z);
+}
+
+//---------------------------------------------------------------------------
+// InterpolateJob
+//
+// Parameters for a batch interpolation, passed to parallelFor.  If t is
+// NULL, every element uses sharedT.
+
+struct InterpolateJob {
+	const Quaternion	*q0;
+	const Quaternion	*q1;
+	const float		*t;
+	float			sharedT;
+	Quaternion		*result;
+};
+
+//---------------------------------------------------------------------------
+// interpolateRange
+//
+// Interpolate elements [begin, end) of a job
+
+template <int kKind>
+static void	interpolateRange(int begin, int end, void *context) {
+	const InterpolateJob *job = (const InterpolateJob *)context;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		SimdFloat t = job->t ? simdLoadU(job->t + i) : simdSet1(job->sharedT);
+		interpolateBlock<kKind>(job->q0 + i, job->q1 + i, t, job->result + i);
+	}
+
+	// Finish up the last few by padding them out to a full block
+	// with identity quaternions
+
+	int	left = end - i;
+	if (left > 0) {
+		Quaternion	a[kSimdMaxWidth], b[kSimdMaxWidth], r[kSimdMaxWidth];
+		float		t[kSimdMaxWidth];
+		for (int j = 0 ; j < kSimdWidth ; ++j) {
+			a[j] = (j < left) ? job->q0[i + j] : kQuaternionIdentity;
+			b[j] = (j < left) ? job->q1[i + j] : kQuaternionIdentity;
+			t[j] = (j < left && job->t) ? job->t[i + j] : job->sharedT;
+		}
+		interpolateBlock<kKind>(a, b, simdLoadU(t), r);
+		for (int j = 0 ; j < left ; ++j) {
+			job->result[i + j] = r[j];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// runInterpolate
+//
+// Fill in a job and run it across the worker threads
+
+static void	runInterpolate(EInterpolation kind, const Quaternion *q0, const Quaternion *q1,
+	const float *t, float sharedT, Quaternion *result, int count) {
+
+	InterpolateJob	job;
+	job.q0 = q0;
+	job.q1 = q1;
+	job.t = t;
+	job.sharedT = sharedT;
+	job.result = result;
+
+	ParallelRangeFunc	func;
+	switch (kind) {
+		case eInterpolationSlerp: func = &interpolateRange<eInterpolationSlerp>; break;
+		case eInterpolationFastSlerp: func = &interpolateRange<eInterpolationFastSlerp>; break;
+		default: func = &interpolateRange<eInterpolationNlerp>; break;
+	}
+
+	parallelFor(count, kMinQuaternionsPerChunk, func, &job);
+}
+
+//---------------------------------------------------------------------------
+// squadBlock
+//
+// Squad kSimdWidth quaternions: three interpolations, exactly like
+// squad() in Quaternion.cpp, without going through memory in between
+
+template <int kKind>
+static inline void	squadBlock(const Quaternion *q0, const Quaternion *a0, const Quaternion *a1,
+	const Quaternion *q1, SimdFloat t, Quaternion *out) {
+
+	SimdFloat	w0, x0, y0, z0;
+	SimdFloat	w1, x1, y1, z1;
+	SimdFloat	pw, px, py, pz;
+	SimdFloat	sw, sx, sy, sz;
+
+	simdLoadTranspose4(&q0->w, w0, x0, y0, z0);
+	simdLoadTranspose4(&q1->w, w1, x1, y1, z1);
+	interpolateLanes<kKind>(w0, x0, y0, z0, w1, x1, y1, z1, t, pw, px, py, pz);
+
+	simdLoadTranspose4(&a0->w, w0, x0, y0, z0);
+	simdLoadTranspose4(&a1->w, w1, x1, y1, z1);
+	interpolateLanes<kKind>(w0, x0, y0, z0, w1, x1, y1, z1, t, sw, sx, sy, sz);
+
+	SimdFloat	h = simdSet1(2.0f) * t * (simdSet1(1.0f) - t);
+	SimdFloat	w, x, y, z;
+	interpolateLanes<kKind>(pw, px, py, pz, sw, sx, sy, sz, h, w, x, y, z);
+	simdStoreTranspose4(&out->w, w, x, y, z);
+}
+
+//---------------------------------------------------------------------------
+// SquadJob
+//
+// Parameters for a batch squad, passed to parallelFor
+
+struct SquadJob {
+	const Quaternion	*q0;
+	const Quaternion	*a0;
+	const Quaternion	*a1;
+	const Quaternion	*q1;
+	const float		*t;
+	Quaternion		*result;
+};
+
+//---------------------------------------------------------------------------
+// squadRange
+//
+// Squad elements [begin, end) of a job
+
+template <int kKind>
+static void	squadRange(int begin, int end, void *context) {
+	const SquadJob *job = (const SquadJob *)context;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		squadBlock<kKind>(job->q0 + i, job->a0 + i, job->a1 + i, job->q1 + i,
+			simdLoadU(job->t + i), job->result + i);
+	}
+
+	// Finish up the last few by padding them out to a full block
+	// with identity quaternions
+
+	int	left = end - i;
+	if (left > 0) {
+		Quaternion	q0[kSimdMaxWidth], a0[kSimdMaxWidth], a1[kSimdMaxWidth];
+		Quaternion	q1[kSimdMaxWidth], r[kSimdMaxWidth];
+		float		t[kSimdMaxWidth];
+		for (int j = 0 ; j < kSimdWidth ; ++j) {
+			q0[j] = (j < left) ? job->q0[i + j] : kQuaternionIdentity;
+			a0[j] = (j < left) ? job->a0[i + j] : kQuaternionIdentity;
+			a1[j] = (j < left) ? job->a1[i + j] : kQuaternionIdentity;
+			q1[j] = (j < left) ? job->q1[i + j] : kQuaternionIdentity;
+			t[j] = (j < left) ? job->t[i + j] : 0.0f;
+		}
+		squadBlock<kKind>(q0, a0, a1, q1, simdLoadU(t), r);
+		for (int j = 0 ; j < left ; ++j) {
+			job->result[i + j] = r[j];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// rotateLanes
+//
+// Rotate kSimdWidth vectors by kSimdWidth quaternions, exactly like
+// rotate()
+
+static inline void	rotateLanes(SimdFloat qw, SimdFloat qx, SimdFloat qy, SimdFloat qz,
+	SimdFloat &x, SimdFloat &y, SimdFloat &z) {
+
+	// t = 2 (u x v)
+
+	SimdFloat	tx = qy*z - qz*y;
+	SimdFloat	ty = qz*x - qx*z;
+	SimdFloat	tz = qx*y - qy*x;
+	tx = tx + tx;
+	ty = ty + ty;
+	tz = tz + tz;
+
+	// v + w t + u x t
+
+	x = simdMadd(qw, tx, x) + (qy*tz - qz*ty);
+	y = simdMadd(qw, ty, y) + (qz*tx - qx*tz);
+	z = simdMadd(qw, tz, z) + (qx*ty - qy*tx);
+}
+
+//---------------------------------------------------------------------------
+// RotateJob
+//
+// Parameters for a batch rotation, passed to parallelFor.  If q is NULL,
+// every element is rotated by sharedM, the matrix of the shared
+// quaternion.  The vectors are either strided (src/dst) or in the lanes of
+// a Vector3Array (sx.../dx...)
+
+struct RotateJob {
+	const Quaternion	*q;
+	Matrix4x3		sharedM;
+	const char		*src;
+	char			*dst;
+	int			srcStride;
+	int			dstStride;
+	const float		*sx, *sy, *sz;
+	float			*dx, *dy, *dz;
+};
+
+//---------------------------------------------------------------------------
+// rotateBlock
+//
+// Rotate the vectors in x, y and z, for the block starting at element i.
+// Per-element quaternions are transposed into lanes and go through
+// rotateLanes(); the shared matrix is broadcast.
+
+template <bool kPerElement>
+static inline void	rotateBlock(const RotateJob *job, int i, SimdFloat &x, SimdFloat &y, SimdFloat &z) {
+	if (kPerElement) {
+		SimdFloat	qw, qx, qy, qz;
+		simdLoadTranspose4(&job->q[i].w, qw, qx, qy, qz);
+		rotateLanes(qw, qx, qy, qz, x, y, z);
+	} else {
+		const Matrix4x3	&m = job->sharedM;
+		SimdFloat	rx = simdMadd(z, simdSet1(m.m31), simdMadd(y, simdSet1(m.m21), x * simdSet1(m.m11)));
+		SimdFloat	ry = simdMadd(z, simdSet1(m.m32), simdMadd(y, simdSet1(m.m22), x * simdSet1(m.m12)));
+		SimdFloat	rz = simdMadd(z, simdSet1(m.m33), simdMadd(y, simdSet1(m.m23), x * simdSet1(m.m13)));
+		x = rx;
+		y = ry;
+		z = rz;
+	}
+}
+
+//---------------------------------------------------------------------------
+// rotateSharedTail
+//
+// The last few vectors of a shared rotation, copied into a zero padded
+// block of scratch space, so they get exactly the same math as the rest.
+// Rotated in place.
+
+static inline void	rotateSharedTail(const RotateJob *job, float *tx, float *ty, float *tz) {
+	SimdFloat	x = simdLoadU(tx), y = simdLoadU(ty), z = simdLoadU(tz);
+	rotateBlock<false>(job, 0, x, y, z);
+	simdStoreU(tx, x);
+	simdStoreU(ty, y);
+	simdStoreU(tz, z);
+}
+
+//---------------------------------------------------------------------------
+// rotateStridedRange
+// rotateArrayRange
+//
+// Rotate elements [begin, end) of a job, with the vectors strided or in a
+// Vector3Array.  With per-element quaternions the last few are done one
+// at a time.
+
+template <bool kPerElement>
+static void	rotateStridedRange(int begin, int end, void *context) {
+	const RotateJob *job = (const RotateJob *)context;
+
+	// Strides are in bytes, but the gathers want floats
+
+	int	sf = job->srcStride / (int)sizeof(float);
+	int	df = job->dstStride / (int)sizeof(float);
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		const float *s = (const float *)(job->src + (size_t)i * job->srcStride);
+		SimdFloat	x = simdGather(s, sf);
+		SimdFloat	y = simdGather(s + 1, sf);
+		SimdFloat	z = simdGather(s + 2, sf);
+
+		rotateBlock<kPerElement>(job, i, x, y, z);
+
+		float *d = (float *)(job->dst + (size_t)i * job->dstStride);
+		simdScatter(d, df, x);
+		simdScatter(d + 1, df, y);
+		simdScatter(d + 2, df, z);
+	}
+
+	if (!kPerElement && i < end) {
+		float	tx[kSimdMaxWidth] = { 0.0f }, ty[kSimdMaxWidth] = { 0.0f }, tz[kSimdMaxWidth] = { 0.0f };
+		for (int j = 0 ; i + j < end ; ++j) {
+			const Vector3 *s = (const Vector3 *)(job->src + (size_t)(i + j) * job->srcStride);
+			tx[j] = s->x;
+			ty[j] = s->y;
+			tz[j] = s->z;
+		}
+		rotateSharedTail(job, tx, ty, tz);
+		for (int j = 0 ; i + j < end ; ++j) {
+			*(Vector3 *)(job->dst + (size_t)(i + j) * job->dstStride) = Vector3(tx[j], ty[j], tz[j]);
+		}
+		return;
+	}
+
+	for ( ; i < end ; ++i) {
+		const Vector3 *s = (const Vector3 *)(job->src + (size_t)i * job->srcStride);
+		*(Vector3 *)(job->dst + (size_t)i * job->dstStride) = rotate(job->q[i], *s);
+	}
+}
+
+template <bool kPerElement>
+static void	rotateArrayRange(int begin, int end, void *context) {
+	const RotateJob *job = (const RotateJob *)context;
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+		SimdFloat	x = simdLoadU(job->sx + i);
+		SimdFloat	y = simdLoadU(job->sy + i);
+		SimdFloat	z = simdLoadU(job->sz + i);
+
+		rotateBlock<kPerElement>(job, i, x, y, z);
+
+		simdStoreU(job->dx + i, x);
+		simdStoreU(job->dy + i, y);
+		simdStoreU(job->dz + i, z);
+	}
+
+	if (!kPerElement && i < end) {
+		float	tx[kSimdMaxWidth] = { 0.0f }, ty[kSimdMaxWidth] = { 0.0f }, tz[kSimdMaxWidth] = { 0.0f };
+		for (int j = 0 ; i + j < end ; ++j) {
+			tx[j] = job->sx[i + j];
+			ty[j] = job->sy[i + j];
+			tz[j] = job->sz[i + j];
+		}
+		rotateSharedTail(job, tx, ty, tz);
+		for (int j = 0 ; i + j < end ; ++j) {
+			job->dx[i + j] = tx[j];
+			job->dy[i + j] = ty[j];
+			job->dz[i + j] = tz[j];
+		}
+		return;
+	}
+
+	for ( ; i < end ; ++i) {
+		Vector3	r = rotate(job->q[i], Vector3(job->sx[i], job->sy[i], job->sz[i]));
+		job->dx[i] = r.x;
+		job->dy[i] = r.y;
+		job->dz[i] = r.z;
+	}
+}
+
+//---------------------------------------------------------------------------
+// runRotateStrided
+// runRotateArray
+//
+// Fill in a job and run it across the worker threads
+
+static void	runRotateStrided(const Quaternion *q, const Quaternion &sharedQ, const Vector3 *src,
+	Vector3 *dst, int count, int srcStride, int dstStride) {
+
+	// The gathers index by floats, so the strides must be
+	// a whole number of floats
+
+	assert(srcStride % sizeof(float) == 0);
+	assert(dstStride % sizeof(float) == 0);
+
+	// In-place is fine, but only if the vectors line up
+
+	assert(src != dst || srcStride == dstStride);
+
+	RotateJob	job;
+	job.q = q;
+	if (q == NULL) {
+		job.sharedM.fromQuaternion(sharedQ);
+	}
+	job.src = (const char *)src;
+	job.dst = (char *)dst;
+	job.srcStride = srcStride;
+	job.dstStride = dstStride;
+
+	parallelFor(count, kMinRotationsPerChunk,
+		q ? &rotateStridedRange<true> : &rotateStridedRange<false>, &job);
+}
+
+static void	runRotateArray(const Quaternion *q, const Quaternion &sharedQ,
+	Vector3Array &result, const Vector3Array &v) {
+
+	int	n = v.count();
+	result.resize(n);
+
+	RotateJob	job;
+	job.q = q;
+	if (q == NULL) {
+		job.sharedM.fromQuaternion(sharedQ);
+	}
+	job.sx = v.x;
+	job.sy = v.y;
+	job.sz = v.z;
+	job.dx = result.x;
+	job.dy = result.y;
+	job.dz = result.z;
+
+	parallelFor(n, kMinRotationsPerChunk,
+		q ? &rotateArrayRange<true> : &rotateArrayRange<false>, &job);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// slerpBatch
+//
+// Spherical linear interpolation of arrays.  See QuaternionBatch.h
+
+void	slerpBatch(const Quaternion *q0, const Quaternion *q1, const float *t,
+	Quaternion *result, int count, ESlerpMode mode) {
+
+	assert(t != NULL);
+	runInterpolate((mode == eSlerpModeFast) ? eInterpolationFastSlerp : eInterpolationSlerp,
+		q0, q1, t, 0.0f, result, count);
+}
+
+void	slerpBatch(const Quaternion *q0, const Quaternion *q1, float t,
+	Quaternion *result, int count, ESlerpMode mode) {
+
+	runInterpolate((mode == eSlerpModeFast) ? eInterpolationFastSlerp : eInterpolationSlerp,
+		q0, q1, NULL, t, result, count);
+}
+
+//---------------------------------------------------------------------------
+// nlerpBatch
+//
+// Normalized linear interpolation of arrays
+
+void	nlerpBatch(const Quaternion *q0, const Quaternion *q1, const float *t,
+	Quaternion *result, int count) {
+
+	assert(t != NULL);
+	runInterpolate(eInterpolationNlerp, q0, q1, t, 0.0f, result, count);
+}
+
+void	nlerpBatch(const Quaternion *q0, const Quaternion *q1, float t,
+	Quaternion *result, int count) {
+
+	runInterpolate(eInterpolationNlerp, q0, q1, NULL, t, result, count);
+}
+
+//---------------------------------------------------------------------------
+// squadBatch
+//
+// Batch spherical cubic interpolation.  See QuaternionBatch.h
+
+void	squadBatch(const Quaternion *q0, const Quaternion *a0, const Quaternion *a1,
+	const Quaternion *q1, const float *t, Quaternion *result, int count, ESlerpMode mode) {
+
+	SquadJob	job;
+	job.q0 = q0;
+	job.a0 = a0;
+	job.a1 = a1;
+	job.q1 = q1;
+	job.t = t;
+	job.result = result;
+
+	ParallelRangeFunc	func = (mode == eSlerpModeFast) ?
+		&squadRange<eInterpolationFastSlerp> : &squadRange<eInterpolationSlerp>;
+	parallelFor(count, kMinSquadsPerChunk, func, &job);
+}
+
+//---------------------------------------------------------------------------
+// computeSquadTangents
+//
+// Tangents for a sequence of keys.  See QuaternionBatch.h
+
+void	computeSquadTangents(const Quaternion *key, Quaternion *tangent, int count) {
+	if (count < 1) {
+		return;
+	}
+	tangent[0] = key[0];
+	for (int i = 1 ; i < count - 1 ; ++i) {
+		tangent[i] = squadTangent(key[i - 1], key[i], key[i + 1]);
+	}
+	tangent[count - 1] = key[count - 1];
+}
+
+//---------------------------------------------------------------------------
+// rotateBatch
+//
+// Rotate arrays of vectors by one quaternion, or by one quaternion per
+// vector.  See QuaternionBatch.h
+
+void	rotateBatch(const Quaternion &q, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride, int dstStride) {
+
+	runRotateStrided(NULL, q, src, dst, count, srcStride, dstStride);
+}
+
+void	rotateBatch(Vector3Array &result, const Vector3Array &v, const Quaternion &q) {
+	runRotateArray(NULL, q, result, v);
+}
+
+void	rotateBatch(const Quaternion *q, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride, int dstStride) {
+
+	assert(q != NULL);
+	runRotateStrided(q, kQuaternionIdentity, src, dst, count, srcStride, dstStride);
+}
+
+void	rotateBatch(Vector3Array &result, const Vector3Array &v, const Quaternion *q) {
+	assert(q != NULL);
+	runRotateArray(q, kQuaternionIdentity, result, v);
+}
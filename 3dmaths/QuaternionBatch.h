@@ -0,0 +1,114 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// QuaternionBatch.h - Array-at-a-time operations on quaternions
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see QuaternionBatch.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __QUATERNIONBATCH_H_INCLUDED__
+#define __QUATERNIONBATCH_H_INCLUDED__
+
+#ifndef __VECTOR3_H_INCLUDED__
+	#include "vector3.h"
+#endif
+
+class Quaternion;
+class Vector3Array;
+
+//---------------------------------------------------------------------------
+// Slerp accuracy
+//
+// eSlerpModeExact matches slerp() in Quaternion.cpp to within float
+// precision.
+//
+// eSlerpModeFast is an nlerp with the interpolation parameter adjusted by
+// a polynomial so the angular velocity comes out nearly constant.  It
+// needs no trig at all.  The largest angular difference from a true slerp
+// is 0.00078 radians (0.045 degrees), when the endpoints are 180 degrees
+// of rotation apart.  For endpoints less than 90 degrees apart, which is
+// typical for adjacent animation keys, it is under 0.000075 radians.
+// The bench program measures this.
+
+enum ESlerpMode {
+	eSlerpModeExact,
+	eSlerpModeFast
+};
+
+//---------------------------------------------------------------------------
+// Batch interpolation
+//
+// result[i] = interpolation from q0[i] to q1[i] by t[i] (or by the same t
+// for every element.)  These do the same thing as calling slerp() in a
+// loop, but several quaternions are interpolated at a time using SIMD,
+// and large arrays are split across the worker threads.  result may be
+// the same array as q0 or q1.
+
+void	slerpBatch(const Quaternion *q0, const Quaternion *q1, const float *t,
+	Quaternion *result, int count, ESlerpMode mode = eSlerpModeExact);
+void	slerpBatch(const Quaternion *q0, const Quaternion *q1, float t,
+	Quaternion *result, int count, ESlerpMode mode = eSlerpModeExact);
+
+// Normalized linear interpolation: lerp, then normalize.  Cheapest of
+// all, and fine for small angles, but the rotation speeds up in the
+// middle of the interval.  Like slerp, takes the short way around.
+
+void	nlerpBatch(const Quaternion *q0, const Quaternion *q1, const float *t,
+	Quaternion *result, int count);
+void	nlerpBatch(const Quaternion *q0, const Quaternion *q1, float t,
+	Quaternion *result, int count);
+
+//---------------------------------------------------------------------------
+// Batch spherical cubic interpolation
+//
+// result[i] = squad(q0[i], a0[i], a1[i], q1[i], t[i]), several at a time
+// using SIMD, with large arrays split across the worker threads.  Each
+// of the three slerps inside uses the given mode.
+//
+// The tangents a0 and a1 depend only on the keys, so compute them once
+// when the keys are set up and keep them, rather than every frame.
+// computeSquadTangents() does a whole sequence of keys: tangent[i] is
+// squadTangent() of key i and its neighbors, and the first and last keys
+// are their own tangents.
+
+void	squadBatch(const Quaternion *q0, const Quaternion *a0, const Quaternion *a1,
+	const Quaternion *q1, const float *t, Quaternion *result, int count,
+	ESlerpMode mode = eSlerpModeExact);
+
+void	computeSquadTangents(const Quaternion *key, Quaternion *tangent, int count);
+
+//---------------------------------------------------------------------------
+// Batch rotation
+//
+// Rotate count vectors from src to dst.  These do the same thing as
+// calling rotate() from Quaternion.h in a loop, several vectors at a time
+// using SIMD, with large arrays split across the worker threads.  The
+// quaternions must be normalized.
+//
+// As with transformPoints(), the vectors may be embedded in larger
+// structures; pass the size of the structure as the stride, in bytes.
+// src and dst may be the same array, provided the strides are the same.
+
+// Rotate every vector by the same quaternion.  This builds the rotation
+// matrix once and multiplies by that, which is cheaper per vector, so the
+// results can differ from rotate() by float rounding.
+
+void	rotateBatch(const Quaternion &q, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride = sizeof(Vector3), int dstStride = sizeof(Vector3));
+void	rotateBatch(Vector3Array &result, const Vector3Array &v, const Quaternion &q);
+
+// Rotate each vector by its own quaternion: dst[i] = rotate(q[i], src[i]).
+// This is the one for particles and rigid bodies, where every element
+// has its own orientation.  Going straight from the quaternion is cheaper
+// than building a matrix for each vector.
+
+void	rotateBatch(const Quaternion *q, const Vector3 *src, Vector3 *dst,
+	int count, int srcStride = sizeof(Vector3), int dstStride = sizeof(Vector3));
+void	rotateBatch(Vector3Array &result, const Vector3Array &v, const Quaternion *q);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __QUATERNIONBATCH_H_INCLUDED__
@@ -17,7 +17,8 @@
 #ifndef __ROTATIONMATRIX_H_INCLUDED__
 #define __ROTATIONMATRIX_H_INCLUDED__
 
-class Vector3;
+template <class T> class TVector3;
+typedef TVector3<float> Vector3;
 class EulerAngles;
 class Quaternion;
 
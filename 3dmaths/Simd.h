@@ -0,0 +1,426 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Simd.h - Thin portable wrapper over the SSE/AVX instruction sets, used
+// by the batch (array-at-a-time) math kernels.
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SIMD_H_INCLUDED__
+#define __SIMD_H_INCLUDED__
+
+#include <stdlib.h>
+#include <stddef.h>
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The batch kernels are written once against the SimdFloat type below.
+// SimdFloat is a register holding kSimdWidth floats: 8 when compiled for
+// AVX, 4 for SSE2, and 1 (plain scalar code) on anything else.  Defining
+// MATH_NO_SIMD forces the scalar version, which is handy when debugging a
+// kernel, since it must always produce the same results.
+//
+// Kernels process kSimdWidth elements per iteration and finish the last
+// few elements with the scalar code path, so they never read or write
+// past the end of a caller's arrays.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#if !defined(MATH_NO_SIMD)
+	#if defined(__AVX__)
+		#define MATH_SIMD_AVX
+	#endif
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define MATH_SIMD_SSE
+	#endif
+#endif
+
+#if defined(MATH_SIMD_AVX)
+	#include <immintrin.h>
+#elif defined(MATH_SIMD_SSE)
+	#include <emmintrin.h>
+#endif
+
+#include <math.h>
+
+// Alignment used for all lane arrays.  Big enough for an AVX register,
+// and half a cache line.
+
+const int	kSimdAlignment = 32;
+
+// Largest lane count we ever compile for.  Arrays padded to this many
+// elements can be processed by any kernel width.
+
+const int	kSimdMaxWidth = 8;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Aligned memory allocation
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Allocate a block aligned to kSimdAlignment.  The pointer returned by
+// malloc is stashed just before the aligned block so we can free it.
+
+inline void	*alignedAlloc(size_t bytes) {
+	char	*raw = (char *)malloc(bytes + kSimdAlignment + sizeof(void *));
+	if (raw == NULL) {
+		return NULL;
+	}
+	size_t	addr = (size_t)(raw + sizeof(void *));
+	char	*aligned = (char *)((addr + kSimdAlignment - 1) & ~(size_t)(kSimdAlignment - 1));
+	((void **)aligned)[-1] = raw;
+	return aligned;
+}
+
+inline void	alignedFree(void *p) {
+	if (p != NULL) {
+		free(((void **)p)[-1]);
+	}
+}
+
+// Round an element count up to a whole number of the widest registers
+
+inline int	simdPadCount(int n) {
+	return (n + kSimdMaxWidth - 1) & ~(kSimdMaxWidth - 1);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// SimdFloat - kSimdWidth floats in a register
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#if defined(MATH_SIMD_AVX)
+
+const int	kSimdWidth = 8;
+
+struct SimdFloat { __m256 v; };
+struct SimdMask  { __m256 v; };
+
+inline SimdFloat	simdMake(__m256 v) { SimdFloat r; r.v = v; return r; }
+inline SimdMask		simdMakeMask(__m256 v) { SimdMask r; r.v = v; return r; }
+
+inline SimdFloat	simdLoad(const float *p) { return simdMake(_mm256_load_ps(p)); }
+inline SimdFloat	simdLoadU(const float *p) { return simdMake(_mm256_loadu_ps(p)); }
+inline void		simdStore(float *p, SimdFloat a) { _mm256_store_ps(p, a.v); }
+inline void		simdStoreU(float *p, SimdFloat a) { _mm256_storeu_ps(p, a.v); }
+inline SimdFloat	simdSet1(float k) { return simdMake(_mm256_set1_ps(k)); }
+inline SimdFloat	simdZero() { return simdMake(_mm256_setzero_ps()); }
+
+inline SimdFloat	operator+(SimdFloat a, SimdFloat b) { return simdMake(_mm256_add_ps(a.v, b.v)); }
+inline SimdFloat	operator-(SimdFloat a, SimdFloat b) { return simdMake(_mm256_sub_ps(a.v, b.v)); }
+inline SimdFloat	operator*(SimdFloat a, SimdFloat b) { return simdMake(_mm256_mul_ps(a.v, b.v)); }
+inline SimdFloat	operator/(SimdFloat a, SimdFloat b) { return simdMake(_mm256_div_ps(a.v, b.v)); }
+inline SimdFloat	operator-(SimdFloat a) { return simdMake(_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))); }
+
+inline SimdFloat	simdMin(SimdFloat a, SimdFloat b) { return simdMake(_mm256_min_ps(a.v, b.v)); }
+inline SimdFloat	simdMax(SimdFloat a, SimdFloat b) { return simdMake(_mm256_max_ps(a.v, b.v)); }
+inline SimdFloat	simdSqrt(SimdFloat a) { return simdMake(_mm256_sqrt_ps(a.v)); }
+inline SimdFloat	simdAbs(SimdFloat a) { return simdMake(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+inline SimdFloat	simdRsqrtEst(SimdFloat a) { return simdMake(_mm256_rsqrt_ps(a.v)); }
+inline SimdFloat	simdFloor(SimdFloat a) { return simdMake(_mm256_floor_ps(a.v)); }
+
+inline SimdMask	operator<(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)); }
+inline SimdMask	operator<=(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)); }
+inline SimdMask	operator>(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)); }
+inline SimdMask	operator>=(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)); }
+inline SimdMask	operator&(SimdMask a, SimdMask b) { return simdMakeMask(_mm256_and_ps(a.v, b.v)); }
+inline SimdMask	operator|(SimdMask a, SimdMask b) { return simdMakeMask(_mm256_or_ps(a.v, b.v)); }
+
+// Masks always come from compares, so and/andnot/or does the same job as
+// blendv.  Some compilers turn chains of blendv into per-lane branches.
+
+inline SimdFloat	simdSelect(SimdMask m, SimdFloat a, SimdFloat b) {
+	return simdMake(_mm256_or_ps(_mm256_and_ps(m.v, a.v), _mm256_andnot_ps(m.v, b.v)));
+}
+inline int		simdMoveMask(SimdMask m) { return _mm256_movemask_ps(m.v); }
+
+#if defined(__FMA__)
+inline SimdFloat	simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return simdMake(_mm256_fmadd_ps(a.v, b.v, c.v)); }
+#else
+inline SimdFloat	simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return a*b + c; }
+#endif
+
+// Convert to integers, rounding to nearest, and store kSimdWidth of them
+
+inline void	simdStoreInt(int *p, SimdFloat a) { _mm256_storeu_si256((__m256i *)p, _mm256_cvtps_epi32(a.v)); }
+
+// Load kSimdWidth integers and convert them to float
+
+inline SimdFloat	simdLoadInt(const int *p) { return simdMake(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)p))); }
+
+// Load eight consecutive groups of four floats and transpose them, so a
+// holds the first float of each group, b the second, and so on.  Each
+// 128-bit half gets four of the groups, so the transpose never has to
+// cross halves.
+
+inline void	simdLoadTranspose4(const float *p, SimdFloat &a, SimdFloat &b, SimdFloat &c, SimdFloat &d) {
+	__m256	r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 16), 1);
+	__m256	r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 20), 1);
+	__m256	r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 24), 1);
+	__m256	r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 12)), _mm_loadu_ps(p + 28), 1);
+	__m256	t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256	t1 = _mm256_unpackhi_ps(r0, r1);
+	__m256	t2 = _mm256_unpacklo_ps(r2, r3);
+	__m256	t3 = _mm256_unpackhi_ps(r2, r3);
+	a.v = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	b.v = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	c.v = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	d.v = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+// The reverse of simdLoadTranspose4
+
+inline void	simdStoreTranspose4(float *p, SimdFloat a, SimdFloat b, SimdFloat c, SimdFloat d) {
+	__m256	t0 = _mm256_unpacklo_ps(a.v, b.v);
+	__m256	t1 = _mm256_unpackhi_ps(a.v, b.v);
+	__m256	t2 = _mm256_unpacklo_ps(c.v, d.v);
+	__m256	t3 = _mm256_unpackhi_ps(c.v, d.v);
+	__m256	r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256	r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	__m256	r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	__m256	r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	_mm_storeu_ps(p,      _mm256_castps256_ps128(r0));
+	_mm_storeu_ps(p + 4,  _mm256_castps256_ps128(r1));
+	_mm_storeu_ps(p + 8,  _mm256_castps256_ps128(r2));
+	_mm_storeu_ps(p + 12, _mm256_castps256_ps128(r3));
+	_mm_storeu_ps(p + 16, _mm256_extractf128_ps(r0, 1));
+	_mm_storeu_ps(p + 20, _mm256_extractf128_ps(r1, 1));
+	_mm_storeu_ps(p + 24, _mm256_extractf128_ps(r2, 1));
+	_mm_storeu_ps(p + 28, _mm256_extractf128_ps(r3, 1));
+}
+
+// Like simdLoadTranspose4, but the groups of four floats aren't
+// contiguous.  The group for lane i starts at p[i] + offset.  Used when
+// each lane needs a different entry of a table.
+
+inline void	simdGatherTranspose4(const float *const *p, int offset, SimdFloat &a, SimdFloat &b, SimdFloat &c, SimdFloat &d) {
+	__m256	r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[0] + offset)), _mm_loadu_ps(p[4] + offset), 1);
+	__m256	r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[1] + offset)), _mm_loadu_ps(p[5] + offset), 1);
+	__m256	r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[2] + offset)), _mm_loadu_ps(p[6] + offset), 1);
+	__m256	r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p[3] + offset)), _mm_loadu_ps(p[7] + offset), 1);
+	__m256	t0 = _mm256_unpacklo_ps(r0, r1);
+	__m256	t1 = _mm256_unpackhi_ps(r0, r1);
+	__m256	t2 = _mm256_unpacklo_ps(r2, r3);
+	__m256	t3 = _mm256_unpackhi_ps(r2, r3);
+	a.v = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+	b.v = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+	c.v = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+	d.v = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+}
+
+#elif defined(MATH_SIMD_SSE)
+
+const int	kSimdWidth = 4;
+
+struct SimdFloat { __m128 v; };
+struct SimdMask  { __m128 v; };
+
+inline SimdFloat	simdMake(__m128 v) { SimdFloat r; r.v = v; return r; }
+inline SimdMask		simdMakeMask(__m128 v) { SimdMask r; r.v = v; return r; }
+
+inline SimdFloat	simdLoad(const float *p) { return simdMake(_mm_load_ps(p)); }
+inline SimdFloat	simdLoadU(const float *p) { return simdMake(_mm_loadu_ps(p)); }
+inline void		simdStore(float *p, SimdFloat a) { _mm_store_ps(p, a.v); }
+inline void		simdStoreU(float *p, SimdFloat a) { _mm_storeu_ps(p, a.v); }
+inline SimdFloat	simdSet1(float k) { return simdMake(_mm_set1_ps(k)); }
+inline SimdFloat	simdZero() { return simdMake(_mm_setzero_ps()); }
+
+inline SimdFloat	operator+(SimdFloat a, SimdFloat b) { return simdMake(_mm_add_ps(a.v, b.v)); }
+inline SimdFloat	operator-(SimdFloat a, SimdFloat b) { return simdMake(_mm_sub_ps(a.v, b.v)); }
+inline SimdFloat	operator*(SimdFloat a, SimdFloat b) { return simdMake(_mm_mul_ps(a.v, b.v)); }
+inline SimdFloat	operator/(SimdFloat a, SimdFloat b) { return simdMake(_mm_div_ps(a.v, b.v)); }
+inline SimdFloat	operator-(SimdFloat a) { return simdMake(_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))); }
+
+inline SimdFloat	simdMin(SimdFloat a, SimdFloat b) { return simdMake(_mm_min_ps(a.v, b.v)); }
+inline SimdFloat	simdMax(SimdFloat a, SimdFloat b) { return simdMake(_mm_max_ps(a.v, b.v)); }
+inline SimdFloat	simdSqrt(SimdFloat a) { return simdMake(_mm_sqrt_ps(a.v)); }
+inline SimdFloat	simdAbs(SimdFloat a) { return simdMake(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+inline SimdFloat	simdRsqrtEst(SimdFloat a) { return simdMake(_mm_rsqrt_ps(a.v)); }
+
+// SSE2 has no floor instruction.  Truncate, then step down one where
+// truncation rounded a negative value up.  Only valid for |a| < 2^31
+
+inline SimdFloat	simdFloor(SimdFloat a) {
+	__m128	t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+	__m128	fix = _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f));
+	return simdMake(_mm_sub_ps(t, fix));
+}
+
+inline SimdMask	operator<(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm_cmplt_ps(a.v, b.v)); }
+inline SimdMask	operator<=(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm_cmple_ps(a.v, b.v)); }
+inline SimdMask	operator>(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm_cmpgt_ps(a.v, b.v)); }
+inline SimdMask	operator>=(SimdFloat a, SimdFloat b) { return simdMakeMask(_mm_cmpge_ps(a.v, b.v)); }
+inline SimdMask	operator&(SimdMask a, SimdMask b) { return simdMakeMask(_mm_and_ps(a.v, b.v)); }
+inline SimdMask	operator|(SimdMask a, SimdMask b) { return simdMakeMask(_mm_or_ps(a.v, b.v)); }
+
+inline SimdFloat	simdSelect(SimdMask m, SimdFloat a, SimdFloat b) {
+	return simdMake(_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)));
+}
+inline int		simdMoveMask(SimdMask m) { return _mm_movemask_ps(m.v); }
+
+#if defined(__FMA__)
+inline SimdFloat	simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return simdMake(_mm_fmadd_ps(a.v, b.v, c.v)); }
+#else
+inline SimdFloat	simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return a*b + c; }
+#endif
+
+// Convert to integers, rounding to nearest, and store kSimdWidth of them
+
+inline void	simdStoreInt(int *p, SimdFloat a) { _mm_storeu_si128((__m128i *)p, _mm_cvtps_epi32(a.v)); }
+
+// Load kSimdWidth integers and convert them to float
+
+inline SimdFloat	simdLoadInt(const int *p) { return simdMake(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)p))); }
+
+// Load four consecutive groups of four floats and transpose them, so a
+// holds the first float of each group, b the second, and so on
+
+inline void	simdLoadTranspose4(const float *p, SimdFloat &a, SimdFloat &b, SimdFloat &c, SimdFloat &d) {
+	__m128	r0 = _mm_loadu_ps(p);
+	__m128	r1 = _mm_loadu_ps(p + 4);
+	__m128	r2 = _mm_loadu_ps(p + 8);
+	__m128	r3 = _mm_loadu_ps(p + 12);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	a.v = r0; b.v = r1; c.v = r2; d.v = r3;
+}
+
+// The reverse of simdLoadTranspose4
+
+inline void	simdStoreTranspose4(float *p, SimdFloat a, SimdFloat b, SimdFloat c, SimdFloat d) {
+	__m128	r0 = a.v, r1 = b.v, r2 = c.v, r3 = d.v;
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	_mm_storeu_ps(p, r0);
+	_mm_storeu_ps(p + 4, r1);
+	_mm_storeu_ps(p + 8, r2);
+	_mm_storeu_ps(p + 12, r3);
+}
+
+// Like simdLoadTranspose4, but the group for lane i starts at
+// p[i] + offset
+
+inline void	simdGatherTranspose4(const float *const *p, int offset, SimdFloat &a, SimdFloat &b, SimdFloat &c, SimdFloat &d) {
+	__m128	r0 = _mm_loadu_ps(p[0] + offset);
+	__m128	r1 = _mm_loadu_ps(p[1] + offset);
+	__m128	r2 = _mm_loadu_ps(p[2] + offset);
+	__m128	r3 = _mm_loadu_ps(p[3] + offset);
+	_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+	a.v = r0; b.v = r1; c.v = r2; d.v = r3;
+}
+
+#else
+
+// Scalar fallback.  The "register" holds a single float.
+
+const int	kSimdWidth = 1;
+
+struct SimdFloat { float v; };
+struct SimdMask  { bool v; };
+
+inline SimdFloat	simdMake(float v) { SimdFloat r; r.v = v; return r; }
+inline SimdMask		simdMakeMask(bool v) { SimdMask r; r.v = v; return r; }
+
+inline SimdFloat	simdLoad(const float *p) { return simdMake(*p); }
+inline SimdFloat	simdLoadU(const float *p) { return simdMake(*p); }
+inline void		simdStore(float *p, SimdFloat a) { *p = a.v; }
+inline void		simdStoreU(float *p, SimdFloat a) { *p = a.v; }
+inline SimdFloat	simdSet1(float k) { return simdMake(k); }
+inline SimdFloat	simdZero() { return simdMake(0.0f); }
+
+inline SimdFloat	operator+(SimdFloat a, SimdFloat b) { return simdMake(a.v + b.v); }
+inline SimdFloat	operator-(SimdFloat a, SimdFloat b) { return simdMake(a.v - b.v); }
+inline SimdFloat	operator*(SimdFloat a, SimdFloat b) { return simdMake(a.v * b.v); }
+inline SimdFloat	operator/(SimdFloat a, SimdFloat b) { return simdMake(a.v / b.v); }
+inline SimdFloat	operator-(SimdFloat a) { return simdMake(-a.v); }
+
+inline SimdFloat	simdMin(SimdFloat a, SimdFloat b) { return simdMake(a.v < b.v ? a.v : b.v); }
+inline SimdFloat	simdMax(SimdFloat a, SimdFloat b) { return simdMake(a.v > b.v ? a.v : b.v); }
+inline SimdFloat	simdSqrt(SimdFloat a) { return simdMake((float)sqrt(a.v)); }
+inline SimdFloat	simdAbs(SimdFloat a) { return simdMake((float)fabs(a.v)); }
+inline SimdFloat	simdRsqrtEst(SimdFloat a) { return simdMake(1.0f / (float)sqrt(a.v)); }
+inline SimdFloat	simdFloor(SimdFloat a) { return simdMake((float)floor(a.v)); }
+
+inline SimdMask	operator<(SimdFloat a, SimdFloat b) { return simdMakeMask(a.v < b.v); }
+inline SimdMask	operator<=(SimdFloat a, SimdFloat b) { return simdMakeMask(a.v <= b.v); }
+inline SimdMask	operator>(SimdFloat a, SimdFloat b) { return simdMakeMask(a.v > b.v); }
+inline SimdMask	operator>=(SimdFloat a, SimdFloat b) { return simdMakeMask(a.v >= b.v); }
+inline SimdMask	operator&(SimdMask a, SimdMask b) { return simdMakeMask(a.v && b.v); }
+inline SimdMask	operator|(SimdMask a, SimdMask b) { return simdMakeMask(a.v || b.v); }
+
+inline SimdFloat	simdSelect(SimdMask m, SimdFloat a, SimdFloat b) { return m.v ? a : b; }
+inline int		simdMoveMask(SimdMask m) { return m.v ? 1 : 0; }
+
+inline SimdFloat	simdMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return simdMake(a.v*b.v + c.v); }
+
+// Round to nearest even, like cvtps2dq, so large values come out the same
+
+inline void	simdStoreInt(int *p, SimdFloat a) { *p = (int)nearbyintf(a.v); }
+inline SimdFloat	simdLoadInt(const int *p) { return simdMake((float)*p); }
+
+inline void	simdLoadTranspose4(const float *p, SimdFloat &a, SimdFloat &b, SimdFloat &c, SimdFloat &d) {
+	a.v = p[0]; b.v = p[1]; c.v = p[2]; d.v = p[3];
+}
+inline void	simdStoreTranspose4(float *p, SimdFloat a, SimdFloat b, SimdFloat c, SimdFloat d) {
+	p[0] = a.v; p[1] = b.v; p[2] = c.v; p[3] = d.v;
+}
+inline void	simdGatherTranspose4(const float *const *p, int offset, SimdFloat &a, SimdFloat &b, SimdFloat &c, SimdFloat &d) {
+	simdLoadTranspose4(p[0] + offset, a, b, c, d);
+}
+
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Width-independent helpers
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Bit mask with one bit set for every lane
+
+const int	kSimdAllLanes = (1 << kSimdWidth) - 1;
+
+// Reciprocal square root, refined with one Newton-Raphson step.  The
+// hardware estimate is only good to about 12 bits; after the refinement
+// we are within a couple of ulps of 1/sqrt(a), which is plenty for
+// normalizing vectors.
+
+inline SimdFloat	simdRsqrt(SimdFloat a) {
+	SimdFloat	y = simdRsqrtEst(a);
+	return y * (simdSet1(1.5f) - simdSet1(0.5f) * a * y * y);
+}
+
+// Gather one lane from each of kSimdWidth strided floats.  Used to pull
+// a single component out of an array of structures.  The lanes are
+// assembled in registers; writing them to memory and loading them back
+// as one wide value would stall the store forwarding.
+
+inline SimdFloat	simdGather(const float *p, int strideInFloats) {
+#if defined(MATH_SIMD_AVX)
+	int	s = strideInFloats;
+	return simdMake(_mm256_setr_ps(p[0], p[s], p[2*s], p[3*s], p[4*s], p[5*s], p[6*s], p[7*s]));
+#elif defined(MATH_SIMD_SSE)
+	int	s = strideInFloats;
+	return simdMake(_mm_setr_ps(p[0], p[s], p[2*s], p[3*s]));
+#else
+	return simdMake(*p);
+#endif
+}
+
+// Scatter each lane to kSimdWidth strided floats
+
+inline void	simdScatter(float *p, int strideInFloats, SimdFloat a) {
+	float	tmp[kSimdMaxWidth];
+	simdStoreU(tmp, a);
+	for (int i = 0 ; i < kSimdWidth ; ++i) {
+		p[i * strideInFloats] = tmp[i];
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __SIMD_H_INCLUDED__
@@ -0,0 +1,295 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// SimdTrig.h - Polynomial sin, cos, acos and atan2, scalar and SIMD
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SIMDTRIG_H_INCLUDED__
+#define __SIMDTRIG_H_INCLUDED__
+
+#include <math.h>
+#include <string.h>
+
+#ifndef __SIMD_H_INCLUDED__
+	#include "Simd.h"
+#endif
+
+#ifndef __MATHUTIL_H_INCLUDED__
+	#include "MathUtil.h"
+#endif
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// These are the kernels behind fastSinCos(), fastAcos(), fastAtan2() and
+// their batch versions in MathUtil.h.  They are templated on the
+// accuracy tier, so each tier compiles down to just its own polynomial.
+// Batch kernels elsewhere can call the SIMD versions directly on values
+// that are already in registers.
+//
+// Each function comes in a SIMD version and a plain float version.  They
+// share the polynomials and do the same operations in the same order, so
+// they give exactly the same results.
+//
+// The polynomials are minimax fits (they minimize the largest absolute
+// error over the range, rather than matching derivatives at one point
+// like a Taylor series).  The worst errors over the whole domain, as
+// measured by the trig_accuracy benchmark against double precision, are
+// about:
+//
+//			sin/cos		acos		atan2
+//	Low		3.2e-4		3.3e-4		6.1e-4
+//	Medium		9.9e-7		5.1e-6		1.2e-5
+//	High		9.3e-8		3.2e-7		2.8e-7
+//
+// High is as close as float can get; most of its error is the rounding of
+// results near pi, where a float only has a resolution of 2.4e-7.
+//
+// sin and cos reduce the angle to [-pi/4, pi/4] by subtracting the
+// nearest multiple of pi/2, split into three parts (Cody and Waite) so the
+// subtraction stays exact.  That works for |theta| up to about 1e5;
+// beyond that, float can't hold the angle precisely enough to mean much
+// anyway.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// trigConst
+// trigMadd
+// trigSelect
+//
+// The few operations the kernels need, for both plain floats and SIMD
+// registers, so the polynomials below can be written once.  The float
+// versions do exactly what the SIMD ones do in each lane, including
+// fusing the multiply-add only when simdMadd() does, so the scalar and
+// SIMD kernels give the same bits.
+
+inline float		trigConst(float, float k) { return k; }
+inline SimdFloat	trigConst(SimdFloat, float k) { return simdSet1(k); }
+
+inline float	trigMadd(float a, float b, float c) {
+#if defined(__FMA__)
+	return fmaf(a, b, c);
+#else
+	return a*b + c;
+#endif
+}
+inline SimdFloat	trigMadd(SimdFloat a, SimdFloat b, SimdFloat c) { return simdMadd(a, b, c); }
+
+// Picking with the bits rather than ?: keeps the compiler from making a
+// branch, which would mispredict half the time on random input.
+
+inline float	trigSelect(bool m, float a, float b) {
+	unsigned int	ua, ub;
+	memcpy(&ua, &a, sizeof(ua));
+	memcpy(&ub, &b, sizeof(ub));
+	unsigned int	mask = 0u - (unsigned int)m;
+	ua = (ua & mask) | (ub & ~mask);
+	memcpy(&a, &ua, sizeof(a));
+	return a;
+}
+
+//---------------------------------------------------------------------------
+// trigSinPoly
+// trigCosPoly
+// trigAcosPoly
+// trigAtanPoly
+//
+// The minimax polynomials for each tier.  For r in [-pi/4, pi/4],
+// sin(r) = r + r^3 P(r^2) and cos(r) = 1 - r^2/2 + r^4 Q(r^2), and these
+// return P and Q.  For a in [0, 1], acos(a) = sqrt(1 - a) trigAcosPoly(a),
+// and for z in [0, 1], atan(z) = z trigAtanPoly(z^2).
+
+template <int kAccuracy, class T>
+inline T	trigSinPoly(T r2) {
+	if (kAccuracy == eTrigAccuracyLow) {
+		return trigConst(r2, -0.16225882f);
+	} else if (kAccuracy == eTrigAccuracyMedium) {
+		return trigMadd(trigConst(r2, 0.008152985f), r2, trigConst(r2, -0.16662833f));
+	}
+	T	p = trigMadd(trigConst(r2, -0.00019495626f), r2, trigConst(r2, 0.0083319787f));
+	return trigMadd(p, r2, trigConst(r2, -0.16666651f));
+}
+
+template <int kAccuracy, class T>
+inline T	trigCosPoly(T r2) {
+	if (kAccuracy == eTrigAccuracyLow) {
+		return trigConst(r2, 0.040908396f);
+	} else if (kAccuracy == eTrigAccuracyMedium) {
+		return trigMadd(trigConst(r2, -0.0013652442f), r2, trigConst(r2, 0.041661277f));
+	}
+	T	p = trigMadd(trigConst(r2, 2.4438443e-05f), r2, trigConst(r2, -0.0013887368f));
+	return trigMadd(p, r2, trigConst(r2, 0.041666646f));
+}
+
+template <int kAccuracy, class T>
+inline T	trigAcosPoly(T a) {
+	T	p;
+	if (kAccuracy == eTrigAccuracyLow) {
+		p = trigMadd(trigConst(a, 0.05139047f), a, trigConst(a, -0.20549846f));
+		return trigMadd(p, a, trigConst(a, 1.5704705f));
+	} else if (kAccuracy == eTrigAccuracyMedium) {
+		p = trigMadd(trigConst(a, 0.0097331703f), a, trigConst(a, -0.037618615f));
+		p = trigMadd(p, a, trigConst(a, 0.085638635f));
+		p = trigMadd(p, a, trigConst(a, -0.21428066f));
+		return trigMadd(p, a, trigConst(a, 1.5707915f));
+	}
+	p = trigMadd(trigConst(a, -0.0014415116f), a, trigConst(a, 0.0072455592f));
+	p = trigMadd(p, a, trigConst(a, -0.017809138f));
+	p = trigMadd(p, a, trigConst(a, 0.031335577f));
+	p = trigMadd(p, a, trigConst(a, -0.050312825f));
+	p = trigMadd(p, a, trigConst(a, 0.088999271f));
+	p = trigMadd(p, a, trigConst(a, -0.21459989f));
+	return trigMadd(p, a, trigConst(a, 1.5707964f));
+}
+
+template <int kAccuracy, class T>
+inline T	trigAtanPoly(T z2) {
+	T	p;
+	if (kAccuracy == eTrigAccuracyLow) {
+		p = trigMadd(trigConst(z2, 0.079337075f), z2, trigConst(z2, -0.28868833f));
+		return trigMadd(p, z2, trigConst(z2, 0.99535763f));
+	} else if (kAccuracy == eTrigAccuracyMedium) {
+		p = trigMadd(trigConst(z2, 0.020844601f), z2, trigConst(z2, -0.085155345f));
+		p = trigMadd(p, z2, trigConst(z2, 0.18015866f));
+		p = trigMadd(p, z2, trigConst(z2, -0.33030465f));
+		return trigMadd(p, z2, trigConst(z2, 0.99986631f));
+	}
+	p = trigMadd(trigConst(z2, -0.0040545100f), z2, trigConst(z2, 0.021862783f));
+	p = trigMadd(p, z2, trigConst(z2, -0.05591213f));
+	p = trigMadd(p, z2, trigConst(z2, 0.096421875f));
+	p = trigMadd(p, z2, trigConst(z2, -0.13908628f));
+	p = trigMadd(p, z2, trigConst(z2, 0.19946566f));
+	p = trigMadd(p, z2, trigConst(z2, -0.33329859f));
+	return trigMadd(p, z2, trigConst(z2, 0.99999934f));
+}
+
+//---------------------------------------------------------------------------
+// trigReduce
+//
+// Subtract the nearest multiple of pi/2 from theta.  q is that multiple.
+
+template <class T>
+inline T	trigReduce(T theta, T q) {
+	T	r = trigMadd(q, trigConst(q, -1.5703125f), theta);
+	r = trigMadd(q, trigConst(q, -4.8375129699707031e-4f), r);
+	return trigMadd(q, trigConst(q, -7.5497899548918822e-8f), r);
+}
+
+//---------------------------------------------------------------------------
+// simdSinCos
+// scalarSinCos
+//
+// Sin and cosine of each lane, or of one float
+
+template <int kAccuracy>
+inline void	simdSinCos(SimdFloat theta, SimdFloat &sinResult, SimdFloat &cosResult) {
+
+	// Nearest multiple of pi/2, and which quadrant that puts us in
+
+	SimdFloat	q = simdFloor(simdMadd(theta, simdSet1(0.63661977f), simdSet1(0.5f)));
+	SimdFloat	quadrant = q - simdFloor(q * simdSet1(0.25f)) * simdSet1(4.0f);
+
+	SimdFloat	r = trigReduce(theta, q);
+	SimdFloat	r2 = r * r;
+	SimdFloat	s = simdMadd(trigSinPoly<kAccuracy>(r2) * r2, r, r);
+	SimdFloat	c = simdMadd(trigCosPoly<kAccuracy>(r2) * r2, r2, simdMadd(r2, simdSet1(-0.5f), simdSet1(1.0f)));
+
+	// Quadrant 1 and 3 swap sin and cos.  Sin is negative in quadrants
+	// 2 and 3, cos in 1 and 2.
+
+	SimdMask	odd = (quadrant > simdSet1(0.5f)) & (quadrant < simdSet1(1.5f));
+	odd = odd | (quadrant > simdSet1(2.5f));
+	SimdMask	negSin = quadrant > simdSet1(1.5f);
+	SimdMask	negCos = (quadrant > simdSet1(0.5f)) & (quadrant < simdSet1(2.5f));
+
+	SimdFloat	sw = simdSelect(odd, c, s);
+	SimdFloat	cw = simdSelect(odd, s, c);
+	sinResult = simdSelect(negSin, -sw, sw);
+	cosResult = simdSelect(negCos, -cw, cw);
+}
+
+template <int kAccuracy>
+inline void	scalarSinCos(float theta, float &sinResult, float &cosResult) {
+
+	// Floor without a library call: truncate, then fix up negatives
+
+	float	f = trigMadd(theta, 0.63661977f, 0.5f);
+	int	qi = (int)f;
+	qi -= (f < (float)qi);
+	float	q = (float)qi;
+
+	float	r = trigReduce(theta, q);
+	float	r2 = r * r;
+	float	s = trigMadd(trigSinPoly<kAccuracy>(r2) * r2, r, r);
+	float	c = trigMadd(trigCosPoly<kAccuracy>(r2) * r2, r2, trigMadd(r2, -0.5f, 1.0f));
+
+	int	quadrant = qi & 3;
+	bool	odd = (quadrant & 1) != 0;
+	float	sw = trigSelect(odd, c, s);
+	float	cw = trigSelect(odd, s, c);
+	sinResult = trigSelect(quadrant >= 2, -sw, sw);
+	cosResult = trigSelect(quadrant == 1 || quadrant == 2, -cw, cw);
+}
+
+//---------------------------------------------------------------------------
+// simdAcos
+// scalarAcos
+//
+// acos, clamped to [-1, 1] first, like safeAcos().  For x >= 0,
+// acos(x) = sqrt(1 - x) P(x); the square root takes care of the infinite
+// slope at x = 1.  For negative x we use acos(-x) = pi - acos(x).
+
+template <int kAccuracy>
+inline SimdFloat	simdAcos(SimdFloat x) {
+	SimdFloat	a = simdMin(simdAbs(x), simdSet1(1.0f));
+	SimdFloat	r = simdSqrt(simdSet1(1.0f) - a) * trigAcosPoly<kAccuracy>(a);
+	return simdSelect(x < simdZero(), simdSet1(kPi) - r, r);
+}
+
+template <int kAccuracy>
+inline float	scalarAcos(float x) {
+	float	a = fminf(fabsf(x), 1.0f);
+	float	r = sqrtf(1.0f - a) * trigAcosPoly<kAccuracy>(a);
+	return trigSelect(x < 0.0f, kPi - r, r);
+}
+
+//---------------------------------------------------------------------------
+// simdAtan2
+// scalarAtan2
+//
+// atan2(y, x), in the range -pi...pi, with atan2(0, 0) = 0.  We take atan
+// of min/max of |x| and |y|, which is in [0, 1], and then unfold it into
+// the right octant.
+
+template <int kAccuracy>
+inline SimdFloat	simdAtan2(SimdFloat y, SimdFloat x) {
+	SimdFloat	ax = simdAbs(x);
+	SimdFloat	ay = simdAbs(y);
+	SimdFloat	z = simdMin(ax, ay) / simdMax(simdMax(ax, ay), simdSet1(1e-30f));
+	SimdFloat	r = z * trigAtanPoly<kAccuracy>(z * z);
+
+	r = simdSelect(ay > ax, simdSet1(kPiOver2) - r, r);
+	r = simdSelect(x < simdZero(), simdSet1(kPi) - r, r);
+	return simdSelect(y < simdZero(), -r, r);
+}
+
+template <int kAccuracy>
+inline float	scalarAtan2(float y, float x) {
+	float	ax = fabsf(x);
+	float	ay = fabsf(y);
+	float	z = fminf(ax, ay) / fmaxf(fmaxf(ax, ay), 1e-30f);
+	float	r = z * trigAtanPoly<kAccuracy>(z * z);
+
+	r = trigSelect(ay > ax, kPiOver2 - r, r);
+	r = trigSelect(x < 0.0f, kPi - r, r);
+	return trigSelect(y < 0.0f, -r, r);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __SIMDTRIG_H_INCLUDED__
@@ -0,0 +1,545 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// SkinnedMesh.cpp - Vertex data for linear blend skinning
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+
+#include "SkinnedMesh.h"
+#include "TriMesh.h"
+#include "Matrix4x3.h"
+#include "DualQuaternion.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Linear blend skinning transforms each vertex by the weighted sum of the
+// matrices of the bones that influence it:
+//
+//	p' = p * (w0*M[b0] + w1*M[b1] + w2*M[b2] + w3*M[b3])
+//
+// Blending the matrices first and transforming once is cheaper than
+// transforming by each bone and blending the results.  Normals are
+// transformed by the 3x3 portion of the blended matrix and renormalized.
+// This is exact for palettes of rigid transforms (and uniform scale),
+// which is what skeletons almost always contain.
+//
+// Every vertex uses different bones, so we don't try to gather the
+// palette into SIMD lanes.  Instead, like concatenation in
+// Matrix4x3Batch.cpp, each row of the blended matrix is held in one
+// four-wide register, and blending a bone in is four multiply-adds.
+//
+// Dual quaternion skinning blends the bones' dual quaternions instead
+// (see DualQuaternion.cpp.)  Blending is done per vertex as above, eight
+// floats per bone.  The blended transforms are then copied into SIMD
+// lanes and kSimdWidth vertices are normalized and transformed at a time,
+// since that part is a lot more math than the blend.
+//
+// Meshes smaller than kMinVerticesPerChunk don't bother with the worker
+// threads.  When skinning many characters, it's usually better to spread
+// the characters across the threads with parallelFor, and skin each one
+// serially (which happens automatically, since nested loops are serial.)
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMinVerticesPerChunk = 4096;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// SkinJob
+//
+// Parameters for one skinning call, passed to parallelFor
+
+struct SkinJob {
+	const SkinnedVertex	*src;
+	const Matrix4x3		*palette;
+	RenderVertex		*dst;
+};
+
+//---------------------------------------------------------------------------
+// skinRange
+//
+// Skin vertices [begin, end) of a job
+
+static void	skinRange(int begin, int end, void *context) {
+	const SkinJob *job = (const SkinJob *)context;
+
+#if defined(MATH_SIMD_SSE)
+
+	// The translation row would pick up transformType in the
+	// fourth lane, so mask it off
+
+	const __m128	xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+
+	for (int i = begin ; i < end ; ++i) {
+		const SkinnedVertex	&s = job->src[i];
+		RenderVertex		&d = job->dst[i];
+
+		// Blend the matrices.  The heaviest influence always
+		// comes first, so stop at the first zero weight
+
+		const Matrix4x3	*m = &job->palette[s.bone[0]];
+		__m128	w = _mm_set1_ps(s.weight[0]);
+		__m128	r1 = _mm_mul_ps(w, _mm_loadu_ps(&m->m11));
+		__m128	r2 = _mm_mul_ps(w, _mm_loadu_ps(&m->m21));
+		__m128	r3 = _mm_mul_ps(w, _mm_loadu_ps(&m->m31));
+		__m128	rt = _mm_mul_ps(w, _mm_and_ps(_mm_loadu_ps(&m->tx), xyzMask));
+
+		for (int k = 1 ; k < kMaxBonesPerVertex && s.weight[k] != 0.0f ; ++k) {
+			m = &job->palette[s.bone[k]];
+			w = _mm_set1_ps(s.weight[k]);
+			r1 = _mm_add_ps(r1, _mm_mul_ps(w, _mm_loadu_ps(&m->m11)));
+			r2 = _mm_add_ps(r2, _mm_mul_ps(w, _mm_loadu_ps(&m->m21)));
+			r3 = _mm_add_ps(r3, _mm_mul_ps(w, _mm_loadu_ps(&m->m31)));
+			rt = _mm_add_ps(rt, _mm_mul_ps(w, _mm_and_ps(_mm_loadu_ps(&m->tx), xyzMask)));
+		}
+
+		// Transform the position and normal
+
+		const Vector3	&p = s.v.p;
+		const Vector3	&n = s.v.n;
+		__m128	rp = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), r1), _mm_mul_ps(_mm_set1_ps(p.y), r2)),
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), r3), rt));
+		__m128	rn = _mm_add_ps(
+			_mm_add_ps(_mm_mul_ps(_mm_set1_ps(n.x), r1), _mm_mul_ps(_mm_set1_ps(n.y), r2)),
+			_mm_mul_ps(_mm_set1_ps(n.z), r3));
+
+		// The four-wide position store spills into n.x, which we are
+		// about to write anyway
+
+		float	nf[4];
+		_mm_storeu_ps(&d.p.x, rp);
+		_mm_storeu_ps(nf, rn);
+		d.n.x = nf[0];
+		d.n.y = nf[1];
+		d.n.z = nf[2];
+		d.n.normalize();
+		d.u = s.v.u;
+		d.v = s.v.v;
+	}
+
+#else
+
+	for (int i = begin ; i < end ; ++i) {
+		const SkinnedVertex	&s = job->src[i];
+		RenderVertex		&d = job->dst[i];
+
+		// Blend the matrices
+
+		float	r[12];
+		const float *m = &job->palette[s.bone[0]].m11;
+		for (int e = 0 ; e < 12 ; ++e) {
+			r[e] = s.weight[0] * m[e];
+		}
+		for (int k = 1 ; k < kMaxBonesPerVertex && s.weight[k] != 0.0f ; ++k) {
+			m = &job->palette[s.bone[k]].m11;
+			for (int e = 0 ; e < 12 ; ++e) {
+				r[e] += s.weight[k] * m[e];
+			}
+		}
+
+		// Transform the position and normal
+
+		const Vector3	&p = s.v.p;
+		const Vector3	&n = s.v.n;
+		d.p.x = p.x*r[0] + p.y*r[3] + p.z*r[6] + r[9];
+		d.p.y = p.x*r[1] + p.y*r[4] + p.z*r[7] + r[10];
+		d.p.z = p.x*r[2] + p.y*r[5] + p.z*r[8] + r[11];
+		d.n.x = n.x*r[0] + n.y*r[3] + n.z*r[6];
+		d.n.y = n.x*r[1] + n.y*r[4] + n.z*r[7];
+		d.n.z = n.x*r[2] + n.y*r[5] + n.z*r[8];
+		d.n.normalize();
+		d.u = s.v.u;
+		d.v = s.v.v;
+	}
+
+#endif
+}
+
+//---------------------------------------------------------------------------
+// DualQuaternionSkinJob
+//
+// Parameters for one dual quaternion skinning call
+
+struct DualQuaternionSkinJob {
+	const SkinnedVertex	*src;
+	const DualQuaternion	*palette;
+	RenderVertex		*dst;
+};
+
+//---------------------------------------------------------------------------
+// blendInfluences
+//
+// Blend the dual quaternions of the bones influencing a vertex, without
+// normalizing.  Quaternions on the far side of the first one are
+// flipped.  The result is stored real part first, in w, x, y, z order.
+
+static inline void	blendInfluences(const SkinnedVertex &s, const DualQuaternion *palette, float *out) {
+	const DualQuaternion	*first = &palette[s.bone[0]];
+
+#if defined(MATH_SIMD_SSE)
+
+	__m128	w = _mm_set1_ps(s.weight[0]);
+	__m128	r = _mm_mul_ps(w, _mm_loadu_ps(&first->real.w));
+	__m128	d = _mm_mul_ps(w, _mm_loadu_ps(&first->dual.w));
+
+	// The sign of the dot product with the first quaternion is copied
+	// onto the weight, which avoids a hard-to-predict branch
+
+	const __m128	signMask = _mm_set1_ps(-0.0f);
+	__m128		firstReal = _mm_loadu_ps(&first->real.w);
+
+	for (int k = 1 ; k < kMaxBonesPerVertex && s.weight[k] != 0.0f ; ++k) {
+		const DualQuaternion *dq = &palette[s.bone[k]];
+		__m128	real = _mm_loadu_ps(&dq->real.w);
+		__m128	dot = _mm_mul_ps(real, firstReal);
+		dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(2, 3, 0, 1)));
+		dot = _mm_add_ps(dot, _mm_shuffle_ps(dot, dot, _MM_SHUFFLE(1, 0, 3, 2)));
+		w = _mm_xor_ps(_mm_set1_ps(s.weight[k]), _mm_and_ps(dot, signMask));
+		r = _mm_add_ps(r, _mm_mul_ps(w, real));
+		d = _mm_add_ps(d, _mm_mul_ps(w, _mm_loadu_ps(&dq->dual.w)));
+	}
+
+	_mm_storeu_ps(out, r);
+	_mm_storeu_ps(out + 4, d);
+
+#else
+
+	const float	*q = &first->real.w;
+	for (int e = 0 ; e < 8 ; ++e) {
+		out[e] = s.weight[0] * q[e];
+	}
+
+	for (int k = 1 ; k < kMaxBonesPerVertex && s.weight[k] != 0.0f ; ++k) {
+		const DualQuaternion *dq = &palette[s.bone[k]];
+		float	weight = s.weight[k];
+		if (dotProduct(dq->real, first->real) < 0.0f) {
+			weight = -weight;
+		}
+		q = &dq->real.w;
+		for (int e = 0 ; e < 8 ; ++e) {
+			out[e] += weight * q[e];
+		}
+	}
+
+#endif
+}
+
+//---------------------------------------------------------------------------
+// rotateLanes
+//
+// Rotate kSimdWidth vectors by kSimdWidth unit quaternions.  Same math
+// as transformNormal() in DualQuaternion.cpp.
+
+static inline void	rotateLanes(SimdFloat rw, SimdFloat rx, SimdFloat ry, SimdFloat rz,
+	SimdFloat &x, SimdFloat &y, SimdFloat &z) {
+
+	SimdFloat	two = simdSet1(2.0f);
+	SimdFloat	cx = two * (ry*z - rz*y);
+	SimdFloat	cy = two * (rz*x - rx*z);
+	SimdFloat	cz = two * (rx*y - ry*x);
+
+	x = x + rw*cx + (ry*cz - rz*cy);
+	y = y + rw*cy + (rz*cx - rx*cz);
+	z = z + rw*cz + (rx*cy - ry*cx);
+}
+
+//---------------------------------------------------------------------------
+// dualQuaternionSkinRange
+//
+// Skin vertices [begin, end) of a job
+
+static void	dualQuaternionSkinRange(int begin, int end, void *context) {
+	const DualQuaternionSkinJob *job = (const DualQuaternionSkinJob *)context;
+
+	// Strides for the gathers and scatters, in floats
+
+	const int	sf = sizeof(SkinnedVertex) / sizeof(float);
+	const int	df = sizeof(RenderVertex) / sizeof(float);
+
+	int	i = begin;
+	for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+
+		// Blend each vertex, and copy into lane order
+
+		float	lanes[8][kSimdMaxWidth];
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			float	blended[8];
+			blendInfluences(job->src[i + lane], job->palette, blended);
+			for (int e = 0 ; e < 8 ; ++e) {
+				lanes[e][lane] = blended[e];
+			}
+		}
+
+		SimdFloat	rw = simdLoadU(lanes[0]), rx = simdLoadU(lanes[1]);
+		SimdFloat	ry = simdLoadU(lanes[2]), rz = simdLoadU(lanes[3]);
+		SimdFloat	dw = simdLoadU(lanes[4]), dx = simdLoadU(lanes[5]);
+		SimdFloat	dy = simdLoadU(lanes[6]), dz = simdLoadU(lanes[7]);
+
+		// Normalize by the magnitude of the real part
+
+		SimdFloat	k = simdRsqrt(rw*rw + rx*rx + ry*ry + rz*rz);
+		rw = rw * k; rx = rx * k; ry = ry * k; rz = rz * k;
+		dw = dw * k; dx = dx * k; dy = dy * k; dz = dz * k;
+
+		// Extract the translation
+
+		SimdFloat	two = simdSet1(2.0f);
+		SimdFloat	tx = two * (rw*dx - dw*rx + ry*dz - rz*dy);
+		SimdFloat	ty = two * (rw*dy - dw*ry + rz*dx - rx*dz);
+		SimdFloat	tz = two * (rw*dz - dw*rz + rx*dy - ry*dx);
+
+		// Transform the positions and normals
+
+		const float	*s = &job->src[i].v.p.x;
+		SimdFloat	px = simdGather(s, sf), py = simdGather(s + 1, sf), pz = simdGather(s + 2, sf);
+		SimdFloat	nx = simdGather(s + 3, sf), ny = simdGather(s + 4, sf), nz = simdGather(s + 5, sf);
+
+		rotateLanes(rw, rx, ry, rz, px, py, pz);
+		rotateLanes(rw, rx, ry, rz, nx, ny, nz);
+
+		float	*d = &job->dst[i].p.x;
+		simdScatter(d, df, px + tx);
+		simdScatter(d + 1, df, py + ty);
+		simdScatter(d + 2, df, pz + tz);
+		simdScatter(d + 3, df, nx);
+		simdScatter(d + 4, df, ny);
+		simdScatter(d + 5, df, nz);
+
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			job->dst[i + lane].u = job->src[i + lane].v.u;
+			job->dst[i + lane].v = job->src[i + lane].v.v;
+		}
+	}
+
+	// Finish up the last few one at a time
+
+	for ( ; i < end ; ++i) {
+		const SkinnedVertex	&s = job->src[i];
+		RenderVertex		&d = job->dst[i];
+
+		DualQuaternion	dq;
+		blendInfluences(s, job->palette, &dq.real.w);
+
+		float	k = 1.0f / (float)sqrt(dotProduct(dq.real, dq.real));
+		float	*q = &dq.real.w;
+		for (int e = 0 ; e < 8 ; ++e) {
+			q[e] *= k;
+		}
+
+		d.p = s.v.p * dq;
+		d.n = transformNormal(s.v.n, dq);
+		d.u = s.v.u;
+		d.v = s.v.v;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class SkinnedMesh member functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::SkinnedMesh
+//
+// Constructor - reset internal variables to default (empty) state
+
+SkinnedMesh::SkinnedMesh() {
+	vertexCount = 0;
+	vertexList = NULL;
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::~SkinnedMesh
+//
+// Destructor - make sure resources are freed
+
+SkinnedMesh::~SkinnedMesh() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::allocateMemory
+//
+// Allocate the vertex list
+
+void	SkinnedMesh::allocateMemory(int nVertexCount) {
+
+	// First, make sure and free any memory already allocated
+
+	freeMemory();
+
+	// Allocate vertex list
+
+	vertexCount = nVertexCount;
+	vertexList = new SkinnedVertex[vertexCount];
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::freeMemory
+//
+// Free up any memory and reset object to default state
+
+void	SkinnedMesh::freeMemory() {
+	delete [] vertexList;
+	vertexList = NULL;
+	vertexCount = 0;
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::fromTriMesh
+//
+// Copy the bind pose vertices from a TriMesh, attached rigidly to bone 0
+
+void	SkinnedMesh::fromTriMesh(const TriMesh &mesh) {
+	allocateMemory(mesh.getVertexCount());
+
+	const RenderVertex *src = mesh.getVertexList();
+	for (int i = 0 ; i < vertexCount ; ++i) {
+		SkinnedVertex &s = vertexList[i];
+		s.v = src[i];
+		for (int k = 0 ; k < kMaxBonesPerVertex ; ++k) {
+			s.bone[k] = 0;
+			s.weight[k] = 0.0f;
+		}
+		s.weight[0] = 1.0f;
+	}
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::normalizeWeights
+//
+// Put the weights into the form skin() expects: summing to 1, heaviest
+// first, unused influences at the end with zero weight.
+
+void	SkinnedMesh::normalizeWeights() {
+	for (int i = 0 ; i < vertexCount ; ++i) {
+		SkinnedVertex &s = vertexList[i];
+
+		// Sort by weight, largest first.  Only four entries,
+		// so insertion sort is fine
+
+		for (int k = 1 ; k < kMaxBonesPerVertex ; ++k) {
+			unsigned short	b = s.bone[k];
+			float		w = s.weight[k];
+			int j = k;
+			while (j > 0 && s.weight[j - 1] < w) {
+				s.bone[j] = s.bone[j - 1];
+				s.weight[j] = s.weight[j - 1];
+				--j;
+			}
+			s.bone[j] = b;
+			s.weight[j] = w;
+		}
+
+		// Scale to sum to 1.  A vertex with no weight at all
+		// just follows its first bone
+
+		float	total = 0.0f;
+		for (int k = 0 ; k < kMaxBonesPerVertex ; ++k) {
+			assert(s.weight[k] >= 0.0f);
+			total += s.weight[k];
+		}
+		if (total > 0.0f) {
+			float	oneOverTotal = 1.0f / total;
+			for (int k = 0 ; k < kMaxBonesPerVertex ; ++k) {
+				s.weight[k] *= oneOverTotal;
+			}
+		} else {
+			s.weight[0] = 1.0f;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::skin
+//
+// Deform the mesh by a matrix palette.  See the notes at the top of
+// this file.
+
+void	SkinnedMesh::skin(const Matrix4x3 *palette, int boneCount, RenderVertex *dst) const {
+
+	// Make sure we have something
+
+	if (vertexCount < 1) {
+		return;
+	}
+	assert(palette != NULL);
+	assert(dst != NULL);
+
+#ifdef _DEBUG
+
+	// Check that every bone referenced is in the palette
+
+	for (int i = 0 ; i < vertexCount ; ++i) {
+		for (int k = 0 ; k < kMaxBonesPerVertex ; ++k) {
+			assert((k > 0 && vertexList[i].weight[k] == 0.0f) || vertexList[i].bone[k] < boneCount);
+		}
+	}
+
+#else
+	(void)boneCount;
+#endif
+
+	SkinJob	job;
+	job.src = vertexList;
+	job.palette = palette;
+	job.dst = dst;
+
+	parallelFor(vertexCount, kMinVerticesPerChunk, &skinRange, &job);
+}
+
+//---------------------------------------------------------------------------
+// SkinnedMesh::skin
+//
+// Deform the mesh by a dual quaternion palette.  See the notes at the top
+// of this file.
+
+void	SkinnedMesh::skin(const DualQuaternion *palette, int boneCount, RenderVertex *dst) const {
+
+	// Make sure we have something
+
+	if (vertexCount < 1) {
+		return;
+	}
+	assert(palette != NULL);
+	assert(dst != NULL);
+
+#ifdef _DEBUG
+
+	// Check that every bone referenced is in the palette
+
+	for (int i = 0 ; i < vertexCount ; ++i) {
+		for (int k = 0 ; k < kMaxBonesPerVertex ; ++k) {
+			assert((k > 0 && vertexList[i].weight[k] == 0.0f) || vertexList[i].bone[k] < boneCount);
+		}
+	}
+
+#else
+	(void)boneCount;
+#endif
+
+	DualQuaternionSkinJob	job;
+	job.src = vertexList;
+	job.palette = palette;
+	job.dst = dst;
+
+	parallelFor(vertexCount, kMinVerticesPerChunk, &dualQuaternionSkinRange, &job);
+}
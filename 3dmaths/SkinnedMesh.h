@@ -0,0 +1,110 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// SkinnedMesh.h - Vertex data for linear blend skinning
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see SkinnedMesh.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SKINNEDMESH_H_INCLUDED__
+#define __SKINNEDMESH_H_INCLUDED__
+
+#ifndef __RENDERER_H_INCLUDED__
+	#include "Renderer.h"
+#endif
+
+class TriMesh;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
+class DualQuaternion;
+
+// Maximum number of bones that can influence a single vertex
+
+const int	kMaxBonesPerVertex = 4;
+
+//---------------------------------------------------------------------------
+// struct SkinnedVertex
+//
+// A vertex in the bind pose, plus the bones that move it.  The weights
+// should sum to 1.  Unused influences have zero weight, and must come
+// after all the used ones.  (normalizeWeights() takes care of this.)
+
+struct SkinnedVertex {
+	RenderVertex	v;				// bind pose position, normal, and texture coordinates
+	unsigned short	bone[kMaxBonesPerVertex];	// index into the matrix palette
+	float		weight[kMaxBonesPerVertex];	// influence of each bone
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// SkinnedMesh
+//
+// The vertices of a mesh deformed by a skeleton.  The triangles and
+// everything else needed for rendering live in an ordinary TriMesh; each
+// frame, skin() writes the deformed vertices into the TriMesh vertex
+// list (or any other RenderVertex buffer.)
+//
+/////////////////////////////////////////////////////////////////////////////
+
+class SkinnedMesh {
+public:
+	SkinnedMesh();
+	~SkinnedMesh();
+
+	// Memory allocation
+
+	void	allocateMemory(int nVertexCount);
+	void	freeMemory();
+
+	// Mesh accessors
+
+	int		getVertexCount() const { return vertexCount; }
+	SkinnedVertex	*getVertexList() const { return vertexList; }
+
+	// Take the bind pose from a TriMesh.  Every vertex is attached
+	// to bone 0 with full weight; fill in the real influences afterwards.
+
+	void	fromTriMesh(const TriMesh &mesh);
+
+	// Scale the weights of each vertex to sum to 1, and sort the
+	// influences so the heaviest come first
+
+	void	normalizeWeights();
+
+	// Deform the mesh.  palette[i] is the matrix of bone i: its bind
+	// pose inverse concatenated with its current local-to-model
+	// transform.  Positions and normals are written to dst, which must
+	// have room for getVertexCount() vertices; texture coordinates are
+	// copied through.  Nothing is allocated.
+
+	void	skin(const Matrix4x3 *palette, int boneCount, RenderVertex *dst) const;
+
+	// Deform the mesh using dual quaternion skinning.  Same as above,
+	// but each bone is a rigid transform stored as a dual quaternion
+	// (see convertPalette() in DualQuaternion.h.)  Blending dual
+	// quaternions doesn't collapse the mesh around twisting joints the
+	// way blending matrices does, and the palette is a third smaller.
+
+	void	skin(const DualQuaternion *palette, int boneCount, RenderVertex *dst) const;
+
+protected:
+
+	// Mesh data
+
+	int		vertexCount;
+	SkinnedVertex	*vertexList;
+
+private:
+
+	// Not copyable
+
+	SkinnedMesh(const SkinnedMesh &);
+	SkinnedMesh &operator=(const SkinnedMesh &);
+};
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __SKINNEDMESH_H_INCLUDED__
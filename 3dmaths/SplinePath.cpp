@@ -0,0 +1,961 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// SplinePath.cpp - Cubic spline paths with constant speed playback
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include <vector>
+
+#include "SplinePath.h"
+#include "EulerAngles.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Both kinds of spline are stored the same way.  Catmull-Rom points are
+// converted to Bezier control points, and each Bezier segment is
+// converted to an ordinary cubic polynomial in t, one per axis.  A point
+// on the curve is then three Horner evaluations, which is the cheapest
+// way there is, and vectorizes nicely.
+//
+// Arc length has no closed form for a cubic, so the table is built
+// numerically.  Each segment is divided into kArcIntervalsPerSegment
+// intervals, and the length of each is integrated with five point
+// Gauss-Legendre quadrature, which is good to about float precision
+// for all but the most sharply bent pieces of curve.  The table stores
+// the parameter at evenly spaced distances, found by walking the
+// running total of the interval lengths and refining with Newton
+// steps, kept from running off by bisection.  At run time a distance is
+// converted to a parameter by indexing the table directly and
+// interpolating between two entries.  A straight lerp between entries
+// makes the speed jump at every entry, badly so on tight bends, so
+// each entry also stores the slope of the parameter, and a cubic
+// Hermite curve is used instead.  Where the curve almost comes to a
+// stop between two entries, such as at a corner with a tiny loop in
+// it, the error can still be a sizable fraction of the entry spacing,
+// and more entries is the only cure.  But only there: doubling the
+// whole table for one bad corner would make a path of a dozen segments
+// cost megabytes and milliseconds.  So the path is cut into
+// kTableCellsPerSegment evenly spaced cells per segment, each starting
+// out with one entry.  The error is measured halfway between each pair
+// of entries, where it's largest, and any cell where it's over the
+// tolerance has its entries doubled, and so on up to
+// kMaxEntriesPerCell.  The lookup is still direct: the distance gives
+// the cell, and the cell gives its first entry and how many there are.
+// If a cell is still over the tolerance at the limit, the error is kept
+// for getArcLengthError(), rather than quietly handing back a table
+// that doesn't do what was asked.
+//
+// The batch version does everything sideways except fetching the cells,
+// table entries and segments, which are four float groups gathered
+// straight into registers with simdGatherTranspose4().  With many paths
+// each lane gathers from its own path's table, and the numbers that
+// describe the table are gathered across the lanes the same way, so
+// the lookup is the same code either way.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kArcIntervalsPerSegment = 16;
+const int	kTableCellsPerSegment = 64;
+const int	kMaxEntriesPerCell = 64;
+const int	kFloatsPerArcEntry = 3;
+const float	kDefaultArcLengthTolerance = 1e-4f;
+const int	kMaxSolveSteps = 32;
+const double	kSolveTolerance = 1e-4;
+const int	kMinSamplesPerChunk = 4096;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Local utility stuff
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// Five point Gauss-Legendre quadrature on [-1, 1]
+
+static const double	kGaussNode[5] = {
+	-0.9061798459386640, -0.5384693101056831, 0.0, 0.5384693101056831, 0.9061798459386640
+};
+static const double	kGaussWeight[5] = {
+	0.2369268850561891, 0.4786286704993665, 0.5688888888888889, 0.4786286704993665, 0.2369268850561891
+};
+
+//---------------------------------------------------------------------------
+// evaluateSegment
+//
+// Position and derivative with respect to t of one segment
+
+static inline Vector3	evaluateSegment(const float *c, float t) {
+	return Vector3(
+		((c[0]*t + c[1])*t + c[2])*t + c[3],
+		((c[4]*t + c[5])*t + c[6])*t + c[7],
+		((c[8]*t + c[9])*t + c[10])*t + c[11]
+	);
+}
+
+static inline Vector3	evaluateSegmentVelocity(const float *c, float t) {
+	return Vector3(
+		(3.0f*c[0]*t + 2.0f*c[1])*t + c[2],
+		(3.0f*c[4]*t + 2.0f*c[5])*t + c[6],
+		(3.0f*c[8]*t + 2.0f*c[9])*t + c[10]
+	);
+}
+
+//---------------------------------------------------------------------------
+// segmentArcLength
+//
+// Length of one segment between t0 and t1, by Gauss-Legendre quadrature
+
+static double	segmentArcLength(const float *c, float t0, float t1) {
+	double	half = 0.5 * (t1 - t0);
+	double	mid = 0.5 * (t1 + t0);
+	double	sum = 0.0;
+	for (int i = 0 ; i < 5 ; ++i) {
+		Vector3	v = evaluateSegmentVelocity(c, (float)(mid + half*kGaussNode[i]));
+		sum += kGaussWeight[i] * sqrt((double)v.x*v.x + (double)v.y*v.y + (double)v.z*v.z);
+	}
+	return sum * half;
+}
+
+//---------------------------------------------------------------------------
+// locate
+//
+// Find the segment a parameter falls in, and the fraction t of the way
+// through it.  Out of range parameters are clamped, or wrapped around a
+// closed path.
+
+static inline const float	*locate(const float *coeff, int segmentCount, bool closed,
+	float u, float &t) {
+
+	if (closed) {
+		u -= floor(u / (float)segmentCount) * (float)segmentCount;
+	}
+	int	segment = (int)u;
+	if (u < 0.0f) {
+		segment = 0;
+		u = 0.0f;
+	} else if (segment >= segmentCount) {
+		segment = segmentCount - 1;
+		u = (u > (float)segmentCount) ? (float)segmentCount : u;
+	}
+	t = u - (float)segment;
+	return coeff + segment * SplinePath::kFloatsPerSegment;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class SplinePath member functions
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// SplinePath::SplinePath
+//
+// Constructor - an empty path
+
+SplinePath::SplinePath() {
+	segmentCount = 0;
+	closed = false;
+	coeff = NULL;
+	length = 0.0f;
+	distanceStep = 0.0f;
+	oneOverDistanceStep = 0.0f;
+	cellCount = 0;
+	arcCell = NULL;
+	tableSize = 0;
+	arcTable = NULL;
+	arcTolerance = kDefaultArcLengthTolerance;
+	arcError = 0.0f;
+	for (int i = 0 ; i < 8 ; ++i) {
+		batchConstant[i] = 0.0f;
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::~SplinePath
+//
+// Destructor - free the memory
+
+SplinePath::~SplinePath() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::freeMemory
+//
+// Free all memory, leaving an empty path
+
+void	SplinePath::freeMemory() {
+	delete [] coeff;
+	coeff = NULL;
+	delete [] arcCell;
+	arcCell = NULL;
+	delete [] arcTable;
+	arcTable = NULL;
+	segmentCount = 0;
+	closed = false;
+	length = 0.0f;
+	distanceStep = 0.0f;
+	oneOverDistanceStep = 0.0f;
+	cellCount = 0;
+	tableSize = 0;
+	arcError = 0.0f;
+	for (int i = 0 ; i < 8 ; ++i) {
+		batchConstant[i] = 0.0f;
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::allocateSegments
+//
+// Make room for n segments
+
+void	SplinePath::allocateSegments(int n) {
+	assert(n > 0);
+	freeMemory();
+	segmentCount = n;
+	coeff = new float[n * kFloatsPerSegment];
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::setSegmentBezier
+//
+// Convert one Bezier segment to polynomial form.  Expanding the Bernstein
+// polynomials and collecting powers of t gives
+//
+//	a = -b0 + 3b1 - 3b2 + b3
+//	b = 3b0 - 6b1 + 3b2
+//	c = -3b0 + 3b1
+//	d = b0
+
+void	SplinePath::setSegmentBezier(int segment, const Vector3 &b0, const Vector3 &b1,
+	const Vector3 &b2, const Vector3 &b3) {
+
+	float	*c = coeff + segment * kFloatsPerSegment;
+	const float	p0[3] = { b0.x, b0.y, b0.z };
+	const float	p1[3] = { b1.x, b1.y, b1.z };
+	const float	p2[3] = { b2.x, b2.y, b2.z };
+	const float	p3[3] = { b3.x, b3.y, b3.z };
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		c[axis*4 + 0] = -p0[axis] + 3.0f*p1[axis] - 3.0f*p2[axis] + p3[axis];
+		c[axis*4 + 1] = 3.0f*p0[axis] - 6.0f*p1[axis] + 3.0f*p2[axis];
+		c[axis*4 + 2] = -3.0f*p0[axis] + 3.0f*p1[axis];
+		c[axis*4 + 3] = p0[axis];
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::setupCatmullRom
+//
+// Setup from points the path passes through.  The tangent at each point
+// is half the vector from the previous point to the next, which in
+// Bezier form puts the control points a sixth of that away.  At the ends
+// of an open path, a phantom point is made by reflecting the neighbor.
+
+void	SplinePath::setupCatmullRom(const Vector3 *point, int count, bool closePath) {
+	assert(point != NULL);
+	assert(count >= 2);
+
+	allocateSegments(closePath ? count : count - 1);
+	closed = closePath;
+
+	for (int i = 0 ; i < segmentCount ; ++i) {
+		Vector3	p1 = point[i];
+		Vector3	p2 = point[(i + 1) % count];
+		Vector3	p0, p3;
+		if (closed) {
+			p0 = point[(i + count - 1) % count];
+			p3 = point[(i + 2) % count];
+		} else {
+			p0 = (i > 0) ? point[i - 1] : p1*2.0f - p2;
+			p3 = (i + 2 < count) ? point[i + 2] : p2*2.0f - p1;
+		}
+		setSegmentBezier(i, p1, p1 + (p2 - p0) / 6.0f, p2 - (p3 - p1) / 6.0f, p2);
+	}
+
+	buildArcLengthTable();
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::setupBezier
+//
+// Setup from Bezier control points, three per segment plus one
+
+void	SplinePath::setupBezier(const Vector3 *point, int count) {
+	assert(point != NULL);
+	assert(count >= 4 && (count - 1) % 3 == 0);
+
+	allocateSegments((count - 1) / 3);
+	for (int i = 0 ; i < segmentCount ; ++i) {
+		const Vector3	*b = point + i*3;
+		setSegmentBezier(i, b[0], b[1], b[2], b[3]);
+	}
+
+	// Closed if it ends where it starts
+
+	closed = (point[0] == point[count - 1]);
+
+	buildArcLengthTable();
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::setArcLengthTolerance
+//
+// Change the tolerance, rebuilding the table if there's a path
+
+void	SplinePath::setArcLengthTolerance(float tolerance) {
+	assert(tolerance > 0.0f);
+	arcTolerance = tolerance;
+	if (segmentCount > 0) {
+		buildArcLengthTable();
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::buildArcLengthTable
+//
+// Fill in the table of parameters at evenly spaced distances, doubling
+// the number of entries in each cell until it's accurate enough.  See the
+// notes at the top of the file.
+
+void	SplinePath::buildArcLengthTable() {
+	int	intervalCount = segmentCount * kArcIntervalsPerSegment;
+	float	dt = 1.0f / (float)kArcIntervalsPerSegment;
+
+	// Running total of the length at the end of each interval
+
+	std::vector<double>	total(intervalCount + 1);
+	total[0] = 0.0;
+	for (int j = 0 ; j < intervalCount ; ++j) {
+		const float	*c = coeff + (j / kArcIntervalsPerSegment) * kFloatsPerSegment;
+		float		t0 = (float)(j % kArcIntervalsPerSegment) * dt;
+		total[j + 1] = total[j] + segmentArcLength(c, t0, t0 + dt);
+	}
+	length = (float)total[intervalCount];
+
+	// Start from scratch, in case the path changed
+
+	delete [] arcCell;
+	arcCell = NULL;
+	delete [] arcTable;
+	arcTable = NULL;
+
+	cellCount = segmentCount * kTableCellsPerSegment;
+	std::vector<int>	cellEntries(cellCount, 1);
+	std::vector<float>	cellError(cellCount);
+	float	scale = length / (float)segmentCount;
+	float	tolerance = arcTolerance * scale;
+	for (;;) {
+		fillArcTable(&total[0], &cellEntries[0]);
+		if (length <= 0.0f) {
+			arcError = 0.0f;
+			break;
+		}
+		arcTableError(&total[0], &cellError[0]);
+
+		// Refine the cells that need it.  Refining a cell changes
+		// the slopes at its ends, so the next pass measures them all
+		// again.
+
+		bool	refined = false;
+		float	worst = 0.0f;
+		for (int i = 0 ; i < cellCount ; ++i) {
+			if (cellError[i] > tolerance && cellEntries[i] < kMaxEntriesPerCell) {
+				cellEntries[i] *= 2;
+				refined = true;
+			}
+			worst = fmax(worst, cellError[i]);
+		}
+		if (!refined) {
+			arcError = worst / scale;
+			break;
+		}
+	}
+
+	// What the batch version needs to find its way around the table
+
+	bool	wrap = closed && length > 0.0f;
+	batchConstant[0] = length;
+	batchConstant[1] = wrap ? 1.0f / length : 0.0f;
+	batchConstant[2] = oneOverDistanceStep;
+	batchConstant[3] = (float)(cellCount - 1);
+	batchConstant[4] = (float)segmentCount;
+	batchConstant[5] = 0.0f;
+	batchConstant[6] = 0.0f;
+	batchConstant[7] = 0.0f;
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::fillArcTable
+//
+// Build the table with cellEntries[i] entries in cell i, given the running
+// total of the interval lengths.  If there's already a table from the
+// last pass, the parameters it found are kept, and only the new entries
+// are solved for.
+
+void	SplinePath::fillArcTable(const double *total, const int *cellEntries) {
+	int	intervalCount = segmentCount * kArcIntervalsPerSegment;
+	float	dt = 1.0f / (float)kArcIntervalsPerSegment;
+
+	float	*lastCell = arcCell;
+	float	*lastTable = arcTable;
+	arcCell = new float[cellCount + 3];
+	tableSize = 1;
+	for (int i = 0 ; i < cellCount ; ++i) {
+		arcCell[i] = (float)(tableSize - 1);
+		tableSize += cellEntries[i];
+	}
+	for (int i = cellCount ; i < cellCount + 3 ; ++i) {
+		arcCell[i] = (float)(tableSize - 1);
+	}
+
+	arcTable = new float[tableSize * kFloatsPerArcEntry];
+
+	// A path with no length at all, such as all the points in the
+	// same place.  Any parameter is as good as any other.
+
+	if (length <= 0.0f) {
+		distanceStep = 0.0f;
+		oneOverDistanceStep = 0.0f;
+		for (int i = 0 ; i < tableSize * kFloatsPerArcEntry ; ++i) {
+			arcTable[i] = 0.0f;
+		}
+		delete [] lastCell;
+		delete [] lastTable;
+		return;
+	}
+
+	double	step = total[intervalCount] / (double)cellCount;
+	distanceStep = (float)step;
+	oneOverDistanceStep = 1.0f / distanceStep;
+
+	// The distance of each entry, the length of the piece from it to
+	// the next as a fraction of a cell, and which entry of the last
+	// table was at the same distance, if any
+
+	std::vector<double>	entryDistance(tableSize);
+	std::vector<float>	pieceLength(tableSize, 0.0f);
+	std::vector<int>	lastEntry(tableSize, -1);
+	int	e = 0;
+	for (int i = 0 ; i < cellCount ; ++i) {
+		int	n = cellEntries[i];
+		int	lastN = lastCell ? (int)lastCell[i + 1] - (int)lastCell[i] : 0;
+		for (int k = 0 ; k < n ; ++k) {
+			if (lastCell != NULL && (k * lastN) % n == 0) {
+				lastEntry[e] = (int)lastCell[i] + k * lastN / n;
+			}
+			pieceLength[e] = 1.0f / (float)n;
+			entryDistance[e++] = step * ((double)i + (double)k / (double)n);
+		}
+	}
+	entryDistance[e] = total[intervalCount];
+
+	int	j = 0;
+	for (int i = 0 ; i < tableSize ; ++i) {
+		double	d = entryDistance[i];
+		if (lastEntry[i] >= 0) {
+			arcTable[i*kFloatsPerArcEntry] = lastTable[lastEntry[i]*kFloatsPerArcEntry];
+			continue;
+		}
+
+		// Walk forward to the interval containing this distance
+
+		while (j < intervalCount - 1 && total[j + 1] < d) {
+			++j;
+		}
+
+		// Guess by lerping across the interval, then refine.  The
+		// derivative of the arc length with respect to t is just the
+		// speed.  Where the curve nearly stops, a Newton step can
+		// shoot far off, so we keep the interval the answer must be
+		// in, and bisect whenever a step would leave it.
+
+		const float	*c = coeff + (j / kArcIntervalsPerSegment) * kFloatsPerSegment;
+		float		t0 = (float)(j % kArcIntervalsPerSegment) * dt;
+		double		span = total[j + 1] - total[j];
+		float		t = t0 + ((span > 0.0) ? (float)((d - total[j]) / span) * dt : 0.0f);
+		float		lo = t0, hi = t0 + dt;
+		for (int iteration = 0 ; iteration < kMaxSolveSteps ; ++iteration) {
+			double	error = total[j] + segmentArcLength(c, t0, t) - d;
+			if (fabs(error) <= step * kSolveTolerance) {
+				break;
+			}
+			if (error > 0.0) hi = t; else lo = t;
+			double	speed = vectorMag(evaluateSegmentVelocity(c, t));
+			float	next = (speed > 0.0) ? t - (float)(error / speed) : lo;
+			if (!(next > lo && next < hi)) {
+				next = (lo + hi) * .5f;
+			}
+			if (next == t) {
+				break;
+			}
+			t = next;
+		}
+		arcTable[i*kFloatsPerArcEntry] = (float)(j / kArcIntervalsPerSegment) + t;
+	}
+
+	delete [] lastCell;
+	delete [] lastTable;
+
+	// Make sure the ends are exact
+
+	arcTable[0] = 0.0f;
+	arcTable[(tableSize - 1)*kFloatsPerArcEntry] = (float)segmentCount;
+
+	// The slope of the parameter with respect to distance is one over
+	// the speed, which we know exactly.  Where the curve nearly stops,
+	// such as at a tight corner, the slope is huge, and the cubic
+	// between the entries would overshoot.  So the slopes are limited
+	// to three times the neighboring secants, which keeps the
+	// interpolation monotonic (Fritsch and Carlson's condition.)  The
+	// slopes are worked out per cell, since the pieces on either side
+	// of an entry can be different lengths, and then each piece gets
+	// the slopes at its two ends scaled to its own length.
+
+	std::vector<float>	slope(tableSize);
+	for (int i = 0 ; i < tableSize ; ++i) {
+		float	u = arcTable[i*kFloatsPerArcEntry];
+		float	speed = vectorMag(getVelocity(u < (float)segmentCount ? u : (float)segmentCount));
+		float	limit = 1e30f;
+		if (i > 0) {
+			limit = 3.0f * (u - arcTable[(i - 1)*kFloatsPerArcEntry]) / pieceLength[i - 1];
+		}
+		if (i < tableSize - 1) {
+			float	next = 3.0f * (arcTable[(i + 1)*kFloatsPerArcEntry] - u) / pieceLength[i];
+			if (next < limit) limit = next;
+		}
+		slope[i] = (speed * limit > distanceStep) ? distanceStep / speed : limit;
+	}
+	for (int i = 0 ; i < tableSize ; ++i) {
+		float	*entry = arcTable + i*kFloatsPerArcEntry;
+		entry[1] = (i < tableSize - 1) ? slope[i] * pieceLength[i] : 0.0f;
+		entry[2] = (i < tableSize - 1) ? slope[i + 1] * pieceLength[i] : 0.0f;
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::arcTableError
+//
+// For each cell, the largest difference between a distance halfway
+// between two table entries, and the true distance to the parameter the
+// table gives for it.  That's where the Hermite curve is furthest from
+// its entries.
+
+void	SplinePath::arcTableError(const double *total, float *cellError) const {
+	float	dt = 1.0f / (float)kArcIntervalsPerSegment;
+	for (int i = 0 ; i < cellCount ; ++i) {
+		int	first = (int)arcCell[i];
+		int	n = (int)arcCell[i + 1] - first;
+		double	worst = 0.0;
+		for (int k = 0 ; k < n ; ++k) {
+			double	d = ((double)i + ((double)k + .5) / (double)n) * distanceStep;
+			float	t;
+			float	u = distanceToParameter((float)d);
+			const float	*c = locate(coeff, segmentCount, closed, u, t);
+			int	m = (int)(t * (float)kArcIntervalsPerSegment);
+			if (m > kArcIntervalsPerSegment - 1) {
+				m = kArcIntervalsPerSegment - 1;
+			}
+			int	j = (int)((c - coeff) / kFloatsPerSegment) * kArcIntervalsPerSegment + m;
+			double	s = total[j] + segmentArcLength(c, (float)m * dt, t);
+			worst = fmax(worst, fabs(s - d));
+		}
+		cellError[i] = (float)worst;
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::getPosition
+// SplinePath::getVelocity
+//
+// Evaluate by parameter
+
+Vector3	SplinePath::getPosition(float u) const {
+	assert(segmentCount > 0);
+	float		t;
+	const float	*c = locate(coeff, segmentCount, closed, u, t);
+	return evaluateSegment(c, t);
+}
+
+Vector3	SplinePath::getVelocity(float u) const {
+	assert(segmentCount > 0);
+	float		t;
+	const float	*c = locate(coeff, segmentCount, closed, u, t);
+	return evaluateSegmentVelocity(c, t);
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::wrapDistance
+//
+// Clamp a distance to the path, or wrap it around a closed path
+
+float	SplinePath::wrapDistance(float distance) const {
+	if (closed && length > 0.0f) {
+		distance -= floor(distance / length) * length;
+	}
+	if (distance < 0.0f) return 0.0f;
+	if (distance > length) return length;
+	return distance;
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::distanceToParameter
+//
+// Index the cell, then the entry within it, and interpolate between the
+// two nearest entries with the cubic Hermite curve that matches their
+// parameters and slopes
+
+float	SplinePath::distanceToParameter(float distance) const {
+	assert(segmentCount > 0);
+	float	f = wrapDistance(distance) * oneOverDistanceStep;
+	int	i = (int)f;
+	if (i > cellCount - 1) {
+		i = cellCount - 1;
+	}
+	f -= (float)i;
+
+	float	first = arcCell[i];
+	float	n = arcCell[i + 1] - first;
+	f *= n;
+	int	k = (int)f;
+	if (k > (int)n - 1) {
+		k = (int)n - 1;
+	}
+	f -= (float)k;
+
+	const float	*entry = arcTable + ((int)first + k)*kFloatsPerArcEntry;
+	float	u0 = entry[0];
+	float	m0 = entry[1];
+	float	m1 = entry[2];
+	float	delta = entry[3] - u0;
+	float	c2 = delta + delta + delta - m0 - m0 - m1;
+	float	c3 = m0 + m1 - delta - delta;
+	return u0 + ((c3*f + c2)*f + m0)*f;
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::getPositionAtDistance
+// SplinePath::getDirectionAtDistance
+//
+// Evaluate by distance
+
+Vector3	SplinePath::getPositionAtDistance(float distance) const {
+	return getPosition(distanceToParameter(distance));
+}
+
+Vector3	SplinePath::getDirectionAtDistance(float distance) const {
+	Vector3	v = getVelocity(distanceToParameter(distance));
+	v.normalize();
+	return v;
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::getCameraOrientation
+//
+// Heading and pitch that point the object's +z axis along the path.  The
+// forward vector of an object with heading h and pitch p, in upright
+// space, is
+//
+//	(sin h cos p, -sin p, cos h cos p)
+//
+// which we solve for h and p.  See 10.3.
+
+void	SplinePath::getCameraOrientation(float distance, EulerAngles &orientation) const {
+	Vector3	forward = getDirectionAtDistance(distance);
+
+	float	sp = -forward.y;
+	if (sp > 1.0f) sp = 1.0f;
+	if (sp < -1.0f) sp = -1.0f;
+
+	orientation.heading = atan2(forward.x, forward.z);
+	orientation.pitch = asin(sp);
+	orientation.bank = 0.0f;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch evaluation
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// SampleJob
+//
+// Parameters for a batch evaluation, passed to parallelFor.  Either one
+// path is used for every sample, or paths gives one per sample.
+
+struct SampleJob {
+	const SplinePath		*path;
+	const SplinePath *const		*paths;
+	const float			*distance;
+	Vector3				*position;
+};
+
+//---------------------------------------------------------------------------
+// evaluateLanes
+//
+// Evaluate the segments pointed to by c[] at t, one per lane, and write
+// n <= kSimdWidth results to position
+
+static inline void	evaluateLanes(const float *const *c, SimdFloat t, Vector3 *position, int n) {
+	SimdFloat	a, b, cc, d;
+	simdGatherTranspose4(c, 0, a, b, cc, d);
+	SimdFloat	x = simdMadd(simdMadd(simdMadd(a, t, b), t, cc), t, d);
+	simdGatherTranspose4(c, 4, a, b, cc, d);
+	SimdFloat	y = simdMadd(simdMadd(simdMadd(a, t, b), t, cc), t, d);
+	simdGatherTranspose4(c, 8, a, b, cc, d);
+	SimdFloat	z = simdMadd(simdMadd(simdMadd(a, t, b), t, cc), t, d);
+
+	if (n == kSimdWidth) {
+		simdScatter(&position->x, 3, x);
+		simdScatter(&position->y, 3, y);
+		simdScatter(&position->z, 3, z);
+	} else {
+		float	ox[kSimdMaxWidth], oy[kSimdMaxWidth], oz[kSimdMaxWidth];
+		simdStoreU(ox, x);
+		simdStoreU(oy, y);
+		simdStoreU(oz, z);
+		for (int lane = 0 ; lane < n ; ++lane) {
+			position[lane] = Vector3(ox[lane], oy[lane], oz[lane]);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// Lanes
+//
+// Where each lane's path keeps its table and segments, and the numbers
+// from SplinePath::getBatchConstants(), one lane each.  For one path it's
+// all the same path, set up once per range.  For many paths it's set up
+// for each block, with the numbers gathered across the lanes.
+
+struct Lanes {
+	const float	*arcCell[kSimdMaxWidth];
+	const float	*arcTable[kSimdMaxWidth];
+	const float	*coeff[kSimdMaxWidth];
+	bool		wrap;
+	SimdFloat	length;
+	SimdFloat	oneOverLength;
+	SimdFloat	oneOverDistanceStep;
+	SimdFloat	lastCell;
+	SimdFloat	segmentCount;
+
+	void	setLane(int lane, const SplinePath *path) {
+		arcCell[lane] = path->getArcCells();
+		arcTable[lane] = path->getArcTable();
+		coeff[lane] = path->getSegmentData(0);
+		wrap = wrap || path->getBatchConstants()[1] != 0.0f;
+	}
+
+	void	setConstants(const float *const *p) {
+		SimdFloat	unused0, unused1, unused2;
+		simdGatherTranspose4(p, 0, length, oneOverLength, oneOverDistanceStep, lastCell);
+		simdGatherTranspose4(p, 4, segmentCount, unused0, unused1, unused2);
+	}
+};
+
+//---------------------------------------------------------------------------
+// sampleLanes
+//
+// Evaluate one distance per lane, and write n <= kSimdWidth results to
+// position.  This is distanceToParameter() and getPosition() done
+// sideways; only the cells, table entries and segments are fetched one
+// lane at a time.
+
+static inline void	sampleLanes(const Lanes &k, SimdFloat d, Vector3 *position, int n) {
+
+	// Wrap or clamp the distance, and find the cell.  Open paths have
+	// one over the length set to zero, so wrapping leaves them alone,
+	// but the floor is slow without SSE4, so skip it if we can.
+
+	if (k.wrap) {
+		d = d - simdFloor(d * k.oneOverLength) * k.length;
+	}
+	d = simdMin(simdMax(d, simdZero()), k.length);
+	SimdFloat	f = d * k.oneOverDistanceStep;
+	SimdFloat	cell = simdMin(simdFloor(f), k.lastCell);
+	f = f - cell;
+
+	int		index[kSimdMaxWidth];
+	const float	*p[kSimdMaxWidth];
+	simdStoreInt(index, cell);
+	for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+		p[lane] = k.arcCell[lane] + index[lane];
+	}
+
+	// And the entry within the cell
+
+	SimdFloat	first, next, unused0, unused1;
+	simdGatherTranspose4(p, 0, first, next, unused0, unused1);
+	SimdFloat	entries = next - first;
+	f = f * entries;
+	SimdFloat	entry = simdMin(simdFloor(f), entries - simdSet1(1.0f));
+	f = f - entry;
+	simdStoreInt(index, first + entry);
+	for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+		p[lane] = k.arcTable[lane] + index[lane]*kFloatsPerArcEntry;
+	}
+
+	// Hermite interpolation between the entries.  The next entry's
+	// parameter comes right after this one's slopes.
+
+	SimdFloat	u0, m0, m1, u1;
+	simdGatherTranspose4(p, 0, u0, m0, m1, u1);
+	SimdFloat	delta = u1 - u0;
+	SimdFloat	c2 = delta + delta + delta - m0 - m0 - m1;
+	SimdFloat	c3 = m0 + m1 - delta - delta;
+	SimdFloat	u = simdMadd(simdMadd(simdMadd(c3, f, c2), f, m0), f, u0);
+
+	// Find the segment.  Like locate(), keep the parameter on the path,
+	// since rounding can take it just past the end.
+
+	u = simdMin(simdMax(u, simdZero()), k.segmentCount);
+	SimdFloat	segment = simdMin(simdFloor(u), k.segmentCount - simdSet1(1.0f));
+	SimdFloat	t = u - segment;
+	simdStoreInt(index, segment);
+	for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+		p[lane] = k.coeff[lane] + index[lane]*SplinePath::kFloatsPerSegment;
+	}
+	evaluateLanes(p, t, position, n);
+}
+
+//---------------------------------------------------------------------------
+// samplePathBlock
+//
+// Evaluate samples [i, i + n) of a job that uses one path, n <=
+// kSimdWidth
+
+static inline void	samplePathBlock(const SampleJob *job, const Lanes &k, int i, int n) {
+	SimdFloat	d;
+	if (n == kSimdWidth) {
+		d = simdLoadU(job->distance + i);
+	} else {
+		float	pad[kSimdMaxWidth];
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			pad[lane] = (lane < n) ? job->distance[i + lane] : 0.0f;
+		}
+		d = simdLoadU(pad);
+	}
+	sampleLanes(k, d, job->position + i, n);
+}
+
+//---------------------------------------------------------------------------
+// sampleManyBlock
+//
+// Evaluate samples [i, i + n) of a job with one path per sample, n <=
+// kSimdWidth.  The unused lanes repeat the first sample.
+
+static inline void	sampleManyBlock(const SampleJob *job, int i, int n) {
+	Lanes		k;
+	const float	*p[kSimdMaxWidth];
+	float		d[kSimdMaxWidth];
+	k.wrap = false;
+	for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+		int			j = i + ((lane < n) ? lane : 0);
+		const SplinePath	*path = job->paths[j];
+		k.setLane(lane, path);
+		p[lane] = path->getBatchConstants();
+		d[lane] = job->distance[j];
+	}
+	k.setConstants(p);
+	sampleLanes(k, simdLoadU(d), job->position + i, n);
+}
+
+//---------------------------------------------------------------------------
+// sampleRange
+//
+// Evaluate samples [begin, end) of a job
+
+static void	sampleRange(int begin, int end, void *context) {
+	const SampleJob *job = (const SampleJob *)context;
+
+	// Without SIMD, the floors and conversions of the sideways version
+	// cost more than they save
+
+	if (kSimdWidth == 1) {
+		for (int i = begin ; i < end ; ++i) {
+			const SplinePath *path = job->paths ? job->paths[i] : job->path;
+			job->position[i] = path->getPositionAtDistance(job->distance[i]);
+		}
+		return;
+	}
+
+	int	i = begin;
+	if (job->paths == NULL) {
+		Lanes		k;
+		const float	*p[kSimdMaxWidth];
+		k.wrap = false;
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			k.setLane(lane, job->path);
+			p[lane] = job->path->getBatchConstants();
+		}
+		k.setConstants(p);
+		for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+			samplePathBlock(job, k, i, kSimdWidth);
+		}
+		if (i < end) {
+			samplePathBlock(job, k, i, end - i);
+		}
+	} else {
+		for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+			sampleManyBlock(job, i, kSimdWidth);
+		}
+		if (i < end) {
+			sampleManyBlock(job, i, end - i);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// SplinePath::getPositionsAtDistance
+//
+// Many positions along one path
+
+void	SplinePath::getPositionsAtDistance(const float *distance, Vector3 *position, int count) const {
+	assert(segmentCount > 0);
+	assert(distance != NULL);
+	assert(position != NULL);
+
+	SampleJob	job;
+	job.path = this;
+	job.paths = NULL;
+	job.distance = distance;
+	job.position = position;
+	parallelFor(count, kMinSamplesPerChunk, &sampleRange, &job);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Global code
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// getPositionsAtDistance
+//
+// One position on each of many paths.  See SplinePath.h
+
+void	getPositionsAtDistance(const SplinePath *const *path, const float *distance,
+	Vector3 *position, int count) {
+
+	assert(path != NULL);
+	assert(distance != NULL);
+	assert(position != NULL);
+
+	SampleJob	job;
+	job.path = NULL;
+	job.paths = path;
+	job.distance = distance;
+	job.position = position;
+	parallelFor(count, kMinSamplesPerChunk, &sampleRange, &job);
+}
@@ -0,0 +1,196 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// SplinePath.h - Cubic spline paths with constant speed playback
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see SplinePath.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __SPLINEPATH_H_INCLUDED__
+#define __SPLINEPATH_H_INCLUDED__
+
+#ifndef __VECTOR3_H_INCLUDED__
+	#include "vector3.h"
+#endif
+
+class EulerAngles;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// SplinePath
+//
+// A path through space made of cubic segments, for flying cameras and
+// other objects along authored curves.  The path can be set up from
+// Catmull-Rom points, which it passes through, or from Bezier control
+// points.
+//
+// There are two ways to say where on the path you are:
+//
+// - The parameter u, in [0, getSegmentCount()].  The integer part picks
+//   the segment and the fraction is the position within it.  Equal steps
+//   in u are generally not equal distances, so an object moved along the
+//   path by u speeds up and slows down.
+//
+// - The distance along the path, in [0, getLength()].  Moving by equal
+//   distances gives constant speed.  This is what you almost always
+//   want.
+//
+// Distances are converted to u with a table built when the path is set
+// up, which is indexed directly by distance, so the lookup is constant
+// time with no searching.  The parts of the path around tight corners
+// get more entries, as many as it takes to meet setArcLengthTolerance().
+// Distances outside the path are clamped, or wrapped around if the path
+// is closed.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+class SplinePath {
+public:
+	SplinePath();
+	~SplinePath();
+
+	// Setup from Catmull-Rom points.  The path goes through all of
+	// them, with count - 1 segments, or count segments if
+	// closePath is true, in which case the last point joins back
+	// up with the first.  At least two points are needed.
+
+	void	setupCatmullRom(const Vector3 *point, int count, bool closePath = false);
+
+	// Setup from Bezier control points.  Segment i runs from point
+	// 3i to point 3i + 3, with the two points in between as the
+	// control points, so count must be 3n + 1 for n segments.
+
+	void	setupBezier(const Vector3 *point, int count);
+
+	// Free all memory, leaving an empty path
+
+	void	freeMemory();
+
+	// Accessors
+
+	int	getSegmentCount() const { return segmentCount; }
+	float	getLength() const { return length; }
+	bool	isClosed() const { return closed; }
+
+	// Evaluate by parameter
+
+	Vector3	getPosition(float u) const;
+	Vector3	getVelocity(float u) const;	// dp/du
+
+	// Convert a distance along the path to a parameter
+
+	float	distanceToParameter(float distance) const;
+
+	// Evaluate by distance.  The direction is a unit vector
+	// along the path.
+
+	Vector3	getPositionAtDistance(float distance) const;
+	Vector3	getDirectionAtDistance(float distance) const;
+
+	// The orientation of a camera at a distance along the path,
+	// looking along it, with no bank.  Pass this with
+	// getPositionAtDistance() to Renderer::setCamera().
+
+	void	getCameraOrientation(float distance, EulerAngles &orientation) const;
+
+	// Evaluate many positions along the path at once.  Uses SIMD, and
+	// large arrays are split across the worker threads.
+
+	void	getPositionsAtDistance(const float *distance, Vector3 *position, int count) const;
+
+	// Data used by the batch evaluation.  Each segment is stored as
+	// the polynomial p(t) = ((a t + b) t + c) t + d, t in [0, 1], as
+	// twelve floats: the a, b, c and d of x, then of y, then of z.
+	// The arc length table is described below.
+
+	enum { kFloatsPerSegment = 12 };
+
+	const float	*getSegmentData(int segment) const { return coeff + segment * kFloatsPerSegment; }
+	const float	*getArcTable() const { return arcTable; }
+	int		getArcTableSize() const { return tableSize; }
+	const float	*getArcCells() const { return arcCell; }
+	int		getArcCellCount() const { return cellCount; }
+	float		getDistanceStep() const { return distanceStep; }
+
+	// The numbers the batch evaluation needs to use the table, eight
+	// floats so they can be gathered into registers: the length, one
+	// over the length if the path is closed or else zero, one over the
+	// distance step, the last cell, and the number of segments, then
+	// padding.
+
+	const float	*getBatchConstants() const { return batchConstant; }
+
+	// How closely the table has to follow the true arc length.  Entries
+	// are added until the distance error is under the tolerance times
+	// the average segment length, within a limit.  The default is 1e-4.
+	// Tight camera paths that need smoother motion can ask for less.
+	//
+	// getArcLengthError() is the error the table ended up with, measured
+	// the same way.  It's only over the tolerance if part of the path
+	// needed more entries than the limit allows.
+
+	void		setArcLengthTolerance(float tolerance);
+	float		getArcLengthTolerance() const { return arcTolerance; }
+	float		getArcLengthError() const { return arcError; }
+
+protected:
+
+	void	allocateSegments(int n);
+	void	setSegmentBezier(int segment, const Vector3 &b0, const Vector3 &b1,
+			const Vector3 &b2, const Vector3 &b3);
+	void	buildArcLengthTable();
+	void	fillArcTable(const double *total, const int *cellEntries);
+	void	arcTableError(const double *total, float *cellError) const;
+	float	wrapDistance(float distance) const;
+
+	int	segmentCount;
+	bool	closed;
+	float	*coeff;		// kFloatsPerSegment per segment
+
+	// Arc length table.  The path is cut into cells distanceStep long,
+	// and each cell into a power of two number of pieces, with an entry
+	// at the start of each piece.  Cell i's entries start at entry
+	// arcCell[i], and run up to where cell i + 1's start.  These are
+	// floats so the batch version can gather them, and there are three
+	// more past the last cell so it can always read four.  Each entry
+	// is three floats: the parameter at its distance, and the
+	// derivatives with respect to distance at the start and end of the
+	// piece that follows, times the length of the piece.  The last entry
+	// is at the end of the path, with no piece after it.
+
+	float	length;
+	float	distanceStep;
+	float	oneOverDistanceStep;
+	int	cellCount;
+	float	*arcCell;
+	int	tableSize;
+	float	*arcTable;
+	float	arcTolerance;
+	float	arcError;
+	float	batchConstant[8];
+
+private:
+
+	// Not copyable
+
+	SplinePath(const SplinePath &);
+	SplinePath &operator=(const SplinePath &);
+};
+
+//---------------------------------------------------------------------------
+// Sample many paths at once
+//
+// position[i] is the position on path[i] at distance[i].  Several paths
+// are evaluated at a time using SIMD, and large arrays are split across
+// the worker threads.  Useful for crowds of objects following their own
+// paths.
+
+void	getPositionsAtDistance(const SplinePath *const *path, const float *distance,
+		Vector3 *position, int count);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __SPLINEPATH_H_INCLUDED__
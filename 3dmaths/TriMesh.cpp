@@ -16,6 +16,7 @@
 #include "TriMesh.h"
 #include "Renderer.h"
 #include "EditTriMesh.h"
+#include "Matrix4x3Batch.h"
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -121,6 +122,34 @@ void	TriMesh::computeBoundingBox() {
 	}
 }
 
+//---------------------------------------------------------------------------
+// TriMesh::transformVertices
+//
+// Transform the vertex list in place.  Positions and normals are
+// transformed right inside the RenderVertex structures, using the batch
+// transforms.  Normals are transformed by the inverse transpose, so this
+// works for any affine transform, not just rigid ones.
+
+void	TriMesh::transformVertices(const Matrix4x3 &m) {
+
+	// Make sure we have something
+
+	if (vertexCount < 1) {
+		return;
+	}
+
+	// Transform positions and normals
+
+	transformPoints(m, &vertexList[0].p, &vertexList[0].p, vertexCount,
+		sizeof(RenderVertex), sizeof(RenderVertex));
+	transformNormals(m, &vertexList[0].n, &vertexList[0].n, vertexCount,
+		sizeof(RenderVertex), sizeof(RenderVertex));
+
+	// Bounds have changed
+
+	computeBoundingBox();
+}
+
 //---------------------------------------------------------------------------
 // TriMesh::fromEditMesh
 //
@@ -19,6 +19,8 @@
 struct RenderVertex;
 struct RenderTri;
 class EditTriMesh;
+template <class T> class TMatrix4x3;
+typedef TMatrix4x3<float> Matrix4x3;
 
 /////////////////////////////////////////////////////////////////////////////
 //
@@ -54,6 +56,11 @@ public:
 	void		computeBoundingBox();
 	const AABB3	&getBoundingBox() const { return boundingBox; }
 
+	// Transform the vertex positions and normals in place.  The
+	// bounding box is recomputed
+
+	void	transformVertices(const Matrix4x3 &m);
+
 	// Conversion to/from an "edit" mesh.  Note that this class
 	// doesn't know anything about parts or materials, so the
 	// conversion is not an exact translation.
@@ -0,0 +1,496 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Vector3Array.cpp - Implementation of class Vector3Array
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <assert.h>
+#include <string.h>
+
+#include "Vector3Array.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Each kernel is written twice: a SIMD loop that handles kSimdWidth
+// vectors per iteration, and the plain scalar loop that mops up the last
+// few.  The scalar code is exactly what the Vector3 operators do, so the
+// results for the tail match what the old one-at-a-time code computed.
+// The exception is normalize(), whose SIMD reciprocal square root only
+// matches 1/sqrt to within a few ulps, so its tail goes through the SIMD
+// code too.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class Vector3Array members
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// Vector3Array::Vector3Array
+//
+// Constructors
+
+Vector3Array::Vector3Array() {
+	x = y = z = NULL;
+	vCount = vAlloc = 0;
+}
+
+Vector3Array::Vector3Array(int n) {
+	x = y = z = NULL;
+	vCount = vAlloc = 0;
+	resize(n);
+}
+
+Vector3Array::Vector3Array(const Vector3Array &a) {
+	x = y = z = NULL;
+	vCount = vAlloc = 0;
+	*this = a;
+}
+
+//---------------------------------------------------------------------------
+// Vector3Array::~Vector3Array
+//
+// Destructor - make sure resources are freed
+
+Vector3Array::~Vector3Array() {
+	freeMemory();
+}
+
+//---------------------------------------------------------------------------
+// Vector3Array::operator=
+//
+// Make a copy of the array
+
+Vector3Array &Vector3Array::operator=(const Vector3Array &a) {
+
+	// Check for assignment to self
+
+	if (&a == this) {
+		return *this;
+	}
+
+	// Copy the lanes
+
+	resize(a.vCount);
+	memcpy(x, a.x, vCount * sizeof(float));
+	memcpy(y, a.y, vCount * sizeof(float));
+	memcpy(z, a.z, vCount * sizeof(float));
+
+	// Return reference to l-value
+
+	return *this;
+}
+
+//---------------------------------------------------------------------------
+// Vector3Array::resize
+//
+// Set the number of vectors in the array.  The lanes are only reallocated
+// if they grow beyond the current capacity.
+
+void	Vector3Array::resize(int n) {
+	assert(n >= 0);
+
+	// Do we have room?
+
+	if (n > vAlloc) {
+
+		// Allocate all three lanes in one block, so they
+		// are close together in memory
+
+		int	newAlloc = simdPadCount(n);
+		float	*block = (float *)alignedAlloc(newAlloc * 3 * sizeof(float));
+		assert(block != NULL);
+
+		// Copy over the old values
+
+		if (vCount > 0) {
+			memcpy(block, x, vCount * sizeof(float));
+			memcpy(block + newAlloc, y, vCount * sizeof(float));
+			memcpy(block + newAlloc*2, z, vCount * sizeof(float));
+		}
+
+		// Install new lanes
+
+		alignedFree(x);
+		x = block;
+		y = block + newAlloc;
+		z = block + newAlloc*2;
+		vAlloc = newAlloc;
+	}
+
+	vCount = n;
+}
+
+//---------------------------------------------------------------------------
+// Vector3Array::freeMemory
+//
+// Free up any memory and reset object to default state
+
+void	Vector3Array::freeMemory() {
+	alignedFree(x);
+	x = y = z = NULL;
+	vCount = vAlloc = 0;
+}
+
+//---------------------------------------------------------------------------
+// Vector3Array::gather
+//
+// Load the array from n Vector3's, which may be embedded in a larger
+// structure.  For example, to gather the positions out of a list of
+// RenderVertex:
+//
+//	a.gather(&vertexList[0].p, vertexCount, sizeof(RenderVertex));
+
+void	Vector3Array::gather(const Vector3 *src, int n, int strideInBytes) {
+	resize(n);
+
+	const char *s = (const char *)src;
+	for (int i = 0 ; i < n ; ++i) {
+		const Vector3 *v = (const Vector3 *)s;
+		x[i] = v->x;
+		y[i] = v->y;
+		z[i] = v->z;
+		s += strideInBytes;
+	}
+}
+
+//---------------------------------------------------------------------------
+// Vector3Array::scatter
+//
+// Store the array out to count() Vector3's.  See gather() for an example
+// of how to use the stride.
+
+void	Vector3Array::scatter(Vector3 *dst, int strideInBytes) const {
+	char *d = (char *)dst;
+	for (int i = 0 ; i < vCount ; ++i) {
+		Vector3 *v = (Vector3 *)d;
+		v->x = x[i];
+		v->y = y[i];
+		v->z = z[i];
+		d += strideInBytes;
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch kernels
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// add
+// subtract
+// scale
+//
+// Componentwise arithmetic
+
+void	add(Vector3Array &result, const Vector3Array &a, const Vector3Array &b) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		simdStore(result.x + i, simdLoad(a.x + i) + simdLoad(b.x + i));
+		simdStore(result.y + i, simdLoad(a.y + i) + simdLoad(b.y + i));
+		simdStore(result.z + i, simdLoad(a.z + i) + simdLoad(b.z + i));
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] + b.x[i];
+		result.y[i] = a.y[i] + b.y[i];
+		result.z[i] = a.z[i] + b.z[i];
+	}
+}
+
+void	subtract(Vector3Array &result, const Vector3Array &a, const Vector3Array &b) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		simdStore(result.x + i, simdLoad(a.x + i) - simdLoad(b.x + i));
+		simdStore(result.y + i, simdLoad(a.y + i) - simdLoad(b.y + i));
+		simdStore(result.z + i, simdLoad(a.z + i) - simdLoad(b.z + i));
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] - b.x[i];
+		result.y[i] = a.y[i] - b.y[i];
+		result.z[i] = a.z[i] - b.z[i];
+	}
+}
+
+void	scale(Vector3Array &result, const Vector3Array &a, float k) {
+	int	n = a.count();
+	result.resize(n);
+
+	SimdFloat	kk = simdSet1(k);
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		simdStore(result.x + i, simdLoad(a.x + i) * kk);
+		simdStore(result.y + i, simdLoad(a.y + i) * kk);
+		simdStore(result.z + i, simdLoad(a.z + i) * kk);
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] * k;
+		result.y[i] = a.y[i] * k;
+		result.z[i] = a.z[i] * k;
+	}
+}
+
+//---------------------------------------------------------------------------
+// madd
+// lerp
+//
+// Fused multiply-add and linear interpolation.  Each output component is
+// a single simdMadd, so there are no intermediate arrays.  The scalar
+// per-element factors are loaded unaligned, since they can come from
+// anywhere.
+
+void	madd(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, float k) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	SimdFloat	kk = simdSet1(k);
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		simdStore(result.x + i, simdMadd(simdLoad(b.x + i), kk, simdLoad(a.x + i)));
+		simdStore(result.y + i, simdMadd(simdLoad(b.y + i), kk, simdLoad(a.y + i)));
+		simdStore(result.z + i, simdMadd(simdLoad(b.z + i), kk, simdLoad(a.z + i)));
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] + b.x[i]*k;
+		result.y[i] = a.y[i] + b.y[i]*k;
+		result.z[i] = a.z[i] + b.z[i]*k;
+	}
+}
+
+void	madd(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, const float *k) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	kk = simdLoadU(k + i);
+		simdStore(result.x + i, simdMadd(simdLoad(b.x + i), kk, simdLoad(a.x + i)));
+		simdStore(result.y + i, simdMadd(simdLoad(b.y + i), kk, simdLoad(a.y + i)));
+		simdStore(result.z + i, simdMadd(simdLoad(b.z + i), kk, simdLoad(a.z + i)));
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] + b.x[i]*k[i];
+		result.y[i] = a.y[i] + b.y[i]*k[i];
+		result.z[i] = a.z[i] + b.z[i]*k[i];
+	}
+}
+
+void	lerp(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, float t) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	SimdFloat	tt = simdSet1(t);
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	ax = simdLoad(a.x + i), ay = simdLoad(a.y + i), az = simdLoad(a.z + i);
+		simdStore(result.x + i, simdMadd(simdLoad(b.x + i) - ax, tt, ax));
+		simdStore(result.y + i, simdMadd(simdLoad(b.y + i) - ay, tt, ay));
+		simdStore(result.z + i, simdMadd(simdLoad(b.z + i) - az, tt, az));
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] + (b.x[i] - a.x[i])*t;
+		result.y[i] = a.y[i] + (b.y[i] - a.y[i])*t;
+		result.z[i] = a.z[i] + (b.z[i] - a.z[i])*t;
+	}
+}
+
+void	lerp(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, const float *t) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	tt = simdLoadU(t + i);
+		SimdFloat	ax = simdLoad(a.x + i), ay = simdLoad(a.y + i), az = simdLoad(a.z + i);
+		simdStore(result.x + i, simdMadd(simdLoad(b.x + i) - ax, tt, ax));
+		simdStore(result.y + i, simdMadd(simdLoad(b.y + i) - ay, tt, ay));
+		simdStore(result.z + i, simdMadd(simdLoad(b.z + i) - az, tt, az));
+	}
+	for ( ; i < n ; ++i) {
+		result.x[i] = a.x[i] + (b.x[i] - a.x[i])*t[i];
+		result.y[i] = a.y[i] + (b.y[i] - a.y[i])*t[i];
+		result.z[i] = a.z[i] + (b.z[i] - a.z[i])*t[i];
+	}
+}
+
+//---------------------------------------------------------------------------
+// dotProduct
+//
+// Dot product of each pair of vectors
+
+void	dotProduct(float *result, const Vector3Array &a, const Vector3Array &b) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	d = simdLoad(a.x + i) * simdLoad(b.x + i);
+		d = simdMadd(simdLoad(a.y + i), simdLoad(b.y + i), d);
+		d = simdMadd(simdLoad(a.z + i), simdLoad(b.z + i), d);
+		simdStoreU(result + i, d);
+	}
+	for ( ; i < n ; ++i) {
+		result[i] = a.x[i]*b.x[i] + a.y[i]*b.y[i] + a.z[i]*b.z[i];
+	}
+}
+
+//---------------------------------------------------------------------------
+// crossProduct
+//
+// Cross product of each pair of vectors.  We load all the inputs into
+// registers before storing, so the result may alias either input.
+
+void	crossProduct(Vector3Array &result, const Vector3Array &a, const Vector3Array &b) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+	result.resize(n);
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	ax = simdLoad(a.x + i), ay = simdLoad(a.y + i), az = simdLoad(a.z + i);
+		SimdFloat	bx = simdLoad(b.x + i), by = simdLoad(b.y + i), bz = simdLoad(b.z + i);
+		simdStore(result.x + i, ay*bz - az*by);
+		simdStore(result.y + i, az*bx - ax*bz);
+		simdStore(result.z + i, ax*by - ay*bx);
+	}
+	for ( ; i < n ; ++i) {
+		float	ax = a.x[i], ay = a.y[i], az = a.z[i];
+		float	bx = b.x[i], by = b.y[i], bz = b.z[i];
+		result.x[i] = ay*bz - az*by;
+		result.y[i] = az*bx - ax*bz;
+		result.z[i] = ax*by - ay*bx;
+	}
+}
+
+//---------------------------------------------------------------------------
+// normalize
+//
+// Normalize each vector.  Zero vectors are detected and left as they
+// are, so there is no divide by zero.
+//
+// simdRsqrt() doesn't round the same as 1/sqrt, so rather than a scalar
+// tail, the last few vectors are copied into a zero padded block and
+// normalized the same way as the rest.  Otherwise a vector's result
+// would depend on where in the array it happened to be.
+
+static inline void	normalizeBlock(float *x, float *y, float *z) {
+	SimdFloat	vx = simdLoad(x), vy = simdLoad(y), vz = simdLoad(z);
+	SimdFloat	magSq = vx*vx + vy*vy + vz*vz;
+
+	// Lanes with zero length get a scale of 1
+
+	SimdMask	ok = magSq > simdZero();
+	SimdFloat	oneOverMag = simdSelect(ok, simdRsqrt(magSq), simdSet1(1.0f));
+
+	simdStore(x, vx * oneOverMag);
+	simdStore(y, vy * oneOverMag);
+	simdStore(z, vz * oneOverMag);
+}
+
+void	normalize(Vector3Array &a) {
+	int	n = a.count();
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		normalizeBlock(a.x + i, a.y + i, a.z + i);
+	}
+	if (i < n) {
+		alignas(kSimdAlignment) float	tx[kSimdMaxWidth], ty[kSimdMaxWidth], tz[kSimdMaxWidth];
+		for (int lane = 0 ; lane < kSimdWidth ; ++lane) {
+			bool	used = i + lane < n;
+			tx[lane] = used ? a.x[i + lane] : 0.0f;
+			ty[lane] = used ? a.y[i + lane] : 0.0f;
+			tz[lane] = used ? a.z[i + lane] : 0.0f;
+		}
+		normalizeBlock(tx, ty, tz);
+		for (int lane = 0 ; i + lane < n ; ++lane) {
+			a.x[i + lane] = tx[lane];
+			a.y[i + lane] = ty[lane];
+			a.z[i + lane] = tz[lane];
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// vectorMag
+//
+// Magnitude of each vector
+
+void	vectorMag(float *result, const Vector3Array &a) {
+	int	n = a.count();
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	vx = simdLoad(a.x + i), vy = simdLoad(a.y + i), vz = simdLoad(a.z + i);
+		simdStoreU(result + i, simdSqrt(vx*vx + vy*vy + vz*vz));
+	}
+	for ( ; i < n ; ++i) {
+		result[i] = (float)sqrt(a.x[i]*a.x[i] + a.y[i]*a.y[i] + a.z[i]*a.z[i]);
+	}
+}
+
+//---------------------------------------------------------------------------
+// distanceSquared
+// distance
+//
+// Distance between each pair of points.  Use the squared version where
+// you can, since it avoids the square root.
+
+void	distanceSquared(float *result, const Vector3Array &a, const Vector3Array &b) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	dx = simdLoad(a.x + i) - simdLoad(b.x + i);
+		SimdFloat	dy = simdLoad(a.y + i) - simdLoad(b.y + i);
+		SimdFloat	dz = simdLoad(a.z + i) - simdLoad(b.z + i);
+		simdStoreU(result + i, dx*dx + dy*dy + dz*dz);
+	}
+	for ( ; i < n ; ++i) {
+		float	dx = a.x[i] - b.x[i];
+		float	dy = a.y[i] - b.y[i];
+		float	dz = a.z[i] - b.z[i];
+		result[i] = dx*dx + dy*dy + dz*dz;
+	}
+}
+
+void	distance(float *result, const Vector3Array &a, const Vector3Array &b) {
+	assert(a.count() == b.count());
+	int	n = a.count();
+
+	int	i = 0;
+	for ( ; i + kSimdWidth <= n ; i += kSimdWidth) {
+		SimdFloat	dx = simdLoad(a.x + i) - simdLoad(b.x + i);
+		SimdFloat	dy = simdLoad(a.y + i) - simdLoad(b.y + i);
+		SimdFloat	dz = simdLoad(a.z + i) - simdLoad(b.z + i);
+		simdStoreU(result + i, simdSqrt(dx*dx + dy*dy + dz*dz));
+	}
+	for ( ; i < n ; ++i) {
+		float	dx = a.x[i] - b.x[i];
+		float	dy = a.y[i] - b.y[i];
+		float	dz = a.z[i] - b.z[i];
+		result[i] = (float)sqrt(dx*dx + dy*dy + dz*dz);
+	}
+}
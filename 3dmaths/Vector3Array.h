@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Vector3Array.h - Declarations for class Vector3Array
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see Vector3Array.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VECTOR3ARRAY_H_INCLUDED__
+#define __VECTOR3ARRAY_H_INCLUDED__
+
+#ifndef __VECTOR3_H_INCLUDED__
+	#include "vector3.h"
+#endif
+
+//---------------------------------------------------------------------------
+// class Vector3Array
+//
+// A list of 3D vectors stored as a "structure of arrays."  Rather than
+// storing x,y,z,x,y,z,... like an array of Vector3, we keep three
+// seperate lanes x,x,x,..., y,y,y,..., z,z,z,...  This is the layout
+// the SIMD batch kernels want, since one register load fetches the same
+// component from several vectors at once.
+//
+// Each lane is aligned and padded to a multiple of kSimdMaxWidth floats.
+
+class Vector3Array {
+public:
+
+// Public data
+
+	// The component lanes.  Left public so that other batch
+	// kernels may stream over them directly
+
+	float	*x;
+	float	*y;
+	float	*z;
+
+// Standard class object maintenance
+
+	Vector3Array();
+	explicit Vector3Array(int n);
+	Vector3Array(const Vector3Array &a);
+	~Vector3Array();
+
+	Vector3Array &operator=(const Vector3Array &a);
+
+// Size
+
+	int	count() const { return vCount; }
+
+	// Set the number of vectors.  Existing values are preserved,
+	// new entries are uninitialized
+
+	void	resize(int n);
+
+	// Free all memory and reset to empty
+
+	void	freeMemory();
+
+// Element access.  Handy, but slow - don't use this in inner loops
+
+	Vector3	get(int i) const { return Vector3(x[i], y[i], z[i]); }
+	void	set(int i, const Vector3 &v) { x[i] = v.x; y[i] = v.y; z[i] = v.z; }
+
+// Conversion to/from an array of Vector3.  The source/destination may be
+// embedded in larger structures, such as RenderVertex::p, in which case
+// pass the size of the structure as the stride.  The data is transposed
+// directly between the two layouts, without any temporary buffer.
+
+	void	gather(const Vector3 *src, int n, int strideInBytes = sizeof(Vector3));
+	void	scatter(Vector3 *dst, int strideInBytes = sizeof(Vector3)) const;
+
+// Private representation
+
+private:
+	int	vCount;
+	int	vAlloc;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Batch kernels.  These are the array versions of the Vector3 operators
+// and nonmember functions.  Output arrays are resized to match the input,
+// and may be the same object as one of the inputs.  Inputs must be the
+// same length.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+// result[i] = a[i] + b[i]
+
+void	add(Vector3Array &result, const Vector3Array &a, const Vector3Array &b);
+
+// result[i] = a[i] - b[i]
+
+void	subtract(Vector3Array &result, const Vector3Array &a, const Vector3Array &b);
+
+// result[i] = a[i] * k
+
+void	scale(Vector3Array &result, const Vector3Array &a, float k);
+
+// Fused versions of the chains above, done in one pass over the data.
+// result[i] = a[i] + b[i]*k, and result[i] = a[i] + b[i]*k[i]
+
+void	madd(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, float k);
+void	madd(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, const float *k);
+
+// result[i] = lerp(a[i], b[i], t), and lerp(a[i], b[i], t[i])
+
+void	lerp(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, float t);
+void	lerp(Vector3Array &result, const Vector3Array &a, const Vector3Array &b, const float *t);
+
+// result[i] = a[i] * b[i].  result must have room for a.count() floats
+
+void	dotProduct(float *result, const Vector3Array &a, const Vector3Array &b);
+
+// result[i] = crossProduct(a[i], b[i])
+
+void	crossProduct(Vector3Array &result, const Vector3Array &a, const Vector3Array &b);
+
+// Normalize each vector in place.  Zero vectors are left alone, just
+// like Vector3::normalize()
+
+void	normalize(Vector3Array &a);
+
+// Vector magnitude, and point-point distances
+
+void	vectorMag(float *result, const Vector3Array &a);
+void	distance(float *result, const Vector3Array &a, const Vector3Array &b);
+void	distanceSquared(float *result, const Vector3Array &a, const Vector3Array &b);
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __VECTOR3ARRAY_H_INCLUDED__
@@ -0,0 +1,584 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// VertexStream.h - Strided views of vertex arrays, and the transform,
+// bounds, lighting and projection kernels that run over them
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __VERTEXSTREAM_H_INCLUDED__
+#define __VERTEXSTREAM_H_INCLUDED__
+
+#include <assert.h>
+
+#include <atomic>
+
+#ifndef __AABB3_H_INCLUDED__
+	#include "AABB3.h"
+#endif
+
+#ifndef __MATRIX4X3BATCH_H_INCLUDED__
+	#include "Matrix4x3Batch.h"
+#endif
+
+#ifndef __RENDERER_H_INCLUDED__
+	#include "Renderer.h"
+#endif
+
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Every vertex format has a position, and most have a normal or a color,
+// but each at a different offset and stride: RenderVertex is 32 bytes,
+// RenderVertexL 24, RenderVertexTL 28, and EditTriMesh::Vertex something
+// else again.  The kernels in Matrix4x3Batch.h take the stride as an
+// argument, so one compiled loop serves them all, but it has to multiply
+// by the stride at runtime and can't see how the gathers line up.
+//
+// Here the stride is a template parameter instead.  A VertexStream is
+// just a pointer to the first element and a count; the stride is part of
+// the type, taken from sizeof() the vertex structure, so the compiler
+// generates a loop for each vertex format with the gather offsets folded
+// into the addressing.  Nothing is copied into temporary arrays.
+//
+// The kernels follow the usual pattern: kSimdWidth vertices at a time
+// gathered "sideways" into registers, the last few done one at a time,
+// and large arrays split across the worker threads.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMinStreamVerticesPerChunk = 8192;
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// class VertexStream
+//
+// A view of count values of type T, each kStride bytes after the last.
+// T is usually Vector3, or const Vector3 for a stream that is only read.
+// The view doesn't own anything.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+template <class T, int kStride>
+class VertexStream {
+public:
+
+	// The kernels access the elements as floats
+
+	static_assert(kStride % sizeof(float) == 0, "stride must be a whole number of floats");
+	static_assert(kStride >= (int)sizeof(T), "elements can't overlap");
+
+	enum { kStrideInFloats = kStride / sizeof(float) };
+
+	VertexStream(T *first, int count) : first(first), count(count) {}
+
+	// A read-only view of a writable stream
+
+	template <class U>
+	VertexStream(const VertexStream<U, kStride> &s) : first(s.first), count(s.count) {}
+
+	T	&operator[](int i) const { return *(T *)((const char *)first + (size_t)i * kStride); }
+
+	// Pointer to the first float of element i
+
+	const float	*floatPtr(int i) const { return (const float *)&(*this)[i]; }
+	float		*floatPtr(int i) { return (float *)&(*this)[i]; }
+
+	T	*first;
+	int	count;
+};
+
+//---------------------------------------------------------------------------
+// vertexStream
+//
+// Make a stream over one member of an array of vertices, with the stride
+// taken from the vertex structure.  For example:
+//
+//	vertexStream(vertexList, &RenderVertex::p, vertexCount)
+//	vertexStream(&mesh.vertex(0), &EditTriMesh::Vertex::normal, mesh.vertexCount())
+//
+// A const array of vertices gives a read-only stream.
+
+template <class Vertex, class T>
+inline VertexStream<T, sizeof(Vertex)>	vertexStream(Vertex *v, T Vertex::*member, int count) {
+	return VertexStream<T, sizeof(Vertex)>(&(v->*member), count);
+}
+
+template <class Vertex, class T>
+inline VertexStream<const T, sizeof(Vertex)>	vertexStream(const Vertex *v, T Vertex::*member, int count) {
+	return VertexStream<const T, sizeof(Vertex)>(&(v->*member), count);
+}
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// struct StreamProjection
+//
+// What projectPoints() needs to know about the camera and the window.
+// These are the same numbers the Renderer uses; see Section 15.2.4.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+struct StreamProjection {
+
+	// Setup.  zoomX and zoomY are the actual zoom values, not zero
+	// for "auto."  The window is given in pixels.
+
+	void	setup(float zoomX, float zoomY, float nearClip, float farClip,
+			int windowX1, int windowY1, int windowSizeX, int windowSizeY) {
+		assert(nearClip > 0.0f);
+		assert(farClip > nearClip);
+		this->zoomX = zoomX;
+		this->zoomY = zoomY;
+		zScale = farClip / (farClip - nearClip);
+		zOffset = nearClip * farClip / (nearClip - farClip);
+		halfSizeX = (float)windowSizeX * .5f;
+		halfSizeY = (float)windowSizeY * .5f;
+		centerX = (float)windowX1 + halfSizeX;
+		centerY = (float)windowY1 + halfSizeY;
+	}
+
+	// Camera space to clip space is x*zoomX, y*zoomY, z*zScale + zOffset,
+	// with w = z.  Clip space to the screen is the usual divide by w and
+	// scale into the window, with y pointing down.
+
+	float	zoomX, zoomY;
+	float	zScale, zOffset;
+	float	centerX, centerY;
+	float	halfSizeX, halfSizeY;
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Implementation details
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// StreamTransformJob
+//
+// Transform a range of a stream.  Same as transformRange() in
+// Matrix4x3Batch.cpp, but with the strides fixed at compile time.
+
+template <bool kTranslate, bool kNormalize, class Src, int kSrc, int kDst>
+struct StreamTransformJob {
+	Matrix4x3			m;
+	VertexStream<Src, kSrc>		src;
+	VertexStream<Vector3, kDst>	dst;
+
+	StreamTransformJob(const Matrix4x3 &m, const VertexStream<Src, kSrc> &src,
+		const VertexStream<Vector3, kDst> &dst) : m(m), src(src), dst(dst) {}
+
+	void	operator()(int begin, int end) const {
+		SimdFloat	m11 = simdSet1(m.m11), m12 = simdSet1(m.m12), m13 = simdSet1(m.m13);
+		SimdFloat	m21 = simdSet1(m.m21), m22 = simdSet1(m.m22), m23 = simdSet1(m.m23);
+		SimdFloat	m31 = simdSet1(m.m31), m32 = simdSet1(m.m32), m33 = simdSet1(m.m33);
+		SimdFloat	tx = simdSet1(kTranslate ? m.tx : 0.0f);
+		SimdFloat	ty = simdSet1(kTranslate ? m.ty : 0.0f);
+		SimdFloat	tz = simdSet1(kTranslate ? m.tz : 0.0f);
+
+		const int	sf = VertexStream<Src, kSrc>::kStrideInFloats;
+		const int	df = VertexStream<Vector3, kDst>::kStrideInFloats;
+
+		int	i = begin;
+		for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+			const float	*s = src.floatPtr(i);
+			SimdFloat	x = simdGather(s, sf);
+			SimdFloat	y = simdGather(s + 1, sf);
+			SimdFloat	z = simdGather(s + 2, sf);
+
+			SimdFloat	rx = simdMadd(x, m11, simdMadd(y, m21, simdMadd(z, m31, tx)));
+			SimdFloat	ry = simdMadd(x, m12, simdMadd(y, m22, simdMadd(z, m32, ty)));
+			SimdFloat	rz = simdMadd(x, m13, simdMadd(y, m23, simdMadd(z, m33, tz)));
+
+			if (kNormalize) {
+				SimdFloat	magSq = rx*rx + ry*ry + rz*rz;
+				SimdFloat	k = simdSelect(magSq > simdZero(), simdRsqrt(magSq), simdSet1(1.0f));
+				rx = rx * k;
+				ry = ry * k;
+				rz = rz * k;
+			}
+
+			float	*d = (float *)&dst[i];
+			simdScatter(d, df, rx);
+			simdScatter(d + 1, df, ry);
+			simdScatter(d + 2, df, rz);
+		}
+
+		// Finish up the last few one at a time
+
+		for ( ; i < end ; ++i) {
+			const Vector3	&s = src[i];
+			Vector3	r(
+				s.x*m.m11 + s.y*m.m21 + s.z*m.m31,
+				s.x*m.m12 + s.y*m.m22 + s.z*m.m32,
+				s.x*m.m13 + s.y*m.m23 + s.z*m.m33
+			);
+			if (kTranslate) {
+				r.x += m.tx; r.y += m.ty; r.z += m.tz;
+			}
+			if (kNormalize) {
+				r.normalize();
+			}
+			dst[i] = r;
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// runStreamTransform
+//
+// Check the streams and run a transform across the worker threads
+
+template <bool kTranslate, bool kNormalize, class Src, int kSrc, int kDst>
+inline void	runStreamTransform(const Matrix4x3 &m, const VertexStream<Src, kSrc> &src,
+	const VertexStream<Vector3, kDst> &dst) {
+
+	// In-place is fine, but only if the vectors line up
+
+	assert(dst.count >= src.count);
+	assert((const void *)src.first != (const void *)dst.first || kSrc == kDst);
+
+	StreamTransformJob<kTranslate, kNormalize, Src, kSrc, kDst>	job(m, src, dst);
+	parallelFor(src.count, kMinStreamVerticesPerChunk, job);
+}
+
+//---------------------------------------------------------------------------
+// StreamLightJob
+//
+// Light a range of a stream
+
+template <class Src, int kSrc, int kDst>
+struct StreamLightJob {
+	VertexStream<Src, kSrc>			normal;
+	VertexStream<unsigned, kDst>		argb;
+	Vector3					toLight;
+	float					ambient[3];
+	float					directional[3];
+
+	StreamLightJob(const VertexStream<Src, kSrc> &normal, const VertexStream<unsigned, kDst> &argb)
+		: normal(normal), argb(argb) {}
+
+	// Light kSimdWidth normals, sf floats apart, into packed RGB
+
+	void	lightBlock(const float *s, int sf, int *rgb) const {
+		SimdFloat	k = simdMadd(simdGather(s, sf), simdSet1(toLight.x),
+			simdMadd(simdGather(s + 1, sf), simdSet1(toLight.y), simdGather(s + 2, sf) * simdSet1(toLight.z)));
+		k = simdMax(k, simdZero());
+
+		SimdFloat	maxChannel = simdSet1(255.0f);
+		SimdFloat	r = simdMin(simdFloor(simdMadd(simdSet1(directional[0]), k, simdSet1(ambient[0] + .5f))), maxChannel);
+		SimdFloat	g = simdMin(simdFloor(simdMadd(simdSet1(directional[1]), k, simdSet1(ambient[1] + .5f))), maxChannel);
+		SimdFloat	b = simdMin(simdFloor(simdMadd(simdSet1(directional[2]), k, simdSet1(ambient[2] + .5f))), maxChannel);
+
+		// Pack the channels while they're still floats.  The
+		// 24-bit result is exact in a float.
+
+		simdStoreInt(rgb, simdMadd(r, simdSet1(65536.0f), simdMadd(g, simdSet1(256.0f), b)));
+	}
+
+	void	operator()(int begin, int end) const {
+		const int	sf = VertexStream<Src, kSrc>::kStrideInFloats;
+		int		rgb[kSimdMaxWidth];
+
+		int	i = begin;
+		for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+			lightBlock(normal.floatPtr(i), sf, rgb);
+			for (int j = 0 ; j < kSimdWidth ; ++j) {
+				argb[i + j] = 0xff000000 | (unsigned)rgb[j];
+			}
+		}
+
+		// Finish up the last few by copying them into a block of
+		// their own, so they get exactly the same arithmetic
+
+		if (i < end) {
+			float	tail[kSimdMaxWidth * 3] = { 0.0f };
+			for (int j = 0 ; i + j < end ; ++j) {
+				const Vector3	&n = normal[i + j];
+				tail[j*3] = n.x;
+				tail[j*3 + 1] = n.y;
+				tail[j*3 + 2] = n.z;
+			}
+			lightBlock(tail, 3, rgb);
+			for (int j = 0 ; i + j < end ; ++j) {
+				argb[i + j] = 0xff000000 | (unsigned)rgb[j];
+			}
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// StreamProjectJob
+//
+// Project a range of a stream.  The outcodes of the range are ANDed
+// into allCodes.
+
+template <class Src, int kSrc, int kDst, int kOow>
+struct StreamProjectJob {
+	Matrix4x3			m;
+	StreamProjection		proj;
+	VertexStream<Src, kSrc>		src;
+	VertexStream<Vector3, kDst>	screen;
+	VertexStream<float, kOow>	oow;
+	int				*outCode;
+	mutable std::atomic<int>	allCodes;
+
+	StreamProjectJob(const VertexStream<Src, kSrc> &src, const VertexStream<Vector3, kDst> &screen,
+		const VertexStream<float, kOow> &oow)
+		: src(src), screen(screen), oow(oow), outCode(NULL), allCodes(kOutCodeFrustumMask) {}
+
+	// Code one point against the frustum, given in clip space.  Unlike
+	// Renderer::computeOutCode(), which has its planes at x = w and so
+	// on, these are the real D3D planes: -w <= x,y <= w and 0 <= z <= w.
+
+	static int	computeOutCode(float x, float y, float z, float w) {
+		int	code = 0;
+		if (x < -w) code |= kOutCodeLeft;
+		if (x > w) code |= kOutCodeRight;
+		if (y < -w) code |= kOutCodeBottom;
+		if (y > w) code |= kOutCodeTop;
+		if (z < 0.0f) code |= kOutCodeNear;
+		if (z > w) code |= kOutCodeFar;
+		return code;
+	}
+
+	void	operator()(int begin, int end) const {
+		SimdFloat	m11 = simdSet1(m.m11), m12 = simdSet1(m.m12), m13 = simdSet1(m.m13);
+		SimdFloat	m21 = simdSet1(m.m21), m22 = simdSet1(m.m22), m23 = simdSet1(m.m23);
+		SimdFloat	m31 = simdSet1(m.m31), m32 = simdSet1(m.m32), m33 = simdSet1(m.m33);
+		SimdFloat	tx = simdSet1(m.tx), ty = simdSet1(m.ty), tz = simdSet1(m.tz);
+		SimdFloat	zoomX = simdSet1(proj.zoomX), zoomY = simdSet1(proj.zoomY);
+		SimdFloat	zScale = simdSet1(proj.zScale), zOffset = simdSet1(proj.zOffset);
+		SimdFloat	centerX = simdSet1(proj.centerX), centerY = simdSet1(proj.centerY);
+		SimdFloat	halfSizeX = simdSet1(proj.halfSizeX), halfSizeY = simdSet1(proj.halfSizeY);
+		SimdFloat	zero = simdZero(), one = simdSet1(1.0f);
+
+		const int	sf = VertexStream<Src, kSrc>::kStrideInFloats;
+		const int	df = VertexStream<Vector3, kDst>::kStrideInFloats;
+		const int	of = VertexStream<float, kOow>::kStrideInFloats;
+
+		int	rangeCodes = kOutCodeFrustumMask;
+		int	i = begin;
+		for ( ; i + kSimdWidth <= end ; i += kSimdWidth) {
+			const float	*s = src.floatPtr(i);
+			SimdFloat	px = simdGather(s, sf);
+			SimdFloat	py = simdGather(s + 1, sf);
+			SimdFloat	pz = simdGather(s + 2, sf);
+
+			// Model to camera, then to clip space
+
+			SimdFloat	w = simdMadd(px, m13, simdMadd(py, m23, simdMadd(pz, m33, tz)));
+			SimdFloat	x = simdMadd(px, m11, simdMadd(py, m21, simdMadd(pz, m31, tx))) * zoomX;
+			SimdFloat	y = simdMadd(px, m12, simdMadd(py, m22, simdMadd(pz, m32, ty))) * zoomY;
+			SimdFloat	z = simdMadd(w, zScale, zOffset);
+
+			// Outcodes, built up as floats and converted all at once
+
+			SimdFloat	negW = -w;
+			SimdFloat	code =
+				simdSelect(x < negW, simdSet1((float)kOutCodeLeft), zero) +
+				simdSelect(x > w, simdSet1((float)kOutCodeRight), zero) +
+				simdSelect(y < negW, simdSet1((float)kOutCodeBottom), zero) +
+				simdSelect(y > w, simdSet1((float)kOutCodeTop), zero) +
+				simdSelect(z < zero, simdSet1((float)kOutCodeNear), zero) +
+				simdSelect(z > w, simdSet1((float)kOutCodeFar), zero);
+			int	laneCode[kSimdMaxWidth];
+			simdStoreInt(laneCode, code);
+			for (int j = 0 ; j < kSimdWidth ; ++j) {
+				rangeCodes &= laneCode[j];
+			}
+			if (outCode != NULL) {
+				for (int j = 0 ; j < kSimdWidth ; ++j) {
+					outCode[i + j] = laneCode[j];
+				}
+			}
+
+			// Project.  Points behind the camera get garbage, but
+			// not a divide by zero.
+
+			SimdFloat	r = one / simdSelect(w > zero, w, one);
+			float	*d = (float *)&screen[i];
+			simdScatter(d, df, simdMadd(x * r, halfSizeX, centerX));
+			simdScatter(d + 1, df, centerY - y * r * halfSizeY);
+			simdScatter(d + 2, df, z * r);
+			simdScatter((float *)&oow[i], of, r);
+		}
+
+		// Finish up the last few one at a time
+
+		for ( ; i < end ; ++i) {
+			const Vector3	&p = src[i];
+			float	w = p.x*m.m13 + p.y*m.m23 + p.z*m.m33 + m.tz;
+			float	x = (p.x*m.m11 + p.y*m.m21 + p.z*m.m31 + m.tx) * proj.zoomX;
+			float	y = (p.x*m.m12 + p.y*m.m22 + p.z*m.m32 + m.ty) * proj.zoomY;
+			float	z = w*proj.zScale + proj.zOffset;
+
+			int	code = computeOutCode(x, y, z, w);
+			rangeCodes &= code;
+			if (outCode != NULL) {
+				outCode[i] = code;
+			}
+
+			float	r = 1.0f / ((w > 0.0f) ? w : 1.0f);
+			screen[i].x = x*r*proj.halfSizeX + proj.centerX;
+			screen[i].y = proj.centerY - y*r*proj.halfSizeY;
+			screen[i].z = z*r;
+			oow[i] = r;
+		}
+
+		allCodes.fetch_and(rangeCodes);
+	}
+};
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Stream kernels
+//
+/////////////////////////////////////////////////////////////////////////////
+
+//---------------------------------------------------------------------------
+// Transformation
+//
+// Transform src.count vectors from src into dst, like the versions in
+// Matrix4x3Batch.h.  src and dst may be the same stream.
+
+// Transform points.  (The translation portion is applied)
+
+template <class Src, int kSrc, int kDst>
+inline void	transformPoints(const Matrix4x3 &m, const VertexStream<Src, kSrc> &src,
+	const VertexStream<Vector3, kDst> &dst) {
+	runStreamTransform<true, false>(m, src, dst);
+}
+
+// Transform direction vectors.  (The translation portion is ignored)
+
+template <class Src, int kSrc, int kDst>
+inline void	transformVectors(const Matrix4x3 &m, const VertexStream<Src, kSrc> &src,
+	const VertexStream<Vector3, kDst> &dst) {
+	runStreamTransform<false, false>(m, src, dst);
+}
+
+// Transform surface normals by the inverse transpose, and renormalize
+
+template <class Src, int kSrc, int kDst>
+inline void	transformNormals(const Matrix4x3 &m, const VertexStream<Src, kSrc> &src,
+	const VertexStream<Vector3, kDst> &dst) {
+	runStreamTransform<false, true>(normalMatrix(m), src, dst);
+}
+
+//---------------------------------------------------------------------------
+// computeBounds
+//
+// The axially aligned box around all the points in a stream.  An empty
+// stream gives an empty box.  This is done on the calling thread: it is
+// just a pass over memory, and hardly any work.
+
+template <class Src, int kSrc>
+AABB3	computeBounds(const VertexStream<Src, kSrc> &src) {
+	AABB3	box;
+	box.empty();
+
+	const int	sf = VertexStream<Src, kSrc>::kStrideInFloats;
+
+	int	i = 0;
+	if (src.count >= kSimdWidth) {
+		SimdFloat	minX = simdSet1(box.min.x), minY = simdSet1(box.min.y), minZ = simdSet1(box.min.z);
+		SimdFloat	maxX = simdSet1(box.max.x), maxY = simdSet1(box.max.y), maxZ = simdSet1(box.max.z);
+		for ( ; i + kSimdWidth <= src.count ; i += kSimdWidth) {
+			const float	*s = src.floatPtr(i);
+			SimdFloat	x = simdGather(s, sf);
+			SimdFloat	y = simdGather(s + 1, sf);
+			SimdFloat	z = simdGather(s + 2, sf);
+			minX = simdMin(minX, x); maxX = simdMax(maxX, x);
+			minY = simdMin(minY, y); maxY = simdMax(maxY, y);
+			minZ = simdMin(minZ, z); maxZ = simdMax(maxZ, z);
+		}
+
+		// Combine the lanes
+
+		float	lo[3][kSimdMaxWidth], hi[3][kSimdMaxWidth];
+		simdStoreU(lo[0], minX); simdStoreU(lo[1], minY); simdStoreU(lo[2], minZ);
+		simdStoreU(hi[0], maxX); simdStoreU(hi[1], maxY); simdStoreU(hi[2], maxZ);
+		for (int j = 0 ; j < kSimdWidth ; ++j) {
+			box.add(Vector3(lo[0][j], lo[1][j], lo[2][j]));
+			box.add(Vector3(hi[0][j], hi[1][j], hi[2][j]));
+		}
+	}
+
+	// Finish up the last few one at a time
+
+	for ( ; i < src.count ; ++i) {
+		box.add(src[i]);
+	}
+	return box;
+}
+
+//---------------------------------------------------------------------------
+// lightVertices
+//
+// Light vertices with the Renderer's lighting model: an ambient light and
+// one directional light.  Each vertex gets
+//
+//	ambient + directional * max(0, -n . lightDirection)
+//
+// clamped, with alpha 255, packed as 0xAARRGGBB into argb.  This is how
+// to prelight RenderVertexL or RenderVertexTL colors on the CPU.
+//
+// The normals must be in the same space as lightDirection, which is the
+// direction the light is travelling, and should be unit length.  The
+// colors are 0x00RRGGBB, as passed to Renderer::setAmbientLightColor()
+// and setDirectionalLightColor().
+
+template <class Src, int kSrc, int kDst>
+void	lightVertices(const VertexStream<Src, kSrc> &normal, const Vector3 &lightDirection,
+	unsigned ambientColor, unsigned directionalColor, const VertexStream<unsigned, kDst> &argb) {
+	assert(argb.count >= normal.count);
+
+	StreamLightJob<Src, kSrc, kDst>	job(normal, argb);
+	job.toLight = -lightDirection;
+	job.ambient[0] = (float)GET_R(ambientColor);
+	job.ambient[1] = (float)GET_G(ambientColor);
+	job.ambient[2] = (float)GET_B(ambientColor);
+	job.directional[0] = (float)GET_R(directionalColor);
+	job.directional[1] = (float)GET_G(directionalColor);
+	job.directional[2] = (float)GET_B(directionalColor);
+	parallelFor(normal.count, kMinStreamVerticesPerChunk, job);
+}
+
+//---------------------------------------------------------------------------
+// projectPoints
+//
+// Transform points into camera space with modelToCamera, and project them
+// onto the screen.  screen gets the screen space x, y and z, and oow gets
+// one over w, ready for a RenderVertexTL.  If outCode isn't NULL, it gets
+// the kOutCodeXXX bits of each point; the projected values of a point
+// are only meaningful if its outcode has none of kOutCodeOffScreenMask.
+//
+// Returns the outcodes of all the points ANDed together.  If this is
+// nonzero, all the points are outside the same plane, and anything
+// made from them can be trivially rejected.  (See Section 16.1.1)
+
+template <class Src, int kSrc, int kDst, int kOow>
+int	projectPoints(const Matrix4x3 &modelToCamera, const StreamProjection &projection,
+	const VertexStream<Src, kSrc> &src, const VertexStream<Vector3, kDst> &screen,
+	const VertexStream<float, kOow> &oow, int *outCode = NULL) {
+	assert(screen.count >= src.count);
+	assert(oow.count >= src.count);
+
+	StreamProjectJob<Src, kSrc, kDst, kOow>	job(src, screen, oow);
+	job.m = modelToCamera;
+	job.proj = projection;
+	job.outCode = outCode;
+	parallelFor(src.count, kMinStreamVerticesPerChunk, job);
+	return (src.count > 0) ? job.allCodes.load() : 0;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __VERTEXSTREAM_H_INCLUDED__
@@ -21,18 +21,39 @@
 
 /////////////////////////////////////////////////////////////////////////////
 //
-// Vector3 - һ򵥵3D
-// class Vector3 - a simple 3D vector class
+// TVector3 - һ򵥵3D
+// class TVector3 - a simple 3D vector class
+//
+// ģд󲿷ֵطʹõfloat汾ı
+// Vector3Ҫ߾ȵĵطʹVector3d
+// The component type is a template parameter.  Most of the code uses
+// the float version through the alias Vector3 below, and Vector3d is
+// there for places that need more precision.
+//
+// ûԶĿ캯͸ֵƽɸƵģ
+// memcpyƶ캯Ͳ޸ĶĲconstexpr
+// Գڱڹ졣
+// There is no user-defined copy constructor or assignment, so the class
+// is trivially copyable and arrays of vectors may be moved with memcpy.
+// The constructors and the operations that don't modify the object are
+// constexpr, so constants can be built at compile time.
 //
 /////////////////////////////////////////////////////////////////////////////
 
-class Vector3 {
+template <class T>
+class TVector3 {
 public:
 
 // г֣û̫ѡ
 // Public representation:  Not many options here.
 
-	float x,y,z;
+	T x,y,z;
+
+	// ͡ķǳԱñʽת
+	// The component type.  The nonmember functions below use it so
+	// the scalar arguments convert implicitly
+
+	typedef T	Scalar;
 
 // 캯
 // Constructors
@@ -41,38 +62,27 @@ public:
 	// Default constructor leaves vector in
 	// an indeterminate state
 
-	Vector3() {}
-
-	// 캯
-	// Copy constructor
-
-	Vector3(const Vector3 &a) : x(a.x), y(a.y), z(a.z) {}
+	TVector3() = default;
 
 	// ֵĹ캯
 	// Construct given three values
 
-	Vector3(float nx, float ny, float nz) : x(nx), y(ny), z(nz) {}
+	constexpr TVector3(T nx, T ny, T nz) : x(nx), y(ny), z(nz) {}
 
 // ׼
 // Standard object maintenance
 
-	// ֵCԹҷֵá
-	// Assignment.  We adhere to C convention and
-	// return reference to the lvalue
-
-	Vector3 &operator =(const Vector3 &a) {
-		x = a.x; y = a.y; z = a.z;
-		return *this;
-	}
+	// ֵͿʹñɵİ汾
+	// Copy and assignment are the compiler generated ones
 
 	// 
 	// Check for equality
 
-	bool operator ==(const Vector3 &a) const {
+	constexpr bool operator ==(const TVector3 &a) const {
 		return x==a.x && y==a.y && z==a.z;
 	}
 
-	bool operator !=(const Vector3 &a) const {
+	constexpr bool operator !=(const TVector3 &a) const {
 		return x!=a.x || y!=a.y || z!=a.z;
 	}
 
@@ -83,58 +93,59 @@ public:
 	// Ϊ0
 	// Set the vector to zero
 
-	void zero() { x = y = z = 0.0f; }
+	void zero() { x = y = z = T(0); }
 
 	// һԪŷĸֵ
 	// Unary minus returns the negative of the vector
 
-	Vector3 operator -() const { return Vector3(-x,-y,-z); }
+	constexpr TVector3 operator -() const { return TVector3(-x,-y,-z); }
 
 	// ԪӺźͼţļӼ
 	// Binary + and - add and subtract vectors
 
-	Vector3 operator +(const Vector3 &a) const {
-		return Vector3(x + a.x, y + a.y, z + a.z);
+	constexpr TVector3 operator +(const TVector3 &a) const {
+		return TVector3(x + a.x, y + a.y, z + a.z);
 	}
 
-	Vector3 operator -(const Vector3 &a) const {
-		return Vector3(x - a.x, y - a.y, z - a.z);
+	constexpr TVector3 operator -(const TVector3 &a) const {
+		return TVector3(x - a.x, y - a.y, z - a.z);
 	}
 
 	// ĳ˷ͳ
 	// Multiplication and division by scalar
 
-	Vector3 operator *(float a) const {
-		return Vector3(x*a, y*a, z*a);
+	constexpr TVector3 operator *(T a) const {
+		return TVector3(x*a, y*a, z*a);
 	}
 
-	Vector3 operator /(float a) const {
-									 // ע⣺ûмĸǷΪ0
-		float	oneOverA = 1.0f / a; // NOTE: no check for divide by zero here 
-		return Vector3(x*oneOverA, y*oneOverA, z*oneOverA);
+	// ע⣺ûмĸǷΪ0
+	// NOTE: no check for divide by zero here
+
+	constexpr TVector3 operator /(T a) const {
+		return *this * (T(1) / a);
 	}
 
 	// ϲֵʹúCԷԼһ
 	// Combined assignment operators to conform to
 	// C notation convention
 
-	Vector3 &operator +=(const Vector3 &a) {
+	TVector3 &operator +=(const TVector3 &a) {
 		x += a.x; y += a.y; z += a.z;
 		return *this;
 	}
 
-	Vector3 &operator -=(const Vector3 &a) {
+	TVector3 &operator -=(const TVector3 &a) {
 		x -= a.x; y -= a.y; z -= a.z;
 		return *this;
 	}
 
-	Vector3 &operator *=(float a) {
+	TVector3 &operator *=(T a) {
 		x *= a; y *= a; z *= a;
 		return *this;
 	}
 
-	Vector3 &operator /=(float a) {
-		float	oneOverA = 1.0f / a;
+	TVector3 &operator /=(T a) {
+		T	oneOverA = T(1) / a;
 		x *= oneOverA; y *= oneOverA; z *= oneOverA;
 		return *this;
 	}
@@ -143,10 +154,10 @@ public:
 	// Normalize the vector
 
 	void	normalize() {
-		float magSq = x*x + y*y + z*z;
+		T magSq = x*x + y*y + z*z;
 							// 0
-		if (magSq > 0.0f) { // check for divide-by-zero
-			float oneOverMag = 1.0f / sqrt(magSq);
+		if (magSq > T(0)) { // check for divide-by-zero
+			T oneOverMag = T(1) / sqrt(magSq);
 			x *= oneOverMag;
 			y *= oneOverMag;
 			z *= oneOverMag;
@@ -157,11 +168,27 @@ public:
 	// Vector dot product.  We overload the standard
 	// multiplication symbol to do this
 
-	float operator *(const Vector3 &a) const {
+	constexpr T operator *(const TVector3 &a) const {
 		return x*a.x + y*a.y + z*a.z;
 	}
+
+	// ˣһԡдԪΪñԱ汾
+	// һʽת0.5 * v
+	// Scalar on the left multiplication, for symmetry.  It's a friend
+	// so that the scalar converts just like it does for the member
+	// version, e.g. 0.5 * v
+
+	friend constexpr TVector3 operator *(T k, const TVector3 &v) {
+		return TVector3(k*v.x, k*v.y, k*v.z);
+	}
 };
 
+// õʵ
+// The usual instantiations
+
+typedef TVector3<float>		Vector3;
+typedef TVector3<double>	Vector3d;
+
 /////////////////////////////////////////////////////////////////////////////
 //
 // ǳԱ
@@ -172,35 +199,31 @@ public:
 // ĴС
 // Compute the magnitude of a vector
 
-inline float vectorMag(const Vector3 &a) {
+template <class T>
+inline T vectorMag(const TVector3<T> &a) {
 	return sqrt(a.x*a.x + a.y*a.y + a.z*a.z);
 }
 
 // Ĳ
 // Compute the cross product of two vectors
 
-inline Vector3 crossProduct(const Vector3 &a, const Vector3 &b) {
-	return Vector3(
+template <class T>
+constexpr TVector3<T> crossProduct(const TVector3<T> &a, const TVector3<T> &b) {
+	return TVector3<T>(
 		a.y*b.z - a.z*b.y,
 		a.z*b.x - a.x*b.z,
 		a.x*b.y - a.y*b.x
 	);
 }
 
-// ҳˣһ
-// Scalar on the left multiplication, for symmetry
-
-inline Vector3 operator *(float k, const Vector3 &v) {
-	return Vector3(k*v.x, k*v.y, k*v.z);
-}
-
 // ľ
 // Compute the distance between two points
 
-inline float distance(const Vector3 &a, const Vector3 &b) {
-	float dx = a.x - b.x;
-	float dy = a.y - b.y;
-	float dz = a.z - b.z;
+template <class T>
+inline T distance(const TVector3<T> &a, const TVector3<T> &b) {
+	T dx = a.x - b.x;
+	T dy = a.y - b.y;
+	T dz = a.z - b.z;
 	return sqrt(dx*dx + dy*dy + dz*dz);
 }
 
@@ -208,11 +231,33 @@ inline float distance(const Vector3 &a, const Vector3 &b) {
 // Compute the distance between two points, squared.  Often useful
 // when comparing distances, since the square root is slow
 
-inline float distanceSquared(const Vector3 &a, const Vector3 &b) {
-	float dx = a.x - b.x;
-	float dy = a.y - b.y;
-	float dz = a.z - b.z;
-	return dx*dx + dy*dy + dz*dz;
+template <class T>
+constexpr T distanceSquared(const TVector3<T> &a, const TVector3<T> &b) {
+	return (a - b) * (a - b);
+}
+
+// ں㡣һʽÿһʱ
+// ÿa + b*kʽFMAʱϲһָ
+// Ƕףa + b*k - c*mдmadd(madd(a, b, k), c, -m)
+// Fused operations.  These evaluate the whole expression at once, rather
+// than building a temporary per operator.  Each component has the form
+// a + b*k, which the compiler contracts into a single instruction when
+// FMA is enabled.  Longer chains nest: a + b*k - c*m is
+// madd(madd(a, b, k), c, -m).
+
+// a + b*k
+
+template <class T>
+constexpr TVector3<T> madd(const TVector3<T> &a, const TVector3<T> &b, typename TVector3<T>::Scalar k) {
+	return TVector3<T>(a.x + b.x*k, a.y + b.y*k, a.z + b.z*k);
+}
+
+// Բֵt = 0ʱΪat = 1ʱΪb
+// Linear interpolation: a when t = 0, b when t = 1
+
+template <class T>
+constexpr TVector3<T> lerp(const TVector3<T> &a, const TVector3<T> &b, typename TVector3<T>::Scalar t) {
+	return TVector3<T>(a.x + (b.x - a.x)*t, a.y + (b.y - a.y)*t, a.z + (b.z - a.z)*t);
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -222,10 +267,11 @@ inline float distanceSquared(const Vector3 &a, const Vector3 &b) {
 //
 /////////////////////////////////////////////////////////////////////////////
 
-// ṩȫ
-// We provide a global zero vector constant
+// ṩȫǱڳԲҪڱ𴦶塣
+// We provide a global zero vector constant.  It's a compile time
+// constant, so there is no definition anywhere else.
 
-extern const Vector3 kZeroVector;
+constexpr Vector3 kZeroVector(0.0f, 0.0f, 0.0f);
 
 /////////////////////////////////////////////////////////////////////////////
 #endif // #ifndef __VECTOR3_H_INCLUDED__
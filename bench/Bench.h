@@ -0,0 +1,124 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// Bench.h - Tiny framework for timing the math kernels
+//
+// Visit gamemath.com for the latest version of this file.
+//
+// For more details, see BenchMain.cpp
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#ifndef __BENCH_H_INCLUDED__
+#define __BENCH_H_INCLUDED__
+
+#include <chrono>
+
+//---------------------------------------------------------------------------
+// class BenchRun
+//
+// Handed to each benchmark case.  The case sets up its data, and then
+// calls time() on each variant it wants measured.  time() calls the
+// function object over and over until enough time has passed to get a
+// stable measurement, and reports the best time per operation.
+
+class BenchRun {
+public:
+	BenchRun(const char *caseName) : name(caseName) {}
+
+	// Time f().  Each call to f performs opsPerCall operations (usually,
+	// the number of elements in the array being processed.)  Returns
+	// the time per operation, in nanoseconds.
+
+	template <class Func>
+	double	time(const char *label, double opsPerCall, const Func &f);
+
+	// Report some other measured quantity, such as an error bound or a
+	// speedup ratio
+
+	void	report(const char *label, double value, const char *units);
+
+	// Name of the case being run
+
+	const char	*name;
+
+private:
+	void	reportTime(const char *label, double nsPerOp);
+};
+
+// Benchmark cases register themselves through this.  Use the BENCH()
+// macro below rather than declaring these directly.
+
+typedef void (*BenchFunc)(BenchRun &run);
+
+struct BenchCase {
+	BenchCase(const char *caseName, BenchFunc caseFunc);
+
+	const char	*name;
+	BenchFunc	func;
+	BenchCase	*next;
+};
+
+#define BENCH(caseName) \
+	static void bench_##caseName(BenchRun &run); \
+	static BenchCase benchCase_##caseName(#caseName, bench_##caseName); \
+	static void bench_##caseName(BenchRun &run)
+
+// Keep the compiler from optimizing away results that aren't used
+
+extern volatile float	gBenchSink;
+
+inline void	benchUse(float x) { gBenchSink = x; }
+
+// Minimum time spent measuring each variant, in seconds
+
+extern double	gBenchMinSeconds;
+
+//---------------------------------------------------------------------------
+// BenchRun::time
+//
+// Find a repeat count that takes a decent amount of time, then take the
+// best of several samples.  The best, rather than the average, is the
+// least sensitive to other things happening on the machine.
+
+template <class Func>
+double	BenchRun::time(const char *label, double opsPerCall, const Func &f) {
+	typedef std::chrono::steady_clock Clock;
+
+	// Warm up the caches and find out roughly how long a call takes
+
+	int	reps = 1;
+	for (;;) {
+		Clock::time_point t0 = Clock::now();
+		for (int i = 0 ; i < reps ; ++i) {
+			f();
+		}
+		double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+		if (secs > gBenchMinSeconds * 0.2 || reps >= (1 << 28)) {
+			break;
+		}
+		reps *= 2;
+	}
+
+	// Take the best of five samples
+
+	double	best = 1e30;
+	for (int sample = 0 ; sample < 5 ; ++sample) {
+		Clock::time_point t0 = Clock::now();
+		for (int i = 0 ; i < reps ; ++i) {
+			f();
+		}
+		double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+		if (secs < best) {
+			best = secs;
+		}
+	}
+
+	double	nsPerOp = best * 1e9 / (reps * opsPerCall);
+	reportTime(label, nsPerOp);
+	return nsPerOp;
+}
+
+/////////////////////////////////////////////////////////////////////////////
+#endif // #ifndef __BENCH_H_INCLUDED__
@@ -0,0 +1,153 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchAABB3.cpp - Benchmarks for the axially aligned bounding box tests
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "AABB3.h"
+#include "Matrix4x3.h"
+#include "EulerAngles.h"
+#include "MathUtil.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Boxes and rays are scattered over the same region, and each ray is
+// aimed roughly at its box, so that a decent fraction of the tests hit
+// and the branches inside the tests don't all go the same way.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kBoxCount = 16384;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randVector
+//
+// Random vector in the cube [-r, r]
+
+static Vector3	randVector(float r) {
+	return Vector3(randFloat(-r, r), randFloat(-r, r), randFloat(-r, r));
+}
+
+//---------------------------------------------------------------------------
+// randBox
+//
+// Random box with its center within r of the origin
+
+static AABB3	randBox(float r, float maxSize) {
+	Vector3	c = randVector(r);
+	Vector3	h(randFloat(0.1f, maxSize), randFloat(0.1f, maxSize), randFloat(0.1f, maxSize));
+	AABB3	box;
+	box.min = c - h;
+	box.max = c + h;
+	return box;
+}
+
+//---------------------------------------------------------------------------
+// Ray and moving box tests
+
+BENCH(aabb3_intersect) {
+	srand(17);
+	std::vector<AABB3>	boxes(kBoxCount), moving(kBoxCount);
+	std::vector<Vector3>	org(kBoxCount), delta(kBoxCount), d(kBoxCount);
+	for (int i = 0 ; i < kBoxCount ; ++i) {
+		boxes[i] = randBox(10.0f, 3.0f);
+		moving[i] = randBox(10.0f, 1.0f);
+		org[i] = randVector(20.0f);
+		delta[i] = (boxes[i].center() + randVector(4.0f) - org[i]) * 1.5f;
+		d[i] = randVector(10.0f);
+	}
+
+	int	hits = 0;
+	run.time("rayIntersect", kBoxCount, [&]() {
+		float	sum = 0.0f;
+		hits = 0;
+		for (int i = 0 ; i < kBoxCount ; ++i) {
+			float	t = boxes[i].rayIntersect(org[i], delta[i]);
+			if (t <= 1.0f) {
+				sum += t;
+				++hits;
+			}
+		}
+		benchUse(sum);
+	});
+	run.report("rayIntersect hit rate", (double)hits / kBoxCount, "");
+
+	run.time("rayIntersect with normal", kBoxCount, [&]() {
+		Vector3	normalSum = kZeroVector;
+		for (int i = 0 ; i < kBoxCount ; ++i) {
+			Vector3	n;
+			if (boxes[i].rayIntersect(org[i], delta[i], &n) <= 1.0f) {
+				normalSum += n;
+			}
+		}
+		benchUse(normalSum.x);
+	});
+
+	run.time("intersectMovingAABB", kBoxCount, [&]() {
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kBoxCount ; ++i) {
+			sum += intersectMovingAABB(boxes[i], moving[i], d[i]);
+		}
+		benchUse(sum);
+	});
+
+	run.time("intersectAABBs", kBoxCount, [&]() {
+		int	count = 0;
+		for (int i = 0 ; i < kBoxCount ; ++i) {
+			count += intersectAABBs(boxes[i], moving[i]) ? 1 : 0;
+		}
+		benchUse((float)count);
+	});
+}
+
+//---------------------------------------------------------------------------
+// Transforming boxes
+
+BENCH(aabb3_transform) {
+	srand(18);
+	std::vector<AABB3>	boxes(kBoxCount), out(kBoxCount);
+	std::vector<Matrix4x3>	m(kBoxCount);
+	for (int i = 0 ; i < kBoxCount ; ++i) {
+		boxes[i] = randBox(10.0f, 3.0f);
+		EulerAngles	e(randFloat(-kPi, kPi), randFloat(-kPiOver2, kPiOver2), randFloat(-kPi, kPi));
+		m[i].setupLocalToParent(randVector(100.0f), e);
+	}
+
+	run.time("setToTransformedBox", kBoxCount, [&]() {
+		for (int i = 0 ; i < kBoxCount ; ++i) {
+			out[i].setToTransformedBox(boxes[i], m[i]);
+		}
+		benchUse(out[kBoxCount - 1].min.x);
+	});
+
+	// The same work done the slow way, transforming all eight corners
+
+	run.time("eight transformed corners", kBoxCount, [&]() {
+		for (int i = 0 ; i < kBoxCount ; ++i) {
+			out[i].empty();
+			for (int j = 0 ; j < 8 ; ++j) {
+				out[i].add(boxes[i].corner(j) * m[i]);
+			}
+		}
+		benchUse(out[kBoxCount - 1].min.x);
+	});
+}
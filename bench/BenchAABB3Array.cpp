@@ -0,0 +1,249 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchAABB3Array.cpp - Benchmarks and checks for the structure of arrays
+// box list and frustum culling
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "AABB3.h"
+#include "AABB3Array.h"
+#include "EulerAngles.h"
+#include "MathUtil.h"
+#include "Matrix4x3.h"
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The scene is a million boxes in clumps of a few hundred spread over a
+// big level, with each clump's boxes next to each other in the array, the
+// way a game keeps its objects sorted by where they are.  The camera sits
+// in the middle and turns a little each frame, so roughly a fifth of the
+// boxes are visible.
+//
+// The results are checked against AABB3::classifyPlane().  Boxes within
+// rounding error of a plane can legitimately go either way, so a
+// difference only counts when the box is clearly inside or outside.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kCullBoxCount = 1000000;
+const int	kCheckBoxCount = 100003;
+const float	kCullLevelSize = 4000.0f;
+const float	kRoundingSlop = 1e-3f;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randVector
+//
+// Random vector in the cube [-r, r]
+
+static Vector3	randVector(float r) {
+	return Vector3(randFloat(-r, r), randFloat(-r, r), randFloat(-r, r));
+}
+
+//---------------------------------------------------------------------------
+// makeBoxes
+//
+// Clumps of 256 boxes, each clump together in the array
+
+static void	makeBoxes(std::vector<AABB3> &box, int count) {
+	box.resize(count);
+	Vector3	clump;
+	for (int i = 0 ; i < count ; ++i) {
+		if (i % 256 == 0) {
+			clump = randVector(kCullLevelSize * .5f);
+			clump.y *= .05f;
+		}
+		Vector3	c = clump + randVector(30.0f);
+		float	size = (rand() % 100 == 0) ? randFloat(5.0f, 30.0f) : randFloat(0.2f, 2.0f);
+		Vector3	h(randFloat(.5f, 1.0f) * size, randFloat(.5f, 1.0f) * size, randFloat(.5f, 1.0f) * size);
+		box[i].min = c - h;
+		box[i].max = c + h;
+	}
+}
+
+//---------------------------------------------------------------------------
+// cameraFrustum
+//
+// The frustum for the camera at the middle of the level, turned by heading
+
+static Frustum	cameraFrustum(float heading) {
+	Matrix4x3	cameraToWorld;
+	cameraToWorld.setupLocalToParent(Vector3(0.0f, 10.0f, 0.0f), EulerAngles(heading, .1f, 0.0f));
+	Frustum	f;
+	f.setup(cameraToWorld, 1.0f, 1.5f, 1.0f, kCullLevelSize * .4f);
+	return f;
+}
+
+//---------------------------------------------------------------------------
+// margin
+//
+// Distance from the plane in double precision.  With front true, this
+// is positive if the box is completely in front of the plane, and with
+// front false, it's negative if the box is completely behind it.
+
+static double	margin(const AABB3 &box, const Vector3 &n, float d, bool front) {
+	double	c = 0.0, r = 0.0;
+	for (int axis = 0 ; axis < 3 ; ++axis) {
+		double	lo = (&box.min.x)[axis], hi = (&box.max.x)[axis];
+		double	k = (&n.x)[axis];
+		c += (lo + hi) * .5 * k;
+		r += (hi - lo) * .5 * fabs(k);
+	}
+	return front ? c - r - d : c + r - d;
+}
+
+//---------------------------------------------------------------------------
+BENCH(aabb3_array_check) {
+	srand(250);
+	std::vector<AABB3>	box;
+	makeBoxes(box, kCheckBoxCount);
+	AABB3Array	soa;
+	soa.gather(&box[0], kCheckBoxCount);
+
+	// Round trip through center/extent form
+
+	float	roundTrip = 0.0f;
+	for (int i = 0 ; i < kCheckBoxCount ; ++i) {
+		AABB3	b = soa.get(i);
+		roundTrip = fmax(roundTrip, distance(b.min, box[i].min));
+		roundTrip = fmax(roundTrip, distance(b.max, box[i].max));
+	}
+	run.report("round trip error", roundTrip, "");
+
+	// Plane classification against AABB3::classifyPlane
+
+	std::vector<signed char>	side(kCheckBoxCount);
+	int	wrongSide = 0;
+	for (int p = 0 ; p < 16 ; ++p) {
+		Vector3	n = randVector(1.0f);
+		n.normalize();
+		float	d = randFloat(-200.0f, 200.0f);
+		classifyPlane(&side[0], soa, n, d);
+		for (int i = 0 ; i < kCheckBoxCount ; ++i) {
+			int	expected = box[i].classifyPlane(n, d);
+			if (side[i] != expected
+				&& fabs(margin(box[i], n, d, true)) > kRoundingSlop
+				&& fabs(margin(box[i], n, d, false)) > kRoundingSlop) {
+				++wrongSide;
+			}
+		}
+	}
+	run.report("classifyPlane mismatches", wrongSide, "");
+
+	// Culling against AABB3::classifyPlane, for several frames, with and
+	// without plane coherency.  Those two must agree exactly.
+
+	std::vector<int>		visible(kCheckBoxCount), coherent(kCheckBoxCount);
+	std::vector<unsigned char>	lastPlane(kCheckBoxCount, 0);
+	int	wrongCull = 0, wrongCoherent = 0, unsorted = 0;
+	for (int frame = 0 ; frame < 8 ; ++frame) {
+		Frustum	f = cameraFrustum(frame * .05f);
+		int	visibleCount = cullFrustum(&visible[0], soa, f);
+		int	coherentCount = cullFrustum(&coherent[0], soa, f, &lastPlane[0]);
+		if (coherentCount != visibleCount) {
+			++wrongCoherent;
+		}
+		for (int i = 0 ; i < visibleCount && i < coherentCount ; ++i) {
+			if (visible[i] != coherent[i]) {
+				++wrongCoherent;
+			}
+			if (i > 0 && visible[i] <= visible[i - 1]) {
+				++unsorted;
+			}
+		}
+		int	next = 0;
+		for (int i = 0 ; i < kCheckBoxCount ; ++i) {
+			bool	expected = true;
+			double	closest = 1e30;
+			for (int p = 0 ; p < kFrustumPlaneCount ; ++p) {
+				if (box[i].classifyPlane(f.n[p], f.d[p]) < 0) {
+					expected = false;
+				}
+				closest = fmin(closest, fabs(margin(box[i], f.n[p], f.d[p], false)));
+			}
+			bool	culled = (next >= visibleCount || visible[next] != i);
+			if (!culled) {
+				++next;
+			}
+			if (culled == expected && closest > kRoundingSlop) {
+				++wrongCull;
+			}
+		}
+	}
+	run.report("cull mismatches", wrongCull, "");
+	run.report("coherent cull mismatches", wrongCoherent, "");
+	run.report("unsorted visible indices", unsorted, "");
+}
+
+//---------------------------------------------------------------------------
+BENCH(aabb3_array) {
+	srand(251);
+	std::vector<AABB3>	box;
+	makeBoxes(box, kCullBoxCount);
+	AABB3Array	soa;
+	soa.gather(&box[0], kCullBoxCount);
+	std::vector<int>		visible(kCullBoxCount);
+	std::vector<unsigned char>	lastPlane(kCullBoxCount, 0);
+	Frustum	f = cameraFrustum(0.0f);
+
+	// The old way, one box and one plane at a time
+
+	double	scalar = run.time("AABB3::classifyPlane x6", kCullBoxCount, [&]() {
+		int	visibleCount = 0;
+		for (int i = 0 ; i < kCullBoxCount ; ++i) {
+			int	p = 0;
+			while (p < kFrustumPlaneCount && box[i].classifyPlane(f.n[p], f.d[p]) >= 0) {
+				++p;
+			}
+			if (p == kFrustumPlaneCount) {
+				visible[visibleCount++] = i;
+			}
+		}
+		benchUse((float)visibleCount);
+	});
+
+	int	threads = getWorkerThreadCount();
+	setWorkerThreadCount(1);
+	double	one = run.time("cullFrustum 1 thread", kCullBoxCount, [&]() {
+		benchUse((float)cullFrustum(&visible[0], soa, f));
+	});
+	double	coherent = run.time("cullFrustum coherent 1 thread", kCullBoxCount, [&]() {
+		benchUse((float)cullFrustum(&visible[0], soa, f, &lastPlane[0]));
+	});
+	setWorkerThreadCount(threads);
+	double	all = run.time("cullFrustum all threads", kCullBoxCount, [&]() {
+		benchUse((float)cullFrustum(&visible[0], soa, f, &lastPlane[0]));
+	});
+	run.report("visible", (double)cullFrustum(&visible[0], soa, f) / kCullBoxCount, "");
+	run.report("speedup over classifyPlane", scalar / one, "x");
+	run.report("coherent speedup", one / coherent, "x");
+	run.report("1M boxes 1 thread", coherent * kCullBoxCount * 1e-6, "ms");
+	run.report("1M boxes all threads", all * kCullBoxCount * 1e-6, "ms");
+	run.report("thread scaling", coherent / all, "x");
+
+	std::vector<signed char>	side(kCullBoxCount);
+	run.time("classifyPlane batch", kCullBoxCount, [&]() {
+		classifyPlane(&side[0], soa, f.n[0], f.d[0]);
+		benchUse((float)side[kCullBoxCount - 1]);
+	});
+}
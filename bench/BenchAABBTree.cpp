@@ -0,0 +1,692 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchAABBTree.cpp - Benchmarks and checks for the bounding volume
+// hierarchy
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <vector>
+
+#include "Bench.h"
+#include "AABB3.h"
+#include "AABBTree.h"
+#include "EulerAngles.h"
+#include "MathUtil.h"
+#include "Matrix4x3.h"
+#include "Renderer.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The scene is a level-sized region full of boxes of mixed sizes, mostly
+// small props with a few big ones, clumped together the way real objects
+// are.  The rays are picking and line of sight rays: they start anywhere
+// in the level and go a good way in a random direction, so some hit
+// nothing, some hit something nearby, and some cross much of the level.
+//
+// Every query is checked against looping over all the boxes, which must
+// give exactly the same answer, for trees from both builders.
+//
+// The mesh is a bumpy terrain grid, the biggest that 16-bit indices allow.
+//
+// For the moving objects, each box is an object's local box, placed by
+// its own matrix, and every object turns and drifts a little each frame.
+// Removed boxes are moved far outside the level before checking against
+// the loop, where no ray can reach them.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kSceneBoxCount = 100000;
+const int	kRayCount = 16384;
+const int	kCheckRayCount = 2048;
+const float	kLevelSize = 1000.0f;
+const int	kGridSize = 256;
+const int	kFrameCount = 30;
+const int	kIncrementalCount = 10000;
+const int	kLineBoxCount = 2000;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randVector
+//
+// Random vector in the cube [-r, r]
+
+static Vector3	randVector(float r) {
+	return Vector3(randFloat(-r, r), randFloat(-r, r), randFloat(-r, r));
+}
+
+//---------------------------------------------------------------------------
+// makeScene
+//
+// Boxes clumped around a few hundred spots in the level
+
+static void	makeScene(std::vector<AABB3> &box, int count) {
+	box.resize(count);
+	std::vector<Vector3>	clump(256);
+	for (int i = 0 ; i < (int)clump.size() ; ++i) {
+		clump[i] = randVector(kLevelSize * .5f);
+	}
+	for (int i = 0 ; i < count ; ++i) {
+		Vector3	c = clump[rand() % clump.size()] + randVector(40.0f);
+		float	size = (rand() % 100 == 0) ? randFloat(5.0f, 30.0f) : randFloat(0.2f, 2.0f);
+		Vector3	h(randFloat(.5f, 1.0f) * size, randFloat(.5f, 1.0f) * size, randFloat(.5f, 1.0f) * size);
+		box[i].min = c - h;
+		box[i].max = c + h;
+	}
+}
+
+//---------------------------------------------------------------------------
+// makeRays
+//
+// Rays from anywhere in the level, a few hundred units long
+
+static void	makeRays(std::vector<Vector3> &org, std::vector<Vector3> &delta, int count) {
+	org.resize(count);
+	delta.resize(count);
+	for (int i = 0 ; i < count ; ++i) {
+		org[i] = randVector(kLevelSize * .5f);
+		Vector3	d = randVector(1.0f);
+		d.normalize();
+		delta[i] = d * randFloat(50.0f, 500.0f);
+
+		// Some axis aligned rays, which have zeros in them
+
+		if (i % 16 == 0) {
+			delta[i] = Vector3(0.0f, -randFloat(50.0f, 500.0f), 0.0f);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// bruteForce
+//
+// Closest hit by testing every box
+
+static float	bruteForce(const std::vector<AABB3> &box, const Vector3 &org, const Vector3 &delta, int *hitIndex) {
+	float	bestT = 1e30f;
+	*hitIndex = -1;
+	for (int i = 0 ; i < (int)box.size() ; ++i) {
+		float	t = box[i].rayIntersect(org, delta);
+		if (t <= 1.0f && t < bestT) {
+			bestT = t;
+			*hitIndex = i;
+		}
+	}
+	return bestT;
+}
+
+//---------------------------------------------------------------------------
+// makeGrid
+//
+// A terrain grid, kGridSize vertices on a side
+
+static void	makeGrid(std::vector<RenderVertex> &vertex, std::vector<RenderTri> &tri) {
+	vertex.resize(kGridSize * kGridSize);
+	for (int z = 0 ; z < kGridSize ; ++z) {
+		for (int x = 0 ; x < kGridSize ; ++x) {
+			RenderVertex	&v = vertex[z * kGridSize + x];
+			v.p = Vector3((float)x * 4.0f, randFloat(0.0f, 3.0f) + 10.0f * sinf(x * .05f) * cosf(z * .07f), (float)z * 4.0f);
+			v.n = Vector3(0.0f, 1.0f, 0.0f);
+			v.u = (float)x / kGridSize;
+			v.v = (float)z / kGridSize;
+		}
+	}
+	tri.clear();
+	for (int z = 0 ; z < kGridSize - 1 ; ++z) {
+		for (int x = 0 ; x < kGridSize - 1 ; ++x) {
+			unsigned short	i = (unsigned short)(z * kGridSize + x);
+			RenderTri	t0 = { { i, (unsigned short)(i + kGridSize), (unsigned short)(i + 1) } };
+			RenderTri	t1 = { { (unsigned short)(i + 1), (unsigned short)(i + kGridSize), (unsigned short)(i + kGridSize + 1) } };
+			tri.push_back(t0);
+			tri.push_back(t1);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// leafBoxCount
+//
+// Number of boxes in the leaves reachable from the root
+
+static int	leafBoxCount(const AABBTree &tree) {
+	const AABBTreeNode	*node = tree.getNodes();
+	int	total = 0;
+	std::vector<int>	stack;
+	if (tree.getNodeCount() > 0) {
+		stack.push_back(0);
+	}
+	while (!stack.empty()) {
+		const AABBTreeNode	&nd = node[stack.back()];
+		stack.pop_back();
+		if (nd.isLeaf()) {
+			total += nd.count;
+		} else {
+			stack.push_back(nd.child);
+			stack.push_back(nd.child + 1);
+		}
+	}
+	return total;
+}
+
+//---------------------------------------------------------------------------
+// checkTree
+//
+// Number of rays for which the tree doesn't give the same closest hit as
+// testing every box
+
+static int	checkTree(const AABBTree &tree, const std::vector<AABB3> &box,
+	const std::vector<Vector3> &org, const std::vector<Vector3> &delta) {
+	int	wrong = 0;
+	for (int i = 0 ; i < (int)org.size() ; ++i) {
+		int	expected, hit;
+		float	expectedT = bruteForce(box, org[i], delta[i], &expected);
+		float	t = tree.rayIntersect(org[i], delta[i], &hit);
+		if (hit != expected || t != expectedT || (tree.rayIntersectAny(org[i], delta[i]) >= 0) != (expected >= 0)) {
+			++wrong;
+		}
+	}
+	return wrong;
+}
+
+//---------------------------------------------------------------------------
+// Objects
+//
+// Moving objects: a local box, and where the object is and which way
+// it's facing
+
+struct Objects {
+	std::vector<AABB3>	localBox;
+	std::vector<Vector3>	position;
+	std::vector<EulerAngles>	orient;
+	std::vector<Matrix4x3>	objectToWorld;
+	std::vector<AABB3>	worldBox;
+
+	void	make(const std::vector<AABB3> &box) {
+		int	n = (int)box.size();
+		localBox.resize(n);
+		position.resize(n);
+		orient.resize(n);
+		objectToWorld.resize(n);
+		worldBox.resize(n);
+		for (int i = 0 ; i < n ; ++i) {
+			position[i] = box[i].center();
+			localBox[i].min = box[i].min - position[i];
+			localBox[i].max = box[i].max - position[i];
+			orient[i] = EulerAngles(randFloat(-kPi, kPi), 0.0f, 0.0f);
+		}
+		update();
+	}
+
+	// Move everything along a bit
+
+	void	step(float distance) {
+		for (int i = 0 ; i < (int)position.size() ; ++i) {
+			position[i] += randVector(distance);
+			orient[i].heading += randFloat(-.1f, .1f);
+		}
+		update();
+	}
+
+	void	update() {
+		for (int i = 0 ; i < (int)position.size() ; ++i) {
+			objectToWorld[i].setupLocalToParent(position[i], orient[i]);
+			worldBox[i].setToTransformedBox(localBox[i], objectToWorld[i]);
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// Correctness
+
+BENCH(aabb_tree_check) {
+	srand(210);
+	std::vector<AABB3>	box;
+	makeScene(box, kSceneBoxCount);
+	std::vector<Vector3>	org, delta;
+	makeRays(org, delta, kCheckRayCount);
+
+	AABBTree	tree;
+	tree.build(&box[0], kSceneBoxCount);
+	run.report("nodes per box", (double)tree.getNodeCount() / kSceneBoxCount, "");
+	run.report("depth", tree.getDepth(), "");
+
+	// Closest and any hit against testing every box
+
+	int	wrongHit = 0, wrongAny = 0, hits = 0;
+	float	normalError = 0.0f;
+	for (int i = 0 ; i < kCheckRayCount ; ++i) {
+		int	expected, hit;
+		float	expectedT = bruteForce(box, org[i], delta[i], &expected);
+		Vector3	n, expectedN;
+		float	t = tree.rayIntersect(org[i], delta[i], &hit, &n);
+		if (hit != expected || t != expectedT) {
+			++wrongHit;
+		}
+		if (hit >= 0) {
+			++hits;
+			box[hit].rayIntersect(org[i], delta[i], &expectedN);
+			normalError = fmax(normalError, distance(n, expectedN));
+		}
+		int	any = tree.rayIntersectAny(org[i], delta[i]);
+		if ((any >= 0) != (expected >= 0) || (any >= 0 && box[any].rayIntersect(org[i], delta[i]) > 1.0f)) {
+			++wrongAny;
+		}
+	}
+	run.report("rays hitting something", (double)hits / kCheckRayCount, "");
+	run.report("closest hit mismatches", wrongHit, "");
+	run.report("closest hit normal error", normalError, "");
+	run.report("any hit mismatches", wrongAny, "");
+
+	// The batch versions
+
+	std::vector<float>	t(kCheckRayCount);
+	std::vector<int>	hit(kCheckRayCount), any(kCheckRayCount);
+	tree.rayIntersect(&org[0], &delta[0], &t[0], &hit[0], kCheckRayCount);
+	tree.rayIntersectAny(&org[0], &delta[0], &any[0], kCheckRayCount);
+	int	wrongBatch = 0;
+	for (int i = 0 ; i < kCheckRayCount ; ++i) {
+		int	h;
+		float	single = tree.rayIntersect(org[i], delta[i], &h);
+		if (h != hit[i] || single != t[i] || any[i] != tree.rayIntersectAny(org[i], delta[i])) {
+			++wrongBatch;
+		}
+	}
+	run.report("batch mismatches", wrongBatch, "");
+
+	// Rays that slide along the top face of a box
+
+	std::vector<Vector3>	faceOrg(256), faceDelta(256, Vector3(20.0f, 0.0f, 0.0f));
+	for (int i = 0 ; i < 256 ; ++i) {
+		const AABB3	&b = box[rand() % kSceneBoxCount];
+		faceOrg[i] = Vector3(b.min.x - 10.0f, b.max.y, b.center().z);
+	}
+	run.report("face ray mismatches", checkTree(tree, box, faceOrg, faceDelta), "");
+
+	// Tiny trees, and rays that start inside a box
+
+	AABBTree	small;
+	small.build(&box[0], 1);
+	int	h;
+	float	inside = small.rayIntersect(box[0].center(), Vector3(1.0f, 0.0f, 0.0f), &h);
+	run.report("ray from inside one box", (inside == 0.0f && h == 0) ? 0 : 1, "");
+	small.build(NULL, 0);
+	run.report("empty tree hit", small.rayIntersectAny(kZeroVector, Vector3(1.0f, 1.0f, 1.0f)) + 1, "");
+
+	// The binned builder.  Its trees must give the same answers, and
+	// shouldn't be much worse.
+
+	AABBTree	binned;
+	binned.build(&box[0], kSceneBoxCount, eAABBTreeBuildBinned);
+	run.report("binned closest hit mismatches", checkTree(binned, box, org, delta), "");
+	AABBTreeStats	sweepStats, binnedStats;
+	tree.getStats(sweepStats);
+	binned.getStats(binnedStats);
+	run.report("sweep SAH cost", sweepStats.sahCost, "");
+	run.report("binned SAH cost", binnedStats.sahCost, "");
+	run.report("binned depth", binnedStats.depth, "");
+	run.report("binned average leaf size", binnedStats.averageLeafSize, "");
+
+	for (int n = 1 ; n <= 9 ; ++n) {
+		small.build(&box[0], n, eAABBTreeBuildBinned);
+		std::vector<AABB3>	few(box.begin(), box.begin() + n);
+		if (checkTree(small, few, org, delta) != 0) {
+			run.report("binned small tree mismatches", n, "boxes");
+		}
+	}
+
+	// Everything on top of everything else, which has no split
+
+	std::vector<AABB3>	same(1000, box[0]);
+	small.build(&same[0], (int)same.size(), eAABBTreeBuildBinned);
+	run.report("identical boxes mismatches", checkTree(small, same, org, delta), "");
+
+	// Triangle bounds, and a tree over them
+
+	std::vector<RenderVertex>	vertex;
+	std::vector<RenderTri>		tri;
+	makeGrid(vertex, tri);
+	std::vector<AABB3>	triBox(tri.size());
+	computeTriangleBounds(&vertex[0], &tri[0], (int)tri.size(), &triBox[0]);
+	int	wrongBounds = 0;
+	for (int i = 0 ; i < (int)tri.size() ; ++i) {
+		AABB3	b;
+		b.empty();
+		for (int j = 0 ; j < 3 ; ++j) {
+			b.add(vertex[tri[i].index[j]].p);
+		}
+		if (b.min != triBox[i].min || b.max != triBox[i].max) {
+			++wrongBounds;
+		}
+	}
+	run.report("triangle bounds mismatches", wrongBounds, "");
+
+	std::vector<Vector3>	down(kCheckRayCount), downDelta(kCheckRayCount, Vector3(0.0f, -100.0f, 0.0f));
+	for (int i = 0 ; i < kCheckRayCount ; ++i) {
+		down[i] = Vector3(randFloat(-10.0f, kGridSize * 4.0f), 50.0f, randFloat(-10.0f, kGridSize * 4.0f));
+	}
+	AABBTree	terrain;
+	terrain.build(&triBox[0], (int)triBox.size(), eAABBTreeBuildBinned);
+	run.report("terrain tree mismatches", checkTree(terrain, triBox, down, downDelta), "");
+}
+
+//---------------------------------------------------------------------------
+// Refitting and incremental updates
+
+BENCH(aabb_tree_update_check) {
+	srand(230);
+	std::vector<AABB3>	box;
+	makeScene(box, kSceneBoxCount);
+	std::vector<Vector3>	org, delta;
+	makeRays(org, delta, kCheckRayCount / 4);
+
+	// Refit while everything drifts, and check the last frame
+
+	Objects	obj;
+	obj.make(box);
+	AABBTree	tree;
+	tree.build(&obj.worldBox[0], kSceneBoxCount, eAABBTreeBuildBinned);
+	AABBTreeStats	stats;
+	for (int frame = 0 ; frame < kFrameCount ; ++frame) {
+		obj.step(1.0f);
+		tree.refit(&obj.localBox[0], &obj.objectToWorld[0]);
+	}
+	run.report("refit mismatches", checkTree(tree, obj.worldBox, org, delta), "");
+	tree.getStats(stats);
+	run.report("SAH cost after build", stats.buildSahCost, "");
+	run.report("SAH cost after refits", stats.sahCost, "");
+	run.report("rebuilt", tree.rebuildIfNeeded() ? 1 : 0, "");
+	tree.getStats(stats);
+	run.report("SAH cost after rebuild", stats.sahCost, "");
+
+	// setBox() and refit() give the same tree as refit(box)
+
+	obj.step(1.0f);
+	for (int i = 0 ; i < kSceneBoxCount ; ++i) {
+		tree.setBox(i, obj.worldBox[i]);
+	}
+	tree.refit();
+	run.report("setBox refit mismatches", checkTree(tree, obj.worldBox, org, delta), "");
+
+	// Remove some, insert some, and move some
+
+	const Vector3	kGone(1e6f, 1e6f, 1e6f);
+	std::vector<AABB3>	world = obj.worldBox;
+	for (int i = 0 ; i < kIncrementalCount ; ++i) {
+		int	k = rand() % kSceneBoxCount;
+		if (tree.contains(k)) {
+			tree.remove(k);
+			world[k].min = world[k].max = kGone;
+		}
+	}
+	std::vector<AABB3>	extra;
+	makeScene(extra, kIncrementalCount);
+	for (int i = 0 ; i < kIncrementalCount ; ++i) {
+		int	k = tree.insert(extra[i]);
+		if (k != (int)world.size()) {
+			run.report("wrong insert index", k, "");
+			break;
+		}
+		world.push_back(extra[i]);
+	}
+	for (int i = 0 ; i < kIncrementalCount ; ++i) {
+		int	k = rand() % (int)world.size();
+		if (tree.contains(k)) {
+			world[k].min += Vector3(5.0f, 0.0f, 0.0f);
+			world[k].max += Vector3(5.0f, 0.0f, 0.0f);
+			tree.moveBox(k, world[k]);
+		}
+	}
+	run.report("incremental mismatches", checkTree(tree, world, org, delta), "");
+	tree.getStats(stats);
+	run.report("incremental depth", stats.depth, "");
+	run.report("incremental SAH cost", stats.sahCost, "");
+
+	// The running SAH cost against working it out from scratch
+
+	float	tracked = tree.getSahCost();
+	tree.refit();
+	run.report("tracked SAH cost error", fabs(tracked - tree.getSahCost()) / tree.getSahCost(), "");
+
+	// Rebuilding keeps the indices
+
+	tree.rebuild();
+	run.report("rebuild mismatches", checkTree(tree, world, org, delta), "");
+	run.report("rebuilt box count error", leafBoxCount(tree) - tree.getBoxCount(), "");
+
+	// Empty it out and fill it up again
+
+	AABBTree	small;
+	small.build(&box[0], 8);
+	for (int i = 0 ; i < 8 ; ++i) {
+		small.remove(i);
+	}
+	run.report("emptied hit", small.rayIntersectAny(kZeroVector, Vector3(1.0f, 1.0f, 1.0f)) + 1, "");
+	std::vector<AABB3>	few(8);
+	for (int i = 0 ; i < 8 ; ++i) {
+		few[i].min = few[i].max = kGone;
+	}
+	for (int i = 0 ; i < 100 ; ++i) {
+		few.push_back(box[i]);
+		small.insert(box[i]);
+	}
+	run.report("refilled mismatches", checkTree(small, few, org, delta), "");
+
+	// Boxes inserted along a line and then moved further along it one
+	// after another, which the rotations turn into a long chain, then
+	// every other one removed.  The tree must never get deeper than the
+	// queries can handle.
+
+	AABBTree	line;
+	std::vector<AABB3>	lineBox(kLineBoxCount);
+	int	deepest = 0;
+	for (int i = 0 ; i < kLineBoxCount ; ++i) {
+		lineBox[i].min = Vector3((float)i, 0.0f, 0.0f);
+		lineBox[i].max = lineBox[i].min + Vector3(1.0f, 1.0f, 1.0f);
+		line.insert(lineBox[i]);
+		deepest = std::max(deepest, line.getDepth());
+	}
+	for (int i = 0 ; i < kLineBoxCount ; ++i) {
+		lineBox[i].min.x += (float)kLineBoxCount;
+		lineBox[i].max.x += (float)kLineBoxCount;
+		line.moveBox(i, lineBox[i]);
+		deepest = std::max(deepest, line.getDepth());
+	}
+	for (int i = 0 ; i < kLineBoxCount ; i += 2) {
+		line.remove(i);
+		lineBox[i].min = lineBox[i].max = kGone;
+		deepest = std::max(deepest, line.getDepth());
+	}
+	run.report("line depth over limit", std::max(0, deepest - kAABBTreeMaxDepth), "");
+	std::vector<Vector3>	lineOrg(256), lineDelta(256);
+	for (int i = 0 ; i < 256 ; ++i) {
+		lineOrg[i] = Vector3(-10.0f, randFloat(0.0f, 1.0f), randFloat(0.0f, 1.0f));
+		lineDelta[i] = Vector3(kLineBoxCount * 3.0f, 0.0f, 0.0f);
+	}
+	run.report("line mismatches", checkTree(line, lineBox, lineOrg, lineDelta), "");
+}
+
+//---------------------------------------------------------------------------
+// Throughput
+
+BENCH(aabb_tree) {
+	srand(211);
+	std::vector<AABB3>	box;
+	makeScene(box, kSceneBoxCount);
+	std::vector<Vector3>	org, delta;
+	makeRays(org, delta, kRayCount);
+
+	AABBTree	tree, binned;
+	double	sweepBuild = run.time("build, 100k boxes", 1, [&]() {
+		tree.build(&box[0], kSceneBoxCount);
+		benchUse((float)tree.getNodeCount());
+	});
+	double	binnedBuild = run.time("binned build, 100k boxes", 1, [&]() {
+		binned.build(&box[0], kSceneBoxCount, eAABBTreeBuildBinned);
+		benchUse((float)binned.getNodeCount());
+	});
+	AABBTreeStats	sweepStats, binnedStats;
+	tree.getStats(sweepStats);
+	binned.getStats(binnedStats);
+	run.report("sweep build time", sweepStats.buildMilliseconds, "ms");
+	run.report("binned build time", binnedStats.buildMilliseconds, "ms");
+	run.report("binned build speedup", sweepBuild / binnedBuild, "x");
+	run.report("binned SAH cost over sweep", binnedStats.sahCost / sweepStats.sahCost, "x");
+
+	// Looping over every box is slow enough that a few rays will do
+
+	const int	kBruteRays = 64;
+	double	brute = run.time("loop over boxes, per ray", kBruteRays, [&]() {
+		int	hit;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kBruteRays ; ++i) {
+			sum += bruteForce(box, org[i], delta[i], &hit);
+		}
+		benchUse(sum);
+	});
+	double	closest = run.time("rayIntersect", kRayCount, [&]() {
+		int	hit;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += tree.rayIntersect(org[i], delta[i], &hit);
+		}
+		benchUse(sum);
+	});
+	run.time("rayIntersectAny", kRayCount, [&]() {
+		int	sum = 0;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += tree.rayIntersectAny(org[i], delta[i]);
+		}
+		benchUse((float)sum);
+	});
+	run.report("speedup over loop", brute / closest, "x");
+
+	std::vector<float>	t(kRayCount);
+	std::vector<int>	hit(kRayCount);
+	run.time("rayIntersect batch", kRayCount, [&]() {
+		tree.rayIntersect(&org[0], &delta[0], &t[0], &hit[0], kRayCount);
+		benchUse(t[kRayCount - 1]);
+	});
+	run.time("rayIntersectAny batch", kRayCount, [&]() {
+		tree.rayIntersectAny(&org[0], &delta[0], &hit[0], kRayCount);
+		benchUse((float)hit[kRayCount - 1]);
+	});
+	run.time("rayIntersect, binned tree", kRayCount, [&]() {
+		int	h;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += binned.rayIntersect(org[i], delta[i], &h);
+		}
+		benchUse(sum);
+	});
+
+	// Bounds and a tree for a mesh
+
+	std::vector<RenderVertex>	vertex;
+	std::vector<RenderTri>		tri;
+	makeGrid(vertex, tri);
+	std::vector<AABB3>	triBox(tri.size());
+	run.time("computeTriangleBounds", (int)tri.size(), [&]() {
+		computeTriangleBounds(&vertex[0], &tri[0], (int)tri.size(), &triBox[0]);
+		benchUse(triBox[tri.size() - 1].max.y);
+	});
+	run.time("binned build, terrain", 1, [&]() {
+		binned.build(&triBox[0], (int)triBox.size(), eAABBTreeBuildBinned);
+		benchUse((float)binned.getNodeCount());
+	});
+}
+
+BENCH(aabb_tree_update) {
+	srand(231);
+	std::vector<AABB3>	box;
+	makeScene(box, kSceneBoxCount);
+	std::vector<Vector3>	org, delta;
+	makeRays(org, delta, kRayCount);
+	Objects	obj;
+	obj.make(box);
+	obj.step(1.0f);
+
+	AABBTree	tree;
+	tree.build(&obj.worldBox[0], kSceneBoxCount, eAABBTreeBuildBinned);
+	double	rebuild = run.time("binned rebuild, 100k boxes", 1, [&]() {
+		tree.build(&obj.worldBox[0], kSceneBoxCount, eAABBTreeBuildBinned);
+		benchUse(tree.getSahCost());
+	});
+	double	refit = run.time("refit, 100k boxes", 1, [&]() {
+		tree.refit(&obj.worldBox[0]);
+		benchUse(tree.getSahCost());
+	});
+	run.time("refit with transforms, 100k boxes", 1, [&]() {
+		tree.refit(&obj.localBox[0], &obj.objectToWorld[0]);
+		benchUse(tree.getSahCost());
+	});
+	run.report("refit speedup over rebuild", rebuild / refit, "x");
+
+	// After a lot of drifting, how much slower are the rays, and does
+	// rebuilding when the SAH cost says so get it back?
+
+	for (int frame = 0 ; frame < kFrameCount ; ++frame) {
+		obj.step(2.0f);
+		tree.refit(&obj.localBox[0], &obj.objectToWorld[0]);
+	}
+	AABBTreeStats	stats;
+	tree.getStats(stats);
+	run.report("SAH cost growth from refits", stats.sahCost / stats.buildSahCost, "x");
+	auto	traceRays = [&]() {
+		int	hit;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += tree.rayIntersect(org[i], delta[i], &hit);
+		}
+		benchUse(sum);
+	};
+	double	refitRays = run.time("rayIntersect, refit tree", kRayCount, traceRays);
+	tree.rebuildIfNeeded();
+	double	rebuiltRays = run.time("rayIntersect, rebuilt tree", kRayCount, traceRays);
+	run.report("refit ray cost over rebuilt", refitRays / rebuiltRays, "x");
+
+	// Incremental updates, per box.  Each call has to leave the tree
+	// the way it found it.
+
+	std::vector<AABB3>	extra;
+	makeScene(extra, kIncrementalCount);
+	std::vector<int>	index(kIncrementalCount);
+	run.time("insert and remove", kIncrementalCount, [&]() {
+		for (int i = 0 ; i < kIncrementalCount ; ++i) {
+			index[i] = tree.insert(extra[i]);
+		}
+		for (int i = 0 ; i < kIncrementalCount ; ++i) {
+			tree.remove(index[i]);
+		}
+		benchUse((float)tree.getBoxCount());
+	});
+	for (int i = 0 ; i < kIncrementalCount ; ++i) {
+		index[i] = tree.insert(extra[i]);
+	}
+	float	offset = 0.0f;
+	run.time("moveBox", kIncrementalCount, [&]() {
+		offset = (offset > 0.0f) ? 0.0f : 1.0f;
+		for (int i = 0 ; i < kIncrementalCount ; ++i) {
+			AABB3	b = extra[i];
+			b.min.y += offset;
+			b.max.y += offset;
+			tree.moveBox(index[i], b);
+		}
+		benchUse(tree.getSahCost());
+	});
+}
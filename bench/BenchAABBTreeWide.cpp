@@ -0,0 +1,287 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchAABBTreeWide.cpp - Benchmarks and checks for the wide bounding
+// volume hierarchy
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "AABB3.h"
+#include "AABBTree.h"
+#include "AABBTreeWide.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The scene is the same sort of level as in BenchAABBTree.cpp.  There are
+// two kinds of rays.  The random rays go every which way, like picking
+// and line of sight rays, and are the worst case for packets.  The camera
+// rays come from one eye point through the pixels of a small screen, in
+// scanline order, so each packet is a run of neighboring pixels.
+//
+// Every query is checked against the binary tree, which must give
+// exactly the same answer.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kSceneBoxCount = 100000;
+const int	kRayCount = 16384;
+const int	kCheckRayCount = 2048;
+const float	kLevelSize = 1000.0f;
+const int	kScreenWidth = 128;
+const int	kScreenHeight = 128;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randVector
+//
+// Random vector in the cube [-r, r]
+
+static Vector3	randVector(float r) {
+	return Vector3(randFloat(-r, r), randFloat(-r, r), randFloat(-r, r));
+}
+
+//---------------------------------------------------------------------------
+// makeScene
+//
+// Boxes clumped around a few hundred spots in the level
+
+static void	makeScene(std::vector<AABB3> &box, int count) {
+	box.resize(count);
+	std::vector<Vector3>	clump(256);
+	for (int i = 0 ; i < (int)clump.size() ; ++i) {
+		clump[i] = randVector(kLevelSize * .5f);
+	}
+	for (int i = 0 ; i < count ; ++i) {
+		Vector3	c = clump[rand() % clump.size()] + randVector(40.0f);
+		float	size = (rand() % 100 == 0) ? randFloat(5.0f, 30.0f) : randFloat(0.2f, 2.0f);
+		Vector3	h(randFloat(.5f, 1.0f) * size, randFloat(.5f, 1.0f) * size, randFloat(.5f, 1.0f) * size);
+		box[i].min = c - h;
+		box[i].max = c + h;
+	}
+}
+
+//---------------------------------------------------------------------------
+// makeRays
+//
+// Random rays from anywhere in the level, with some axis aligned ones
+
+static void	makeRays(std::vector<Vector3> &org, std::vector<Vector3> &delta, int count) {
+	org.resize(count);
+	delta.resize(count);
+	for (int i = 0 ; i < count ; ++i) {
+		org[i] = randVector(kLevelSize * .5f);
+		Vector3	d = randVector(1.0f);
+		d.normalize();
+		delta[i] = d * randFloat(50.0f, 500.0f);
+		if (i % 16 == 0) {
+			delta[i] = Vector3(0.0f, -randFloat(50.0f, 500.0f), 0.0f);
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// makeCameraRays
+//
+// One ray per pixel from an eye at the edge of the level, looking in
+// toward the middle, in scanline order
+
+static void	makeCameraRays(std::vector<Vector3> &org, std::vector<Vector3> &delta) {
+	Vector3	eye(-kLevelSize * .45f, 20.0f, -kLevelSize * .4f);
+	Vector3	forward = -eye;
+	forward.normalize();
+	Vector3	right = crossProduct(Vector3(0.0f, 1.0f, 0.0f), forward);
+	right.normalize();
+	Vector3	up = crossProduct(forward, right);
+	org.assign(kScreenWidth * kScreenHeight, eye);
+	delta.resize(kScreenWidth * kScreenHeight);
+	for (int y = 0 ; y < kScreenHeight ; ++y) {
+		for (int x = 0 ; x < kScreenWidth ; ++x) {
+			float	sx = ((float)x + .5f) / kScreenWidth * 2.0f - 1.0f;
+			float	sy = 1.0f - ((float)y + .5f) / kScreenHeight * 2.0f;
+			Vector3	d = forward + right * (sx * .6f) + up * (sy * .6f);
+			d.normalize();
+			delta[y * kScreenWidth + x] = d * kLevelSize;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// checkWide
+//
+// Number of rays for which the wide tree, traced one at a time, in a
+// batch, or in packets, doesn't give the same answer as the binary tree
+
+static int	checkWide(const AABBTree &tree, const AABBTreeWide &wide,
+	const std::vector<Vector3> &org, const std::vector<Vector3> &delta) {
+	int	count = (int)org.size();
+	std::vector<float>	t(count), packetT(count);
+	std::vector<int>	hit(count), any(count), packetHit(count);
+	wide.rayIntersect(&org[0], &delta[0], &t[0], &hit[0], count);
+	wide.rayIntersectAny(&org[0], &delta[0], &any[0], count);
+	wide.rayIntersectPackets(&org[0], &delta[0], &packetT[0], &packetHit[0], count);
+	int	wrong = 0;
+	for (int i = 0 ; i < count ; ++i) {
+		int	expected, h;
+		float	expectedT = tree.rayIntersect(org[i], delta[i], &expected);
+		float	single = wide.rayIntersect(org[i], delta[i], &h);
+		if (h != expected || single != expectedT
+			|| hit[i] != expected || t[i] != expectedT
+			|| packetHit[i] != expected || packetT[i] != expectedT
+			|| (any[i] >= 0) != (expected >= 0)
+			|| any[i] != wide.rayIntersectAny(org[i], delta[i])) {
+			++wrong;
+		}
+	}
+	return wrong;
+}
+
+//---------------------------------------------------------------------------
+BENCH(aabb_tree_wide_check) {
+	srand(240);
+	std::vector<AABB3>	box;
+	makeScene(box, kSceneBoxCount);
+
+	AABBTree	tree;
+	tree.build(&box[0], kSceneBoxCount);
+	AABBTreeWide	wide;
+	wide.build(tree);
+	run.report("node width", kWideNodeWidth, "");
+	run.report("wide nodes per binary node", (double)wide.getNodeCount() / tree.getNodeCount(), "");
+	run.report("wide depth", wide.getDepth(), "");
+
+	std::vector<Vector3>	org, delta;
+	makeRays(org, delta, kCheckRayCount);
+	run.report("random ray mismatches", checkWide(tree, wide, org, delta), "");
+
+	// Coherent rays, with a short packet at the end
+
+	makeCameraRays(org, delta);
+	org.resize(org.size() - 3);
+	delta.resize(delta.size() - 3);
+	run.report("camera ray mismatches", checkWide(tree, wide, org, delta), "");
+
+	// Rays that slide along the top face of a box, and rays along each
+	// axis, both ways, which mix signs within a packet
+
+	std::vector<Vector3>	faceOrg(256), faceDelta(256);
+	for (int i = 0 ; i < 256 ; ++i) {
+		const AABB3	&b = box[rand() % kSceneBoxCount];
+		faceOrg[i] = Vector3(b.min.x - 10.0f, b.max.y, b.center().z);
+		faceDelta[i] = Vector3(20.0f, 0.0f, 0.0f);
+	}
+	run.report("face ray mismatches", checkWide(tree, wide, faceOrg, faceDelta), "");
+	for (int i = 0 ; i < 256 ; ++i) {
+		faceOrg[i] = randVector(kLevelSize * .5f);
+		faceDelta[i] = Vector3(0.0f, 0.0f, 0.0f);
+		(&faceDelta[i].x)[i % 3] = (i & 4) ? 300.0f : -300.0f;
+	}
+	run.report("axis ray mismatches", checkWide(tree, wide, faceOrg, faceDelta), "");
+
+	// A tree with holes left by remove(), and a tree of one box
+
+	for (int i = 0 ; i < kSceneBoxCount ; i += 3) {
+		tree.remove(i);
+	}
+	wide.build(tree);
+	makeRays(org, delta, kCheckRayCount);
+	run.report("mismatches after remove", checkWide(tree, wide, org, delta), "");
+
+	tree.build(&box[0], 1);
+	wide.build(tree);
+	int	h;
+	float	inside = wide.rayIntersect(box[0].center(), Vector3(1.0f, 0.0f, 0.0f), &h);
+	run.report("ray from inside one box", (inside == 0.0f && h == 0) ? 0 : 1, "");
+}
+
+//---------------------------------------------------------------------------
+BENCH(aabb_tree_wide) {
+	srand(241);
+	std::vector<AABB3>	box;
+	makeScene(box, kSceneBoxCount);
+	AABBTree	tree;
+	tree.build(&box[0], kSceneBoxCount);
+	AABBTreeWide	wide;
+	run.time("collapse, 100k boxes", 1, [&]() {
+		wide.build(tree);
+		benchUse((float)wide.getNodeCount());
+	});
+
+	std::vector<Vector3>	org, delta;
+	makeRays(org, delta, kRayCount);
+	double	binary = run.time("binary rayIntersect, random", kRayCount, [&]() {
+		int	hit;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += tree.rayIntersect(org[i], delta[i], &hit);
+		}
+		benchUse(sum);
+	});
+	double	single = run.time("wide rayIntersect, random", kRayCount, [&]() {
+		int	hit;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += wide.rayIntersect(org[i], delta[i], &hit);
+		}
+		benchUse(sum);
+	});
+	run.time("wide rayIntersectAny, random", kRayCount, [&]() {
+		int	sum = 0;
+		for (int i = 0 ; i < kRayCount ; ++i) {
+			sum += wide.rayIntersectAny(org[i], delta[i]);
+		}
+		benchUse((float)sum);
+	});
+	std::vector<float>	t(kRayCount);
+	std::vector<int>	hit(kRayCount);
+	double	packets = run.time("wide packets, random", kRayCount, [&]() {
+		wide.rayIntersectPackets(&org[0], &delta[0], &t[0], &hit[0], kRayCount);
+		benchUse(t[kRayCount - 1]);
+	});
+	run.report("wide speedup, random", binary / single, "x");
+	run.report("packet speedup, random", binary / packets, "x");
+
+	makeCameraRays(org, delta);
+	int	cameraCount = (int)org.size();
+	t.resize(cameraCount);
+	hit.resize(cameraCount);
+	binary = run.time("binary rayIntersect, camera", cameraCount, [&]() {
+		int	h;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < cameraCount ; ++i) {
+			sum += tree.rayIntersect(org[i], delta[i], &h);
+		}
+		benchUse(sum);
+	});
+	single = run.time("wide rayIntersect, camera", cameraCount, [&]() {
+		int	h;
+		float	sum = 0.0f;
+		for (int i = 0 ; i < cameraCount ; ++i) {
+			sum += wide.rayIntersect(org[i], delta[i], &h);
+		}
+		benchUse(sum);
+	});
+	packets = run.time("wide packets, camera", cameraCount, [&]() {
+		wide.rayIntersectPackets(&org[0], &delta[0], &t[0], &hit[0], cameraCount);
+		benchUse(t[cameraCount - 1]);
+	});
+	run.report("wide speedup, camera", binary / single, "x");
+	run.report("packet speedup, camera", binary / packets, "x");
+}
@@ -0,0 +1,201 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchAnimation.cpp - Benchmarks for animation sampling
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "AnimationClip.h"
+#include "Quaternion.h"
+#include "Matrix4x3.h"
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The clip is a typical character: 64 bones, keyed at 30 frames per
+// second for four seconds.  Each frame, every instance moves forward by
+// one 60 Hz frame and then the whole crowd is sampled.  Times are per
+// track.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kAnimTrackCount = 64;
+const int	kAnimKeyCount = 121;
+const int	kAnimInstanceCount = 1000;
+const float	kAnimFrameTime = 1.0f / 60.0f;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// buildClip
+//
+// Fill a clip with random keys
+
+static void	buildClip(AnimationClip &clip) {
+	std::vector<int>	keyCount(kAnimTrackCount, kAnimKeyCount);
+	clip.allocateMemory(kAnimTrackCount, &keyCount[0]);
+	for (int i = 0 ; i < kAnimTrackCount ; ++i) {
+		for (int k = 0 ; k < kAnimKeyCount ; ++k) {
+			Quaternion	q;
+			q.w = randFloat(0.5f, 1.0f);
+			q.x = randFloat(-0.3f, 0.3f);
+			q.y = randFloat(-0.3f, 0.3f);
+			q.z = randFloat(-0.3f, 0.3f);
+			q.normalize();
+			clip.setKey(i, k, k / 30.0f, q, Vector3(randFloat(-1.0f, 1.0f), 0.0f, 0.0f));
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// sampleBySearch
+//
+// The obvious way: binary search each track for its keys, slerp, and
+// build the matrix, one track at a time
+
+static void	sampleBySearch(const AnimationClip &clip, float time, Matrix4x3 *localToParent) {
+	const float		*keyTime = clip.getKeyTimes();
+	const Quaternion	*keyRotation = clip.getRotationKeys();
+	const Vector3Array	&keyTranslation = clip.getTranslationKeys();
+
+	for (int i = 0 ; i < clip.getTrackCount() ; ++i) {
+		int	lo = clip.getFirstKey(i);
+		int	hi = lo + clip.getKeyCount(i) - 2;
+		while (lo < hi) {
+			int	mid = (lo + hi + 1) >> 1;
+			if (keyTime[mid] <= time) lo = mid; else hi = mid - 1;
+		}
+		float	t = (time - keyTime[lo]) / (keyTime[lo + 1] - keyTime[lo]);
+		if (t < 0.0f) t = 0.0f;
+		if (t > 1.0f) t = 1.0f;
+
+		Matrix4x3	&m = localToParent[i];
+		m.fromQuaternion(slerp(keyRotation[lo], keyRotation[lo + 1], t));
+		m.setTranslation(keyTranslation.get(lo) * (1.0f - t) + keyTranslation.get(lo + 1) * t);
+	}
+}
+
+//---------------------------------------------------------------------------
+// One instance, played forward a frame at a time
+
+BENCH(animation_sample) {
+	srand(5);
+	AnimationClip		clip;
+	buildClip(clip);
+	AnimationSampler	sampler;
+	sampler.bind(&clip);
+	std::vector<Matrix4x3>	pose(kAnimTrackCount);
+
+	float	time = 0.0f;
+	float	duration = clip.getDuration();
+	double	search = run.time("binary search + slerp", kAnimTrackCount, [&]() {
+		time += kAnimFrameTime;
+		if (time > duration) time = 0.0f;
+		sampleBySearch(clip, time, &pose[0]);
+		benchUse(pose[kAnimTrackCount - 1].tx);
+	});
+
+	double	exact = run.time("sampler exact", kAnimTrackCount, [&]() {
+		time += kAnimFrameTime;
+		if (time > duration) time = 0.0f;
+		sampler.sample(time, &pose[0], eSlerpModeExact);
+		benchUse(pose[kAnimTrackCount - 1].tx);
+	});
+
+	double	fast = run.time("sampler fast", kAnimTrackCount, [&]() {
+		time += kAnimFrameTime;
+		if (time > duration) time = 0.0f;
+		sampler.sample(time, &pose[0]);
+		benchUse(pose[kAnimTrackCount - 1].tx);
+	});
+
+	run.time("sampler fast, random times", kAnimTrackCount, [&]() {
+		sampler.sample(randFloat(0.0f, duration), &pose[0]);
+		benchUse(pose[kAnimTrackCount - 1].tx);
+	});
+
+	run.report("speedup exact", search / exact, "x");
+	run.report("speedup fast", search / fast, "x");
+
+	// Copies of a sampler, in a vector that grows, must play back the
+	// same as the original
+
+	std::vector<AnimationSampler>	copies;
+	for (int i = 0 ; i < 64 ; ++i) {
+		copies.push_back(sampler);
+	}
+	std::vector<Matrix4x3>	copyPose(kAnimTrackCount);
+	int	wrong = 0;
+	for (int frame = 0 ; frame < 16 ; ++frame) {
+		time += kAnimFrameTime;
+		if (time > duration) time = 0.0f;
+		sampler.sample(time, &pose[0]);
+		copies[frame].sample(time, &copyPose[0]);
+		for (int i = 0 ; i < kAnimTrackCount ; ++i) {
+			if (copyPose[i].tx != pose[i].tx || copyPose[i].m11 != pose[i].m11) {
+				++wrong;
+			}
+		}
+	}
+	run.report("copied sampler mismatches", wrong, "");
+}
+
+//---------------------------------------------------------------------------
+// A crowd, each instance at a different point in the clip
+
+BENCH(animation_crowd) {
+	srand(6);
+	AnimationClip	clip;
+	buildClip(clip);
+
+	std::vector<AnimationSampler>	sampler(kAnimInstanceCount);
+	std::vector<float>		time(kAnimInstanceCount);
+	std::vector<Matrix4x3>		pose(kAnimInstanceCount * kAnimTrackCount);
+	std::vector<Matrix4x3 *>	posePtr(kAnimInstanceCount);
+	for (int i = 0 ; i < kAnimInstanceCount ; ++i) {
+		sampler[i].bind(&clip);
+		time[i] = randFloat(0.0f, clip.getDuration());
+		posePtr[i] = &pose[i * kAnimTrackCount];
+	}
+
+	float	duration = clip.getDuration();
+	auto	step = [&]() {
+		for (int i = 0 ; i < kAnimInstanceCount ; ++i) {
+			time[i] += kAnimFrameTime;
+			if (time[i] > duration) time[i] = 0.0f;
+		}
+	};
+
+	int	threads = getWorkerThreadCount();
+	setWorkerThreadCount(1);
+	double	one = run.time("sampleInstances 1 thread", kAnimInstanceCount * kAnimTrackCount, [&]() {
+		step();
+		sampleInstances(&sampler[0], &time[0], &posePtr[0], kAnimInstanceCount);
+		benchUse(pose[0].tx);
+	});
+	setWorkerThreadCount(threads);
+	double	all = run.time("sampleInstances all threads", kAnimInstanceCount * kAnimTrackCount, [&]() {
+		step();
+		sampleInstances(&sampler[0], &time[0], &posePtr[0], kAnimInstanceCount);
+		benchUse(pose[0].tx);
+	});
+
+	run.report("frame time 1 thread", one * kAnimInstanceCount * kAnimTrackCount * 1e-6, "ms");
+	run.report("frame time all threads", all * kAnimInstanceCount * kAnimTrackCount * 1e-6, "ms");
+}
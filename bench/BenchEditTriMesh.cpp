@@ -0,0 +1,74 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchEditTriMesh.cpp - Benchmarks for the edit mesh normal computation
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+
+#include "Bench.h"
+#include "EditTriMesh.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The mesh is a bumpy square grid, two triangles per cell, so most
+// vertices are shared by six triangles, like a typical closed mesh.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kGridSize = 256;
+
+//---------------------------------------------------------------------------
+// makeGrid
+//
+// Build a kGridSize x kGridSize vertex height field
+
+static void	makeGrid(EditTriMesh &mesh) {
+	mesh.empty();
+	mesh.setVertexCount(kGridSize * kGridSize);
+	for (int z = 0 ; z < kGridSize ; ++z) {
+		for (int x = 0 ; x < kGridSize ; ++x) {
+			EditTriMesh::Vertex	&v = mesh.vertex(z*kGridSize + x);
+			v.p = Vector3((float)x, sin(x * 0.3f) * cos(z * 0.2f) * 2.0f, (float)z);
+		}
+	}
+
+	int	cells = kGridSize - 1;
+	mesh.setTriCount(cells * cells * 2);
+	for (int z = 0 ; z < cells ; ++z) {
+		for (int x = 0 ; x < cells ; ++x) {
+			int	i = z*kGridSize + x;
+			EditTriMesh::Tri	&t0 = mesh.tri((z*cells + x) * 2);
+			t0.v[0].index = i;
+			t0.v[1].index = i + kGridSize;
+			t0.v[2].index = i + 1;
+			EditTriMesh::Tri	&t1 = mesh.tri((z*cells + x) * 2 + 1);
+			t1.v[0].index = i + 1;
+			t1.v[1].index = i + kGridSize;
+			t1.v[2].index = i + kGridSize + 1;
+		}
+	}
+}
+
+//---------------------------------------------------------------------------
+// Triangle and vertex normals
+
+BENCH(edittrimesh_normals) {
+	EditTriMesh	mesh;
+	makeGrid(mesh);
+
+	run.time("computeTriNormals", mesh.triCount(), [&]() {
+		mesh.computeTriNormals();
+		benchUse(mesh.tri(mesh.triCount() - 1).normal.y);
+	});
+	run.time("computeVertexNormals", mesh.vertexCount(), [&]() {
+		mesh.computeVertexNormals();
+		benchUse(mesh.vertex(mesh.vertexCount() - 1).normal.y);
+	});
+}
@@ -0,0 +1,155 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchEulerAngles.cpp - Benchmarks for the batch Euler angle conversions
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "EulerAnglesArray.h"
+#include "Vector3Array.h"
+#include "RotationMatrix.h"
+#include "Quaternion.h"
+#include "Matrix4x3.h"
+#include "MathUtil.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// About the number of entities a big scene updates each frame.  Each
+// conversion is timed one element at a time with the member functions,
+// then with the batch version over the same data.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kEulerCount = 32768;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// Euler angles to matrices and quaternions
+
+BENCH(euler_to_rotation) {
+	srand(12);
+	std::vector<EulerAngles>	e(kEulerCount);
+	std::vector<Vector3>		p(kEulerCount);
+	for (int i = 0 ; i < kEulerCount ; ++i) {
+		e[i] = EulerAngles(randFloat(-kPi, kPi), randFloat(-kPiOver2, kPiOver2), randFloat(-kPi, kPi));
+		p[i] = Vector3(randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f));
+	}
+	EulerAnglesArray	orient;
+	orient.gather(&e[0], kEulerCount);
+	Vector3Array		pos;
+	pos.gather(&p[0], kEulerCount);
+
+	std::vector<RotationMatrix>	r(kEulerCount);
+	std::vector<Quaternion>		q(kEulerCount);
+	std::vector<Matrix4x3>		m(kEulerCount);
+
+	double	single = run.time("RotationMatrix::setup", kEulerCount, [&]() {
+		for (int i = 0 ; i < kEulerCount ; ++i) {
+			r[i].setup(e[i]);
+		}
+		benchUse(r[kEulerCount - 1].m11);
+	});
+	double	batch = run.time("setupRotationMatrices", kEulerCount, [&]() {
+		setupRotationMatrices(&r[0], orient);
+		benchUse(r[kEulerCount - 1].m11);
+	});
+	run.report("rotation matrix speedup", single / batch, "x");
+
+	single = run.time("Quaternion::setToRotateObjectToInertial", kEulerCount, [&]() {
+		for (int i = 0 ; i < kEulerCount ; ++i) {
+			q[i].setToRotateObjectToInertial(e[i]);
+		}
+		benchUse(q[kEulerCount - 1].w);
+	});
+	batch = run.time("setToRotateObjectToInertial batch", kEulerCount, [&]() {
+		setToRotateObjectToInertial(&q[0], orient);
+		benchUse(q[kEulerCount - 1].w);
+	});
+	run.report("quaternion speedup", single / batch, "x");
+
+	single = run.time("Matrix4x3::setupLocalToParent", kEulerCount, [&]() {
+		for (int i = 0 ; i < kEulerCount ; ++i) {
+			m[i].setupLocalToParent(p[i], e[i]);
+		}
+		benchUse(m[kEulerCount - 1].tx);
+	});
+	batch = run.time("setupLocalToParent batch", kEulerCount, [&]() {
+		setupLocalToParent(&m[0], pos, orient);
+		benchUse(m[kEulerCount - 1].tx);
+	});
+	run.report("local->parent speedup", single / batch, "x");
+}
+
+//---------------------------------------------------------------------------
+// Back to Euler angles, and canonizing
+
+BENCH(rotation_to_euler) {
+	srand(13);
+	std::vector<EulerAngles>	e(kEulerCount);
+	for (int i = 0 ; i < kEulerCount ; ++i) {
+		e[i] = EulerAngles(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f));
+	}
+	EulerAnglesArray	orient, result;
+	orient.gather(&e[0], kEulerCount);
+
+	std::vector<RotationMatrix>	r(kEulerCount);
+	std::vector<Quaternion>		q(kEulerCount);
+	setupRotationMatrices(&r[0], orient);
+	setToRotateObjectToInertial(&q[0], orient);
+
+	std::vector<EulerAngles>	out(kEulerCount);
+	double	single = run.time("EulerAngles::fromRotationMatrix", kEulerCount, [&]() {
+		for (int i = 0 ; i < kEulerCount ; ++i) {
+			out[i].fromRotationMatrix(r[i]);
+		}
+		benchUse(out[kEulerCount - 1].heading);
+	});
+	double	batch = run.time("fromRotationMatrices", kEulerCount, [&]() {
+		fromRotationMatrices(result, &r[0], kEulerCount);
+		benchUse(result.heading[kEulerCount - 1]);
+	});
+	run.report("from matrix speedup", single / batch, "x");
+
+	single = run.time("EulerAngles::fromObjectToInertialQuaternion", kEulerCount, [&]() {
+		for (int i = 0 ; i < kEulerCount ; ++i) {
+			out[i].fromObjectToInertialQuaternion(q[i]);
+		}
+		benchUse(out[kEulerCount - 1].heading);
+	});
+	batch = run.time("fromObjectToInertialQuaternions", kEulerCount, [&]() {
+		fromObjectToInertialQuaternions(result, &q[0], kEulerCount);
+		benchUse(result.heading[kEulerCount - 1]);
+	});
+	run.report("from quaternion speedup", single / batch, "x");
+
+	single = run.time("EulerAngles::canonize", kEulerCount, [&]() {
+		for (int i = 0 ; i < kEulerCount ; ++i) {
+			out[i] = e[i];
+			out[i].canonize();
+		}
+		benchUse(out[kEulerCount - 1].heading);
+	});
+	batch = run.time("canonize batch", kEulerCount, [&]() {
+		result = orient;
+		canonize(result);
+		benchUse(result.heading[kEulerCount - 1]);
+	});
+	run.report("canonize speedup", single / batch, "x");
+}
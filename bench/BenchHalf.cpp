@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchHalf.cpp - Benchmarks and checks for the half precision types
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "Half.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The check runs every one of the 65536 half values through float and
+// back, which must give the same bits (NaNs just have to stay NaN), and
+// converts random floats of all magnitudes both ways to make sure the
+// array versions match the single value versions bit for bit.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kHalfCount = 1 << 18;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// Exactness and agreement with the single value versions
+
+BENCH(half_check) {
+	std::vector<Half>	h(65536), h2(65536);
+	std::vector<float>	f(65536);
+	for (int i = 0 ; i < 65536 ; ++i) {
+		h[i].bits = (unsigned short)i;
+	}
+	halfToFloat(&f[0], &h[0], 65536);
+	floatToHalf(&h2[0], &f[0], 65536);
+	int	roundTripErrors = 0;
+	for (int i = 0 ; i < 65536 ; ++i) {
+		bool	isNan = (i & 0x7fff) > 0x7c00;
+		if (isNan ? !(f[i] != f[i]) : h2[i].bits != h[i].bits) ++roundTripErrors;
+		if (!isNan && halfBitsToFloat(h[i].bits) != f[i]) ++roundTripErrors;
+	}
+	run.report("half->float->half errors", roundTripErrors, "");
+
+	// Random floats from tiny denormals to overflow, and the relative
+	// error of the ones in the normal range
+
+	srand(14);
+	std::vector<float>	src(kHalfCount), back(kHalfCount);
+	std::vector<Half>	packed(kHalfCount);
+	for (int i = 0 ; i < kHalfCount ; ++i) {
+		src[i] = ldexpf(randFloat(-1.0f, 1.0f), rand() % 48 - 30);
+	}
+	floatToHalf(&packed[0], &src[0], kHalfCount);
+	halfToFloat(&back[0], &packed[0], kHalfCount);
+	int	mismatches = 0;
+	double	maxRelError = 0.0;
+	for (int i = 0 ; i < kHalfCount ; ++i) {
+		if (packed[i].bits != Half(src[i]).bits) ++mismatches;
+		if (back[i] != (float)packed[i]) ++mismatches;
+		float	a = fabsf(src[i]);
+		if (a >= 6.103515625e-05f && a <= 65504.0f) {
+			maxRelError = fmax(maxRelError, fabs((back[i] - src[i]) / src[i]));
+		}
+	}
+	run.report("single/batch mismatches", mismatches, "");
+	run.report("max relative error", maxRelError, "");
+}
+
+//---------------------------------------------------------------------------
+// Throughput
+
+BENCH(half) {
+	srand(15);
+	std::vector<float>	src(kHalfCount), dst(kHalfCount);
+	std::vector<Half>	packed(kHalfCount);
+	for (int i = 0 ; i < kHalfCount ; ++i) {
+		src[i] = randFloat(-1000.0f, 1000.0f);
+	}
+
+	double	single = run.time("Half(float) loop", kHalfCount, [&]() {
+		for (int i = 0 ; i < kHalfCount ; ++i) {
+			packed[i] = Half(src[i]);
+		}
+		benchUse(packed[kHalfCount - 1]);
+	});
+	double	batch = run.time("floatToHalf", kHalfCount, [&]() {
+		floatToHalf(&packed[0], &src[0], kHalfCount);
+		benchUse(packed[kHalfCount - 1]);
+	});
+	run.report("float->half speedup", single / batch, "x");
+
+	single = run.time("(float)Half loop", kHalfCount, [&]() {
+		for (int i = 0 ; i < kHalfCount ; ++i) {
+			dst[i] = packed[i];
+		}
+		benchUse(dst[kHalfCount - 1]);
+	});
+	batch = run.time("halfToFloat", kHalfCount, [&]() {
+		halfToFloat(&dst[0], &packed[0], kHalfCount);
+		benchUse(dst[kHalfCount - 1]);
+	});
+	run.report("half->float speedup", single / batch, "x");
+
+	// Unpacking half normals against just copying float ones
+
+	const int	kNormals = kHalfCount / 3;
+	std::vector<Vector3>		normals(kNormals), out(kNormals);
+	std::vector<HalfVector3>	halfNormals(kNormals);
+	for (int i = 0 ; i < kNormals ; ++i) {
+		normals[i] = Vector3(src[3*i], src[3*i + 1], src[3*i + 2]);
+		normals[i].normalize();
+	}
+	packHalfVector3(&halfNormals[0], &normals[0], kNormals);
+	run.time("copy Vector3 normals", kNormals, [&]() {
+		out = normals;
+		benchUse(out[kNormals - 1].x);
+	});
+	run.time("unpackHalfVector3", kNormals, [&]() {
+		unpackHalfVector3(&out[0], &halfNormals[0], kNormals);
+		benchUse(out[kNormals - 1].x);
+	});
+}
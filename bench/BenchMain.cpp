@@ -0,0 +1,276 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchMain.cpp - Driver for the math kernel benchmarks
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Bench.h"
+#include "Parallel.h"
+#include "Simd.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Usage: bench [options] [filter]
+//
+//   --threads 1,2,4   Run the cases once for each worker thread count,
+//                     and print how each timing scales with the count.
+//                     The default is one run with the default count.
+//   --json file       Also write every measurement to file as JSON, so
+//                     results can be compared between releases.
+//   --min-time secs   Time spent measuring each variant (default 0.1)
+//   --list            Print the case names and exit
+//
+// Runs every registered case whose name contains filter (or all of them,
+// if no filter is given) and prints one line per measurement.
+//
+// Cases that compare "1 thread" against "all threads" themselves treat
+// the count set by --threads as "all."
+//
+/////////////////////////////////////////////////////////////////////////////
+
+volatile float	gBenchSink;
+double		gBenchMinSeconds = 0.1;
+
+// Head of the linked list of registered cases
+
+static BenchCase	*gFirstCase = NULL;
+
+//---------------------------------------------------------------------------
+// BenchRecord
+//
+// One measurement, kept for the JSON output and the scaling table.
+// Timings have units "ns/op".
+
+struct BenchRecord {
+	std::string	caseName;
+	std::string	label;
+	std::string	units;
+	double		value;
+	int		threads;
+};
+
+static std::vector<BenchRecord>	gRecords;
+static int			gThreads = 1;
+
+//---------------------------------------------------------------------------
+// BenchCase::BenchCase
+//
+// Register a case.  These are static objects, so this happens before
+// main() is called.
+
+BenchCase::BenchCase(const char *caseName, BenchFunc caseFunc) {
+	name = caseName;
+	func = caseFunc;
+	next = gFirstCase;
+	gFirstCase = this;
+}
+
+//---------------------------------------------------------------------------
+// BenchRun::reportTime
+// BenchRun::report
+//
+// Print and record a measurement
+
+void	BenchRun::reportTime(const char *label, double nsPerOp) {
+	printf("%-28s %-32s %10.3f ns/op %12.2f Mop/s\n", name, label, nsPerOp, 1e3 / nsPerOp);
+	BenchRecord	r = { name, label, "ns/op", nsPerOp, gThreads };
+	gRecords.push_back(r);
+}
+
+void	BenchRun::report(const char *label, double value, const char *units) {
+	printf("%-28s %-32s %10.4g %s\n", name, label, value, units);
+	BenchRecord	r = { name, label, units, value, gThreads };
+	gRecords.push_back(r);
+}
+
+//---------------------------------------------------------------------------
+// writeJsonString
+//
+// Write a string with the JSON escapes.  Our labels are plain ASCII, so
+// only quotes, backslashes and control characters need any care.
+
+static void	writeJsonString(FILE *f, const std::string &s) {
+	fputc('"', f);
+	for (size_t i = 0 ; i < s.size() ; ++i) {
+		unsigned char	c = (unsigned char)s[i];
+		if (c == '"' || c == '\\') {
+			fprintf(f, "\\%c", c);
+		} else if (c < 0x20) {
+			fprintf(f, "\\u%04x", c);
+		} else {
+			fputc(c, f);
+		}
+	}
+	fputc('"', f);
+}
+
+//---------------------------------------------------------------------------
+// writeJson
+//
+// Write all the records, and a little about the machine and build
+
+static bool	writeJson(const char *filename) {
+	FILE	*f = fopen(filename, "w");
+	if (f == NULL) {
+		return false;
+	}
+
+	fprintf(f, "{\n");
+	fprintf(f, "  \"simdWidth\": %d,\n", kSimdWidth);
+	fprintf(f, "  \"hardwareThreads\": %u,\n", std::thread::hardware_concurrency());
+	fprintf(f, "  \"results\": [\n");
+	for (size_t i = 0 ; i < gRecords.size() ; ++i) {
+		const BenchRecord	&r = gRecords[i];
+		fprintf(f, "    { \"case\": ");
+		writeJsonString(f, r.caseName);
+		fprintf(f, ", \"label\": ");
+		writeJsonString(f, r.label);
+		fprintf(f, ", \"threads\": %d, ", r.threads);
+		if (r.units == "ns/op") {
+			fprintf(f, "\"nsPerOp\": %.6g, \"mopsPerSec\": %.6g }", r.value, 1e3 / r.value);
+		} else {
+			fprintf(f, "\"value\": %.6g, \"units\": ", r.value);
+			writeJsonString(f, r.units);
+			fprintf(f, " }");
+		}
+		fprintf(f, "%s\n", (i + 1 < gRecords.size()) ? "," : "");
+	}
+	fprintf(f, "  ]\n");
+	fprintf(f, "}\n");
+
+	return fclose(f) == 0;
+}
+
+//---------------------------------------------------------------------------
+// printScaling
+//
+// For each timing, the speedup of each thread count over the first one
+
+static void	printScaling(const std::vector<int> &threadCounts) {
+	printf("\nThread scaling, relative to %d thread(s):\n", threadCounts[0]);
+	for (size_t i = 0 ; i < gRecords.size() ; ++i) {
+		const BenchRecord	&base = gRecords[i];
+		if (base.threads != threadCounts[0] || base.units != "ns/op") {
+			continue;
+		}
+		printf("%-28s %-32s", base.caseName.c_str(), base.label.c_str());
+		for (size_t t = 1 ; t < threadCounts.size() ; ++t) {
+			for (size_t j = 0 ; j < gRecords.size() ; ++j) {
+				const BenchRecord	&r = gRecords[j];
+				if (
+					r.threads == threadCounts[t] && r.units == "ns/op" &&
+					r.caseName == base.caseName && r.label == base.label
+				) {
+					printf(" %3d:%6.2fx", r.threads, base.value / r.value);
+					break;
+				}
+			}
+		}
+		printf("\n");
+	}
+}
+
+//---------------------------------------------------------------------------
+// parseThreadCounts
+//
+// Parse a comma seperated list of positive integers
+
+static bool	parseThreadCounts(const char *s, std::vector<int> &result) {
+	result.clear();
+	while (*s != '\0') {
+		char	*end;
+		long	n = strtol(s, &end, 10);
+		if (end == s || n < 1) {
+			return false;
+		}
+		result.push_back((int)n);
+		s = end;
+		if (*s == ',') {
+			++s;
+		} else if (*s != '\0') {
+			return false;
+		}
+	}
+	return !result.empty();
+}
+
+//---------------------------------------------------------------------------
+// usage
+
+static int	usage() {
+	fprintf(stderr, "usage: bench [--threads 1,2,4] [--json file] [--min-time secs] [--list] [filter]\n");
+	return 1;
+}
+
+//---------------------------------------------------------------------------
+// main
+
+int	main(int argc, char *argv[]) {
+	const char		*filter = "";
+	const char		*jsonFile = NULL;
+	std::vector<int>	threadCounts(1, getWorkerThreadCount());
+
+	for (int i = 1 ; i < argc ; ++i) {
+		const char	*arg = argv[i];
+		if (strcmp(arg, "--threads") == 0 && i + 1 < argc) {
+			if (!parseThreadCounts(argv[++i], threadCounts)) {
+				return usage();
+			}
+		} else if (strcmp(arg, "--json") == 0 && i + 1 < argc) {
+			jsonFile = argv[++i];
+		} else if (strcmp(arg, "--min-time") == 0 && i + 1 < argc) {
+			gBenchMinSeconds = atof(argv[++i]);
+			if (gBenchMinSeconds <= 0.0) {
+				return usage();
+			}
+		} else if (strcmp(arg, "--list") == 0) {
+			for (BenchCase *c = gFirstCase ; c != NULL ; c = c->next) {
+				printf("%s\n", c->name);
+			}
+			return 0;
+		} else if (arg[0] == '-') {
+			return usage();
+		} else {
+			filter = arg;
+		}
+	}
+
+	for (size_t t = 0 ; t < threadCounts.size() ; ++t) {
+		gThreads = threadCounts[t];
+		setWorkerThreadCount(gThreads);
+		if (threadCounts.size() > 1) {
+			printf("%s== %d thread(s)\n", (t > 0) ? "\n" : "", gThreads);
+		}
+		for (BenchCase *c = gFirstCase ; c != NULL ; c = c->next) {
+			if (strstr(c->name, filter) == NULL) {
+				continue;
+			}
+			BenchRun run(c->name);
+			c->func(run);
+		}
+	}
+
+	if (threadCounts.size() > 1) {
+		printScaling(threadCounts);
+	}
+
+	if (jsonFile != NULL && !writeJson(jsonFile)) {
+		fprintf(stderr, "bench: can't write %s\n", jsonFile);
+		return 1;
+	}
+
+	return 0;
+}
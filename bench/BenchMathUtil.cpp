@@ -0,0 +1,198 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchMathUtil.cpp - Benchmarks and error report for the fast trig
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "MathUtil.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The error report sweeps each function over a dense grid covering its
+// domain (angles in -2pi...2pi for sinCos, which covers every quadrant
+// a few times) and compares against the double precision C library.
+// It also checks that the batch versions agree exactly with the single
+// versions, which the tail handling promises.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kTrigCount = 65536;
+const int	kTrigErrorSamples = 1 << 20;
+
+static const ETrigAccuracy	kTiers[] = { eTrigAccuracyLow, eTrigAccuracyMedium, eTrigAccuracyHigh };
+static const char		*kTierNames[] = { "low", "medium", "high" };
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// reportError
+//
+// Report the worst error for one function and tier
+
+static void	reportError(BenchRun &run, const char *function, int tier, double err) {
+	char	label[64];
+	sprintf(label, "%s %s max error", function, kTierNames[tier]);
+	run.report(label, err, "radians");
+}
+
+//---------------------------------------------------------------------------
+// Worst error of each tier
+
+BENCH(trig_accuracy) {
+	std::vector<float>	theta(kTrigErrorSamples), s(kTrigErrorSamples), c(kTrigErrorSamples);
+	std::vector<float>	x(kTrigErrorSamples), y(kTrigErrorSamples), r(kTrigErrorSamples);
+	for (int i = 0 ; i < kTrigErrorSamples ; ++i) {
+		double	t = (i + 0.5) / kTrigErrorSamples;
+		theta[i] = (float)((t * 2.0 - 1.0) * 2.0 * 3.14159265358979);
+		x[i] = (float)(t * 2.0 - 1.0);
+		y[i] = (float)sin(t * 2.0 * 3.14159265358979);
+	}
+
+	int	mismatches = 0;
+	for (int tier = 0 ; tier < 3 ; ++tier) {
+		ETrigAccuracy	accuracy = kTiers[tier];
+
+		// sin and cos
+
+		sinCosBatch(&theta[0], &s[0], &c[0], kTrigErrorSamples, accuracy);
+		double	errSin = 0.0, errCos = 0.0;
+		for (int i = 0 ; i < kTrigErrorSamples ; ++i) {
+			errSin = fmax(errSin, fabs(s[i] - sin((double)theta[i])));
+			errCos = fmax(errCos, fabs(c[i] - cos((double)theta[i])));
+			if ((i & 255) == 0) {
+				float	s1, c1;
+				fastSinCos(&s1, &c1, theta[i], accuracy);
+				if (s1 != s[i] || c1 != c[i]) ++mismatches;
+			}
+		}
+		reportError(run, "sin", tier, errSin);
+		reportError(run, "cos", tier, errCos);
+
+		// acos, over [-1, 1]
+
+		acosBatch(&x[0], &r[0], kTrigErrorSamples, accuracy);
+		double	errAcos = 0.0;
+		for (int i = 0 ; i < kTrigErrorSamples ; ++i) {
+			errAcos = fmax(errAcos, fabs(r[i] - acos((double)x[i])));
+			if ((i & 255) == 0 && fastAcos(x[i], accuracy) != r[i]) ++mismatches;
+		}
+		reportError(run, "acos", tier, errAcos);
+
+		// atan2, with (x, y) going round the circle at different radii
+
+		atan2Batch(&y[0], &theta[0], &r[0], kTrigErrorSamples, accuracy);
+		double	errAtan2 = 0.0;
+		for (int i = 0 ; i < kTrigErrorSamples ; ++i) {
+			double	exact = atan2((double)y[i], (double)theta[i]);
+			errAtan2 = fmax(errAtan2, fabs(r[i] - exact));
+			if ((i & 255) == 0 && fastAtan2(y[i], theta[i], accuracy) != r[i]) ++mismatches;
+		}
+		reportError(run, "atan2", tier, errAtan2);
+	}
+
+	run.report("single/batch mismatches", mismatches, "");
+}
+
+//---------------------------------------------------------------------------
+// Throughput against the C library
+
+BENCH(trig) {
+	srand(11);
+	std::vector<float>	theta(kTrigCount), x(kTrigCount), y(kTrigCount);
+	std::vector<float>	s(kTrigCount), c(kTrigCount), r(kTrigCount);
+	for (int i = 0 ; i < kTrigCount ; ++i) {
+		theta[i] = randFloat(-kPi, kPi);
+		x[i] = randFloat(-1.0f, 1.0f);
+		y[i] = randFloat(-1.0f, 1.0f);
+	}
+
+	double	libSinCos = run.time("sin + cos libm", kTrigCount, [&]() {
+		for (int i = 0 ; i < kTrigCount ; ++i) {
+			s[i] = sin(theta[i]);
+			c[i] = cos(theta[i]);
+		}
+		benchUse(s[kTrigCount - 1] + c[kTrigCount - 1]);
+	});
+	run.time("fastSinCos high", kTrigCount, [&]() {
+		for (int i = 0 ; i < kTrigCount ; ++i) {
+			fastSinCos(&s[i], &c[i], theta[i]);
+		}
+		benchUse(s[kTrigCount - 1] + c[kTrigCount - 1]);
+	});
+	double	batchSinCos = 0.0;
+	for (int tier = 0 ; tier < 3 ; ++tier) {
+		char	label[64];
+		sprintf(label, "sinCosBatch %s", kTierNames[tier]);
+		batchSinCos = run.time(label, kTrigCount, [&]() {
+			sinCosBatch(&theta[0], &s[0], &c[0], kTrigCount, kTiers[tier]);
+			benchUse(s[kTrigCount - 1] + c[kTrigCount - 1]);
+		});
+	}
+
+	double	libAcos = run.time("acos libm", kTrigCount, [&]() {
+		for (int i = 0 ; i < kTrigCount ; ++i) {
+			r[i] = acos(x[i]);
+		}
+		benchUse(r[kTrigCount - 1]);
+	});
+	run.time("fastAcos high", kTrigCount, [&]() {
+		for (int i = 0 ; i < kTrigCount ; ++i) {
+			r[i] = fastAcos(x[i]);
+		}
+		benchUse(r[kTrigCount - 1]);
+	});
+	double	batchAcos = 0.0;
+	for (int tier = 0 ; tier < 3 ; ++tier) {
+		char	label[64];
+		sprintf(label, "acosBatch %s", kTierNames[tier]);
+		batchAcos = run.time(label, kTrigCount, [&]() {
+			acosBatch(&x[0], &r[0], kTrigCount, kTiers[tier]);
+			benchUse(r[kTrigCount - 1]);
+		});
+	}
+
+	double	libAtan2 = run.time("atan2 libm", kTrigCount, [&]() {
+		for (int i = 0 ; i < kTrigCount ; ++i) {
+			r[i] = atan2(y[i], x[i]);
+		}
+		benchUse(r[kTrigCount - 1]);
+	});
+	run.time("fastAtan2 high", kTrigCount, [&]() {
+		for (int i = 0 ; i < kTrigCount ; ++i) {
+			r[i] = fastAtan2(y[i], x[i]);
+		}
+		benchUse(r[kTrigCount - 1]);
+	});
+	double	batchAtan2 = 0.0;
+	for (int tier = 0 ; tier < 3 ; ++tier) {
+		char	label[64];
+		sprintf(label, "atan2Batch %s", kTierNames[tier]);
+		batchAtan2 = run.time(label, kTrigCount, [&]() {
+			atan2Batch(&y[0], &x[0], &r[0], kTrigCount, kTiers[tier]);
+			benchUse(r[kTrigCount - 1]);
+		});
+	}
+
+	run.report("sinCos speedup (high)", libSinCos / batchSinCos, "x");
+	run.report("acos speedup (high)", libAcos / batchAcos, "x");
+	run.report("atan2 speedup (high)", libAtan2 / batchAtan2, "x");
+}
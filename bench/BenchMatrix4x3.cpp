@@ -0,0 +1,199 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchMatrix4x3.cpp - Benchmarks for class Matrix4x3
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "vector3.h"
+#include "EulerAngles.h"
+#include "RotationMatrix.h"
+#include "Matrix4x3.h"
+#include "Matrix4x3Batch.h"
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Most matrices in a scene graph are rigid: a rotation and a translation
+// from setupLocalToParent().  These cases time the usual per-frame work
+// on such a hierarchy twice, once with the matrices tagged with their
+// real transform type and once with the tags forced to the general
+// affine case, so we can see how much the special-case paths buy us.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kNodeCount = 4096;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// Hierarchy
+//
+// A flattened hierarchy of nodes.  Each node's parent comes earlier in
+// the list, so one pass from front to back computes the world matrices.
+
+struct Hierarchy {
+	std::vector<int>	parent;
+	std::vector<Matrix4x3>	local;
+	std::vector<Matrix4x3>	world;
+
+	void	build(int n) {
+		srand(1234);
+		parent.resize(n);
+		local.resize(n);
+		world.resize(n);
+		for (int i = 0 ; i < n ; ++i) {
+			parent[i] = (i == 0) ? -1 : rand() % i;
+			EulerAngles orient(randFloat(-3.0f, 3.0f), randFloat(-1.5f, 1.5f), randFloat(-3.0f, 3.0f));
+			RotationMatrix r;
+			r.setup(orient);
+			Vector3 pos(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f));
+			local[i].setupLocalToParent(pos, r);
+		}
+	}
+
+	void	forceAffine() {
+		for (size_t i = 0 ; i < local.size() ; ++i) {
+			local[i].transformType = eTransformTypeAffine;
+		}
+	}
+
+	void	update() {
+		int n = (int)local.size();
+		for (int i = 0 ; i < n ; ++i) {
+			world[i] = (parent[i] < 0) ? local[i] : local[i] * world[parent[i]];
+		}
+	}
+};
+
+//---------------------------------------------------------------------------
+// Concatenation of a rigid hierarchy
+
+BENCH(matrix4x3_concat) {
+	Hierarchy	h;
+	h.build(kNodeCount);
+
+	double	tagged = run.time("rigid tagged", kNodeCount, [&]() {
+		h.update();
+		benchUse(h.world[kNodeCount - 1].tx);
+	});
+
+	h.forceAffine();
+	double	general = run.time("rigid as affine", kNodeCount, [&]() {
+		h.update();
+		benchUse(h.world[kNodeCount - 1].tx);
+	});
+
+	run.report("speedup", general / tagged, "x");
+}
+
+//---------------------------------------------------------------------------
+// Flattening a hierarchy node by node vs. level by level with
+// flattenHierarchy(), on one thread and on all of them
+
+BENCH(matrix4x3_flatten) {
+	Hierarchy	h;
+	h.build(kNodeCount * 4);
+	int		n = kNodeCount * 4;
+
+	double	scalar = run.time("node by node", n, [&]() {
+		h.update();
+		benchUse(h.world[n - 1].tx);
+	});
+
+	int	threads = getWorkerThreadCount();
+	setWorkerThreadCount(1);
+	double	batch = run.time("flattenHierarchy 1 thread", n, [&]() {
+		flattenHierarchy(&h.parent[0], &h.local[0], &h.world[0], n);
+		benchUse(h.world[n - 1].tx);
+	});
+	setWorkerThreadCount(threads);
+	double	batchMT = run.time("flattenHierarchy all threads", n, [&]() {
+		flattenHierarchy(&h.parent[0], &h.local[0], &h.world[0], n);
+		benchUse(h.world[n - 1].tx);
+	});
+
+	run.report("speedup 1 thread", scalar / batch, "x");
+	run.report("speedup all threads", scalar / batchMT, "x");
+}
+
+//---------------------------------------------------------------------------
+// Inversion of rigid, similarity and translation matrices
+
+BENCH(matrix4x3_inverse) {
+	Hierarchy	h;
+	h.build(kNodeCount);
+	h.update();
+
+	std::vector<Matrix4x3>	inv(kNodeCount);
+
+	double	tagged = run.time("rigid tagged", kNodeCount, [&]() {
+		for (int i = 0 ; i < kNodeCount ; ++i) {
+			inv[i] = inverse(h.world[i]);
+		}
+		benchUse(inv[kNodeCount - 1].tx);
+	});
+
+	for (int i = 0 ; i < kNodeCount ; ++i) {
+		h.world[i].transformType = eTransformTypeAffine;
+	}
+	double	general = run.time("rigid as affine", kNodeCount, [&]() {
+		for (int i = 0 ; i < kNodeCount ; ++i) {
+			inv[i] = inverse(h.world[i]);
+		}
+		benchUse(inv[kNodeCount - 1].tx);
+	});
+
+	run.report("speedup", general / tagged, "x");
+}
+
+//---------------------------------------------------------------------------
+// Transforming points by translation-only matrices, such as the ones
+// used to position particles or billboards
+
+BENCH(matrix4x3_translate_points) {
+	std::vector<Matrix4x3>	m(kNodeCount);
+	std::vector<Vector3>	p(kNodeCount);
+	for (int i = 0 ; i < kNodeCount ; ++i) {
+		m[i].setupTranslation(Vector3(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f)));
+		p[i] = Vector3(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+	}
+
+	Vector3	sum;
+	double	tagged = run.time("translation tagged", kNodeCount, [&]() {
+		sum.zero();
+		for (int i = 0 ; i < kNodeCount ; ++i) {
+			sum += p[i] * m[i];
+		}
+		benchUse(sum.x);
+	});
+
+	for (int i = 0 ; i < kNodeCount ; ++i) {
+		m[i].transformType = eTransformTypeAffine;
+	}
+	double	general = run.time("translation as affine", kNodeCount, [&]() {
+		sum.zero();
+		for (int i = 0 ; i < kNodeCount ; ++i) {
+			sum += p[i] * m[i];
+		}
+		benchUse(sum.x);
+	});
+
+	run.report("speedup", general / tagged, "x");
+}
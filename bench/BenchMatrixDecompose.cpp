@@ -0,0 +1,246 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchMatrixDecompose.cpp - Benchmarks and checks for TRS decomposition
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "EulerAngles.h"
+#include "Matrix4x3.h"
+#include "MatrixDecompose.h"
+#include "Quaternion.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The matrices are built from random rotations, translations and scales,
+// with an occasional mirror, so decomposing them should give back what
+// went in.  The round trip error is the largest difference between an
+// element of the original matrix and the recomposed one, relative to the
+// scale.  Then the same matrices are skewed or made singular, to check
+// that those are reported as not being TRS.
+//
+// Euler angle extraction is timed too, since that's what we used to do.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kMatrixCount = 16384;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randRotation
+//
+// Random unit quaternion
+
+static Quaternion	randRotation() {
+	Quaternion	q;
+	q.w = randFloat(-1.0f, 1.0f);
+	q.x = randFloat(-1.0f, 1.0f);
+	q.y = randFloat(-1.0f, 1.0f);
+	q.z = randFloat(-1.0f, 1.0f);
+	q.normalize();
+	return q;
+}
+
+//---------------------------------------------------------------------------
+// maxElementError
+//
+// Largest difference between the 3x3 portions, relative to the size of
+// the elements, and the largest difference between the translations
+
+static float	maxElementError(const Matrix4x3 &a, const Matrix4x3 &b) {
+	float	size = fabs(determinant(a));
+	size = (size > 1e-6f) ? (float)pow(size, 1.0 / 3.0) : 1.0f;
+	float	e = 0.0f;
+	e = fmax(e, fabs(a.m11 - b.m11) / size);
+	e = fmax(e, fabs(a.m12 - b.m12) / size);
+	e = fmax(e, fabs(a.m13 - b.m13) / size);
+	e = fmax(e, fabs(a.m21 - b.m21) / size);
+	e = fmax(e, fabs(a.m22 - b.m22) / size);
+	e = fmax(e, fabs(a.m23 - b.m23) / size);
+	e = fmax(e, fabs(a.m31 - b.m31) / size);
+	e = fmax(e, fabs(a.m32 - b.m32) / size);
+	e = fmax(e, fabs(a.m33 - b.m33) / size);
+	e = fmax(e, fabs(a.tx - b.tx));
+	e = fmax(e, fabs(a.ty - b.ty));
+	e = fmax(e, fabs(a.tz - b.tz));
+	return e;
+}
+
+//---------------------------------------------------------------------------
+// Correctness
+
+BENCH(matrix4x3_decompose_check) {
+	srand(170);
+	std::vector<Matrix4x3>	m(kMatrixCount);
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		Vector3	s(randFloat(0.1f, 10.0f), randFloat(0.1f, 10.0f), randFloat(0.1f, 10.0f));
+		if (i % 7 == 0) {
+			s.x = s.y = s.z;
+		}
+		if (i % 5 == 0) {
+			s.x = -s.x;
+		}
+		Vector3	t(randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f));
+		m[i] = composeTRS(randRotation(), t, s);
+	}
+
+	// Round trip through the single versions
+
+	Quaternion	r;
+	Vector3		t, s;
+	float		maxError = 0.0f;
+	int		inexact = 0;
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		if (!decomposeTRS(m[i], r, t, s)) {
+			++inexact;
+		}
+		maxError = fmax(maxError, maxElementError(m[i], composeTRS(r, t, s)));
+	}
+	run.report("round trip max error", maxError, "");
+	run.report("TRS reported as skewed", inexact, "");
+
+	// The batch versions should agree with the single ones
+
+	std::vector<Quaternion>	rotation(kMatrixCount);
+	std::vector<Vector3>	translation(kMatrixCount), scale(kMatrixCount);
+	std::vector<Matrix4x3>	back(kMatrixCount);
+	inexact = decomposeTRS(&m[0], &rotation[0], &translation[0], &scale[0], kMatrixCount);
+	composeTRS(&rotation[0], &translation[0], &scale[0], &back[0], kMatrixCount);
+	maxError = 0.0f;
+	float	maxRotationError = 0.0f;
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		decomposeTRS(m[i], r, t, s);
+		maxRotationError = fmax(maxRotationError, 1.0f - fabs(dotProduct(r, rotation[i])));
+		maxError = fmax(maxError, maxElementError(m[i], back[i]));
+	}
+	run.report("batch round trip max error", maxError, "");
+	run.report("batch vs single 1-|dot|", maxRotationError, "");
+	run.report("batch TRS reported as skewed", inexact, "");
+
+	// Skewed and singular matrices aren't TRS
+
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		if (i % 2 == 0) {
+			Matrix4x3	shear;
+			shear.setupShear(1 + i % 3, randFloat(0.1f, 1.0f), randFloat(0.1f, 1.0f));
+			m[i] = shear * m[i];
+		} else {
+			m[i].m21 = m[i].m11 * 2.0f;
+			m[i].m22 = m[i].m12 * 2.0f;
+			m[i].m23 = m[i].m13 * 2.0f;
+		}
+		m[i].transformType = eTransformTypeAffine;
+	}
+	inexact = 0;
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		if (!decomposeTRS(m[i], r, t, s)) {
+			++inexact;
+		}
+	}
+	run.report("non-TRS missed", kMatrixCount - inexact, "");
+	inexact = decomposeTRS(&m[0], &rotation[0], &translation[0], &scale[0], kMatrixCount);
+	run.report("batch non-TRS missed", kMatrixCount - inexact, "");
+
+	// Whatever the input, the rotations must be unit length
+
+	float	maxNormError = 0.0f;
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		maxNormError = fmax(maxNormError, fabs(1.0f - sqrt(dotProduct(rotation[i], rotation[i]))));
+	}
+	run.report("non-TRS rotation norm error", maxNormError, "");
+
+	// A long chain of small rigid steps.  The product is still tagged
+	// rigid, but round off has crept into it, so the single and batch
+	// versions have to clean it up the same way.
+
+	const int	kChainLength = 200000;
+	Matrix4x3	step, chain;
+	step.setupRotate(Vector3(.36f, .48f, .8f), .01f);
+	chain.identity();
+	for (int i = 0 ; i < kChainLength ; ++i) {
+		chain = chain * step;
+	}
+	run.report("drifted chain tagged rigid", (chain.transformType == eTransformTypeRigid) ? 1 : 0, "");
+	run.report("drifted chain row length error", fabs(1.0f - sqrt(chain.m11*chain.m11 + chain.m12*chain.m12 + chain.m13*chain.m13)), "");
+	for (int i = 0 ; i < 16 ; ++i) {
+		m[i] = chain;
+	}
+	decomposeTRS(chain, r, t, s);
+	decomposeTRS(&m[0], &rotation[0], &translation[0], &scale[0], 16);
+	run.report("drifted chain batch vs single scale", distance(s, scale[0]), "");
+	run.report("drifted chain batch vs single 1-|dot|", 1.0f - fabs(dotProduct(r, rotation[0])), "");
+}
+
+//---------------------------------------------------------------------------
+// Throughput
+
+BENCH(matrix4x3_decompose) {
+	srand(171);
+	std::vector<Matrix4x3>	m(kMatrixCount), back(kMatrixCount);
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		Vector3	s(randFloat(0.5f, 2.0f), randFloat(0.5f, 2.0f), randFloat(0.5f, 2.0f));
+		Vector3	t(randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f));
+		m[i] = composeTRS(randRotation(), t, s);
+	}
+	std::vector<Quaternion>	rotation(kMatrixCount);
+	std::vector<Vector3>	translation(kMatrixCount), scale(kMatrixCount);
+	std::vector<EulerAngles>	euler(kMatrixCount);
+
+	double	single = run.time("decomposeTRS loop", kMatrixCount, [&]() {
+		for (int i = 0 ; i < kMatrixCount ; ++i) {
+			decomposeTRS(m[i], rotation[i], translation[i], scale[i]);
+		}
+		benchUse(rotation[kMatrixCount - 1].w);
+	});
+	double	batch = run.time("decomposeTRS batch", kMatrixCount, [&]() {
+		decomposeTRS(&m[0], &rotation[0], &translation[0], &scale[0], kMatrixCount);
+		benchUse(rotation[kMatrixCount - 1].w);
+	});
+	run.report("decompose batch speedup", single / batch, "x");
+
+	// The old way, which only works without scale
+
+	for (int i = 0 ; i < kMatrixCount ; ++i) {
+		m[i] = composeTRS(rotation[i], translation[i], Vector3(1.0f, 1.0f, 1.0f));
+	}
+	run.time("Euler fromObjectToWorldMatrix", kMatrixCount, [&]() {
+		for (int i = 0 ; i < kMatrixCount ; ++i) {
+			euler[i].fromObjectToWorldMatrix(m[i]);
+		}
+		benchUse(euler[kMatrixCount - 1].heading);
+	});
+	run.time("decomposeTRS batch, rigid", kMatrixCount, [&]() {
+		decomposeTRS(&m[0], &rotation[0], &translation[0], &scale[0], kMatrixCount);
+		benchUse(rotation[kMatrixCount - 1].w);
+	});
+
+	single = run.time("composeTRS loop", kMatrixCount, [&]() {
+		for (int i = 0 ; i < kMatrixCount ; ++i) {
+			back[i] = composeTRS(rotation[i], translation[i], scale[i]);
+		}
+		benchUse(back[kMatrixCount - 1].m11);
+	});
+	batch = run.time("composeTRS batch", kMatrixCount, [&]() {
+		composeTRS(&rotation[0], &translation[0], &scale[0], &back[0], kMatrixCount);
+		benchUse(back[kMatrixCount - 1].m11);
+	});
+	run.report("compose batch speedup", single / batch, "x");
+}
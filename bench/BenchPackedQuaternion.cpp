@@ -0,0 +1,137 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchPackedQuaternion.cpp - Benchmarks for packed quaternions
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "Quaternion.h"
+#include "PackedQuaternion.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The array is about the size of the rotation keys of a few long
+// animation clips.  The error is the angle of the rotation that takes the
+// original to the unpacked quaternion, over many random rotations.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kPackedCount = 65536;
+
+//---------------------------------------------------------------------------
+// randGaussian
+//
+// Normally distributed random number, from the Box-Muller transform.
+// Normalizing four of these gives a uniformly distributed rotation.
+
+static double	randGaussian() {
+	double	u = ((double)rand() + 1.0) / ((double)RAND_MAX + 2.0);
+	double	v = (double)rand() / (double)RAND_MAX;
+	return sqrt(-2.0 * log(u)) * cos(6.28318530717959 * v);
+}
+
+//---------------------------------------------------------------------------
+// randRotation
+//
+// Uniformly distributed random unit quaternion
+
+static Quaternion	randRotation() {
+	double	w = randGaussian(), x = randGaussian(), y = randGaussian(), z = randGaussian();
+	double	k = 1.0 / sqrt(w*w + x*x + y*y + z*z);
+	Quaternion	q;
+	q.w = (float)(w * k);
+	q.x = (float)(x * k);
+	q.y = (float)(y * k);
+	q.z = (float)(z * k);
+	return q;
+}
+
+//---------------------------------------------------------------------------
+// angleBetween
+//
+// Angle of the rotation from a to b.  For unit quaternions on the same
+// side of the hypersphere, |a - b| = 2 sin(angle / 4); unlike acos of the
+// dot product, this stays accurate for tiny angles.
+
+static double	angleBetween(const Quaternion &a, const Quaternion &b) {
+	double	s = ((double)a.w*b.w + (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z < 0.0) ? -1.0 : 1.0;
+	double	dw = a.w - s*b.w, dx = a.x - s*b.x, dy = a.y - s*b.y, dz = a.z - s*b.z;
+	double	half = sqrt(dw*dw + dx*dx + dy*dy + dz*dz) * 0.5;
+	if (half > 1.0) half = 1.0;
+	return 4.0 * asin(half);
+}
+
+//---------------------------------------------------------------------------
+// Pack and unpack throughput, and accuracy
+
+BENCH(packed_quaternion) {
+	srand(7);
+	std::vector<Quaternion>		q(kPackedCount), r(kPackedCount);
+	std::vector<PackedQuaternion48>	p48(kPackedCount);
+	std::vector<PackedQuaternion32>	p32(kPackedCount);
+	for (int i = 0 ; i < kPackedCount ; ++i) {
+		q[i] = randRotation();
+	}
+
+	double	single = run.time("packQuaternion 48", kPackedCount, [&]() {
+		for (int i = 0 ; i < kPackedCount ; ++i) {
+			packQuaternion(q[i], p48[i]);
+		}
+		benchUse((float)p48[kPackedCount - 1].bits[0]);
+	});
+
+	double	batch = run.time("packQuaternions 48", kPackedCount, [&]() {
+		packQuaternions(&q[0], &p48[0], kPackedCount);
+		benchUse((float)p48[kPackedCount - 1].bits[0]);
+	});
+
+	run.time("unpackQuaternions 48", kPackedCount, [&]() {
+		unpackQuaternions(&p48[0], &r[0], kPackedCount);
+		benchUse(r[kPackedCount - 1].x);
+	});
+
+	run.time("packQuaternions 32", kPackedCount, [&]() {
+		packQuaternions(&q[0], &p32[0], kPackedCount);
+		benchUse((float)p32[kPackedCount - 1].bits);
+	});
+
+	run.time("unpackQuaternions 32", kPackedCount, [&]() {
+		unpackQuaternions(&p32[0], &r[0], kPackedCount);
+		benchUse(r[kPackedCount - 1].x);
+	});
+
+	run.report("batch pack speedup", single / batch, "x");
+
+	// Accuracy
+
+	packQuaternions(&q[0], &p48[0], kPackedCount);
+	unpackQuaternions(&p48[0], &r[0], kPackedCount);
+	double	worst48 = 0.0;
+	for (int i = 0 ; i < kPackedCount ; ++i) {
+		double	err = angleBetween(q[i], r[i]);
+		if (err > worst48) worst48 = err;
+	}
+
+	packQuaternions(&q[0], &p32[0], kPackedCount);
+	unpackQuaternions(&p32[0], &r[0], kPackedCount);
+	double	worst32 = 0.0;
+	for (int i = 0 ; i < kPackedCount ; ++i) {
+		double	err = angleBetween(q[i], r[i]);
+		if (err > worst32) worst32 = err;
+	}
+
+	run.report("48-bit max error", worst48, "radians");
+	run.report("32-bit max error", worst32, "radians");
+	run.report("48-bit size", (double)sizeof(Quaternion) / sizeof(PackedQuaternion48), "x smaller");
+	run.report("32-bit size", (double)sizeof(Quaternion) / sizeof(PackedQuaternion32), "x smaller");
+}
@@ -0,0 +1,238 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchQuaternion.cpp - Benchmarks for quaternion operations
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "Quaternion.h"
+#include "QuaternionBatch.h"
+#include "Matrix4x3.h"
+#include "Matrix4x3Batch.h"
+#include "Vector3Array.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The arrays are about the size of the pose buffers for a few dozen
+// animated characters.  Endpoints are random, so they are often far
+// apart; this is the worst case for the fast slerp.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kQuaternionCount = 4096;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randQuaternion
+//
+// Random unit quaternion
+
+static Quaternion	randQuaternion() {
+	Quaternion	q;
+	q.w = randFloat(-1.0f, 1.0f);
+	q.x = randFloat(-1.0f, 1.0f);
+	q.y = randFloat(-1.0f, 1.0f);
+	q.z = randFloat(-1.0f, 1.0f);
+	q.normalize();
+	return q;
+}
+
+//---------------------------------------------------------------------------
+// rotationAngleAboutX
+//
+// Angle of a rotation about the x-axis, in [-pi, pi]
+
+static double	rotationAngleAboutX(const Quaternion &q) {
+	return 2.0 * atan2((double)q.x, (double)q.w);
+}
+
+//---------------------------------------------------------------------------
+// slerp vs. the batch versions
+
+BENCH(quaternion_slerp) {
+	srand(99);
+	std::vector<Quaternion>	q0(kQuaternionCount), q1(kQuaternionCount), r(kQuaternionCount);
+	std::vector<float>	t(kQuaternionCount);
+	for (int i = 0 ; i < kQuaternionCount ; ++i) {
+		q0[i] = randQuaternion();
+		q1[i] = randQuaternion();
+		t[i] = randFloat(0.0f, 1.0f);
+	}
+
+	double	scalar = run.time("scalar slerp", kQuaternionCount, [&]() {
+		for (int i = 0 ; i < kQuaternionCount ; ++i) {
+			r[i] = slerp(q0[i], q1[i], t[i]);
+		}
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	double	exact = run.time("slerpBatch exact", kQuaternionCount, [&]() {
+		slerpBatch(&q0[0], &q1[0], &t[0], &r[0], kQuaternionCount);
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	double	fast = run.time("slerpBatch fast", kQuaternionCount, [&]() {
+		slerpBatch(&q0[0], &q1[0], &t[0], &r[0], kQuaternionCount, eSlerpModeFast);
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	run.time("slerpBatch fast, shared t", kQuaternionCount, [&]() {
+		slerpBatch(&q0[0], &q1[0], 0.3f, &r[0], kQuaternionCount, eSlerpModeFast);
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	run.time("nlerpBatch", kQuaternionCount, [&]() {
+		nlerpBatch(&q0[0], &q1[0], &t[0], &r[0], kQuaternionCount);
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	run.report("speedup exact", scalar / exact, "x");
+	run.report("speedup fast", scalar / fast, "x");
+}
+
+//---------------------------------------------------------------------------
+// Error of the fast slerp and nlerp.  Interpolate rotations about the
+// x-axis, so the right answer is known exactly, over every angle between
+// the endpoints
+
+BENCH(quaternion_slerp_error) {
+	const int	kAngleSteps = 720;
+	const int	kTSteps = 100;
+
+	double	worstFast = 0.0, worstFast90 = 0.0, worstNlerp = 0.0;
+	for (int a = 1 ; a <= kAngleSteps ; ++a) {
+
+		// Angle between the endpoints, taking the short way
+
+		double	theta = 3.14159265358979 * a / kAngleSteps;
+
+		Quaternion	q0 = kQuaternionIdentity;
+		Quaternion	q1;
+		q1.w = (float)cos(theta * 0.5);
+		q1.x = (float)sin(theta * 0.5);
+		q1.y = q1.z = 0.0f;
+
+		for (int i = 0 ; i <= kTSteps ; ++i) {
+			float	t = (float)i / kTSteps;
+			Quaternion	fast, lerped;
+			slerpBatch(&q0, &q1, t, &fast, 1, eSlerpModeFast);
+			nlerpBatch(&q0, &q1, t, &lerped, 1);
+
+			double	want = theta * t;
+			double	errFast = fabs(rotationAngleAboutX(fast) - want);
+			double	errNlerp = fabs(rotationAngleAboutX(lerped) - want);
+			if (errFast > worstFast) worstFast = errFast;
+			if (theta <= 3.14159265358979 * 0.5 && errFast > worstFast90) worstFast90 = errFast;
+			if (errNlerp > worstNlerp) worstNlerp = errNlerp;
+		}
+	}
+
+	run.report("fast max error", worstFast, "radians");
+	run.report("fast max error, < 90 degrees", worstFast90, "radians");
+	run.report("nlerp max error", worstNlerp, "radians");
+}
+
+//---------------------------------------------------------------------------
+// Rotating vectors, each by its own quaternion (particles, rigid bodies),
+// and small groups of vectors by a shared quaternion
+
+BENCH(quaternion_rotate) {
+	srand(11);
+	const int	kGroupSize = 16;
+	std::vector<Quaternion>	q(kQuaternionCount);
+	std::vector<Vector3>	v(kQuaternionCount), r(kQuaternionCount);
+	for (int i = 0 ; i < kQuaternionCount ; ++i) {
+		q[i] = randQuaternion();
+		v[i] = Vector3(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+	}
+
+	double	matrix = run.time("per element, via matrix", kQuaternionCount, [&]() {
+		for (int i = 0 ; i < kQuaternionCount ; ++i) {
+			Matrix4x3	m;
+			m.fromQuaternion(q[i]);
+			r[i] = v[i] * m;
+		}
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	run.time("per element, rotate()", kQuaternionCount, [&]() {
+		for (int i = 0 ; i < kQuaternionCount ; ++i) {
+			r[i] = rotate(q[i], v[i]);
+		}
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	double	batch = run.time("per element, rotateBatch", kQuaternionCount, [&]() {
+		rotateBatch(&q[0], &v[0], &r[0], kQuaternionCount);
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	Vector3Array	va, ra;
+	va.gather(&v[0], kQuaternionCount);
+	double	batchSoA = run.time("per element, rotateBatch Vector3Array", kQuaternionCount, [&]() {
+		rotateBatch(ra, va, &q[0]);
+		benchUse(ra.x[kQuaternionCount - 1]);
+	});
+
+	double	groupMatrix = run.time("groups of 16, via transformPoints", kQuaternionCount, [&]() {
+		for (int i = 0 ; i < kQuaternionCount ; i += kGroupSize) {
+			Matrix4x3	m;
+			m.fromQuaternion(q[i]);
+			transformVectors(m, &v[i], &r[i], kGroupSize);
+		}
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	double	group = run.time("groups of 16, rotateBatch", kQuaternionCount, [&]() {
+		for (int i = 0 ; i < kQuaternionCount ; i += kGroupSize) {
+			rotateBatch(q[i], &v[i], &r[i], kGroupSize);
+		}
+		benchUse(r[kQuaternionCount - 1].x);
+	});
+
+	// Check against rotate(), which should agree to within rounding.  The
+	// odd group size leaves a tail in every shared call.
+
+	rotateBatch(&q[0], &v[0], &r[0], kQuaternionCount);
+	float	perElementError = 0.0f;
+	for (int i = 0 ; i < kQuaternionCount ; ++i) {
+		perElementError = fmax(perElementError, distance(r[i], rotate(q[i], v[i])));
+	}
+
+	const int	kOddGroupSize = 13;
+	float	sharedError = 0.0f;
+	for (int i = 0 ; i + kOddGroupSize <= kQuaternionCount ; i += kOddGroupSize) {
+		rotateBatch(q[i], &v[i], &r[i], kOddGroupSize);
+		va.gather(&v[i], kOddGroupSize);
+		rotateBatch(ra, va, q[i]);
+		for (int j = i ; j < i + kOddGroupSize ; ++j) {
+			Vector3	expect = rotate(q[i], v[j]);
+			sharedError = fmax(sharedError, distance(r[j], expect));
+			sharedError = fmax(sharedError, distance(ra.get(j - i), expect));
+		}
+	}
+
+	run.report("per element max error", perElementError, "");
+	run.report("shared max error", sharedError, "");
+	run.report("speedup per element", matrix / batch, "x");
+	run.report("speedup per element, Vector3Array", matrix / batchSoA, "x");
+	run.report("speedup groups of 16", groupMatrix / group, "x");
+}
@@ -0,0 +1,143 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchSkinning.cpp - Benchmarks for linear blend skinning
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "vector3.h"
+#include "EulerAngles.h"
+#include "RotationMatrix.h"
+#include "Matrix4x3.h"
+#include "DualQuaternion.h"
+#include "SkinnedMesh.h"
+#include "Parallel.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// A typical character: 10,000 vertices, 64 bones, with most vertices
+// influenced by two or three bones.  We time skinning one character on
+// one thread and on all of them, and also many characters spread across
+// the threads (each one skinned serially), which is how a game would
+// normally use it.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kSkinVertexCount = 10000;
+const int	kSkinBoneCount = 64;
+const int	kSkinCharacterCount = 32;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// buildCharacter
+//
+// Fill in a mesh with random vertices and bone influences, and a palette
+// of random rigid transforms
+
+static void	buildCharacter(SkinnedMesh &mesh, std::vector<Matrix4x3> &palette) {
+	srand(4321);
+	mesh.allocateMemory(kSkinVertexCount);
+	for (int i = 0 ; i < kSkinVertexCount ; ++i) {
+		SkinnedVertex &s = mesh.getVertexList()[i];
+		s.v.p = Vector3(randFloat(-1.0f, 1.0f), randFloat(0.0f, 2.0f), randFloat(-1.0f, 1.0f));
+		s.v.n = Vector3(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+		s.v.n.normalize();
+		s.v.u = randFloat(0.0f, 1.0f);
+		s.v.v = randFloat(0.0f, 1.0f);
+		int influences = 1 + rand() % kMaxBonesPerVertex;
+		for (int k = 0 ; k < kMaxBonesPerVertex ; ++k) {
+			s.bone[k] = (unsigned short)(rand() % kSkinBoneCount);
+			s.weight[k] = (k < influences) ? randFloat(0.1f, 1.0f) : 0.0f;
+		}
+	}
+	mesh.normalizeWeights();
+
+	palette.resize(kSkinBoneCount);
+	for (int b = 0 ; b < kSkinBoneCount ; ++b) {
+		RotationMatrix r;
+		r.setup(EulerAngles(randFloat(-3.0f, 3.0f), randFloat(-1.5f, 1.5f), randFloat(-3.0f, 3.0f)));
+		palette[b].setupLocalToParent(Vector3(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f)), r);
+	}
+}
+
+//---------------------------------------------------------------------------
+// Skinning one character, and a crowd
+
+BENCH(skinning) {
+	SkinnedMesh		mesh;
+	std::vector<Matrix4x3>	palette;
+	buildCharacter(mesh, palette);
+
+	std::vector<RenderVertex>	out(kSkinVertexCount * kSkinCharacterCount);
+
+	int	threads = getWorkerThreadCount();
+	setWorkerThreadCount(1);
+	double	serial = run.time("one character, 1 thread", kSkinVertexCount, [&]() {
+		mesh.skin(&palette[0], kSkinBoneCount, &out[0]);
+		benchUse(out[kSkinVertexCount - 1].p.x);
+	});
+	setWorkerThreadCount(threads);
+
+	double	parallel = run.time("one character, all threads", kSkinVertexCount, [&]() {
+		mesh.skin(&palette[0], kSkinBoneCount, &out[0]);
+		benchUse(out[kSkinVertexCount - 1].p.x);
+	});
+
+	double	crowd = run.time("crowd, all threads", kSkinVertexCount * kSkinCharacterCount, [&]() {
+		parallelFor(kSkinCharacterCount, 1, [&](int begin, int end) {
+			for (int c = begin ; c < end ; ++c) {
+				mesh.skin(&palette[0], kSkinBoneCount, &out[c * kSkinVertexCount]);
+			}
+		});
+		benchUse(out[kSkinVertexCount - 1].p.x);
+	});
+
+	run.report("thread speedup", serial / parallel, "x");
+	run.report("characters per 16ms frame", 16e6 / (crowd * kSkinVertexCount), "chars");
+}
+
+//---------------------------------------------------------------------------
+// Dual quaternion skinning, including converting the palette
+
+BENCH(skinning_dual_quaternion) {
+	SkinnedMesh		mesh;
+	std::vector<Matrix4x3>	palette;
+	buildCharacter(mesh, palette);
+
+	std::vector<DualQuaternion>	dqPalette(kSkinBoneCount);
+	std::vector<RenderVertex>	out(kSkinVertexCount);
+
+	run.time("convertPalette", kSkinBoneCount, [&]() {
+		convertPalette(&palette[0], &dqPalette[0], kSkinBoneCount);
+		benchUse(dqPalette[kSkinBoneCount - 1].dual.x);
+	});
+
+	double	matrix = run.time("matrix palette", kSkinVertexCount, [&]() {
+		mesh.skin(&palette[0], kSkinBoneCount, &out[0]);
+		benchUse(out[kSkinVertexCount - 1].p.x);
+	});
+
+	double	dq = run.time("dual quaternion palette", kSkinVertexCount, [&]() {
+		mesh.skin(&dqPalette[0], kSkinBoneCount, &out[0]);
+		benchUse(out[kSkinVertexCount - 1].p.x);
+	});
+
+	run.report("dual quaternion / matrix time", dq / matrix, "x");
+}
@@ -0,0 +1,349 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchSplinePath.cpp - Benchmarks and checks for spline paths
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "EulerAngles.h"
+#include "MathUtil.h"
+#include "Matrix4x3.h"
+#include "SplinePath.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Most of the paths are Catmull-Rom splines through random points, some
+// open and some closed, so the segments vary a lot in length and
+// curvature.  One follows a "walk" that turns gently, like an authored
+// camera path.
+//
+// Constant speed is checked against a reference arc length, found by
+// summing a million chords.  Stepping along the path in equal distances
+// should cover equal lengths of the curve.  Stepping in equal parameter
+// increments is shown for comparison.  The distance error is how far
+// along the path we end up from where we asked to be.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kPathPoints = 16;
+const int	kPathCount = 64;
+const int	kSampleCount = 16384;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randPoints
+//
+// Points for a path, wandering around a box
+
+static void	randPoints(Vector3 *p, int n) {
+	for (int i = 0 ; i < n ; ++i) {
+		p[i] = Vector3(randFloat(-100.0f, 100.0f), randFloat(-20.0f, 20.0f), randFloat(-100.0f, 100.0f));
+	}
+}
+
+//---------------------------------------------------------------------------
+// walkPoints
+//
+// Points for a path more like a camera flight: each one a short hop from
+// the last, turning a little each time
+
+static void	walkPoints(Vector3 *p, int n) {
+	float	heading = randFloat(-kPi, kPi);
+	p[0] = kZeroVector;
+	for (int i = 1 ; i < n ; ++i) {
+		heading += randFloat(-0.8f, 0.8f);
+		float	hop = randFloat(20.0f, 40.0f);
+		p[i] = p[i - 1] + Vector3(sin(heading) * hop, randFloat(-5.0f, 5.0f), cos(heading) * hop);
+	}
+}
+
+//---------------------------------------------------------------------------
+// ReferenceArc
+//
+// The distance along a path to any parameter, from summing a great many
+// chords in double precision
+
+struct ReferenceArc {
+	enum { kSteps = 1 << 20 };
+	const SplinePath	&path;
+	std::vector<double>	total;
+
+	explicit ReferenceArc(const SplinePath &p) : path(p), total(kSteps + 1) {
+		total[0] = 0.0;
+		Vector3	prev = path.getPosition(0.0f);
+		for (int i = 1 ; i <= kSteps ; ++i) {
+			Vector3	q = path.getPosition((float)((double)i / kSteps * path.getSegmentCount()));
+			double	dx = q.x - prev.x, dy = q.y - prev.y, dz = q.z - prev.z;
+			total[i] = total[i - 1] + sqrt(dx*dx + dy*dy + dz*dz);
+			prev = q;
+		}
+	}
+
+	double	length() const { return total[kSteps]; }
+
+	double	distanceAt(float u) const {
+		double	f = (double)u / path.getSegmentCount() * kSteps;
+		int	i = (int)f;
+		if (i >= kSteps) return total[kSteps];
+		return total[i] + (total[i + 1] - total[i]) * (f - i);
+	}
+};
+
+//---------------------------------------------------------------------------
+// maxSpeedError
+//
+// Step along a path in equal pieces, by distance or by parameter, and
+// return the largest relative difference between the distance
+// travelled in a step and the average
+
+static double	maxSpeedError(const ReferenceArc &arc, int count, bool byDistance) {
+	const SplinePath	&path = arc.path;
+	double	step = arc.length() / count;
+	double	worst = 0.0;
+	double	prev = 0.0;
+	for (int i = 1 ; i < count ; ++i) {
+		float	f = (float)i / (float)count;
+		float	u = byDistance ?
+			path.distanceToParameter(f * path.getLength()) :
+			f * (float)path.getSegmentCount();
+		double	s = arc.distanceAt(u);
+		worst = fmax(worst, fabs((s - prev) / step - 1.0));
+		prev = s;
+	}
+	return worst;
+}
+
+//---------------------------------------------------------------------------
+// maxDistanceError
+//
+// The largest difference between the distance asked for and the true
+// distance along the path to where we ended up
+
+static double	maxDistanceError(const ReferenceArc &arc, int count) {
+	double	worst = 0.0;
+	for (int i = 0 ; i < count ; ++i) {
+		float	d = arc.path.getLength() * (float)i / (float)count;
+		worst = fmax(worst, fabs(arc.distanceAt(arc.path.distanceToParameter(d)) - d));
+	}
+	return worst;
+}
+
+//---------------------------------------------------------------------------
+// Correctness
+
+BENCH(spline_path_check) {
+	srand(190);
+	Vector3		point[kPathPoints];
+	randPoints(point, kPathPoints);
+
+	SplinePath	open, loop;
+	open.setupCatmullRom(point, kPathPoints);
+	loop.setupCatmullRom(point, kPathPoints, true);
+
+	// The path must go through the points
+
+	float	throughError = 0.0f;
+	for (int i = 0 ; i < kPathPoints ; ++i) {
+		throughError = fmax(throughError, distance(open.getPosition((float)i), point[i]));
+		throughError = fmax(throughError, distance(loop.getPosition((float)i), point[i]));
+	}
+	throughError = fmax(throughError, distance(loop.getPosition((float)kPathPoints), point[0]));
+	run.report("max distance from points", throughError, "");
+
+	// Total length, and how far we are from where we asked to be.
+	// The random points make for some very tight corners, which are
+	// the hardest case; the walk is more typical.
+
+	Vector3		walk[kPathPoints];
+	walkPoints(walk, kPathPoints);
+	SplinePath	smooth;
+	smooth.setupCatmullRom(walk, kPathPoints);
+
+	ReferenceArc	openArc(open), loopArc(loop), smoothArc(smooth);
+	run.report("length relative error", fabs(open.getLength() - openArc.length()) / openArc.length(), "");
+	run.report("max distance error", maxDistanceError(openArc, 65536), "");
+	run.report("max distance error, closed", maxDistanceError(loopArc, 65536), "");
+	run.report("max distance error, walk", maxDistanceError(smoothArc, 65536), "");
+
+	// Speed when stepping by distance and by parameter
+
+	run.report("speed error, by distance", maxSpeedError(openArc, 4096, true), "");
+	run.report("speed error, by distance, closed", maxSpeedError(loopArc, 4096, true), "");
+	run.report("speed error, by distance, walk", maxSpeedError(smoothArc, 4096, true), "");
+	run.report("speed error, by parameter", maxSpeedError(openArc, 4096, false), "");
+	run.report("speed error, by parameter, walk", maxSpeedError(smoothArc, 4096, false), "");
+
+	// The table grows where the path nearly stops, and a tighter
+	// tolerance makes it grow more.  The error the table reports is
+	// relative to the tolerance, so over 1 means it ran out of room.
+
+	int	segments = open.getSegmentCount();
+	run.report("table entries per segment", (double)(open.getArcTableSize() - 1) / segments, "");
+	run.report("table entries per segment, closed", (double)(loop.getArcTableSize() - 1) / loop.getSegmentCount(), "");
+	run.report("table entries per segment, walk", (double)(smooth.getArcTableSize() - 1) / segments, "");
+	run.report("table error / tolerance", open.getArcLengthError() / open.getArcLengthTolerance(), "");
+	run.report("table error / tolerance, closed", loop.getArcLengthError() / loop.getArcLengthTolerance(), "");
+	run.report("table error / tolerance, walk", smooth.getArcLengthError() / smooth.getArcLengthTolerance(), "");
+	open.setArcLengthTolerance(1e-5f);
+	loop.setArcLengthTolerance(1e-5f);
+	run.report("table entries per segment, tight", (double)(open.getArcTableSize() - 1) / segments, "");
+	run.report("table error / tolerance, tight", open.getArcLengthError() / open.getArcLengthTolerance(), "");
+	run.report("table error / tolerance, closed, tight", loop.getArcLengthError() / loop.getArcLengthTolerance(), "");
+	run.report("max distance error, tight", maxDistanceError(openArc, 65536), "");
+	run.report("max distance error, closed, tight", maxDistanceError(loopArc, 65536), "");
+	run.report("speed error, by distance, tight", maxSpeedError(openArc, 4096, true), "");
+
+	// Far tighter than float can do runs out of room, and has to say so
+
+	open.setArcLengthTolerance(1e-8f);
+	run.report("table entries per segment, at limit", (double)(open.getArcTableSize() - 1) / segments, "");
+	run.report("table error / tolerance, at limit", open.getArcLengthError() / open.getArcLengthTolerance(), "");
+	open.setArcLengthTolerance(SplinePath().getArcLengthTolerance());
+	loop.setArcLengthTolerance(SplinePath().getArcLengthTolerance());
+
+	// Distances off the end clamp, or wrap on the closed path
+
+	float	endError = distance(open.getPositionAtDistance(open.getLength() * 1.5f), point[kPathPoints - 1]);
+	endError = fmax(endError, distance(open.getPositionAtDistance(-10.0f), point[0]));
+	endError = fmax(endError, distance(loop.getPositionAtDistance(loop.getLength() * 2.0f + 1.0f),
+		loop.getPositionAtDistance(1.0f)));
+	run.report("clamp/wrap error", endError, "");
+
+	// The camera should look along the path
+
+	float	cameraError = 0.0f;
+	for (int i = 0 ; i <= 256 ; ++i) {
+		float		d = open.getLength() * (float)i / 256.0f;
+		EulerAngles	orient;
+		open.getCameraOrientation(d, orient);
+		Matrix4x3	m;
+		m.setupLocalToParent(kZeroVector, orient);
+		Vector3		forward = Vector3(0.0f, 0.0f, 1.0f) * m;
+		cameraError = fmax(cameraError, distance(forward, open.getDirectionAtDistance(d)));
+	}
+	run.report("camera forward error", cameraError, "");
+
+	// The batch versions should agree with the scalar ones
+
+	std::vector<float>	d(kSampleCount);
+	std::vector<Vector3>	p(kSampleCount);
+	for (int i = 0 ; i < kSampleCount ; ++i) {
+		d[i] = randFloat(-10.0f, open.getLength() + 10.0f);
+	}
+	open.getPositionsAtDistance(&d[0], &p[0], kSampleCount);
+	float	batchError = 0.0f;
+	for (int i = 0 ; i < kSampleCount ; ++i) {
+		batchError = fmax(batchError, distance(p[i], open.getPositionAtDistance(d[i])));
+	}
+	run.report("batch vs scalar max error", batchError, "");
+
+	SplinePath	*paths = new SplinePath[kPathCount];
+	std::vector<const SplinePath *>	which(kSampleCount);
+	for (int i = 0 ; i < kPathCount ; ++i) {
+		randPoints(point, kPathPoints);
+		paths[i].setupCatmullRom(point, kPathPoints, (i & 1) != 0);
+	}
+	for (int i = 0 ; i < kSampleCount ; ++i) {
+		which[i] = &paths[rand() % kPathCount];
+		d[i] = randFloat(0.0f, which[i]->getLength() * 2.0f);
+	}
+	getPositionsAtDistance(&which[0], &d[0], &p[0], kSampleCount);
+	batchError = 0.0f;
+	for (int i = 0 ; i < kSampleCount ; ++i) {
+		batchError = fmax(batchError, distance(p[i], which[i]->getPositionAtDistance(d[i])));
+	}
+	run.report("many paths batch vs scalar max error", batchError, "");
+	delete [] paths;
+}
+
+//---------------------------------------------------------------------------
+// Throughput
+
+BENCH(spline_path) {
+	srand(191);
+	Vector3		point[kPathPoints];
+	randPoints(point, kPathPoints);
+
+	SplinePath	path;
+	run.time("setupCatmullRom", 1, [&]() {
+		path.setupCatmullRom(point, kPathPoints);
+		benchUse(path.getLength());
+	});
+	path.setArcLengthTolerance(1e-5f);
+	run.time("setupCatmullRom, tight", 1, [&]() {
+		path.setupCatmullRom(point, kPathPoints);
+		benchUse(path.getLength());
+	});
+	run.report("table bytes per segment, tight",
+		(double)(path.getArcTableSize() * 3 + path.getArcCellCount() + 3) * sizeof(float)
+		/ path.getSegmentCount(), "");
+	path.setArcLengthTolerance(SplinePath().getArcLengthTolerance());
+
+	std::vector<float>	d(kSampleCount);
+	std::vector<Vector3>	p(kSampleCount);
+	for (int i = 0 ; i < kSampleCount ; ++i) {
+		d[i] = randFloat(0.0f, path.getLength());
+	}
+
+	run.time("getPosition", kSampleCount, [&]() {
+		float	scale = (float)path.getSegmentCount() / path.getLength();
+		for (int i = 0 ; i < kSampleCount ; ++i) {
+			p[i] = path.getPosition(d[i] * scale);
+		}
+		benchUse(p[kSampleCount - 1].x);
+	});
+	double	single = run.time("getPositionAtDistance", kSampleCount, [&]() {
+		for (int i = 0 ; i < kSampleCount ; ++i) {
+			p[i] = path.getPositionAtDistance(d[i]);
+		}
+		benchUse(p[kSampleCount - 1].x);
+	});
+	double	batch = run.time("getPositionsAtDistance", kSampleCount, [&]() {
+		path.getPositionsAtDistance(&d[0], &p[0], kSampleCount);
+		benchUse(p[kSampleCount - 1].x);
+	});
+	run.report("one path batch speedup", single / batch, "x");
+
+	// A crowd, each following its own path
+
+	SplinePath	*paths = new SplinePath[kPathCount];
+	std::vector<const SplinePath *>	which(kSampleCount);
+	for (int i = 0 ; i < kPathCount ; ++i) {
+		randPoints(point, kPathPoints);
+		paths[i].setupCatmullRom(point, kPathPoints, true);
+	}
+	for (int i = 0 ; i < kSampleCount ; ++i) {
+		which[i] = &paths[i % kPathCount];
+		d[i] = randFloat(0.0f, which[i]->getLength());
+	}
+	single = run.time("many paths, loop", kSampleCount, [&]() {
+		for (int i = 0 ; i < kSampleCount ; ++i) {
+			p[i] = which[i]->getPositionAtDistance(d[i]);
+		}
+		benchUse(p[kSampleCount - 1].x);
+	});
+	batch = run.time("many paths, batch", kSampleCount, [&]() {
+		getPositionsAtDistance(&which[0], &d[0], &p[0], kSampleCount);
+		benchUse(p[kSampleCount - 1].x);
+	});
+	run.report("many paths batch speedup", single / batch, "x");
+	delete [] paths;
+}
@@ -0,0 +1,273 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchSquad.cpp - Benchmarks and checks for squad interpolation
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "AnimationClip.h"
+#include "EulerAngles.h"
+#include "Matrix4x3.h"
+#include "MatrixDecompose.h"
+#include "Quaternion.h"
+#include "QuaternionBatch.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The check follows a smooth reference path, a tumbling orientation
+// built from Euler angles that vary sinusoidally, and keys it two ways:
+// with squad and a few keys, and with slerp and four times as many.  The
+// errors are the largest angle between the interpolated orientation and
+// the reference.
+//
+// The "velocity jump" is the largest change in angular velocity across a
+// key, measured with finite differences.  Slerp changes direction
+// abruptly at every key; squad should not.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kSquadCount = 4096;
+const int	kPathKeys = 16;
+const int	kPathSamples = 4096;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randQuaternion
+//
+// Random unit quaternion
+
+static Quaternion	randQuaternion() {
+	Quaternion	q;
+	q.w = randFloat(-1.0f, 1.0f);
+	q.x = randFloat(-1.0f, 1.0f);
+	q.y = randFloat(-1.0f, 1.0f);
+	q.z = randFloat(-1.0f, 1.0f);
+	q.normalize();
+	return q;
+}
+
+//---------------------------------------------------------------------------
+// angleBetween
+//
+// Angle of the rotation from a to b, in radians.  This is computed from
+// the whole relative rotation b a*, in double precision, since the acos
+// of a float dot product can't resolve small angles.
+
+static double	angleBetween(const Quaternion &a, const Quaternion &b) {
+	double	w = (double)a.w*b.w + (double)a.x*b.x + (double)a.y*b.y + (double)a.z*b.z;
+	double	x = (double)a.w*b.x - (double)a.x*b.w + (double)a.y*b.z - (double)a.z*b.y;
+	double	y = (double)a.w*b.y - (double)a.y*b.w + (double)a.z*b.x - (double)a.x*b.z;
+	double	z = (double)a.w*b.z - (double)a.z*b.w + (double)a.x*b.y - (double)a.y*b.x;
+	return 2.0 * atan2(sqrt(x*x + y*y + z*z), fabs(w));
+}
+
+//---------------------------------------------------------------------------
+// referencePath
+//
+// The orientation at s in [0, 1] along the smooth path
+
+static Quaternion	referencePath(float s) {
+	EulerAngles	e(
+		3.0f * sin(2.0f * s) + 1.5f * s,
+		0.8f * sin(5.0f * s),
+		1.2f * cos(3.0f * s)
+	);
+	Quaternion	q;
+	q.setToRotateObjectToInertial(e);
+	return q;
+}
+
+//---------------------------------------------------------------------------
+// PathKeys
+//
+// Keys sampled from the reference path at even intervals, with or
+// without squad tangents
+
+struct PathKeys {
+	std::vector<Quaternion>	key;
+	std::vector<Quaternion>	tangent;
+
+	explicit PathKeys(int n) : key(n), tangent(n) {
+		for (int i = 0 ; i < n ; ++i) {
+			key[i] = referencePath((float)i / (float)(n - 1));
+		}
+		computeSquadTangents(&key[0], &tangent[0], n);
+	}
+
+	Quaternion	evaluate(float s, bool useSquad) const {
+		int	n = (int)key.size();
+		float	f = s * (float)(n - 1);
+		int	k = (int)f;
+		if (k > n - 2) k = n - 2;
+		f -= (float)k;
+		return useSquad ?
+			squad(key[k], tangent[k], tangent[k + 1], key[k + 1], f) :
+			slerp(key[k], key[k + 1], f);
+	}
+};
+
+//---------------------------------------------------------------------------
+// maxVelocityJump
+//
+// The largest change in angular velocity across an interior key
+
+static double	maxVelocityJump(const PathKeys &keys, bool useSquad) {
+	int	n = (int)keys.key.size();
+	float	h = 1e-3f / (float)(n - 1);
+	double	worst = 0.0;
+	for (int k = 1 ; k < n - 1 ; ++k) {
+		float	s = (float)k / (float)(n - 1);
+		Quaternion	before = keys.evaluate(s - h, useSquad);
+		Quaternion	at = keys.evaluate(s, useSquad);
+		Quaternion	after = keys.evaluate(s + h, useSquad);
+
+		// Angular velocity vectors from the log of each step
+
+		Quaternion	w0 = log(at * conjugate(before));
+		Quaternion	w1 = log(after * conjugate(at));
+		if (dotProduct(at, before) < 0.0f) { w0.x = -w0.x; w0.y = -w0.y; w0.z = -w0.z; }
+		if (dotProduct(after, at) < 0.0f) { w1.x = -w1.x; w1.y = -w1.y; w1.z = -w1.z; }
+		double	dx = w1.x - w0.x, dy = w1.y - w0.y, dz = w1.z - w0.z;
+		double	mag = sqrt(w0.x*w0.x + w0.y*w0.y + w0.z*w0.z);
+		double	jump = sqrt(dx*dx + dy*dy + dz*dz) / (mag > 1e-12 ? mag : 1e-12);
+		if (jump > worst) worst = jump;
+	}
+	return worst;
+}
+
+//---------------------------------------------------------------------------
+// Correctness and smoothness
+
+BENCH(quaternion_squad_check) {
+
+	// Few squad keys against many slerp keys
+
+	PathKeys	sparse(kPathKeys), dense(kPathKeys * 4);
+	double		squadError = 0.0, slerpError = 0.0, denseSlerpError = 0.0;
+	for (int i = 0 ; i <= kPathSamples ; ++i) {
+		float		s = (float)i / (float)kPathSamples;
+		Quaternion	ref = referencePath(s);
+		squadError = fmax(squadError, angleBetween(ref, sparse.evaluate(s, true)));
+		slerpError = fmax(slerpError, angleBetween(ref, sparse.evaluate(s, false)));
+		denseSlerpError = fmax(denseSlerpError, angleBetween(ref, dense.evaluate(s, false)));
+	}
+	run.report("squad, 16 keys, max error", squadError, "rad");
+	run.report("slerp, 16 keys, max error", slerpError, "rad");
+	run.report("slerp, 64 keys, max error", denseSlerpError, "rad");
+	run.report("squad velocity jump at keys", maxVelocityJump(sparse, true), "");
+	run.report("slerp velocity jump at keys", maxVelocityJump(sparse, false), "");
+
+	// Squad must pass through the keys
+
+	double	keyError = 0.0;
+	for (int k = 0 ; k < kPathKeys - 1 ; ++k) {
+		keyError = fmax(keyError, angleBetween(sparse.key[k],
+			squad(sparse.key[k], sparse.tangent[k], sparse.tangent[k + 1], sparse.key[k + 1], 0.0f)));
+		keyError = fmax(keyError, angleBetween(sparse.key[k + 1],
+			squad(sparse.key[k], sparse.tangent[k], sparse.tangent[k + 1], sparse.key[k + 1], 1.0f)));
+	}
+	run.report("squad error at keys", keyError, "rad");
+
+	// The batch versions against squad()
+
+	srand(180);
+	std::vector<Quaternion>	q0(kSquadCount), a0(kSquadCount), a1(kSquadCount), q1(kSquadCount);
+	std::vector<Quaternion>	r(kSquadCount);
+	std::vector<float>	t(kSquadCount);
+	for (int i = 0 ; i < kSquadCount ; ++i) {
+		Quaternion	prev = randQuaternion(), next = randQuaternion();
+		q0[i] = randQuaternion();
+		q1[i] = randQuaternion();
+		a0[i] = squadTangent(prev, q0[i], q1[i]);
+		a1[i] = squadTangent(q0[i], q1[i], next);
+		t[i] = randFloat(0.0f, 1.0f);
+	}
+	for (int mode = eSlerpModeExact ; mode <= eSlerpModeFast ; ++mode) {
+		squadBatch(&q0[0], &a0[0], &a1[0], &q1[0], &t[0], &r[0], kSquadCount, (ESlerpMode)mode);
+		double	batchError = 0.0;
+		for (int i = 0 ; i < kSquadCount ; ++i) {
+			batchError = fmax(batchError, angleBetween(r[i], squad(q0[i], a0[i], a1[i], q1[i], t[i])));
+		}
+		run.report(mode == eSlerpModeExact ? "squadBatch exact vs squad" : "squadBatch fast vs squad",
+			batchError, "rad");
+	}
+
+	// An animation clip keyed with squad should play back the same path
+
+	AnimationClip	clip;
+	int		keyCount = kPathKeys;
+	clip.setRotationInterpolation(eRotationSquad);
+	clip.allocateMemory(1, &keyCount);
+	for (int k = 0 ; k < kPathKeys ; ++k) {
+		clip.setKey(0, k, (float)k, sparse.key[k], kZeroVector);
+	}
+	AnimationSampler	sampler;
+	sampler.bind(&clip);
+	double	clipError = 0.0;
+	for (int i = 0 ; i <= kPathSamples ; ++i) {
+		float		s = (float)i / (float)kPathSamples;
+		Matrix4x3	m;
+		sampler.sample(s * (float)(kPathKeys - 1), &m, eSlerpModeExact);
+		clipError = fmax(clipError, angleBetween(rotationFromMatrix(m), sparse.evaluate(s, true)));
+	}
+	run.report("clip sample vs squad", clipError, "rad");
+}
+
+//---------------------------------------------------------------------------
+// Throughput
+
+BENCH(quaternion_squad) {
+	srand(181);
+	std::vector<Quaternion>	q0(kSquadCount), a0(kSquadCount), a1(kSquadCount), q1(kSquadCount);
+	std::vector<Quaternion>	r(kSquadCount);
+	std::vector<float>	t(kSquadCount);
+	for (int i = 0 ; i < kSquadCount ; ++i) {
+		q0[i] = randQuaternion();
+		q1[i] = randQuaternion();
+		a0[i] = squadTangent(randQuaternion(), q0[i], q1[i]);
+		a1[i] = squadTangent(q0[i], q1[i], randQuaternion());
+		t[i] = randFloat(0.0f, 1.0f);
+	}
+
+	double	scalar = run.time("scalar squad", kSquadCount, [&]() {
+		for (int i = 0 ; i < kSquadCount ; ++i) {
+			r[i] = squad(q0[i], a0[i], a1[i], q1[i], t[i]);
+		}
+		benchUse(r[kSquadCount - 1].w);
+	});
+	double	exact = run.time("squadBatch exact", kSquadCount, [&]() {
+		squadBatch(&q0[0], &a0[0], &a1[0], &q1[0], &t[0], &r[0], kSquadCount, eSlerpModeExact);
+		benchUse(r[kSquadCount - 1].w);
+	});
+	double	fast = run.time("squadBatch fast", kSquadCount, [&]() {
+		squadBatch(&q0[0], &a0[0], &a1[0], &q1[0], &t[0], &r[0], kSquadCount, eSlerpModeFast);
+		benchUse(r[kSquadCount - 1].w);
+	});
+	run.report("exact batch speedup", scalar / exact, "x");
+	run.report("fast batch speedup", scalar / fast, "x");
+
+	run.time("squadTangent", kSquadCount, [&]() {
+		for (int i = 1 ; i < kSquadCount - 1 ; ++i) {
+			r[i] = squadTangent(q0[i - 1], q0[i], q0[i + 1]);
+		}
+		benchUse(r[kSquadCount - 2].w);
+	});
+}
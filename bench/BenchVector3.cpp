@@ -0,0 +1,171 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchVector3.cpp - Benchmarks for the vector operations
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <stdlib.h>
+#include <vector>
+
+#include "Bench.h"
+#include "Vector3Array.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// The chain p + v*dt is the usual integration step.  It's timed with the
+// operators, with madd(), and over Vector3Arrays, both as the two
+// seperate passes scale() and add() and as one fused madd() pass.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kVectorCount = 65536;
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// The basic operations, one vector at a time and over Vector3Arrays
+
+BENCH(vector3_ops) {
+	srand(19);
+	std::vector<Vector3>	a(kVectorCount), b(kVectorCount), out(kVectorCount);
+	std::vector<float>	d(kVectorCount);
+	for (int i = 0 ; i < kVectorCount ; ++i) {
+		a[i] = Vector3(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f));
+		b[i] = Vector3(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f));
+	}
+	Vector3Array	aa, ba, ra;
+	aa.gather(&a[0], kVectorCount);
+	ba.gather(&b[0], kVectorCount);
+
+	run.time("Vector3 +", kVectorCount, [&]() {
+		for (int i = 0 ; i < kVectorCount ; ++i) {
+			out[i] = a[i] + b[i];
+		}
+		benchUse(out[kVectorCount - 1].x);
+	});
+	run.time("add arrays", kVectorCount, [&]() {
+		add(ra, aa, ba);
+		benchUse(ra.x[kVectorCount - 1]);
+	});
+
+	run.time("Vector3 dot", kVectorCount, [&]() {
+		for (int i = 0 ; i < kVectorCount ; ++i) {
+			d[i] = a[i] * b[i];
+		}
+		benchUse(d[kVectorCount - 1]);
+	});
+	run.time("dotProduct arrays", kVectorCount, [&]() {
+		dotProduct(&d[0], aa, ba);
+		benchUse(d[kVectorCount - 1]);
+	});
+
+	run.time("crossProduct", kVectorCount, [&]() {
+		for (int i = 0 ; i < kVectorCount ; ++i) {
+			out[i] = crossProduct(a[i], b[i]);
+		}
+		benchUse(out[kVectorCount - 1].x);
+	});
+	run.time("crossProduct arrays", kVectorCount, [&]() {
+		crossProduct(ra, aa, ba);
+		benchUse(ra.x[kVectorCount - 1]);
+	});
+
+	run.time("Vector3::normalize", kVectorCount, [&]() {
+		for (int i = 0 ; i < kVectorCount ; ++i) {
+			out[i] = a[i];
+			out[i].normalize();
+		}
+		benchUse(out[kVectorCount - 1].x);
+	});
+	run.time("normalize arrays", kVectorCount, [&]() {
+		ra = aa;
+		normalize(ra);
+		benchUse(ra.x[kVectorCount - 1]);
+	});
+
+	// A vector should come out the same wherever it is in the array,
+	// including the last few, which don't fill a whole block
+
+	int	tailMismatches = 0;
+	for (int i = 0 ; i < 64 ; ++i) {
+		Vector3Array	one;
+		one.gather(&a[i], 1);
+		normalize(one);
+		if (one.get(0) != ra.get(i)) {
+			++tailMismatches;
+		}
+	}
+	run.report("normalize tail mismatches", tailMismatches, "");
+}
+
+//---------------------------------------------------------------------------
+// Operator chains against the fused versions
+
+BENCH(vector3_madd) {
+	srand(16);
+	std::vector<Vector3>	p(kVectorCount), v(kVectorCount), out(kVectorCount);
+	for (int i = 0 ; i < kVectorCount ; ++i) {
+		p[i] = Vector3(randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f));
+		v[i] = Vector3(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f));
+	}
+	const float	dt = 1.0f / 60.0f;
+
+	run.time("p + v*dt operators", kVectorCount, [&]() {
+		for (int i = 0 ; i < kVectorCount ; ++i) {
+			out[i] = p[i] + v[i]*dt;
+		}
+		benchUse(out[kVectorCount - 1].x);
+	});
+	run.time("madd(p, v, dt)", kVectorCount, [&]() {
+		for (int i = 0 ; i < kVectorCount ; ++i) {
+			out[i] = madd(p[i], v[i], dt);
+		}
+		benchUse(out[kVectorCount - 1].x);
+	});
+
+	Vector3Array	pa, va, ra, tmp;
+	pa.gather(&p[0], kVectorCount);
+	va.gather(&v[0], kVectorCount);
+	double	twoPass = run.time("scale + add arrays", kVectorCount, [&]() {
+		scale(tmp, va, dt);
+		add(ra, pa, tmp);
+		benchUse(ra.x[kVectorCount - 1]);
+	});
+	double	fused = run.time("madd arrays", kVectorCount, [&]() {
+		madd(ra, pa, va, dt);
+		benchUse(ra.x[kVectorCount - 1]);
+	});
+	run.report("fused speedup", twoPass / fused, "x");
+
+	// The batch results should match the scalar ones, give or take the
+	// rounding of a fused multiply-add
+
+	float	maxError = 0.0f;
+	for (int i = 0 ; i < kVectorCount ; ++i) {
+		float	e = distance(ra.get(i), madd(p[i], v[i], dt));
+		if (e > maxError) maxError = e;
+	}
+	run.report("batch vs scalar max error", maxError, "");
+
+	std::vector<float>	t(kVectorCount);
+	for (int i = 0 ; i < kVectorCount ; ++i) {
+		t[i] = randFloat(0.0f, 1.0f);
+	}
+	run.time("lerp arrays", kVectorCount, [&]() {
+		lerp(ra, pa, va, &t[0]);
+		benchUse(ra.x[kVectorCount - 1]);
+	});
+}
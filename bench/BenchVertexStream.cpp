@@ -0,0 +1,330 @@
+/////////////////////////////////////////////////////////////////////////////
+//
+// 3D Math Primer for Games and Graphics Development
+//
+// BenchVertexStream.cpp - Benchmarks and checks for the vertex stream
+// kernels
+//
+// Visit gamemath.com for the latest version of this file.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+#include <math.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "Bench.h"
+#include "EditTriMesh.h"
+#include "EulerAngles.h"
+#include "MathUtil.h"
+#include "Matrix4x3.h"
+#include "Matrix4x3Batch.h"
+#include "Renderer.h"
+#include "VertexStream.h"
+
+/////////////////////////////////////////////////////////////////////////////
+//
+// Notes:
+//
+// Each kernel is run over all four vertex formats and checked against a
+// plain loop doing the same thing one vertex at a time.  The timings
+// compare that loop, the runtime stride kernels from Matrix4x3Batch.h,
+// and the stream kernels, for the smallest and largest vertex.
+//
+/////////////////////////////////////////////////////////////////////////////
+
+const int	kVertexCount = 65536 + 3;	// not a multiple of any SIMD width
+
+//---------------------------------------------------------------------------
+// randFloat
+//
+// Random number in [lo, hi]
+
+static float	randFloat(float lo, float hi) {
+	return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+//---------------------------------------------------------------------------
+// randUnitVector
+//
+// Random direction
+
+static Vector3	randUnitVector() {
+	Vector3	v(randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f), randFloat(-1.0f, 1.0f));
+	v.normalize();
+	return v;
+}
+
+//---------------------------------------------------------------------------
+// randMatrix
+//
+// Random rotation and translation
+
+static Matrix4x3	randMatrix() {
+	Matrix4x3	m;
+	m.setupLocalToParent(
+		Vector3(randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f), randFloat(-10.0f, 10.0f)),
+		EulerAngles(randFloat(-kPi, kPi), randFloat(-kPiOver2, kPiOver2), randFloat(-kPi, kPi))
+	);
+	return m;
+}
+
+//---------------------------------------------------------------------------
+// identityMatrix
+//
+// For points already in camera space
+
+static Matrix4x3	identityMatrix() {
+	Matrix4x3	m;
+	m.identity();
+	return m;
+}
+
+//---------------------------------------------------------------------------
+// checkFormat
+//
+// Run the kernels over one vertex format and report the largest
+// differences from the one-at-a-time versions.  The vertices are laid out
+// in a cloud in front of a camera at the origin, with some off the edges
+// and some behind.
+
+template <class Vertex>
+static void	checkFormat(BenchRun &run, const char *name, std::vector<Vertex> &v, Vector3 Vertex::*normal) {
+	int	n = (int)v.size();
+	for (int i = 0 ; i < n ; ++i) {
+		v[i].p = Vector3(randFloat(-60.0f, 60.0f), randFloat(-40.0f, 40.0f), randFloat(-10.0f, 200.0f));
+		if (normal != NULL) {
+			v[i].*normal = randUnitVector();
+		}
+	}
+	std::vector<Vertex>	orig(v);
+	Matrix4x3	m = randMatrix();
+	std::string	label(name);
+
+	// Transform in place, and back out to a separate array
+
+	transformPoints(m, vertexStream(&v[0], &Vertex::p, n), vertexStream(&v[0], &Vertex::p, n));
+	float	e = 0.0f;
+	for (int i = 0 ; i < n ; ++i) {
+		e = fmax(e, distance(v[i].p, orig[i].p * m));
+	}
+	std::vector<Vector3>	p(n);
+	transformVectors(m, vertexStream((const Vertex *)&orig[0], &Vertex::p, n),
+		VertexStream<Vector3, sizeof(Vector3)>(&p[0], n));
+	for (int i = 0 ; i < n ; ++i) {
+		e = fmax(e, distance(p[i], orig[i].p * m - getTranslation(m)));
+	}
+	run.report((label + " transform max error").c_str(), e, "");
+
+	// Bounds
+
+	AABB3	box;
+	box.empty();
+	for (int i = 0 ; i < n ; ++i) {
+		box.add(orig[i].p);
+	}
+	AABB3	streamBox = computeBounds(vertexStream((const Vertex *)&orig[0], &Vertex::p, n));
+	run.report((label + " bounds error").c_str(), distance(box.min, streamBox.min) + distance(box.max, streamBox.max), "");
+
+	// Projection, against the Renderer's formulas with the frustum
+	// planes where they should be
+
+	StreamProjection	proj;
+	proj.setup(1.5f, 2.0f, 1.0f, 150.0f, 0, 0, 640, 480);
+	std::vector<Vector3>	screen(n);
+	std::vector<float>	oow(n);
+	std::vector<int>	code(n);
+	projectPoints(identityMatrix(), proj, vertexStream((const Vertex *)&orig[0], &Vertex::p, n),
+		VertexStream<Vector3, sizeof(Vector3)>(&screen[0], n),
+		VertexStream<float, sizeof(float)>(&oow[0], n), &code[0]);
+	int	codeErrors = 0, onScreen = 0;
+	e = 0.0f;
+	for (int i = 0 ; i < n ; ++i) {
+		const Vector3	&q = orig[i].p;
+		float	x = q.x * proj.zoomX, y = q.y * proj.zoomY, z = q.z * proj.zScale + proj.zOffset, w = q.z;
+		int	c = 0;
+		if (x < -w) c |= kOutCodeLeft;
+		if (x > w) c |= kOutCodeRight;
+		if (y < -w) c |= kOutCodeBottom;
+		if (y > w) c |= kOutCodeTop;
+		if (z < 0.0f) c |= kOutCodeNear;
+		if (z > w) c |= kOutCodeFar;
+		if (c != code[i]) {
+			++codeErrors;
+		}
+		if ((c & kOutCodeOffScreenMask) == 0) {
+			++onScreen;
+			Vector3	s(320.0f + x / w * 320.0f, 240.0f - y / w * 240.0f, z / w);
+			e = fmax(e, distance(s, screen[i]));
+			e = fmax(e, fabs(oow[i] - 1.0f / w));
+		}
+	}
+	run.report((label + " project max error").c_str(), e, "px");
+	run.report((label + " outcode mismatches").c_str(), codeErrors, "");
+	run.report((label + " fraction on screen").c_str(), (double)onScreen / n, "");
+
+	// Lighting, where there are normals
+
+	if (normal != NULL) {
+		Vector3		lightDir(0.707f, -0.707f, 0.0f);
+		unsigned	ambient = MAKE_RGB(64, 48, 32), directional = MAKE_RGB(192, 255, 100);
+		std::vector<unsigned>	argb(n);
+		lightVertices(vertexStream((const Vertex *)&orig[0], normal, n), lightDir, ambient, directional,
+			VertexStream<unsigned, sizeof(unsigned)>(&argb[0], n));
+		// The reference is in double precision, so a channel that's
+		// within float round off of halfway between two values can
+		// legitimately round either way.  Those are counted, not
+		// checked.
+
+		int	worst = 0, ties = 0;
+		for (int i = 0 ; i < n ; ++i) {
+			double	k = -((orig[i].*normal) * lightDir);
+			if (k < 0.0) k = 0.0;
+			for (int shift = 0 ; shift <= 16 ; shift += 8) {
+				double	c = ((ambient >> shift) & 0xff) + ((directional >> shift) & 0xff) * k;
+				if (fabs(c - floor(c) - .5) < 1e-4) {
+					++ties;
+					continue;
+				}
+				int	ref = (int)floor((c < 255.0 ? c : 255.0) + .5);
+				worst = std::max(worst, abs(ref - (int)((argb[i] >> shift) & 0xff)));
+			}
+			if ((argb[i] >> 24) != 0xff) {
+				worst = 256;
+			}
+		}
+		run.report((label + " lighting max channel error").c_str(), worst, "");
+		run.report((label + " lighting halfway channels").c_str(), ties, "");
+
+		// Vertices lit one at a time all go through the tail code,
+		// which must match the full blocks exactly
+
+		int	tailErrors = 0;
+		for (int i = 0 ; i < n && i < 256 ; ++i) {
+			unsigned	one;
+			lightVertices(vertexStream((const Vertex *)&orig[i], normal, 1), lightDir, ambient, directional,
+				VertexStream<unsigned, sizeof(unsigned)>(&one, 1));
+			if (one != argb[i]) {
+				++tailErrors;
+			}
+		}
+		run.report((label + " lighting tail mismatches").c_str(), tailErrors, "");
+	}
+}
+
+//---------------------------------------------------------------------------
+// Correctness
+
+BENCH(vertex_stream_check) {
+	srand(200);
+	std::vector<RenderVertex>		v(kVertexCount);
+	std::vector<RenderVertexL>		vl(kVertexCount);
+	std::vector<RenderVertexTL>		vtl(kVertexCount);
+	std::vector<EditTriMesh::Vertex>	ve(kVertexCount);
+	checkFormat(run, "RenderVertex", v, &RenderVertex::n);
+	checkFormat(run, "RenderVertexL", vl, (Vector3 RenderVertexL::*)NULL);
+	checkFormat(run, "RenderVertexTL", vtl, (Vector3 RenderVertexTL::*)NULL);
+	checkFormat(run, "EditTriMesh::Vertex", ve, &EditTriMesh::Vertex::normal);
+
+	// Light and project straight into RenderVertexTL, the way a software
+	// pipeline would
+
+	Matrix4x3	m = randMatrix();
+	StreamProjection	proj;
+	proj.setup(1.0f, 1.333f, 1.0f, 1000.0f, 0, 0, 640, 480);
+	int	all = projectPoints(m, proj, vertexStream((const RenderVertex *)&v[0], &RenderVertex::p, kVertexCount),
+		vertexStream(&vtl[0], &RenderVertexTL::p, kVertexCount),
+		vertexStream(&vtl[0], &RenderVertexTL::oow, kVertexCount));
+	lightVertices(vertexStream((const RenderVertex *)&v[0], &RenderVertex::n, kVertexCount),
+		Vector3(0.0f, -1.0f, 0.0f), MAKE_RGB(64, 64, 64), MAKE_RGB(192, 192, 192),
+		vertexStream(&vtl[0], &RenderVertexTL::argb, kVertexCount));
+	float	e = 0.0f;
+	for (int i = 0 ; i < kVertexCount ; ++i) {
+		float	w = (v[i].p * m).z;
+		if (w > 1.0f) {
+			e = fmax(e, fabs(vtl[i].oow * w - 1.0f));
+		}
+	}
+	run.report("RenderVertexTL oow relative error", e, "");
+	run.report("scattered cloud trivially rejected", all != 0 ? 1 : 0, "");
+
+	// A cloud entirely behind the camera is
+
+	for (int i = 0 ; i < kVertexCount ; ++i) {
+		v[i].p = Vector3(randFloat(-60.0f, 60.0f), randFloat(-40.0f, 40.0f), randFloat(-200.0f, -10.0f));
+	}
+	all = projectPoints(identityMatrix(), proj, vertexStream((const RenderVertex *)&v[0], &RenderVertex::p, kVertexCount),
+		vertexStream(&vtl[0], &RenderVertexTL::p, kVertexCount),
+		vertexStream(&vtl[0], &RenderVertexTL::oow, kVertexCount));
+	run.report("cloud behind camera outcodes", all, "");
+}
+
+//---------------------------------------------------------------------------
+// timeFormat
+//
+// Time transforming the positions of one vertex format three ways
+
+template <class Vertex>
+static void	timeFormat(BenchRun &run, const char *name) {
+	std::vector<Vertex>	v(kVertexCount), out(kVertexCount);
+	for (int i = 0 ; i < kVertexCount ; ++i) {
+		v[i].p = Vector3(randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f), randFloat(-100.0f, 100.0f));
+	}
+	Matrix4x3	m = randMatrix();
+	std::string	label(name);
+
+	double	loop = run.time((label + " loop").c_str(), kVertexCount, [&]() {
+		for (int i = 0 ; i < kVertexCount ; ++i) {
+			out[i].p = v[i].p * m;
+		}
+		benchUse(out[kVertexCount - 1].p.x);
+	});
+	double	strided = run.time((label + " runtime stride").c_str(), kVertexCount, [&]() {
+		transformPoints(m, &v[0].p, &out[0].p, kVertexCount, sizeof(Vertex), sizeof(Vertex));
+		benchUse(out[kVertexCount - 1].p.x);
+	});
+	double	stream = run.time((label + " stream").c_str(), kVertexCount, [&]() {
+		transformPoints(m, vertexStream((const Vertex *)&v[0], &Vertex::p, kVertexCount),
+			vertexStream(&out[0], &Vertex::p, kVertexCount));
+		benchUse(out[kVertexCount - 1].p.x);
+	});
+	run.report((label + " stream vs loop").c_str(), loop / stream, "x");
+	run.report((label + " stream vs runtime stride").c_str(), strided / stream, "x");
+
+	run.time((label + " bounds").c_str(), kVertexCount, [&]() {
+		AABB3	box = computeBounds(vertexStream((const Vertex *)&v[0], &Vertex::p, kVertexCount));
+		benchUse(box.max.x);
+	});
+}
+
+//---------------------------------------------------------------------------
+// Throughput
+
+BENCH(vertex_stream) {
+	srand(201);
+	timeFormat<RenderVertexL>(run, "RenderVertexL");
+	timeFormat<EditTriMesh::Vertex>(run, "EditTriMesh::Vertex");
+
+	// A whole software vertex pipeline, RenderVertex to RenderVertexTL
+
+	std::vector<RenderVertex>	v(kVertexCount);
+	std::vector<RenderVertexTL>	vtl(kVertexCount);
+	for (int i = 0 ; i < kVertexCount ; ++i) {
+		v[i].p = Vector3(randFloat(-60.0f, 60.0f), randFloat(-40.0f, 40.0f), randFloat(10.0f, 200.0f));
+		v[i].n = randUnitVector();
+	}
+	StreamProjection	proj;
+	proj.setup(1.0f, 1.333f, 1.0f, 1000.0f, 0, 0, 640, 480);
+	run.time("project and light RenderVertex", kVertexCount, [&]() {
+		int	all = projectPoints(identityMatrix(), proj,
+			vertexStream((const RenderVertex *)&v[0], &RenderVertex::p, kVertexCount),
+			vertexStream(&vtl[0], &RenderVertexTL::p, kVertexCount),
+			vertexStream(&vtl[0], &RenderVertexTL::oow, kVertexCount));
+		lightVertices(vertexStream((const RenderVertex *)&v[0], &RenderVertex::n, kVertexCount),
+			Vector3(0.0f, -1.0f, 0.0f), MAKE_RGB(64, 64, 64), MAKE_RGB(192, 192, 192),
+			vertexStream(&vtl[0], &RenderVertexTL::argb, kVertexCount));
+		benchUse(vtl[kVertexCount - 1].oow + (float)all);
+	});
+}